@@ -0,0 +1,435 @@
+/*
+ * Bench/BigNumBench.cc - Mereni rychlosti zakladnich operaci BigNum.
+ *
+ * Copyright (c) 2006 Jiri Zajpt, <jzajpt@blueberry.cz>
+ */
+
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <new>
+#ifdef WIN32
+#include <windows.h>
+#endif // WIN32
+#if defined( __GNUC__ ) && ( defined( __x86_64__ ) || defined( __i386__ ) )
+#include <x86intrin.h>
+#define BENCH_RDTSC
+#endif // __GNUC__
+#include "../BigNum/BigNum.h"
+
+
+using namespace std;
+
+
+/*
+ * Pocitadlo alokaci. NumberBuffer alokuje pres new[], takze staci
+ * prepsat globalni operatory new.
+ */
+static uint64_t gAllocations = 0;
+
+
+// Specifikace vyjimek se mezi verzemi C++ lisi
+#if __cplusplus >= 201103L
+#define BENCH_THROW_BAD_ALLOC
+#define BENCH_NOTHROW noexcept
+#else
+#define BENCH_THROW_BAD_ALLOC throw( std::bad_alloc )
+#define BENCH_NOTHROW throw()
+#endif
+
+
+void*
+operator new( size_t size ) BENCH_THROW_BAD_ALLOC
+{
+	gAllocations++;
+
+	void* p = malloc( size ? size : 1 );
+	if ( !p )
+		throw std::bad_alloc();
+
+	return p;
+}
+
+
+void*
+operator new[]( size_t size ) BENCH_THROW_BAD_ALLOC
+{
+	return operator new( size );
+}
+
+
+void
+operator delete( void* p ) BENCH_NOTHROW
+{
+	free( p );
+}
+
+
+void
+operator delete[]( void* p ) BENCH_NOTHROW
+{
+	free( p );
+}
+
+
+// Od C++14 prekladac vola i varianty s velikosti
+#if __cplusplus >= 201402L
+void
+operator delete( void* p, size_t ) BENCH_NOTHROW
+{
+	free( p );
+}
+
+
+void
+operator delete[]( void* p, size_t ) BENCH_NOTHROW
+{
+	free( p );
+}
+#endif // __cplusplus
+
+
+/**
+ * \brief Vraci monotonni cas v nanosekundach.
+ */
+static uint64_t
+GetNanoseconds( void )
+{
+#ifdef WIN32
+	LARGE_INTEGER counter, frequency;
+
+	QueryPerformanceCounter( &counter );
+	QueryPerformanceFrequency( &frequency );
+
+	return static_cast< uint64_t >( counter.QuadPart * 1e9 / frequency.QuadPart );
+#else
+	struct timespec ts;
+	clock_gettime( CLOCK_MONOTONIC, &ts );
+
+	return static_cast< uint64_t >( ts.tv_sec ) * 1000000000ULL + ts.tv_nsec;
+#endif // WIN32
+}
+
+
+/**
+ * \brief Vraci pocet taktu procesoru (0, pokud to nejde zjistit).
+ */
+static uint64_t
+GetCycles( void )
+{
+#ifdef BENCH_RDTSC
+	return __rdtsc();
+#else
+	return 0;
+#endif // BENCH_RDTSC
+}
+
+
+/**
+ * \brief Operandy jednoho mereni.
+ */
+struct BenchOperands
+{
+	BigNum mA;       // Nahodne cislo o dane delce
+	BigNum mB;       // Nahodne cislo o dane delce, mensi nez mA
+	BigNum mWide;    // Cislo o dvojnasobne delce (delenec)
+	BigNum mModulus; // Liche cislo o dane delce
+	BigNum mInvert;  // Cislo nesoudelne s mModulus
+};
+
+
+typedef uint32_t (*BenchFunc)( const BenchOperands& rOps );
+
+
+static uint32_t
+BenchAdd( const BenchOperands& rOps )
+{
+	return ( rOps.mA + rOps.mB ).GetDoubleWord( 0 );
+}
+
+
+static uint32_t
+BenchSub( const BenchOperands& rOps )
+{
+	return ( rOps.mA - rOps.mB ).GetDoubleWord( 0 );
+}
+
+
+static uint32_t
+BenchMul( const BenchOperands& rOps )
+{
+	return ( rOps.mA * rOps.mB ).GetDoubleWord( 0 );
+}
+
+
+static uint32_t
+BenchSquare( const BenchOperands& rOps )
+{
+	return ( rOps.mA * rOps.mA ).GetDoubleWord( 0 );
+}
+
+
+static uint32_t
+BenchDivide( const BenchOperands& rOps )
+{
+	BigNum q, r;
+
+	BigNum::Divide( rOps.mWide, rOps.mA, q, r );
+
+	return q.GetDoubleWord( 0 ) ^ r.GetDoubleWord( 0 );
+}
+
+
+static uint32_t
+BenchShift( const BenchOperands& rOps )
+{
+	return ( ( rOps.mA << 37 ) >> 71 ).GetDoubleWord( 0 );
+}
+
+
+static uint32_t
+BenchGcd( const BenchOperands& rOps )
+{
+	return BigNum::Gcd( rOps.mA, rOps.mB ).GetDoubleWord( 0 );
+}
+
+
+static uint32_t
+BenchModularInverse( const BenchOperands& rOps )
+{
+	return BigNum::ModularInverse( rOps.mInvert, rOps.mModulus ).GetDoubleWord( 0 );
+}
+
+
+static uint32_t
+BenchModularExponentiation( const BenchOperands& rOps )
+{
+	return BigNum::ModularExponentiation( rOps.mA, rOps.mB, rOps.mModulus ).GetDoubleWord( 0 );
+}
+
+
+struct BenchCase
+{
+	const char* mpName;
+	BenchFunc   mpFunc;
+};
+
+
+static const BenchCase cBenchCases[] =
+{
+	{ "add",    BenchAdd },
+	{ "sub",    BenchSub },
+	{ "mul",    BenchMul },
+	{ "square", BenchSquare },
+	{ "divide", BenchDivide },
+	{ "shift",  BenchShift },
+	{ "gcd",    BenchGcd },
+	{ "modinv", BenchModularInverse },
+	{ "modexp", BenchModularExponentiation }
+};
+
+
+static const size_t cBenchSizes[] = { 256, 512, 1024, 2048, 4096, 8192 };
+
+
+/**
+ * \brief Vysledek jednoho mereni.
+ */
+struct BenchResult
+{
+	string   mName;
+	size_t   mBits;
+	uint64_t mIterations;
+	double   mNsPerOp;
+	double   mCyclesPerOp;
+	double   mAllocsPerOp;
+};
+
+
+/**
+ * \brief Pripravi operandy. Generator se seeduje delkou, takze jsou
+ *  operandy pri kazdem spusteni stejne.
+ */
+static void
+PrepareOperands( size_t bits, BenchOperands& rOps )
+{
+	BigNum::SeedRandom( static_cast< unsigned int >( bits ) );
+
+	rOps.mA = BigNum::GenerateRandomBits( bits );
+	rOps.mA.SetBit( bits - 1 );
+
+	rOps.mB = BigNum::GenerateRandomBits( bits - 1 );
+	rOps.mB.SetBit( 0 );
+
+	rOps.mWide = BigNum::GenerateRandomBits( 2 * bits );
+	rOps.mWide.SetBit( 2 * bits - 1 );
+
+	rOps.mModulus = BigNum::GenerateRandomBits( bits );
+	rOps.mModulus.SetBit( bits - 1 );
+	rOps.mModulus.SetBit( 0 );
+
+	do
+	{
+		rOps.mInvert = BigNum::GenerateRandomMax( rOps.mModulus );
+	}
+	while ( BigNum::Gcd( rOps.mInvert, rOps.mModulus ) != BigNum( 1 ) );
+}
+
+
+/**
+ * \brief Zmeri jednu operaci.
+ *
+ * Pocet opakovani se zdvojnasobuje, dokud mereni netrva alespon
+ * minTime nanosekund. Vysledek je z posledni davky.
+ */
+static BenchResult
+RunCase( const BenchCase& rCase, size_t bits, const BenchOperands& rOps, uint64_t minTime )
+{
+	static volatile uint32_t sink;
+
+	BenchResult result;
+	uint64_t    iterations = 1;
+
+	result.mName = rCase.mpName;
+	result.mBits = bits;
+
+	// Zahrati (cache, prvni alokace)
+	sink = rCase.mpFunc( rOps );
+
+	for ( ;; )
+	{
+		uint64_t allocations = gAllocations;
+		uint64_t cycles      = GetCycles();
+		uint64_t start       = GetNanoseconds();
+		uint64_t i;
+
+		for ( i = 0 ; i < iterations ; i++ )
+			sink = rCase.mpFunc( rOps );
+
+		uint64_t elapsed = GetNanoseconds() - start;
+		cycles      = GetCycles() - cycles;
+		allocations = gAllocations - allocations;
+
+		if ( elapsed >= minTime || iterations >= ( 1ULL << 40 ) )
+		{
+			result.mIterations  = iterations;
+			result.mNsPerOp     = static_cast< double >( elapsed ) / iterations;
+			result.mCyclesPerOp = static_cast< double >( cycles ) / iterations;
+			result.mAllocsPerOp = static_cast< double >( allocations ) / iterations;
+
+			// Zapisy do sink brani vynechani operaci, jednou jej i precteme
+			( void ) sink;
+			return result;
+		}
+
+		iterations *= 2;
+	}
+}
+
+
+static void
+WriteJson( const char* pFileName, const vector< BenchResult >& rResults )
+{
+	ofstream ofs( pFileName );
+	size_t   i;
+
+	ofs << "{" << endl << "  \"benchmarks\": [" << endl;
+
+	for ( i = 0 ; i < rResults.size() ; i++ )
+	{
+		const BenchResult& r = rResults[ i ];
+		char               line[ 256 ];
+
+		snprintf( line, sizeof( line ),
+		          "    { \"name\": \"%s\", \"bits\": %u, \"iterations\": %llu, "
+		          "\"ns_per_op\": %.1f, \"cycles_per_op\": %.1f, \"allocs_per_op\": %.2f }%s",
+		          r.mName.c_str(), static_cast< unsigned int >( r.mBits ),
+		          static_cast< unsigned long long >( r.mIterations ),
+		          r.mNsPerOp, r.mCyclesPerOp, r.mAllocsPerOp,
+		          i + 1 < rResults.size() ? "," : "" );
+
+		ofs << line << endl;
+	}
+
+	ofs << "  ]" << endl << "}" << endl;
+}
+
+
+static void
+PrintHelp( const char* pProgramName )
+{
+	cout << "Pouziti: " << pProgramName << " [--json soubor] [--filter operace] [--bits n] [--time ms]" << endl;
+	cout << "\t--json soubor    Ulozi vysledky ve formatu JSON." << endl;
+	cout << "\t--filter operace Meri jen operace, jejichz nazev obsahuje dany text." << endl;
+	cout << "\t--bits n         Meri jen operandy o delce n bitu." << endl;
+	cout << "\t--time ms        Minimalni doba mereni jedne operace (implicitne 200 ms)." << endl;
+}
+
+
+int
+main( int argc, char** argv )
+{
+	const char* pJsonFile = NULL;
+	const char* pFilter   = NULL;
+	size_t      onlyBits  = 0;
+	uint64_t    minTime   = 200;
+	int         i;
+
+	for ( i = 1 ; i < argc ; i++ )
+	{
+		if ( strcmp( argv[ i ], "--json" ) == 0 && i + 1 < argc )
+			pJsonFile = argv[ ++i ];
+		else if ( strcmp( argv[ i ], "--filter" ) == 0 && i + 1 < argc )
+			pFilter = argv[ ++i ];
+		else if ( strcmp( argv[ i ], "--bits" ) == 0 && i + 1 < argc )
+			onlyBits = atoi( argv[ ++i ] );
+		else if ( strcmp( argv[ i ], "--time" ) == 0 && i + 1 < argc )
+			minTime = atoi( argv[ ++i ] );
+		else
+		{
+			PrintHelp( argv[ 0 ] );
+			return 1;
+		}
+	}
+
+	vector< BenchResult > results;
+	size_t                s, c;
+
+	printf( "%-8s %6s %14s %14s %10s %10s\n", "operace", "bity", "ns/op", "cykly/op", "alokace/op", "opakovani" );
+
+	for ( s = 0 ; s < sizeof( cBenchSizes ) / sizeof( cBenchSizes[ 0 ] ) ; s++ )
+	{
+		size_t bits = cBenchSizes[ s ];
+
+		if ( onlyBits && bits != onlyBits )
+			continue;
+
+		BenchOperands ops;
+		PrepareOperands( bits, ops );
+
+		for ( c = 0 ; c < sizeof( cBenchCases ) / sizeof( cBenchCases[ 0 ] ) ; c++ )
+		{
+			if ( pFilter && !strstr( cBenchCases[ c ].mpName, pFilter ) )
+				continue;
+
+			BenchResult r = RunCase( cBenchCases[ c ], bits, ops, minTime * 1000000 );
+
+			printf( "%-8s %6u %14.1f %14.1f %10.2f %10llu\n", r.mName.c_str(),
+			        static_cast< unsigned int >( r.mBits ), r.mNsPerOp, r.mCyclesPerOp,
+			        r.mAllocsPerOp, static_cast< unsigned long long >( r.mIterations ) );
+			fflush( stdout );
+
+			results.push_back( r );
+		}
+	}
+
+	if ( pJsonFile )
+		WriteJson( pJsonFile, results );
+
+	return 0;
+}
@@ -0,0 +1,787 @@
+/*
+ * Bench/RsaBench.cc - Mereni propustnosti RSA (bloky, soubory, klice).
+ *
+ * Copyright (c) 2006 Jiri Zajpt, <jzajpt@blueberry.cz>
+ */
+
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <pthread.h>
+#include <unistd.h>
+#include "../BigNum/BigNum.h"
+#include "../Rsa/RsaKey.h"
+#include "../Rsa/Rsa.h"
+#include "../Rsa/RsaStream.h"
+#include "../Common/ThreadPool.h"
+
+
+using namespace std;
+
+
+/**
+ * \brief Vraci monotonni cas v nanosekundach.
+ */
+static uint64_t
+GetNanoseconds( void )
+{
+	struct timespec ts;
+	clock_gettime( CLOCK_MONOTONIC, &ts );
+
+	return static_cast< uint64_t >( ts.tv_sec ) * 1000000000ULL + ts.tv_nsec;
+}
+
+
+/**
+ * \brief Vysledek jednoho mereni.
+ */
+struct RsaBenchResult
+{
+	string   mName;       // Nazev operace
+	size_t   mKeyBits;    // Delka klice
+	size_t   mFileSize;   // Velikost souboru (0 pro operace bez souboru)
+	size_t   mThreads;    // Pocet soubezne pracujicich vlaken
+	uint64_t mOps;        // Pocet provedenych operaci
+	double   mOpsPerSec;  // Operaci za sekundu (vsechna vlakna dohromady)
+	double   mMBPerSec;   // Zpracovanych MB za sekundu
+	double   mP50;        // Percentily doby jedne operace v ms
+	double   mP90;
+	double   mP99;
+	double   mMax;
+};
+
+
+/**
+ * \brief Opakovane merena operace.
+ */
+class RsaBenchWork
+{
+public:
+	virtual ~RsaBenchWork() {};
+
+	/**
+	 * \brief Provede jednu operaci. Vola se soubezne z vice vlaken.
+	 */
+	virtual void Run( size_t thread ) = 0;
+
+	/**
+	 * \brief Pocet bytu zpracovanych jednou operaci.
+	 */
+	virtual uint64_t GetBytes( void ) const = 0;
+};
+
+
+class EncryptBlockWork : public RsaBenchWork
+{
+public:
+	EncryptBlockWork( Rsa& rRsa, const string& rBlock, size_t threads )
+		: mrRsa( rRsa ), mBlock( rBlock ), mBlockSize( rRsa.GetBlockSize() ),
+		  mOutput( threads * mBlockSize, '\0' ) {};
+
+	virtual void Run( size_t thread )
+	{
+		// Kazde vlakno zapisuje do sve casti vystupu
+		mrRsa.EncryptBlockInto( mBlock.data(), mBlock.length(),
+		                        &mOutput[ thread * mBlockSize ], mBlockSize );
+	};
+
+	virtual uint64_t GetBytes( void ) const { return mBlock.length(); };
+
+private:
+	Rsa&   mrRsa;
+	string mBlock;
+	size_t mBlockSize;
+	string mOutput;
+};
+
+
+class DecryptBlockWork : public RsaBenchWork
+{
+public:
+	DecryptBlockWork( Rsa& rRsa, const string& rBlock, size_t payload, size_t threads )
+		: mrRsa( rRsa ), mBlock( rBlock ), mBlockSize( rRsa.GetBlockSize() ),
+		  mOutput( threads * mBlockSize, '\0' ), mPayload( payload ) {};
+
+	virtual void Run( size_t thread )
+	{
+		mrRsa.DecryptBlockInto( mBlock.data(), mBlock.length(),
+		                        &mOutput[ thread * mBlockSize ], mBlockSize );
+	};
+
+	virtual uint64_t GetBytes( void ) const { return mPayload; };
+
+private:
+	Rsa&   mrRsa;
+	string mBlock;
+	size_t mBlockSize;
+	string mOutput;
+	size_t mPayload;
+};
+
+
+class FileWork : public RsaBenchWork
+{
+public:
+	FileWork( Rsa& rRsa, bool encrypt, RsaFileFormat format, const string& rInput,
+	          const string& rOutputPrefix, uint64_t bytes )
+		: mrRsa( rRsa ), mEncrypt( encrypt ), mFormat( format ), mInput( rInput ),
+		  mOutputPrefix( rOutputPrefix ), mBytes( bytes ) {};
+
+	virtual void Run( size_t thread )
+	{
+		char suffix[ 32 ];
+		snprintf( suffix, sizeof( suffix ), ".%u", static_cast< unsigned int >( thread ) );
+
+		string output = mOutputPrefix + suffix;
+
+		if ( mEncrypt )
+			mrRsa.EncryptFileToFile( mInput.c_str(), output.c_str(), mFormat );
+		else
+			mrRsa.DecryptFileToFile( mInput.c_str(), output.c_str() );
+	};
+
+	virtual uint64_t GetBytes( void ) const { return mBytes; };
+
+	/**
+	 * \brief Smaze vystupy vsech vlaken.
+	 */
+	void Cleanup( size_t threads )
+	{
+		for ( size_t i = 0 ; i < threads ; i++ )
+		{
+			char suffix[ 32 ];
+			snprintf( suffix, sizeof( suffix ), ".%u", static_cast< unsigned int >( i ) );
+			unlink( ( mOutputPrefix + suffix ).c_str() );
+		}
+	};
+
+private:
+	Rsa&          mrRsa;
+	bool          mEncrypt;
+	RsaFileFormat mFormat;
+	string        mInput;
+	string        mOutputPrefix;
+	uint64_t      mBytes;
+};
+
+
+class LoadKeyWork : public RsaBenchWork
+{
+public:
+	LoadKeyWork( const string& rFileName ) : mFileName( rFileName ) {};
+
+	virtual void Run( size_t )
+	{
+		RsaKey key;
+
+		if ( !key.LoadKeyFromFile( mFileName.c_str() ) )
+			throw Exception( "Nepodarilo se nacist klic: " + mFileName );
+
+		key.Precompute();
+	};
+
+	virtual uint64_t GetBytes( void ) const { return 0; };
+
+private:
+	string mFileName;
+};
+
+
+/**
+ * \brief Stav jednoho merenoho vlakna.
+ */
+struct RsaBenchThread
+{
+	RsaBenchWork*      mpWork;
+	size_t             mIndex;
+	uint64_t           mDeadline;
+	uint64_t           mEnd;
+	vector< uint64_t > mSamples;
+	string             mError;
+};
+
+
+static void*
+BenchThreadMain( void* pArg )
+{
+	RsaBenchThread* pThread = static_cast< RsaBenchThread* >( pArg );
+
+	try
+	{
+		// Alespon jedna operace, i kdyz trva dele nez cely limit
+		do
+		{
+			uint64_t start = GetNanoseconds();
+			pThread->mpWork->Run( pThread->mIndex );
+			pThread->mEnd = GetNanoseconds();
+
+			pThread->mSamples.push_back( pThread->mEnd - start );
+		}
+		while ( pThread->mEnd < pThread->mDeadline );
+	}
+	catch ( Exception& e )
+	{
+		pThread->mError = e.mMessage;
+	}
+
+	return NULL;
+}
+
+
+static double
+Percentile( const vector< uint64_t >& rSorted, double p )
+{
+	if ( rSorted.empty() )
+		return 0;
+
+	size_t index = static_cast< size_t >( p * ( rSorted.size() - 1 ) + 0.5 );
+
+	return rSorted[ index ] / 1e6;
+}
+
+
+/**
+ * \brief Spusti operaci ve threads vlaknech po dobu alespon minTime ns.
+ */
+static RsaBenchResult
+RunWork( RsaBenchWork& rWork, const char* pName, size_t keyBits, size_t fileSize,
+         size_t threads, uint64_t minTime )
+{
+	vector< RsaBenchThread > state( threads );
+	vector< pthread_t >      handles( threads );
+	uint64_t                 start = GetNanoseconds();
+	size_t                   i;
+
+	for ( i = 0 ; i < threads ; i++ )
+	{
+		state[ i ].mpWork    = &rWork;
+		state[ i ].mIndex    = i;
+		state[ i ].mDeadline = start + minTime;
+		state[ i ].mEnd      = start;
+		pthread_create( &handles[ i ], NULL, BenchThreadMain, &state[ i ] );
+	}
+
+	vector< uint64_t > samples;
+	uint64_t           end = start;
+
+	for ( i = 0 ; i < threads ; i++ )
+	{
+		pthread_join( handles[ i ], NULL );
+
+		if ( !state[ i ].mError.empty() )
+			throw Exception( string( pName ) + ": " + state[ i ].mError );
+
+		samples.insert( samples.end(), state[ i ].mSamples.begin(), state[ i ].mSamples.end() );
+		end = max( end, state[ i ].mEnd );
+	}
+
+	sort( samples.begin(), samples.end() );
+
+	RsaBenchResult result;
+	double         seconds = ( end - start ) / 1e9;
+
+	result.mName      = pName;
+	result.mKeyBits   = keyBits;
+	result.mFileSize  = fileSize;
+	result.mThreads   = threads;
+	result.mOps       = samples.size();
+	result.mOpsPerSec = samples.size() / seconds;
+	result.mMBPerSec  = samples.size() * rWork.GetBytes() / seconds / ( 1024.0 * 1024.0 );
+	result.mP50       = Percentile( samples, 0.50 );
+	result.mP90       = Percentile( samples, 0.90 );
+	result.mP99       = Percentile( samples, 0.99 );
+	result.mMax       = samples.empty() ? 0 : samples.back() / 1e6;
+
+	return result;
+}
+
+
+/**
+ * \brief Zmeri generovani klicu (jednovlaknove, seed = delka + poradi).
+ *
+ * Prvni vygenerovany klic se pouzije pro ostatni mereni.
+ */
+static RsaBenchResult
+RunKeyGeneration( size_t bits, size_t count, RsaKey& rKey )
+{
+	vector< uint64_t > samples;
+	uint64_t           total = 0;
+	size_t             i;
+
+	for ( i = 0 ; i < max< size_t >( count, 1 ) ; i++ )
+	{
+		RsaKey key;
+
+		BigNum::SeedRandom( static_cast< unsigned int >( bits + i ) );
+
+		uint64_t start = GetNanoseconds();
+		key.GenerateKey( bits, 0x10001 );
+		uint64_t elapsed = GetNanoseconds() - start;
+
+		if ( i == 0 )
+			rKey = key;
+
+		samples.push_back( elapsed );
+		total += elapsed;
+	}
+
+	sort( samples.begin(), samples.end() );
+
+	RsaBenchResult result;
+
+	result.mName      = "genkey";
+	result.mKeyBits   = bits;
+	result.mFileSize  = 0;
+	result.mThreads   = 1;
+	result.mOps       = samples.size();
+	result.mOpsPerSec = samples.size() / ( total / 1e9 );
+	result.mMBPerSec  = 0;
+	result.mP50       = Percentile( samples, 0.50 );
+	result.mP90       = Percentile( samples, 0.90 );
+	result.mP99       = Percentile( samples, 0.99 );
+	result.mMax       = samples.back() / 1e6;
+
+	return result;
+}
+
+
+/**
+ * \brief Vytvori soubor s pseudonahodnym obsahem (seed = velikost).
+ */
+static void
+CreateFile( const string& rFileName, size_t size )
+{
+	FILE* fp = fopen( rFileName.c_str(), "wb" );
+	if ( !fp )
+		throw UnableToOpenFileException( "Nepodarilo se vytvorit soubor", rFileName );
+
+	vector< char > buffer( 64 * 1024 );
+	size_t          done = 0;
+
+	srand( static_cast< unsigned int >( size ) );
+
+	while ( done < size )
+	{
+		size_t n = min( buffer.size(), size - done );
+		size_t i;
+
+		for ( i = 0 ; i < n ; i++ )
+			buffer[ i ] = static_cast< char >( rand() >> 7 );
+
+		fwrite( &buffer[ 0 ], 1, n, fp );
+		done += n;
+	}
+
+	fclose( fp );
+}
+
+
+/**
+ * \brief Precte seznam cisel oddelenych carkou, pripony k a m nasobi.
+ */
+static vector< size_t >
+ParseList( const char* pList )
+{
+	vector< size_t > values;
+
+	while ( *pList )
+	{
+		char*  pEnd;
+		size_t value = strtoul( pList, &pEnd, 10 );
+
+		if ( *pEnd == 'k' || *pEnd == 'K' )
+		{
+			value *= 1024;
+			pEnd++;
+		}
+		else if ( *pEnd == 'm' || *pEnd == 'M' )
+		{
+			value *= 1024 * 1024;
+			pEnd++;
+		}
+
+		values.push_back( value );
+
+		pList = pEnd;
+		if ( *pList == ',' )
+			pList++;
+		else if ( *pList )
+			break;
+	}
+
+	return values;
+}
+
+
+static string
+ResultId( const RsaBenchResult& rResult )
+{
+	char id[ 128 ];
+
+	snprintf( id, sizeof( id ), "%s/%u/%u/%u", rResult.mName.c_str(),
+	          static_cast< unsigned int >( rResult.mKeyBits ),
+	          static_cast< unsigned int >( rResult.mFileSize ),
+	          static_cast< unsigned int >( rResult.mThreads ) );
+
+	return id;
+}
+
+
+/**
+ * \brief Najde v radku JSON hodnotu daneho klice.
+ */
+static bool
+JsonValue( const string& rLine, const char* pKey, string& rValue )
+{
+	string key = string( "\"" ) + pKey + "\":";
+	size_t pos = rLine.find( key );
+
+	if ( pos == string::npos )
+		return false;
+
+	pos = rLine.find_first_not_of( " ", pos + key.length() );
+	if ( pos == string::npos )
+		return false;
+
+	if ( rLine[ pos ] == '"' )
+	{
+		size_t end = rLine.find( '"', pos + 1 );
+		rValue = rLine.substr( pos + 1, end - pos - 1 );
+	}
+	else
+	{
+		size_t end = rLine.find_first_of( ",}", pos );
+		rValue = rLine.substr( pos, end - pos );
+	}
+
+	return true;
+}
+
+
+/**
+ * \brief Nacte vysledky ulozene pomoci --json (jeden vysledek na radek).
+ */
+static vector< RsaBenchResult >
+LoadBaseline( const char* pFileName )
+{
+	vector< RsaBenchResult > results;
+	ifstream                 ifs( pFileName );
+	string                   line;
+
+	if ( !ifs )
+		throw UnableToOpenFileException( "Nepodarilo se otevrit soubor", pFileName );
+
+	while ( getline( ifs, line ) )
+	{
+		RsaBenchResult r;
+		string         name, bits, size, threads, ops;
+
+		if ( !JsonValue( line, "name", name ) || !JsonValue( line, "key_bits", bits ) ||
+		     !JsonValue( line, "file_size", size ) || !JsonValue( line, "threads", threads ) ||
+		     !JsonValue( line, "ops_per_s", ops ) )
+			continue;
+
+		r.mName      = name;
+		r.mKeyBits   = atoi( bits.c_str() );
+		r.mFileSize  = atoi( size.c_str() );
+		r.mThreads   = atoi( threads.c_str() );
+		r.mOpsPerSec = atof( ops.c_str() );
+		results.push_back( r );
+	}
+
+	return results;
+}
+
+
+static void
+WriteJson( const char* pFileName, const vector< RsaBenchResult >& rResults )
+{
+	ofstream ofs( pFileName );
+	size_t   i;
+
+	ofs << "{" << endl << "  \"benchmarks\": [" << endl;
+
+	for ( i = 0 ; i < rResults.size() ; i++ )
+	{
+		const RsaBenchResult& r = rResults[ i ];
+		char                  line[ 512 ];
+
+		snprintf( line, sizeof( line ),
+		          "    { \"name\": \"%s\", \"key_bits\": %u, \"file_size\": %u, \"threads\": %u, "
+		          "\"ops\": %llu, \"ops_per_s\": %.3f, \"mb_per_s\": %.3f, "
+		          "\"p50_ms\": %.3f, \"p90_ms\": %.3f, \"p99_ms\": %.3f, \"max_ms\": %.3f }%s",
+		          r.mName.c_str(), static_cast< unsigned int >( r.mKeyBits ),
+		          static_cast< unsigned int >( r.mFileSize ),
+		          static_cast< unsigned int >( r.mThreads ),
+		          static_cast< unsigned long long >( r.mOps ), r.mOpsPerSec, r.mMBPerSec,
+		          r.mP50, r.mP90, r.mP99, r.mMax, i + 1 < rResults.size() ? "," : "" );
+
+		ofs << line << endl;
+	}
+
+	ofs << "  ]" << endl << "}" << endl;
+}
+
+
+static void
+PrintResult( const RsaBenchResult& r )
+{
+	printf( "%-14s %5u %9u %6u %12.2f %10.2f %10.3f %10.3f %10.3f %10.3f\n",
+	        r.mName.c_str(), static_cast< unsigned int >( r.mKeyBits ),
+	        static_cast< unsigned int >( r.mFileSize ), static_cast< unsigned int >( r.mThreads ),
+	        r.mOpsPerSec, r.mMBPerSec, r.mP50, r.mP90, r.mP99, r.mMax );
+	fflush( stdout );
+}
+
+
+static void
+PrintHelp( const char* pProgramName )
+{
+	cout << "Pouziti: " << pProgramName << " [volby]" << endl;
+	cout << "\t--keys 1024,2048,4096   Delky klicu." << endl;
+	cout << "\t--sizes 64k,1m,16m      Velikosti souboru." << endl;
+	cout << "\t--threads 1,4           Pocty vlaken (implicitne 1 a pocet procesoru)." << endl;
+	cout << "\t--format obalka|bloky   Format souboru (implicitne obalka)." << endl;
+	cout << "\t--keygen n              Pocet generovanych klicu pro mereni (implicitne 1)." << endl;
+	cout << "\t--time ms               Minimalni doba jednoho mereni (implicitne 1000 ms)." << endl;
+	cout << "\t--dir adresar           Adresar pro docasne soubory." << endl;
+	cout << "\t--json soubor           Ulozi vysledky ve formatu JSON." << endl;
+	cout << "\t--baseline soubor       Porovna vysledky s drive ulozenymi." << endl;
+	cout << "\t--tolerance procent     Povolene zpomaleni proti baseline (implicitne 10)." << endl;
+}
+
+
+int
+main( int argc, char** argv )
+{
+	vector< size_t > keySizes  = ParseList( "1024,2048,4096" );
+	vector< size_t > fileSizes = ParseList( "64k,1m,16m" );
+	vector< size_t > threads;
+	RsaFileFormat    format     = RSA_FILE_FORMAT_ENVELOPE;
+	size_t           keygen     = 1;
+	uint64_t         minTime    = 1000;
+	const char*      pDirectory = NULL;
+	const char*      pJsonFile  = NULL;
+	const char*      pBaseline  = NULL;
+	double           tolerance  = 10;
+	int              i;
+
+	threads.push_back( 1 );
+	if ( ThreadPool::GetCpuCount() > 1 )
+		threads.push_back( ThreadPool::GetCpuCount() );
+
+	for ( i = 1 ; i < argc ; i++ )
+	{
+		if ( i + 1 >= argc )
+		{
+			PrintHelp( argv[ 0 ] );
+			return 1;
+		}
+
+		const char* pOption = argv[ i ];
+		const char* pValue  = argv[ ++i ];
+
+		if ( strcmp( pOption, "--keys" ) == 0 )
+			keySizes = ParseList( pValue );
+		else if ( strcmp( pOption, "--sizes" ) == 0 )
+			fileSizes = ParseList( pValue );
+		else if ( strcmp( pOption, "--threads" ) == 0 )
+			threads = ParseList( pValue );
+		else if ( strcmp( pOption, "--format" ) == 0 )
+			format = strcmp( pValue, "bloky" ) == 0 ? RSA_FILE_FORMAT_BLOCKS : RSA_FILE_FORMAT_ENVELOPE;
+		else if ( strcmp( pOption, "--keygen" ) == 0 )
+			keygen = atoi( pValue );
+		else if ( strcmp( pOption, "--time" ) == 0 )
+			minTime = atoi( pValue );
+		else if ( strcmp( pOption, "--dir" ) == 0 )
+			pDirectory = pValue;
+		else if ( strcmp( pOption, "--json" ) == 0 )
+			pJsonFile = pValue;
+		else if ( strcmp( pOption, "--baseline" ) == 0 )
+			pBaseline = pValue;
+		else if ( strcmp( pOption, "--tolerance" ) == 0 )
+			tolerance = atof( pValue );
+		else
+		{
+			PrintHelp( argv[ 0 ] );
+			return 1;
+		}
+	}
+
+	minTime *= 1000000;
+
+	// Docasny adresar, pokud nebyl zadan, na konci se smaze
+	char   tempTemplate[] = "/tmp/pmz_rsa_bench.XXXXXX";
+	string directory      = pDirectory ? pDirectory : "";
+
+	if ( directory.empty() )
+	{
+		if ( !mkdtemp( tempTemplate ) )
+		{
+			cerr << "Nepodarilo se vytvorit docasny adresar!" << endl;
+			return 1;
+		}
+		directory = tempTemplate;
+	}
+
+	vector< RsaBenchResult > results;
+	vector< string >         tempFiles;
+	size_t                   k, s, t;
+
+	printf( "%-14s %5s %9s %6s %12s %10s %10s %10s %10s %10s\n", "operace", "klic", "soubor",
+	        "vlakna", "ops/s", "MB/s", "p50 ms", "p90 ms", "p99 ms", "max ms" );
+
+	try
+	{
+		for ( k = 0 ; k < keySizes.size() ; k++ )
+		{
+			size_t bits = keySizes[ k ];
+			RsaKey key;
+
+			// Klic je deterministicky (seed = delka klice)
+			results.push_back( RunKeyGeneration( bits, keygen, key ) );
+			if ( keygen )
+				PrintResult( results.back() );
+			else
+				results.pop_back();
+
+			char name[ 64 ];
+			snprintf( name, sizeof( name ), "/key%u", static_cast< unsigned int >( bits ) );
+
+			string textKey   = directory + name + ".txt";
+			string binaryKey = directory + name + ".bin";
+
+			key.SaveKeyToFile( textKey.c_str(), RSA_KEY_FORMAT_TEXT );
+			key.SaveKeyToFile( binaryKey.c_str(), RSA_KEY_FORMAT_BINARY );
+			tempFiles.push_back( textKey );
+			tempFiles.push_back( binaryKey );
+
+			LoadKeyWork loadText( textKey );
+			results.push_back( RunWork( loadText, "loadkey-text", bits, 0, 1, minTime ) );
+			PrintResult( results.back() );
+
+			LoadKeyWork loadBinary( binaryKey );
+			results.push_back( RunWork( loadBinary, "loadkey-bin", bits, 0, 1, minTime ) );
+			PrintResult( results.back() );
+
+			Rsa    rsa( key );
+			size_t payload = bits / 8 - 2;
+			string block;
+
+			for ( s = 0 ; s < payload ; s++ )
+				block += static_cast< char >( rand() );
+
+			// Zasifrovany blok pro desifrovani vezmeme z proudu (pevna delka)
+			string       cipher;
+			RsaStringSink sink( cipher );
+			RsaEncryptStream stream( key, sink, RSA_FILE_FORMAT_BLOCKS );
+			stream.Update( block.data(), block.length() );
+			stream.Finish();
+
+			for ( t = 0 ; t < threads.size() ; t++ )
+			{
+				EncryptBlockWork encryptBlock( rsa, block, threads[ t ] );
+				results.push_back( RunWork( encryptBlock, "encrypt-block", bits, 0, threads[ t ], minTime ) );
+				PrintResult( results.back() );
+
+				DecryptBlockWork decryptBlock( rsa, cipher.substr( 0, bits / 8 ), payload, threads[ t ] );
+				results.push_back( RunWork( decryptBlock, "decrypt-block", bits, 0, threads[ t ], minTime ) );
+				PrintResult( results.back() );
+			}
+
+			for ( s = 0 ; s < fileSizes.size() ; s++ )
+			{
+				size_t size = fileSizes[ s ];
+
+				snprintf( name, sizeof( name ), "/data%u", static_cast< unsigned int >( size ) );
+
+				string plain     = directory + name;
+				string encrypted = plain + ".rsa";
+
+				CreateFile( plain, size );
+				rsa.EncryptFileToFile( plain.c_str(), encrypted.c_str(), format );
+				tempFiles.push_back( plain );
+				tempFiles.push_back( encrypted );
+
+				for ( t = 0 ; t < threads.size() ; t++ )
+				{
+					FileWork encryptFile( rsa, true, format, plain, plain + ".enc", size );
+					results.push_back( RunWork( encryptFile, "encrypt-file", bits, size, threads[ t ], minTime ) );
+					encryptFile.Cleanup( threads[ t ] );
+					PrintResult( results.back() );
+
+					FileWork decryptFile( rsa, false, format, encrypted, plain + ".dec", size );
+					results.push_back( RunWork( decryptFile, "decrypt-file", bits, size, threads[ t ], minTime ) );
+					decryptFile.Cleanup( threads[ t ] );
+					PrintResult( results.back() );
+				}
+			}
+		}
+	}
+	catch ( Exception& e )
+	{
+		cerr << "Chyba: " << e.mMessage << endl;
+		return 1;
+	}
+
+	for ( s = 0 ; s < tempFiles.size() ; s++ )
+		unlink( tempFiles[ s ].c_str() );
+	if ( !pDirectory )
+		rmdir( directory.c_str() );
+
+	if ( pJsonFile )
+		WriteJson( pJsonFile, results );
+
+	if ( !pBaseline )
+		return 0;
+
+	// Porovnani s baseline podle ops/s
+	vector< RsaBenchResult > baseline;
+	size_t                   regressions = 0;
+
+	try
+	{
+		baseline = LoadBaseline( pBaseline );
+	}
+	catch ( UnableToOpenFileException& e )
+	{
+		cerr << e.mMessage << ": " << e.mFileName << endl;
+		return 1;
+	}
+
+	printf( "\nPorovnani s %s (tolerance %.0f %%):\n", pBaseline, tolerance );
+
+	for ( s = 0 ; s < results.size() ; s++ )
+	{
+		string id = ResultId( results[ s ] );
+
+		for ( k = 0 ; k < baseline.size() ; k++ )
+		{
+			if ( ResultId( baseline[ k ] ) != id || baseline[ k ].mOpsPerSec <= 0 )
+				continue;
+
+			double change = ( results[ s ].mOpsPerSec / baseline[ k ].mOpsPerSec - 1 ) * 100;
+			bool   slower = change < -tolerance;
+
+			printf( "%-32s %+8.1f %%%s\n", id.c_str(), change, slower ? "  REGRESE" : "" );
+
+			if ( slower )
+				regressions++;
+			break;
+		}
+	}
+
+	if ( regressions )
+	{
+		printf( "Zpomaleni: %u\n", static_cast< unsigned int >( regressions ) );
+		return 2;
+	}
+
+	return 0;
+}
@@ -9,9 +9,13 @@
 
 #include <iostream>
 #include <vector>
+#include <algorithm>
 #include <limits.h>
 #include "NumberBuffer.h"
+#include "NumberArena.h"
+#include "Kernels.h"
 #include "BigNum.h"
+#include "../Common/Stats.h"
 
 
 /**
@@ -51,6 +55,364 @@ IntToHexChar( uint8_t i )
 }
 
 
+/**
+ * \brief Rozlozi 64bitove cislo na cislice, vraci pocet aktivnich cislic.
+ */
+static size_t
+ScalarToLimbs( uint64_t value, uint32_t* pLimbs )
+{
+	pLimbs[ 0 ] = static_cast< uint32_t >( value );
+	pLimbs[ 1 ] = static_cast< uint32_t >( value >> 32 );
+
+	return pLimbs[ 1 ] ? 2 : ( pLimbs[ 0 ] ? 1 : 0 );
+}
+
+
+/**
+ * \brief Porovna absolutni hodnoty cisel a (na cislic) a b (nb cislic).
+ *
+ * Pocty cislic musi byt bez nulovych cislic na konci.
+ *
+ * \return 1 pokud |a| > |b|, -1 pokud |a| < |b|, jinak 0.
+ */
+static int
+CompareMagnitude( const uint32_t* pA, size_t na, const uint32_t* pB, size_t nb )
+{
+	if ( na != nb )
+		return na > nb ? 1 : -1;
+
+	return LimbsCompare( pA, pB, na );
+}
+
+
+/**
+ * \brief Secte dve cisla dana cislicemi a znamenkem.
+ *
+ * Spolecny zaklad operatoru + a - i jejich variant s malym cislem.
+ */
+static BigNum
+AddSigned( const uint32_t* pA, size_t na, BigNum::Sign signA,
+           const uint32_t* pB, size_t nb, BigNum::Sign signB )
+{
+	BigNum result;
+
+	// Ruzna znamenka: od vetsi absolutni hodnoty odecteme mensi
+	// a vysledek ma znamenko vetsiho
+	if ( signA != signB )
+	{
+		int cmp = CompareMagnitude( pA, na, pB, nb );
+
+		if ( cmp == 0 )
+			return BigNum( 0 );
+
+		if ( cmp < 0 )
+		{
+			std::swap( pA, pB );
+			std::swap( na, nb );
+			std::swap( signA, signB );
+		}
+
+		try
+		{
+			result.mNb.Allocate( na );
+		}
+		catch ( AllocationFailedException& e )
+		{
+			throw e;
+		}
+
+		uint32_t* pR     = result.mNb.GetBufferPointer();
+		uint32_t  borrow = LimbsSub( pR, pA, pB, nb );
+
+		LimbsSub1( pR + nb, pA + nb, na - nb, borrow );
+		result.mNb.Normalize();
+		result.mSign = signA;
+
+		BIGNUM_CHECK( result );
+		return result;
+	}
+
+	// Delsi z cisel si dame na prvni misto
+	if ( na < nb )
+	{
+		std::swap( pA, pB );
+		std::swap( na, nb );
+	}
+
+	try
+	{
+		result.mNb.Allocate( na + 1 );
+	}
+	catch ( AllocationFailedException& e )
+	{
+		throw e;
+	}
+
+	// Secteme spolecne cislice a prenos pak probublame delsim cislem
+	uint32_t* pR    = result.mNb.GetBufferPointer();
+	uint32_t  carry = LimbsAdd( pR, pA, pB, nb );
+
+	pR[ na ] = LimbsAdd1( pR + nb, pA + nb, na - nb, carry );
+	result.mNb.Normalize();
+	result.mSign = signA;
+
+	BIGNUM_CHECK( result );
+	return result;
+}
+
+
+/**
+ * \brief Jadro Knuthova algoritmu D nad normalizovanymi cisly.
+ *
+ * pUn ma m + 1 cislic, pVn n cislic (m >= n >= 2, nejvyssi bit
+ * pVn[ n - 1 ] je jednicka). Zbytek zustane v dolnich n cislicich pUn,
+ * podil (m - n + 1 cislic) se zapise do pQ, pokud neni NULL.
+ *
+ * Cislice podilu se odhaduje delenim 3/2 prevracenou hodnotou hornich
+ * dvou cislic delitele (Moller, Granlund), ktera se spocita jednou pro
+ * cele deleni. Odhad je presny az na vzacnou korekci o jednicku.
+ */
+static void
+DivideLimbsKnuth( uint32_t* pQ, uint32_t* pUn, size_t m, const uint32_t* pVn, size_t n )
+{
+	uint32_t d1 = pVn[ n - 1 ];
+	uint32_t d0 = pVn[ n - 2 ];
+	uint32_t v  = LimbsInvert3by2( d1, d0 );
+	uint32_t qhat;
+	uint32_t r1;
+	uint32_t r0;
+	uint32_t top;
+	uint32_t borrow;
+	size_t   j = m - n + 1;
+
+	while ( j-- )
+	{
+		uint32_t* pU = pUn + j;
+
+		if ( pU[ n ] == d1 && pU[ n - 1 ] == d0 )
+		{
+			// Deleni 3/2 by pretekalo, podil je B - 1 (nebo o jednu mensi)
+			qhat      = 0xFFFFFFFF;
+			borrow    = gLimbKernels.mpSubMul1( pU, pVn, n, qhat );
+			top       = pU[ n ];
+			pU[ n ]   = top - borrow;
+
+			if ( top < borrow )
+			{
+				qhat--;
+				pU[ n ] += LimbsAdd( pU, pU, pVn, n );
+			}
+		}
+		else
+		{
+			qhat = LimbsDivRem3by2( pU[ n ], pU[ n - 1 ], pU[ n - 2 ], d1, d0, v, r1, r0 );
+
+			// Horni tri cislice uz jsou zbytek ( r1, r0 ), odecteme zbytek delitele
+			borrow = gLimbKernels.mpSubMul1( pU, pVn, n - 2, qhat );
+			top    = r0 < borrow;
+			r0    -= borrow;
+			borrow = r1 < top;
+			r1    -= top;
+
+			pU[ n - 2 ] = r0;
+			pU[ n - 1 ] = r1;
+			pU[ n ]     = 0;
+
+			// Odecetli jsme prilis, delitel jednou pricteme zpet
+			if ( borrow )
+			{
+				qhat--;
+				LimbsAdd( pU, pU, pVn, n );
+			}
+		}
+
+		if ( pQ )
+			pQ[ j ] = qhat;
+	}
+}
+
+
+/**
+ * \brief r = a * b (na a nb cislic, r na + nb cislic mimo vstupy).
+ *
+ * Pro pA == pB a na == nb pocita druhou mocninu. Nad prahem
+ * gKaratsubaThreshold (gKaratsubaSqrThreshold) nasobi Karatsubovou
+ * metodou, pracovni pole je z areny.
+ */
+static void
+MultiplyLimbs( uint32_t* pR, const uint32_t* pA, size_t na, const uint32_t* pB, size_t nb )
+{
+	bool square = ( pA == pB && na == nb );
+
+	if ( square && na < gKaratsubaSqrThreshold )
+	{
+		gLimbKernels.mpSqr( pR, pA, na );
+		return;
+	}
+
+	if ( !square && ( na < gKaratsubaThreshold || nb < gKaratsubaThreshold ) )
+	{
+		gLimbKernels.mpMul( pR, pA, na, pB, nb );
+		return;
+	}
+
+	NumberArenaScope arena;
+
+	if ( square )
+	{
+		NumberBuffer t( LimbsSqrKaratsubaScratch( na ) + 1 );
+		LimbsSqrKaratsuba( pR, pA, na, t.GetBufferPointer() );
+	}
+	else
+	{
+		NumberBuffer t( LimbsMulKaratsubaScratch( na, nb ) + 1 );
+		LimbsMulKaratsuba( pR, pA, na, pB, nb, t.GetBufferPointer() );
+	}
+}
+
+
+/**
+ * \brief Podil 2n / n cislic algoritmem D, pro DivideLimbsRecursive().
+ *
+ * Na rozdil od DivideLimbsKnuth() nemusi byt horni polovina pN mensi
+ * nez delitel, nejvyssi cislici podilu (0 nebo 1) vraci.
+ */
+static uint32_t
+DivideLimbsBase( uint32_t* pQ, uint32_t* pN, const uint32_t* pD, size_t n )
+{
+	uint32_t qh = LimbsCompare( pN + n, pD, n ) >= 0;
+
+	if ( qh )
+		LimbsSub( pN + n, pN + n, pD, n );
+
+	DivideLimbsKnuth( pQ, pN, 2 * n - 1, pD, n );
+
+	return qh;
+}
+
+
+/**
+ * \brief Vraci prah rekurzivniho deleni, rekurze potrebuje aspon 4 cislice.
+ */
+static inline size_t
+DivideThreshold( void )
+{
+	return gDivideThreshold < 4 ? 4 : gDivideThreshold;
+}
+
+
+/**
+ * \brief Vraci velikost pracovniho pole pro DivideLimbsRecursive().
+ */
+static size_t
+DivideLimbsScratch( size_t n )
+{
+	return n + LimbsMulKaratsubaScratch( n - n / 2, n / 2 );
+}
+
+
+/**
+ * \brief Rekurzivni deleni 2n / n cislic (Burnikel, Ziegler).
+ *
+ * pN ma 2n cislic, pD n cislic a je normalizovany. Horni polovina
+ * podilu se spocita delenim hornich cislic pN hornimi cislicemi
+ * delitele, odhad se opravi odectenim soucinu se zbytkem delitele
+ * (Karatsubovo nasobeni) a stejne se spocita dolni polovina. Podil
+ * (n cislic) se zapise do pQ, zbytek zustane v dolnich n cislicich pN.
+ * Vraci nejvyssi cislici podilu (0 nebo 1).
+ */
+static uint32_t
+DivideLimbsRecursive( uint32_t* pQ, uint32_t* pN, const uint32_t* pD, size_t n, uint32_t* pT )
+{
+	size_t   lo        = n / 2;
+	size_t   hi        = n - lo;
+	size_t   threshold = DivideThreshold();
+	uint32_t qh;
+	uint32_t ql;
+	uint32_t cy;
+
+	// Horni polovina podilu
+	if ( hi < threshold )
+		qh = DivideLimbsBase( pQ + lo, pN + 2 * lo, pD + lo, hi );
+	else
+		qh = DivideLimbsRecursive( pQ + lo, pN + 2 * lo, pD + lo, hi, pT );
+
+	LimbsMulKaratsuba( pT, pQ + lo, hi, pD, lo, pT + n );
+	cy = LimbsSub( pN + lo, pN + lo, pT, n );
+	if ( qh )
+		cy += LimbsSub( pN + n, pN + n, pD, lo );
+
+	// Odhad byl nejvyse o dve vetsi
+	while ( cy )
+	{
+		qh -= LimbsSub1( pQ + lo, pQ + lo, hi, 1 );
+		cy -= LimbsAdd( pN + lo, pN + lo, pD, n );
+	}
+
+	// Dolni polovina podilu
+	if ( lo < threshold )
+		ql = DivideLimbsBase( pQ, pN + hi, pD + hi, lo );
+	else
+		ql = DivideLimbsRecursive( pQ, pN + hi, pD + hi, lo, pT );
+
+	LimbsMulKaratsuba( pT, pD, hi, pQ, lo, pT + n );
+	cy = LimbsSub( pN, pN, pT, n );
+	if ( ql )
+		cy += LimbsSub( pN + lo, pN + lo, pD, hi );
+
+	while ( cy )
+	{
+		LimbsSub1( pQ, pQ, lo, 1 );
+		cy -= LimbsAdd( pN, pN, pD, n );
+	}
+
+	return qh;
+}
+
+
+/**
+ * \brief Deleni normalizovanych cisel, parametry jako DivideLimbsKnuth().
+ *
+ * Od delitele i podilu o gDivideThreshold cislicich se podil pocita
+ * po blocich n cislic rekurzivnim delenim 2n / n (DivideLimbsRecursive()),
+ * ktere s Karatsubovym nasobenim stoji O( n^1.58 ) misto O( n^2 )
+ * na blok. Nejvyssi neuplny blok podilu se spocita algoritmem D.
+ */
+static void
+DivideLimbs( uint32_t* pQ, uint32_t* pUn, size_t m, const uint32_t* pVn, size_t n )
+{
+	size_t qn = m - n + 1;
+
+	if ( n < DivideThreshold() || qn < DivideThreshold() )
+	{
+		DivideLimbsKnuth( pQ, pUn, m, pVn, n );
+		return;
+	}
+
+	NumberArenaScope arena;
+	size_t           scratch = DivideLimbsScratch( n );
+	NumberBuffer     t( scratch + ( pQ ? 0 : qn ) );
+	uint32_t*        pT      = t.GetBufferPointer();
+	size_t           first   = qn % n;
+	size_t           j       = qn - first;
+
+	// Podil nepotrebujeme, ale rekurze jej pocita
+	if ( !pQ )
+		pQ = pT + scratch;
+
+	if ( first )
+		DivideLimbsKnuth( pQ + j, pUn + j, first + n - 1, pVn, n );
+
+	// Horni cislice bloku jsou zbytek predchoziho, podil bloku je proto
+	// mensi nez B^n a DivideLimbsRecursive() vraci nulu
+	while ( j )
+	{
+		j -= n;
+		DivideLimbsRecursive( pQ + j, pUn + j, pVn, n, pT );
+	}
+}
+
+
 BigNum::BigNum()
 	: mSign( Positive )
 {
@@ -103,6 +465,8 @@ BigNum::operator = ( int intValue )
 BigNum
 BigNum::operator >> ( unsigned int bits ) const
 {
+	STATS_CALL( STATS_SHIFT, mNb.GetSize() );
+
 	BigNum bn;
 
 	// Pokud posouvame cislo o vice bitu nez je jeho
@@ -130,58 +494,27 @@ BigNum::operator >> ( unsigned int bits ) const
 	}
 
 	//
-	// Protoze nemuzeme posouvat vice jak o 32 bitu musime 
-	// nejdrive provest posunuti o (bits % 32) bitu. Pokud bylo
-	// bits mene nebo rovno 32, vracime cislo. Pokud ale bitu
-	// bylo vice nez 32, musime jeste provest posunuti o 
-	// ( bits / 32 ) * 32. To provedeme v cyklu, vzdy po 32 bitech.
+	// Posun o cele cislice ( bits / 32 ) provedeme uz pri cteni zdroje,
+	// zbyvajicich ( bits % 32 ) bitu posune LimbsShiftRight().
 	//
 
-	unsigned int part_bits = bits % BITS_PER_DWORD;
-	uint32_t     mask      = 0;
-	uint32_t     carry0    = 0;
-	uint32_t     carry     = 0;
-	size_t       rem_bits  = BITS_PER_DWORD - part_bits;
-	size_t       i;
-
-	// Vytvorime masku pomoci ktere ziskame bity urcene pro
-	// prenos do dalsiho bajtu.
-	for ( i = 0 ; i < part_bits ; i++ )
-		mask |= 1 << i;
-
-	// Provedeme posuv o (bits % 32). bitu.
-	i = mNb.GetSize();
-	while ( i-- )
-	{
-		carry0 = ( mNb.Get( i ) & mask ) << rem_bits;
-		bn.mNb.Set( i, ( mNb.Get( i ) >> part_bits ) | carry );
-		carry = carry0;
-	}
-
-	// Zjistime zda-li je potreba jeste provest posunuti
-	unsigned int times = bits / BITS_PER_DWORD;
-	if ( times == 0 )
-		return bn;
-
-	size_t j = 0;
-	carry0   = 0;
-	mask     = 0xFF;
+	size_t          words     = bits / BITS_PER_DWORD;
+	unsigned int    part_bits = bits % BITS_PER_DWORD;
+	size_t          active    = mNb.GetActiveSize();
+	const uint32_t* pA        = mNb.GetBufferPointer() + words;
+	uint32_t*       pR        = bn.mNb.GetBufferPointer();
 
-	// Provedeme posunuti (bits / 32) krat.
-	for ( i = 0 ; i < times ; i++ )
+	if ( words < active )
 	{
-		j = bn.mNb.GetSize();
-		carry   = 0;
-		while ( j-- )
-		{
-			carry0 = bn.mNb.Get( j );
-			bn.mNb.Set( j,
-				( static_cast< uint64_t >( bn.mNb.Get( j ) ) >> BITS_PER_DWORD ) | carry
-			);
-			carry = carry0;
-		}
+		if ( part_bits )
+			LimbsShiftRight( pR, pA, active - words, part_bits );
+		else
+			memcpy( pR, pA, ( active - words ) * sizeof( uint32_t ) );
 	}
 
+	bn.mNb.Normalize();
+
+	BIGNUM_CHECK( bn );
 	return bn;
 }
 
@@ -197,14 +530,9 @@ BigNum::operator >>= ( unsigned int bits )
 BigNum
 BigNum::operator << ( unsigned int bits ) const
 {
-	BigNum bn;
+	STATS_CALL( STATS_SHIFT, mNb.GetSize() );
 
-	// Pokud posouvame cislo o vice bitu nez je jeho
-	// celkovy pocet bitu je vysledek vzdy nula.
-	//
-	// :FIXME:
-	if ( bits >= ( mNb.GetSize() * 32 ) )
-		return bn;
+	BigNum bn;
 
 	// Pokud posouvame cislo o nula bitu je vysledek
 	// vzdy puvodni cislo.
@@ -216,9 +544,14 @@ BigNum::operator << ( unsigned int bits ) const
 	if ( IsZero() )
 		return *this;
 
+	size_t       words     = bits / BITS_PER_DWORD;
+	unsigned int part_bits = bits % BITS_PER_DWORD;
+	size_t       active    = mNb.GetActiveSize();
+
+	// Vysledek se vzdy vejde, nezavisle na velikosti bufferu zdroje
 	try
 	{
-		bn.mNb.Allocate( mNb.GetSize() );
+		bn.mNb.Allocate( active + words + 1 );
 	}
 	catch ( AllocationFailedException& e )
 	{
@@ -226,58 +559,21 @@ BigNum::operator << ( unsigned int bits ) const
 	}
 
 	//
-	// Protoze nemuzeme posouvat vice jak o 32 bitu musime 
-	// nejdrive provest posunuti o (bits % 32) bitu. Pokud bylo
-	// bits mene nebo rovno 32, vracime cislo. Pokud ale bitu
-	// bylo vice nez 32, musime jeste provest posunuti o 
-	// ( bits / 32 ) * 32. To provedeme v cyklu, vzdy po 32 bitech.
+	// Cislice zdroje zapisujeme o ( bits / 32 ) cislic vyse a zbyvajicich
+	// ( bits % 32 ) bitu posune LimbsShiftLeft().
 	//
 
-	unsigned int part_bits = bits % BITS_PER_DWORD;
-	uint32_t     mask   = 0;
-	uint32_t     carry0 = 0;
-	uint32_t     carry  = 0;
-	size_t       rem_bits = BITS_PER_DWORD - part_bits;
-	size_t       i;
-
-	// Vytvorime masku pomoci ktere ziskame bity urcene pro
-	// prenos do dalsiho bajtu.
-	for ( i = 0 ; i < rem_bits ; i++ )
-		mask |= 1 << i;
-	mask = ~mask;
-
-	// Provedeme posuv o (bits % 32) bitu.
-	i = mNb.GetSize();
-	for ( i = 0 ; i < bn.mNb.GetSize() ; i++ )
-	{
-		carry0 = ( mNb.Get( i ) & mask ) >> rem_bits;
-		bn.mNb.Set( i, ( mNb.Get( i ) << part_bits ) | carry );
-		carry = carry0;
-	}
+	const uint32_t* pA = mNb.GetBufferPointer();
+	uint32_t*       pR = bn.mNb.GetBufferPointer() + words;
 
-	// Zjistime zda-li je potreba jeste provest posunuti
-	unsigned int times = bits / BITS_PER_DWORD;
-	if ( times == 0 )
-		return bn;
-
-	size_t j = 0;
-	carry0   = 0;
-	mask     = 0xFF;
+	if ( part_bits )
+		pR[ active ] = LimbsShiftLeft( pR, pA, active, part_bits );
+	else
+		memcpy( pR, pA, active * sizeof( uint32_t ) );
 
-	// Provedeme posunuti (bits / 32) krat.
-	for ( i = 0 ; i < times ; i++ )
-	{
-		carry   = 0;
-		for ( j = 0 ; j < bn.mNb.GetSize() ; j++ )
-		{
-			carry0 = bn.mNb.Get( j );
-			bn.mNb.Set( j,
-				( static_cast< uint64_t >( bn.mNb.Get( j ) ) << BITS_PER_DWORD ) | carry
-			);
-			carry = carry0;
-		}
-	}
+	bn.mNb.Normalize();
 
+	BIGNUM_CHECK( bn );
 	return bn;
 }
 
@@ -293,97 +589,16 @@ BigNum::operator <<= ( unsigned int bits )
 BigNum
 BigNum::operator + ( const BigNum& rBn ) const
 {
+	STATS_CALL( STATS_ADD, std::max( mNb.GetSize(), rBn.mNb.GetSize() ) );
+
 	// Pokud je jedno z cisel nula vracime to druhe
 	if ( rBn.IsZero() )
 		return *this;
 	if ( IsZero() )
 		return rBn;
 
-	// Pokud k kladnemu cislu pricitame zaporne cislo
-	if ( mSign == Positive && rBn.mSign == Negative )
-	{
-		BigNum *pBn = const_cast< BigNum* > ( &rBn );
-		pBn->mSign = Positive;
-		BigNum result = *this - *pBn;
-		pBn->mSign = Negative;
-
-		return result;
-	}
-	// Pokud k zapornemu cislu pricitame kladne cislo
-	else if ( mSign == Negative && rBn.mSign == Positive )
-	{
-		BigNum *pThis = const_cast< BigNum* > ( this );
-		pThis->mSign = Positive;
-		BigNum result = rBn - *this;
-		pThis->mSign = Negative;
-
-		return result;
-	}
-	// Pokud k zapornemu cislu pricitame zaporne cislo
-	else if ( mSign == Negative && rBn.mSign == Negative )
-	{
-		BigNum *pThis = const_cast< BigNum* > ( this );
-		BigNum *pBn = const_cast< BigNum* > ( &rBn );
-
-		pThis->mSign = Positive;
-		pBn->mSign = Positive;
-
-		BigNum result = ( *pThis ) + ( *pBn );
-
-		pThis->mSign = Negative;
-		pBn->mSign = Negative;
-		result.mSign = Negative;
-
-		return result;
-	}
-
-	// Zjistime pocet cislic u obou cisel
-	size_t active_dwords1 = mNb.GetActiveSize();
-	size_t active_dwords2 = rBn.mNb.GetActiveSize();
-	size_t result_size;
-
-	active_dwords1 > active_dwords2
-		? result_size = active_dwords1 + 1
-		: result_size = active_dwords2 + 1;
-
-	BigNum result;
-
-	try
-	{
-		result.mNb.Allocate( result_size );
-	}
-	catch ( AllocationFailedException& e )
-	{
-		throw e;
-	}
-
-	// V tomhle cyklu secteme obe cisla...
-	uint64_t tmp;
-	bool     carry = false;
-
-	for ( size_t i = 0 ; i < result.mNb.GetSize() ; i++ )
-	{
-		tmp = static_cast< uint64_t >( mNb.Get( i ) )
-		    + static_cast< uint64_t >( rBn.mNb.Get( i ) );
-
-		// Zkontrolujeme zda-li nedoslo k prenosu
-		if ( carry )
-		{
-			tmp++;
-			carry = false;
-		}
-
-		// Zkontrolujeme zda-li nedoslo k preteceni
-		if ( tmp >= DWORD_VALUE )
-		{
-			tmp &= 0xFFFFFFFF;
-			carry = true;
-		}
-
-		result.mNb.Set( i, tmp );
-	}
-
-	return result;
+	return AddSigned( mNb.GetBufferPointer(), mNb.GetActiveSize(), mSign,
+	                  rBn.mNb.GetBufferPointer(), rBn.mNb.GetActiveSize(), rBn.mSign );
 }
 
 
@@ -398,6 +613,8 @@ BigNum::operator += ( const BigNum& rBn )
 BigNum
 BigNum::operator - ( const BigNum& rBn ) const
 {
+	STATS_CALL( STATS_SUB, std::max( mNb.GetSize(), rBn.mNb.GetSize() ) );
+
 	// Pokud odecitame nuly
 	if ( rBn.IsZero() )
 		return *this;
@@ -405,163 +622,59 @@ BigNum::operator - ( const BigNum& rBn ) const
 	if ( IsZero() )
 		return -rBn;
 
-	// Pokud od kladneho cisla odecitame zaporne cislo
-	if ( mSign == Positive && rBn.mSign == Negative )
-	{
-		BigNum *pBn = const_cast< BigNum* > ( &rBn );
-		pBn->mSign = Positive;
-		BigNum result = *this + *pBn;
-		pBn->mSign = Negative;
-		return result;
-	}
-	// Pokud od zaporneho cisla odecitame kladne cislo
-	else if ( mSign == Negative && rBn.mSign == Positive )
-	{
-
-		BigNum *pThis = const_cast< BigNum* > ( this );
-		BigNum *pBn = const_cast< BigNum* > ( &rBn );
-
-		pThis->mSign = Positive;
-		pBn->mSign = Positive;
-
-		BigNum result = ( *pThis ) + ( *pBn );
-
-		pThis->mSign = Negative;
-		pBn->mSign = Negative;
-		result.mSign = Negative;
-
-		return result;
-	}
-	// Pokud od zaporneho cisla odecitame zaporne cislo
-	else if ( mSign == Negative && rBn.mSign == Negative )
-	{
-		BigNum *pThis = const_cast< BigNum* > ( this );
-		BigNum *pBn = const_cast< BigNum* > ( &rBn );
-
-		pThis->mSign = Positive;
-		pBn->mSign = Positive;
-
-		BigNum result = ( *pBn ) - ( *pThis );
+	// Odecteni je pricteni cisla s opacnym znamenkem
+	return AddSigned( mNb.GetBufferPointer(), mNb.GetActiveSize(), mSign,
+	                  rBn.mNb.GetBufferPointer(), rBn.mNb.GetActiveSize(),
+	                  rBn.mSign == Positive ? Negative : Positive );
+}
 
-		pThis->mSign = Positive;
-		pBn->mSign = Negative;
 
-		return result;
-	}
+BigNum&
+BigNum::operator -= ( const BigNum& rBn )
+{
+	*this = *this - rBn;
+	return *this;
+}
 
-	// Pokud by mel byt vysledek zaporny
-	if ( rBn > *this )
-	{
-		BigNum *pBn = const_cast< BigNum* > ( &rBn );
-		pBn->mSign = Positive;
-		BigNum result = ( *pBn ) - ( *this );
-		result.mSign = Negative;
-		return result;
-	}
 
-	size_t activeDoubleWords1 = mNb.GetActiveSize();
-	size_t activeDoubleWords2 = rBn.mNb.GetActiveSize();
-	size_t result_size;
+BigNum
+BigNum::Multiply( const BigNum& a, const BigNum& b )
+{
+	STATS_CALL( STATS_MUL, a.mNb.GetActiveSize() * b.mNb.GetActiveSize() );
 
-	activeDoubleWords1 > activeDoubleWords2
-		? result_size = activeDoubleWords1
-		: result_size = activeDoubleWords2;
+	// Pokud je jedno z cisel nula, vysledek je nula.
+	if ( a.IsZero() || b.IsZero() )
+		return BigNum( 0 );
 
+	size_t active1 = a.mNb.GetActiveSize();
+	size_t active2 = b.mNb.GetActiveSize();
 	BigNum result;
+
 	try
 	{
-		result.mNb.Allocate( result_size );
+		result.mNb.Allocate( active1 + active2 );
 	}
 	catch ( AllocationFailedException& e )
 	{
 		throw e;
 	}
 
-	int64_t tmp;
-	bool    carry = false;
-	for ( size_t i = 0 ; i < result.mNb.GetSize() ; i++ )
-	{
-		tmp = static_cast< uint64_t >( mNb.Get( i ) )
-		    - static_cast< uint64_t >( rBn.mNb.Get( i ) );
-
-		if ( carry )
-		{
-			tmp--;
-			carry = false;
-		}
+	MultiplyLimbs( result.mNb.GetBufferPointer(), a.mNb.GetBufferPointer(), active1,
+	               b.mNb.GetBufferPointer(), active2 );
+	result.mNb.Normalize();
 
-		if ( tmp < 0 )
-		{
-			tmp += DWORD_VALUE;
-			carry = true;
-		}
+	if ( a.mSign != b.mSign )
+		result.mSign = Negative;
 
-		result.mNb.Set( i, tmp );
-	}
-	
+	BIGNUM_CHECK( result );
 	return result;
 }
 
 
-BigNum&
-BigNum::operator -= ( const BigNum& rBn )
-{
-	*this = *this - rBn;
-	return *this;
-}
-
-
 BigNum
 BigNum::operator * ( const BigNum& rBn ) const
 {
-	BigNum result( 0 );
-
-	// Pokud je jedno z cisel nula, vysledek je nula.
-	if ( IsZero() || rBn.IsZero() )
-		return result;
-	
-	uint64_t tmp;
-	uint32_t carry;
-	size_t   i;
-	size_t   j;
-
-	for ( i = 0 ; i < rBn.mNb.GetActiveSize() ; i++ )
-	{
-		BigNum subresult;
-		try
-		{
-			subresult.mNb.Allocate( mNb.GetActiveSize() + i + 1 );
-		}
-		catch ( AllocationFailedException& e )
-		{
-			throw e;
-		}
-
-		carry = 0;
-
-		for ( j = 0 ; j < mNb.GetActiveSize() ; j++ )
-		{
-			tmp = static_cast< uint64_t >( mNb.Get( j ) )
-			    * static_cast< uint64_t >( rBn.mNb.Get( i ) )
-				+ carry;
-			subresult.mNb.Set( i + j, tmp % DWORD_VALUE );
-			carry = tmp / DWORD_VALUE;
-		}
-
-		if ( carry > 0 )
-		{
-			subresult.mNb.Set( j + i, carry );
-		}
-
-		result += subresult;
-	}
-
-	if ( mSign == Negative && rBn.mSign == Positive )
-		result.mSign = Negative;
-	if ( mSign == Positive && rBn.mSign == Negative )
-		result.mSign = Negative;
-
-	return result;
+	return Multiply( *this, rBn );
 }
 
 
@@ -721,11 +834,8 @@ BigNum::operator == ( const BigNum& rBn ) const
 	if ( activeDoubleWords1 != activeDoubleWords2 )
 		return false;
 	
-	for ( size_t i = 0 ; i < mNb.GetSize() ; i++ )
-		if ( mNb.Get( i ) != rBn.mNb.Get( i ) )
-			return false;
-
-	return true;
+	return LimbsCompare( mNb.GetBufferPointer(), rBn.mNb.GetBufferPointer(),
+	                     activeDoubleWords1 ) == 0;
 }
 
 
@@ -761,16 +871,8 @@ BigNum::operator > ( const BigNum& rBn ) const
 	else if ( activeDoubleWords1 > activeDoubleWords2 )
 		return true;
 
-	size_t i = activeDoubleWords1;
-	while ( i-- )
-	{
-		if ( mNb.Get( i ) > rBn.mNb.Get( i ) )
-			return true;
-		else if ( mNb.Get( i ) < rBn.mNb.Get( i ) )
-			return false;
-	}
-
-	return false;
+	return LimbsCompare( mNb.GetBufferPointer(), rBn.mNb.GetBufferPointer(),
+	                     activeDoubleWords1 ) > 0;
 }
 
 
@@ -801,16 +903,8 @@ BigNum::operator >= ( const BigNum& rBn ) const
 	else if ( activeDoubleWords1 > activeDoubleWords2 )
 		return true;
 
-	size_t i = activeDoubleWords1;
-	while ( i-- )
-	{
-		if ( mNb.Get( i ) > rBn.mNb.Get( i ) )
-			return true;
-		else if ( mNb.Get( i ) < rBn.mNb.Get( i ) )
-			return false;
-	}
-
-	return true;
+	return LimbsCompare( mNb.GetBufferPointer(), rBn.mNb.GetBufferPointer(),
+	                     activeDoubleWords1 ) >= 0;
 }
 
 
@@ -840,16 +934,8 @@ BigNum::operator < ( const BigNum& rBn ) const
 	else if ( activeDoubleWords1 > activeDoubleWords2 )
 		return false;
 
-	size_t i = activeDoubleWords1;
-	while ( i-- )
-	{
-		if ( mNb.Get( i ) < rBn.mNb.Get( i ) )
-			return true;
-		else if ( mNb.Get( i ) > rBn.mNb.Get( i ) )
-			return false;
-	}
-
-	return false;
+	return LimbsCompare( mNb.GetBufferPointer(), rBn.mNb.GetBufferPointer(),
+	                     activeDoubleWords1 ) < 0;
 }
 
 
@@ -871,25 +957,300 @@ BigNum::operator <= ( const BigNum& rBn ) const
 	if ( mSign == Positive && rBn.mSign == Negative )
 		return false;
 
-	// zjistime pocet aktivnich bitu v cislech
-	size_t activeDoubleWords1 = mNb.GetActiveSize();
-	size_t activeDoubleWords2 = rBn.mNb.GetActiveSize();
+	// zjistime pocet aktivnich bitu v cislech
+	size_t activeDoubleWords1 = mNb.GetActiveSize();
+	size_t activeDoubleWords2 = rBn.mNb.GetActiveSize();
+
+	if ( activeDoubleWords1 < activeDoubleWords2 )
+		return true;
+	else if ( activeDoubleWords1 > activeDoubleWords2 )
+		return false;
+
+	return LimbsCompare( mNb.GetBufferPointer(), rBn.mNb.GetBufferPointer(),
+	                     activeDoubleWords1 ) <= 0;
+}
+
+
+BigNum
+BigNum::AddScalar( uint64_t magnitude, bool negative ) const
+{
+	STATS_CALL( STATS_ADD, mNb.GetActiveSize() );
+
+	if ( magnitude == 0 )
+		return *this;
+
+	uint32_t limbs[ 2 ];
+	size_t   n = ScalarToLimbs( magnitude, limbs );
+
+	return AddSigned( mNb.GetBufferPointer(), mNb.GetActiveSize(), mSign,
+	                  limbs, n, negative ? Negative : Positive );
+}
+
+
+BigNum&
+BigNum::AddScalarInPlace( uint64_t magnitude, bool negative )
+{
+	STATS_CALL( STATS_ADD, mNb.GetActiveSize() );
+
+	if ( magnitude == 0 )
+		return *this;
+
+	uint32_t  limbs[ 2 ];
+	size_t    n      = ScalarToLimbs( magnitude, limbs );
+	size_t    active = mNb.GetActiveSize();
+	uint32_t* p      = mNb.GetBufferPointer();
+
+	// Stejna znamenka: absolutni hodnota roste, pridavame cislici
+	// jen pri prenosu z nejvyssi cislice
+	if ( !IsZero() && ( mSign == Negative ) == negative )
+	{
+		size_t   len = std::max( active, n );
+		uint32_t carry;
+
+		if ( mNb.GetSize() < len )
+			mNb.Reallocate( len );
+
+		p     = mNb.GetBufferPointer();
+		carry = LimbsAdd( p, p, limbs, n );
+		carry = LimbsAdd1( p + n, p + n, len - n, carry );
+
+		if ( carry )
+		{
+			if ( mNb.GetSize() < len + 1 )
+				mNb.Reallocate( len + 1 );
+			mNb.GetBufferPointer()[ len ] = carry;
+		}
+
+		mNb.Normalize();
+		return *this;
+	}
+
+	// Ruzna znamenka a |this| >= magnitude: odecteme na miste,
+	// znamenko zustava
+	if ( !IsZero() && CompareMagnitude( p, active, limbs, n ) >= 0 )
+	{
+		uint32_t borrow = LimbsSub( p, p, limbs, n );
+
+		LimbsSub1( p + n, p + n, active - n, borrow );
+		mNb.Normalize();
+
+		if ( IsZero() )
+			mSign = Positive;
+
+		return *this;
+	}
+
+	*this = AddScalar( magnitude, negative );
+	return *this;
+}
+
+
+BigNum
+BigNum::MultiplyScalar( uint64_t magnitude, bool negative ) const
+{
+	STATS_CALL( STATS_MUL, mNb.GetActiveSize() );
+
+	if ( IsZero() || magnitude == 0 )
+		return BigNum( 0 );
+
+	uint32_t limbs[ 2 ];
+	size_t   n      = ScalarToLimbs( magnitude, limbs );
+	size_t   active = mNb.GetActiveSize();
+	BigNum   result;
+
+	try
+	{
+		result.mNb.Allocate( active + n );
+	}
+	catch ( AllocationFailedException& e )
+	{
+		throw e;
+	}
+
+	gLimbKernels.mpMul( result.mNb.GetBufferPointer(), mNb.GetBufferPointer(), active, limbs, n );
+	result.mNb.Normalize();
+
+	if ( ( mSign == Negative ) != negative )
+		result.mSign = Negative;
+
+	BIGNUM_CHECK( result );
+	return result;
+}
+
+
+BigNum&
+BigNum::MultiplyScalarInPlace( uint64_t magnitude, bool negative )
+{
+	// Na miste umime jen jednu cislici
+	if ( magnitude > 0xFFFFFFFF || IsZero() )
+	{
+		*this = MultiplyScalar( magnitude, negative );
+		return *this;
+	}
+
+	STATS_CALL( STATS_MUL, mNb.GetActiveSize() );
+
+	if ( magnitude == 0 )
+	{
+		SetValue( 0u );
+		return *this;
+	}
+
+	size_t    active = mNb.GetActiveSize();
+	uint32_t* p      = mNb.GetBufferPointer();
+	uint32_t  carry  = gLimbKernels.mpMul1( p, p, active, static_cast< uint32_t >( magnitude ) );
+
+	if ( carry )
+	{
+		if ( mNb.GetSize() < active + 1 )
+			mNb.Reallocate( active + 1 );
+		mNb.GetBufferPointer()[ active ] = carry;
+	}
+
+	mNb.Normalize();
+
+	if ( negative )
+		mSign = mSign == Positive ? Negative : Positive;
+
+	return *this;
+}
+
+
+BigNum
+BigNum::DivideScalar( uint64_t magnitude, bool negative ) const
+{
+	if ( magnitude == 0 )
+		throw DivisionByZeroException();
+
+	// Delitel o dvou cislicich nechame na Divide()
+	if ( magnitude > 0xFFFFFFFF )
+	{
+		uint32_t limbs[ 2 ];
+		BigNum   v;
+
+		ScalarToLimbs( magnitude, limbs );
+		v.SetValue( limbs, 2 );
+		v.mSign = negative ? Negative : Positive;
+
+		return *this / v;
+	}
+
+	STATS_CALL( STATS_DIVIDE, mNb.GetActiveSize() );
+
+	if ( IsZero() )
+		return BigNum( 0 );
+
+	size_t active = mNb.GetActiveSize();
+	BigNum q;
+
+	try
+	{
+		q.mNb.Allocate( active );
+	}
+	catch ( AllocationFailedException& e )
+	{
+		throw e;
+	}
+
+	LimbsDivRem1( q.mNb.GetBufferPointer(), mNb.GetBufferPointer(), active,
+	              static_cast< uint32_t >( magnitude ) );
+	q.mNb.Normalize();
+
+	if ( !q.IsZero() && ( mSign == Negative ) != negative )
+		q.mSign = Negative;
+
+	BIGNUM_CHECK( q );
+	return q;
+}
+
+
+BigNum&
+BigNum::DivideScalarInPlace( uint64_t magnitude, bool negative )
+{
+	if ( magnitude > 0xFFFFFFFF || magnitude == 0 )
+	{
+		*this = DivideScalar( magnitude, negative );
+		return *this;
+	}
+
+	STATS_CALL( STATS_DIVIDE, mNb.GetActiveSize() );
+
+	uint32_t* p = mNb.GetBufferPointer();
+
+	LimbsDivRem1( p, p, mNb.GetActiveSize(), static_cast< uint32_t >( magnitude ) );
+	mNb.Normalize();
+
+	if ( IsZero() )
+		mSign = Positive;
+	else if ( negative )
+		mSign = mSign == Positive ? Negative : Positive;
+
+	return *this;
+}
+
+
+uint64_t
+BigNum::ModuloScalar( uint64_t magnitude ) const
+{
+	if ( magnitude == 0 )
+		throw DivisionByZeroException();
+
+	if ( magnitude <= 0xFFFFFFFF )
+	{
+		STATS_CALL( STATS_DIVIDE, mNb.GetActiveSize() );
+
+		return LimbsMod1( mNb.GetBufferPointer(), mNb.GetActiveSize(),
+		                  static_cast< uint32_t >( magnitude ) );
+	}
+
+	// Delitel o dvou cislicich nechame na Divide()
+	uint32_t limbs[ 2 ];
+	BigNum   u = *this;
+	BigNum   v;
+	BigNum   q;
+	BigNum   r;
+
+	ScalarToLimbs( magnitude, limbs );
+	v.SetValue( limbs, 2 );
+	u.mSign = Positive;
+	Divide( u, v, q, r );
+
+	return r.mNb.Get( 0 ) | ( static_cast< uint64_t >( r.mNb.Get( 1 ) ) << 32 );
+}
+
+
+BigNum&
+BigNum::ModuloScalarInPlace( uint64_t magnitude, bool negative )
+{
+	uint32_t limbs[ 2 ];
+
+	// Allocate() v SetValue() pouzije stavajici buffer
+	ScalarToLimbs( ModuloScalar( magnitude ), limbs );
+	SetValue( limbs, 2 );
+
+	if ( negative && !IsZero() )
+		mSign = Negative;
+
+	return *this;
+}
+
+
+int
+BigNum::CompareScalar( uint64_t magnitude, bool negative ) const
+{
+	// Nula je vzdy kladna, at je znamenko nastavene jakkoliv
+	bool thisNegative = mSign == Negative && !IsZero();
+
+	negative = negative && magnitude != 0;
 
-	if ( activeDoubleWords1 < activeDoubleWords2 )
-		return true;
-	else if ( activeDoubleWords1 > activeDoubleWords2 )
-		return false;
+	if ( thisNegative != negative )
+		return thisNegative ? -1 : 1;
 
-	size_t i = activeDoubleWords1;
-	while ( i-- )
-	{
-		if ( mNb.Get( i ) < rBn.mNb.Get( i ) )
-			return true;
-		else if ( mNb.Get( i ) > rBn.mNb.Get( i ) )
-			return false;
-	}
+	uint32_t limbs[ 2 ];
+	size_t   n   = ScalarToLimbs( magnitude, limbs );
+	int      cmp = CompareMagnitude( mNb.GetBufferPointer(), mNb.GetActiveSize(), limbs, n );
 
-	return true;
+	return thisNegative ? -cmp : cmp;
 }
 
 
@@ -916,9 +1277,7 @@ BigNum::SetValue( const std::string& rStrValue )
 			return false;
 		}
 
-	// Pokud je buffer alokovany, musime jej nejdrive uvolnit.
-	if ( mNb.IsBufferAllocated() )
-		mNb.Free();
+	// Allocate() pouzije stavajici buffer, pokud se do nej cislo vejde.
 
 	size_t str_len = rStrValue.length();
 	// Alokuje buffer o potrebne velikosti.
@@ -995,9 +1354,7 @@ BigNum::SetValue( uint intValue )
 	else
 		mSign = Positive;
 
-	// Pokud je buffer alokovany, musime jej nejdrive uvolnit.
-	if ( mNb.IsBufferAllocated() )
-		mNb.Free();
+	// Allocate() pouzije stavajici buffer, pokud se do nej cislo vejde.
 
 	try
 	{
@@ -1014,6 +1371,174 @@ BigNum::SetValue( uint intValue )
 }
 
 
+bool
+BigNum::SetValue( const uint32_t* pLimbs, size_t count )
+{
+	mSign = Positive;
+
+	if ( pLimbs == NULL || count == 0 )
+	{
+		mNb.Free();
+		return true;
+	}
+
+	try
+	{
+		mNb.Allocate( count );
+	}
+	catch ( AllocationFailedException& e )
+	{
+		throw e;
+	}
+
+	memcpy( mNb.GetBufferPointer(), pLimbs, count * sizeof( uint32_t ) );
+	mNb.Normalize();
+
+	return true;
+}
+
+
+/**
+ * \brief Testuje, zda-li je stroj little-endian (poradi bytu cislice
+ *  je pak stejne jako poradi bytu v NumberBuffer).
+ */
+static bool
+IsLittleEndianHost( void )
+{
+	const uint32_t probe = 1;
+
+	return *reinterpret_cast< const uint8_t* >( &probe ) == 1;
+}
+
+
+/**
+ * \brief Prohodi poradi bytu 32bitoveho cisla.
+ */
+static uint32_t
+SwapBytes32( uint32_t value )
+{
+#ifdef __GNUC__
+	return __builtin_bswap32( value );
+#else
+	return ( value >> 24 ) | ( ( value >> 8 ) & 0xFF00 )
+	     | ( ( value << 8 ) & 0xFF0000 ) | ( value << 24 );
+#endif // __GNUC__
+}
+
+
+bool
+BigNum::FromBytes( const char* pBytes, size_t count, ByteOrder order )
+{
+	mSign = Positive;
+
+	if ( pBytes == NULL || count == 0 )
+	{
+		mNb.Free();
+		return true;
+	}
+
+	// Allocate() pouzije stavajici buffer, pokud se do nej cislo vejde.
+	try
+	{
+		mNb.Allocate( ( count + 3 ) / 4 );
+	}
+	catch ( AllocationFailedException& e )
+	{
+		throw e;
+	}
+
+	uint32_t* p      = mNb.GetBufferPointer();
+	size_t    full   = count / 4;
+	size_t    rest   = count % 4;
+	bool      little = IsLittleEndianHost();
+	uint32_t  value;
+	size_t    i;
+
+	if ( order == LittleEndian )
+	{
+		if ( little )
+			memcpy( p, pBytes, count );
+		else
+		{
+			for ( i = 0 ; i < full ; i++ )
+			{
+				memcpy( &value, pBytes + 4 * i, 4 );
+				p[ i ] = SwapBytes32( value );
+			}
+			for ( i = 0 ; i < rest ; i++ )
+				p[ full ] |= static_cast< uint32_t >( static_cast< uint8_t >( pBytes[ 4 * full + i ] ) ) << ( 8 * i );
+		}
+	}
+	else
+	{
+		// Cislice i je v bytech [ count - 4 * ( i + 1 ), count - 4 * i )
+		for ( i = 0 ; i < full ; i++ )
+		{
+			memcpy( &value, pBytes + count - 4 * ( i + 1 ), 4 );
+			p[ i ] = little ? SwapBytes32( value ) : value;
+		}
+		for ( i = 0 ; i < rest ; i++ )
+			p[ full ] = ( p[ full ] << 8 ) | static_cast< uint8_t >( pBytes[ i ] );
+	}
+
+	mNb.Normalize();
+
+	return true;
+}
+
+
+size_t
+BigNum::ToBytes( char* pBytes, size_t width, ByteOrder order ) const
+{
+	size_t bytes = GetActiveBytes();
+
+	if ( width == 0 )
+		width = bytes;
+	else if ( bytes > width )
+		return 0;
+
+	const uint32_t* p      = mNb.GetBufferPointer();
+	size_t          full   = bytes / 4;
+	size_t          rest   = bytes % 4;
+	bool            little = IsLittleEndianHost();
+	uint32_t        value;
+	size_t          i;
+
+	if ( order == LittleEndian )
+	{
+		if ( little )
+			memcpy( pBytes, p, bytes );
+		else
+		{
+			for ( i = 0 ; i < full ; i++ )
+			{
+				value = SwapBytes32( p[ i ] );
+				memcpy( pBytes + 4 * i, &value, 4 );
+			}
+			for ( i = 0 ; i < rest ; i++ )
+				pBytes[ 4 * full + i ] = static_cast< char >( p[ full ] >> ( 8 * i ) );
+		}
+		memset( pBytes + bytes, 0, width - bytes );
+	}
+	else
+	{
+		// Nuly na zacatku, pak cislice od nejvyssi
+		char* pEnd = pBytes + width;
+
+		memset( pBytes, 0, width - bytes );
+		for ( i = 0 ; i < full ; i++ )
+		{
+			value = little ? SwapBytes32( p[ i ] ) : p[ i ];
+			memcpy( pEnd - 4 * ( i + 1 ), &value, 4 );
+		}
+		for ( i = 0 ; i < rest ; i++ )
+			*( pEnd - 4 * full - i - 1 ) = static_cast< char >( p[ full ] >> ( 8 * i ) );
+	}
+
+	return width;
+}
+
+
 int32_t
 BigNum::ToInt32( void ) const
 {
@@ -1044,7 +1569,7 @@ BigNum::ToDecString( void ) const
 	do
 	{
 		str_value.insert( str_value.begin(),
-		                  IntToHexChar( ( bn % 10 ).mNb.Get( 0 ) ) );
+		                  IntToHexChar( bn % 10 ) );
 		bn /= 10;
 	} while ( !bn.IsZero() );
 
@@ -1248,6 +1773,8 @@ BigNum::RabinMillerPrimalityTest( uint accuracy ) const
 
 	for ( i = 0 ; i < accuracy ; i++ )
 	{
+		STATS_CALL( STATS_RABIN_MILLER, mNb.GetActiveSize() );
+
 		BigNum a = BigNum::GenerateRandomMax( pMinusOne );
 
 		if ( BigNum::Gcd( a, *this ) != 1 )
@@ -1266,7 +1793,7 @@ BigNum::RabinMillerPrimalityTest( uint accuracy ) const
 				break;
 			}
 			
-			b = ( b * b ) % *this;
+			b = MultiplyModulo( b, b, *this );
 		}
 
 		if ( iType == Composite )
@@ -1280,15 +1807,7 @@ BigNum::RabinMillerPrimalityTest( uint accuracy ) const
 bool 
 BigNum::IsZero( void ) const
 {
-	if ( !mNb.IsBufferAllocated() )
-		return true;
-
-	size_t i = mNb.GetSize();
-	while ( i-- )
-		if ( mNb.Get( i ) != 0 )
-			return false;
-
-	return true;
+	return mNb.GetActiveSize() == 0;
 }
 
 
@@ -1325,12 +1844,19 @@ BigNum::IsOdd( void ) const
 size_t
 BigNum::GetActiveBytes( void ) const
 {
-	size_t i = GetSize() * 4;
+	size_t active = mNb.GetActiveSize();
 
-	while ( i-- )
-		if ( GetByte( i ) != 0 )
-			break;
-	return i + 1;
+	if ( active == 0 )
+		return 0;
+
+	// Nenulove byty nejvyssi cislice
+	uint32_t top   = mNb.Get( active - 1 );
+	size_t   bytes = 4;
+
+	while ( ( top >> ( 8 * ( bytes - 1 ) ) ) == 0 )
+		bytes--;
+
+	return ( active - 1 ) * 4 + bytes;
 }
 
 
@@ -1568,6 +2094,12 @@ BigNum::ShortDivide( const BigNum& u, uint16_t v, BigNum& q, BigNum& r )
 bool
 BigNum::Divide( const BigNum& u, const BigNum& v, BigNum& q, BigNum& r )
 {
+	STATS_CALL( STATS_DIVIDE, u.mNb.GetActiveSize() );
+
+	// Normalizovane kopie un a vn jsou z areny, podil a zbytek se na
+	// konci (pokud nejsme uvnitr jine operace) presunou na haldu
+	NumberArenaScope arena( &q.mNb, &r.mNb );
+
 	//
 	// Algoritmus pro deleni je prevzat z knihy The Art of Computer Programming
 	// od Donalda E. Knutha (viz [1] v sekci reference v dokumentaci).
@@ -1634,120 +2166,205 @@ BigNum::Divide( const BigNum& u, const BigNum& v, BigNum& q, BigNum& r )
 		throw e;
 	}
 
+	uint32_t* pQ = q.mNb.GetBufferPointer();
+	uint32_t* pR = r.mNb.GetBufferPointer();
+
 	//
 	// Pokud ma delitel velikost = 1 ( 32 bitu )
 	if ( n == 1 )
 	{
-		//uint64_t b = DWORD_VALUE;
-		int64_t  j;
-		uint64_t k;
+		pR[ 0 ] = LimbsDivRem1( pQ, u.mNb.GetBufferPointer(), m, v.mNb.Get( 0 ) );
 
-		k = 0;
-		for ( j = m - 1 ; j >= 0 ; j-- )
-		{
-			q.mNb.Set( j,
-				( ( k << 32 ) + u.mNb.Get( j ) ) / v.mNb.Get( 0 ) );
-			k = ( ( k << 32 ) + u.mNb.Get( j ) ) - ( q.mNb.Get( j ) * v.mNb.Get( 0 ) );
-		}
-		r.mNb.Set( 0, k );
+		q.mNb.Normalize();
+		r.mNb.Normalize();
 
 		return true;
 	}
 
-	// Normalizovany delenec ( u )
-	BigNum un( u, u.mNb.GetActiveSize() + 1 );
+	// Normalizovany delenec ( u ), o cislici delsi
+	BigNum un( u, m + 1 );
 	// Normalizovany delitel ( v )
-	BigNum vn( v );
+	BigNum vn( v, n );
+
+	uint32_t*    pUn = un.mNb.GetBufferPointer();
+	uint32_t*    pVn = vn.mNb.GetBufferPointer();
 	// Pocet bitu o ktere bude posunuto u a v
-	int    s = 0;
+	unsigned int s   = 0;
 
+	// Provedeme normalizaci, nejvyssi bit delitele musi byt jednicka
+	while ( ( ( pVn[ n - 1 ] << s ) & 0x80000000 ) == 0 )
+		s++;
 
-	// Provedeme normalizaci...
-	while ( ( vn.mNb[ n - 1 ] & 0x80000000 ) != 0x80000000 )
+	if ( s )
 	{
-		vn <<= 1;
-		s++;
+		LimbsShiftLeft( pVn, pVn, n, s );
+		pUn[ m ] = LimbsShiftLeft( pUn, pUn, m, s );
 	}
-	un <<= s;
 
-	bool     still = false;
-	uint64_t b = DWORD_VALUE;
-	uint64_t qhat;
-	uint64_t rhat;
-	uint64_t p;
-	int64_t  i;
-	int64_t  j;
-	int64_t  k;
-	int64_t  t;
+	DivideLimbs( pQ, pUn, m, pVn, n );
+
+	// Zbytek je v dolnich n cislicich un, jeste jej posuneme zpet
+	if ( s )
+		LimbsShiftRight( pR, pUn, n, s );
+	else
+		memcpy( pR, pUn, n * sizeof( uint32_t ) );
+
+	q.mNb.Normalize();
+	r.mNb.Normalize();
 
-	for ( j = m - n ; j >= 0 ; j-- )
+	if ( u.mSign == Negative && v.mSign == Positive )
+		q.mSign = Negative;
+	else if ( u.mSign == Positive && v.mSign == Negative )
 	{
-		qhat = ( ( uint64_t( un.mNb[ j + n ] ) << 32 ) + uint64_t( un.mNb[ j + n - 1 ] ) ) / uint64_t( vn.mNb[ n - 1 ] );
-		rhat = ( ( uint64_t( un.mNb[ j + n ] ) << 32 ) + uint64_t( un.mNb[ j + n - 1 ] ) ) - qhat * uint64_t( vn.mNb[ n - 1 ] );
+		q.mSign = Negative;
+		r.mSign = Negative;
+	}
+	else if ( u.mSign == Negative && v.mSign == Negative )
+		r.mSign = Negative;
 
-		do
-		{
-			if ( ( qhat >= b ) || ( ( qhat * uint64_t( vn.mNb[ n - 2 ] ) ) > ( ( rhat << 32 ) + uint64_t( un.mNb[ j + n - 2 ] ) ) ) )
-			{
-				qhat = qhat - 1;
-				rhat = rhat + uint64_t( vn.mNb[ n - 1 ] );
+	BIGNUM_CHECK( q );
+	BIGNUM_CHECK( r );
 
-				if ( rhat < b )
-					still = true;
-				else
-					still = false;
-			}
-			else
-				still = false;
-		} while ( still == true );
+	return true;
+}
+
+
+BigNum
+BigNum::MultiplyModulo( const BigNum& a, const BigNum& b, const BigNum& m )
+{
+	// Pravidla pro znamenko zbytku zapornych cisel ma Divide()
+	if ( a.mSign == Negative || b.mSign == Negative || m.mSign == Negative )
+		return Multiply( a, b ) % m;
+
+	if ( m.IsZero() )
+		throw DivisionByZeroException();
+
+	BigNum r;
+
+	if ( a.IsZero() || b.IsZero() )
+		return r;
+
+	size_t na = a.mNb.GetActiveSize();
+	size_t nb = b.mNb.GetActiveSize();
+	size_t n  = m.mNb.GetActiveSize();
+
+	STATS_CALL( STATS_MUL, na * nb );
+	STATS_CALL( STATS_DIVIDE, na + nb );
+
+	// Soucin a normalizovane modulo jsou z areny, presune se jen zbytek
+	{
+		NumberArenaScope arena( &r.mNb );
+
+		// Soucin ma o cislici navic pro normalizaci
+		BigNum    t( 0, na + nb + 1 );
+		uint32_t* pT  = t.mNb.GetBufferPointer();
+		size_t    len = na + nb;
+
+		MultiplyLimbs( pT, a.mNb.GetBufferPointer(), na, b.mNb.GetBufferPointer(), nb );
+
+		if ( pT[ len - 1 ] == 0 )
+			len--;
 
-		k = 0;
-		for ( i = 0 ; i < n ; i++ )
+		if ( n == 1 )
 		{
-			p = qhat * uint64_t( vn.mNb[ i ] );
-			t = uint64_t( un.mNb[ i + j ] ) - k - uint64_t( p & 0xFFFFFFFF );
-			un.mNb.Set( i + j, t );
-			k = ( p >> 32 ) - ( t >> 32 );
+			r.mNb.Allocate( 1 );
+			r.mNb.Set( 0, LimbsMod1( pT, len, m.mNb.Get( 0 ) ) );
 		}
-		t = un.mNb[ j + n ] - k;
-		un.mNb.Set( j + n, t );
-
-		q.mNb.Set( j, qhat );
-		if ( t < 0 )
+		else if ( len < n || ( len == n && LimbsCompare( pT, m.mNb.GetBufferPointer(), n ) < 0 ) )
+		{
+			// Soucin je mensi nez modulo
+			r.mNb.Allocate( len );
+			memcpy( r.mNb.GetBufferPointer(), pT, len * sizeof( uint32_t ) );
+			r.mNb.Normalize();
+		}
+		else
 		{
-			q.mNb.Set( j, q.mNb[ j ] - 1 );
-			k = 0;
+			BigNum       vn( m, n );
+			uint32_t*    pVn = vn.mNb.GetBufferPointer();
+			unsigned int s   = 0;
 
-			for ( i = 0; i < n; i++ )
+			// Stejna normalizace jako v Divide()
+			while ( ( ( pVn[ n - 1 ] << s ) & 0x80000000 ) == 0 )
+				s++;
+
+			if ( s )
 			{
-				t = uint64_t( un.mNb[ i + j ] ) + uint64_t( vn.mNb[ i ] ) + k;
-				un.mNb.Set( i + j, t );
-				k = static_cast< uint64_t >( t ) >> 32;
+				LimbsShiftLeft( pVn, pVn, n, s );
+				pT[ len ] = LimbsShiftLeft( pT, pT, len, s );
 			}
-			un.mNb.Set( j + n, uint64_t( un.mNb[ j + n ] ) + k );
+
+			DivideLimbs( NULL, pT, len, pVn, n );
+
+			r.mNb.Allocate( n );
+			if ( s )
+				LimbsShiftRight( r.mNb.GetBufferPointer(), pT, n, s );
+			else
+				memcpy( r.mNb.GetBufferPointer(), pT, n * sizeof( uint32_t ) );
+			r.mNb.Normalize();
 		}
 	}
 
-	for ( i = 0 ; i < n ; i++ )
-		r.mNb.Set( i, ( uint64_t( un.mNb[ i ] ) >> s ) | ( uint64_t( un.mNb[ i + 1 ] ) << ( 32 - s ) ) );
-	
-	if ( u.mSign == Negative && v.mSign == Positive )
-		q.mSign = Negative;
-	else if ( u.mSign == Positive && v.mSign == Negative )
+	BIGNUM_CHECK( r );
+	return r;
+}
+
+
+BigNum
+BigNum::MultiplyAdd( const BigNum& c, const BigNum& a, const BigNum& b )
+{
+	if ( a.mSign == Negative || b.mSign == Negative || c.mSign == Negative )
+		return c + Multiply( a, b );
+
+	if ( a.IsZero() || b.IsZero() )
+		return c;
+
+	size_t na   = a.mNb.GetActiveSize();
+	size_t nb   = b.mNb.GetActiveSize();
+	size_t size = std::max( c.mNb.GetActiveSize(), na + nb ) + 1;
+
+	STATS_CALL( STATS_MUL, na * nb );
+
+	// Kopie c ma misto pro cely soucet, radky a * b[ i ] pricitame do ni
+	BigNum          r( c, size );
+	uint32_t*       pR = r.mNb.GetBufferPointer();
+	const uint32_t* pA = a.mNb.GetBufferPointer();
+	const uint32_t* pB = b.mNb.GetBufferPointer();
+	uint32_t        carry;
+	size_t          i;
+
+	if ( na >= gKaratsubaThreshold && nb >= gKaratsubaThreshold )
 	{
-		q.mSign = Negative;
-		r.mSign = Negative;
+		// Po radcich by se nasobilo skolnim algoritmem, soucin proto
+		// spocitame v arene Karatsubou a pricteme najednou
+		NumberArenaScope arena;
+		NumberBuffer     t( na + nb );
+		uint32_t*        pT = t.GetBufferPointer();
+
+		MultiplyLimbs( pT, pA, na, pB, nb );
+		carry = LimbsAdd( pR, pR, pT, na + nb );
+		LimbsAdd1( pR + na + nb, pR + na + nb, size - na - nb, carry );
+	}
+	else
+	{
+		for ( i = 0 ; i < nb ; i++ )
+		{
+			carry = gLimbKernels.mpAddMul1( pR + i, pA, na, pB[ i ] );
+			LimbsAdd1( pR + i + na, pR + i + na, size - i - na, carry );
+		}
 	}
-	else if ( u.mSign == Negative && v.mSign == Negative )
-		r.mSign = Negative;
 
-	return true;
+	r.mNb.Normalize();
+
+	BIGNUM_CHECK( r );
+	return r;
 }
 
 
 BigNum
 BigNum::Gcd( const BigNum& u, const BigNum& v )
 {
+	STATS_CALL( STATS_GCD, std::max( u.mNb.GetSize(), v.mNb.GetSize() ) );
+
 	//
 	// Algoritmus pro vypocet nejvetsiho spolecneho delitele je prevzat 
 	// z Wikipedie (http://en.wikipedia.org/wiki/Binary_GCD_algorithm).
@@ -1795,22 +2412,32 @@ BigNum::Lcm( const BigNum& u, const BigNum& v )
 BigNum
 BigNum::ModularExponentiation( const BigNum& b, const BigNum& e, const BigNum& m )
 {
+	STATS_CALL( STATS_MODEXP, m.mNb.GetActiveSize() );
+
 	//
 	// Algoritmus pro vypocet modularniho umocneni je prevzat z Wikipedie
 	// (http://en.wikipedia.org/wiki/Modular_exponentiation).
 	//
 
 	BigNum a = 1;
-	BigNum g = b % m;
 
-	int i;
-	for ( i = e.GetBitCnt() - 1 ; i >= 0 ; i-- )
+	// Docasne soucny a zbytky v cyklu bereme z areny (viz NumberArena),
+	// opakovane se tak pouzivaji stale tytez buffery
 	{
-		a = ( a * a ) % m;
-		if ( e.TestBit( i ) )
-			a = ( a * g ) % m;
+		NumberArenaScope arena( &a.mNb );
+
+		BigNum g = b % m;
+
+		int i;
+		for ( i = e.GetBitCnt() - 1 ; i >= 0 ; i-- )
+		{
+			a = MultiplyModulo( a, a, m );
+			if ( e.TestBit( i ) )
+				a = MultiplyModulo( a, g, m );
+		}
 	}
 
+	BIGNUM_CHECK( a );
 	return a;
 }
 
@@ -1818,6 +2445,8 @@ BigNum::ModularExponentiation( const BigNum& b, const BigNum& e, const BigNum& m
 BigNum
 BigNum::ModularInverse( const BigNum& u, const BigNum& v )
 {
+	STATS_CALL( STATS_MODINV, v.mNb.GetActiveSize() );
+
 	BigNum u1, u3, v1, v3, t1, t3, q, w, inv;
 	int    bIterations;
 
@@ -1848,6 +2477,8 @@ BigNum::ModularInverse( const BigNum& u, const BigNum& v )
 	else
 		inv = u1;
 
+	BIGNUM_CHECK( inv );
+
 	if ( u3 == 1 )
 		return inv;
 	else
@@ -1855,6 +2486,108 @@ BigNum::ModularInverse( const BigNum& u, const BigNum& v )
 }
 
 
+/**
+ * \brief Montgomeryho nasobeni r = a * b * R^(-1) mod m.
+ *
+ * Vsechna pole maji n cislic, a i b musi byt mensi nez m. Pole pT
+ * slouzi jako pracovni prostor a musi mit alespon 2n + 2 cislic.
+ * Pole pR se muze prekryvat s pA nebo pB. Pocita se jadrem podle
+ * procesoru (viz LimbKernels).
+ */
+static void
+MontgomeryMultiply( uint32_t* pR, const uint32_t* pA, const uint32_t* pB,
+                    const uint32_t* pM, size_t n, uint32_t mInv, uint32_t* pT )
+{
+	STATS_CALL( STATS_MONTGOMERY, n );
+
+	gLimbKernels.mpMontMul( pR, pA, pB, pM, n, mInv, pT );
+}
+
+
+uint32_t
+BigNum::MontgomeryInverse( const BigNum& m )
+{
+	uint32_t m0 = m.mNb.Get( 0 );
+	uint32_t x  = m0;
+
+	// Newtonova iterace x = x * ( 2 - m0 * x ), kazdy krok zdvojnasobi
+	// pocet platnych bitu (pro liche m0 plati m0 * m0 = 1 mod 8).
+	x *= 2 - m0 * x;
+	x *= 2 - m0 * x;
+	x *= 2 - m0 * x;
+	x *= 2 - m0 * x;
+
+	return -x;
+}
+
+
+BigNum
+BigNum::MontgomeryRR( const BigNum& m )
+{
+	size_t n = m.GetActiveSize();
+	BigNum r;
+
+	r.mNb.Allocate( 2 * n + 1 );
+	r.mNb.Set( 2 * n, 1 );
+
+	return r % m;
+}
+
+
+BigNum
+BigNum::MontgomeryExponentiation( const BigNum& b, const BigNum& e,
+                                  const BigNum& m, uint32_t mInv,
+                                  const BigNum& rr )
+{
+	if ( m.IsZero() )
+		throw DivisionByZeroException();
+
+	if ( m.IsEven() )
+		throw ArithmeticException();
+
+	size_t n = m.GetActiveSize();
+
+	STATS_CALL( STATS_MODEXP, n );
+
+	BigNum base = ( b >= m || b.IsNegative() ) ? b % m : b;
+
+	// Vsechny operandy zarovname na n cislic.
+	BigNum x( rr, n );
+	BigNum g( base, n );
+	BigNum mm( m, n );
+	BigNum one( 1, n );
+	BigNum t( 0, 2 * n + 2 );
+
+	uint32_t* pX   = x.mNb.GetBufferPointer();
+	uint32_t* pG   = g.mNb.GetBufferPointer();
+	uint32_t* pM   = mm.mNb.GetBufferPointer();
+	uint32_t* pOne = one.mNb.GetBufferPointer();
+	uint32_t* pT   = t.mNb.GetBufferPointer();
+
+	// g = b * R mod m
+	MontgomeryMultiply( pG, pG, pX, pM, n, mInv, pT );
+	// x = R mod m, tj. jednicka v Montgomeryho reprezentaci
+	MontgomeryMultiply( pX, pX, pOne, pM, n, mInv, pT );
+
+	int i;
+	for ( i = e.GetBitCnt() - 1 ; i >= 0 ; i-- )
+	{
+		MontgomeryMultiply( pX, pX, pX, pM, n, mInv, pT );
+		if ( e.TestBit( i ) )
+			MontgomeryMultiply( pX, pX, pG, pM, n, mInv, pT );
+	}
+
+	// Prevedeme vysledek zpet z Montgomeryho reprezentace.
+	MontgomeryMultiply( pX, pX, pOne, pM, n, mInv, pT );
+
+	// Do x se zapisovalo primo, pocet cislic je nutne prepocitat
+	x.mNb.Normalize();
+	BIGNUM_CHECK( x );
+
+	return x;
+}
+
+
 void
 BigNum::SeedRandom( unsigned int seed )
 {
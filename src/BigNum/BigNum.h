@@ -30,6 +30,10 @@
 #include "NumberBuffer.h"
 
 
+// Kontrola invariant vysledku operace (jen s BIGNUM_DEBUG)
+#define BIGNUM_CHECK( bn ) BIGNUM_ASSERT( ( bn ).IsNormalized() )
+
+
 using std::string;
 
 
@@ -43,6 +47,7 @@ class BigNum
 public:
 	enum Sign { Positive, Negative };
 	enum IntegerType { Composite, ProbablyPrime, Prime };
+	enum ByteOrder { LittleEndian, BigEndian };
 	
 
 	/**
@@ -176,6 +181,9 @@ public:
 	/**
 	 * \brief Operator nasobeni.
 	 *
+	 * Soucin ( a * b ) % m a soucet c + a * b lze spocitat bez
+	 * mezivysledku pomoci MultiplyModulo() a MultiplyAdd().
+	 *
 	 * \return Vysledek nasobeni.
 	 */
 	BigNum operator * ( const BigNum& rBn ) const;
@@ -287,6 +295,157 @@ public:
 	bool operator <= ( const BigNum& rBn ) const;
 
 
+	/**
+	 * \brief Scitani a odcitani maleho cisla.
+	 *
+	 * Operace s malymi cisly pracuji primo s cislicemi a nevytvari docasny
+	 * BigNum pres implicitni konstruktor. Pretizeni jsou pro vsechny
+	 * zakladni celociselne typy od int vyse (uint32_t, uint64_t i size_t
+	 * jsou jen jejich jine nazvy), aby zadny z nich nebyl nejednoznacny.
+	 * Zaporna cisla se berou se znamenkem.
+	 */
+	BigNum operator + ( int value ) const { return AddScalar( IntMagnitude( value ), value < 0 ); };
+	BigNum operator + ( unsigned int value ) const { return AddScalar( value, false ); };
+	BigNum operator + ( long value ) const { return AddScalar( IntMagnitude( value ), value < 0 ); };
+	BigNum operator + ( unsigned long value ) const { return AddScalar( value, false ); };
+	BigNum operator + ( long long value ) const { return AddScalar( IntMagnitude( value ), value < 0 ); };
+	BigNum operator + ( unsigned long long value ) const { return AddScalar( value, false ); };
+	BigNum operator - ( int value ) const { return AddScalar( IntMagnitude( value ), value >= 0 ); };
+	BigNum operator - ( unsigned int value ) const { return AddScalar( value, true ); };
+	BigNum operator - ( long value ) const { return AddScalar( IntMagnitude( value ), value >= 0 ); };
+	BigNum operator - ( unsigned long value ) const { return AddScalar( value, true ); };
+	BigNum operator - ( long long value ) const { return AddScalar( IntMagnitude( value ), value >= 0 ); };
+	BigNum operator - ( unsigned long long value ) const { return AddScalar( value, true ); };
+
+
+	/**
+	 * \brief Pricteni a odecteni maleho cisla na miste.
+	 *
+	 * Pokud se vysledek vejde do bufferu, nic se nealokuje.
+	 */
+	BigNum& operator += ( int value ) { return AddScalarInPlace( IntMagnitude( value ), value < 0 ); };
+	BigNum& operator += ( unsigned int value ) { return AddScalarInPlace( value, false ); };
+	BigNum& operator += ( long value ) { return AddScalarInPlace( IntMagnitude( value ), value < 0 ); };
+	BigNum& operator += ( unsigned long value ) { return AddScalarInPlace( value, false ); };
+	BigNum& operator += ( long long value ) { return AddScalarInPlace( IntMagnitude( value ), value < 0 ); };
+	BigNum& operator += ( unsigned long long value ) { return AddScalarInPlace( value, false ); };
+	BigNum& operator -= ( int value ) { return AddScalarInPlace( IntMagnitude( value ), value >= 0 ); };
+	BigNum& operator -= ( unsigned int value ) { return AddScalarInPlace( value, true ); };
+	BigNum& operator -= ( long value ) { return AddScalarInPlace( IntMagnitude( value ), value >= 0 ); };
+	BigNum& operator -= ( unsigned long value ) { return AddScalarInPlace( value, true ); };
+	BigNum& operator -= ( long long value ) { return AddScalarInPlace( IntMagnitude( value ), value >= 0 ); };
+	BigNum& operator -= ( unsigned long long value ) { return AddScalarInPlace( value, true ); };
+
+
+	/**
+	 * \brief Nasobeni malym cislem.
+	 */
+	BigNum operator * ( int value ) const { return MultiplyScalar( IntMagnitude( value ), value < 0 ); };
+	BigNum operator * ( unsigned int value ) const { return MultiplyScalar( value, false ); };
+	BigNum operator * ( long value ) const { return MultiplyScalar( IntMagnitude( value ), value < 0 ); };
+	BigNum operator * ( unsigned long value ) const { return MultiplyScalar( value, false ); };
+	BigNum operator * ( long long value ) const { return MultiplyScalar( IntMagnitude( value ), value < 0 ); };
+	BigNum operator * ( unsigned long long value ) const { return MultiplyScalar( value, false ); };
+	BigNum& operator *= ( int value ) { return MultiplyScalarInPlace( IntMagnitude( value ), value < 0 ); };
+	BigNum& operator *= ( unsigned int value ) { return MultiplyScalarInPlace( value, false ); };
+	BigNum& operator *= ( long value ) { return MultiplyScalarInPlace( IntMagnitude( value ), value < 0 ); };
+	BigNum& operator *= ( unsigned long value ) { return MultiplyScalarInPlace( value, false ); };
+	BigNum& operator *= ( long long value ) { return MultiplyScalarInPlace( IntMagnitude( value ), value < 0 ); };
+	BigNum& operator *= ( unsigned long long value ) { return MultiplyScalarInPlace( value, false ); };
+
+
+	/**
+	 * \brief Deleni malym cislem.
+	 *
+	 * Znamenka jako u Divide(), deleni nulou vyhodi DivisionByZeroException.
+	 */
+	BigNum operator / ( int value ) const { return DivideScalar( IntMagnitude( value ), value < 0 ); };
+	BigNum operator / ( unsigned int value ) const { return DivideScalar( value, false ); };
+	BigNum operator / ( long value ) const { return DivideScalar( IntMagnitude( value ), value < 0 ); };
+	BigNum operator / ( unsigned long value ) const { return DivideScalar( value, false ); };
+	BigNum operator / ( long long value ) const { return DivideScalar( IntMagnitude( value ), value < 0 ); };
+	BigNum operator / ( unsigned long long value ) const { return DivideScalar( value, false ); };
+	BigNum& operator /= ( int value ) { return DivideScalarInPlace( IntMagnitude( value ), value < 0 ); };
+	BigNum& operator /= ( unsigned int value ) { return DivideScalarInPlace( value, false ); };
+	BigNum& operator /= ( long value ) { return DivideScalarInPlace( IntMagnitude( value ), value < 0 ); };
+	BigNum& operator /= ( unsigned long value ) { return DivideScalarInPlace( value, false ); };
+	BigNum& operator /= ( long long value ) { return DivideScalarInPlace( IntMagnitude( value ), value < 0 ); };
+	BigNum& operator /= ( unsigned long long value ) { return DivideScalarInPlace( value, false ); };
+
+
+	/**
+	 * \brief Zbytek po deleni malym cislem.
+	 *
+	 * Zbytek se vraci jako cislo typu delitele, nic se nealokuje. Jako
+	 * u Divide() je zbytek zaporny jen pri zapornem deliteli.
+	 */
+	int operator % ( int value ) const
+	{
+		int r = static_cast< int >( ModuloScalar( IntMagnitude( value ) ) );
+		return value < 0 ? -r : r;
+	};
+	unsigned int operator % ( unsigned int value ) const { return static_cast< unsigned int >( ModuloScalar( value ) ); };
+	long operator % ( long value ) const
+	{
+		long r = static_cast< long >( ModuloScalar( IntMagnitude( value ) ) );
+		return value < 0 ? -r : r;
+	};
+	unsigned long operator % ( unsigned long value ) const { return static_cast< unsigned long >( ModuloScalar( value ) ); };
+	long long operator % ( long long value ) const
+	{
+		long long r = static_cast< long long >( ModuloScalar( IntMagnitude( value ) ) );
+		return value < 0 ? -r : r;
+	};
+	unsigned long long operator % ( unsigned long long value ) const { return static_cast< unsigned long long >( ModuloScalar( value ) ); };
+	BigNum& operator %= ( int value ) { return ModuloScalarInPlace( IntMagnitude( value ), value < 0 ); };
+	BigNum& operator %= ( unsigned int value ) { return ModuloScalarInPlace( value, false ); };
+	BigNum& operator %= ( long value ) { return ModuloScalarInPlace( IntMagnitude( value ), value < 0 ); };
+	BigNum& operator %= ( unsigned long value ) { return ModuloScalarInPlace( value, false ); };
+	BigNum& operator %= ( long long value ) { return ModuloScalarInPlace( IntMagnitude( value ), value < 0 ); };
+	BigNum& operator %= ( unsigned long long value ) { return ModuloScalarInPlace( value, false ); };
+
+
+	/**
+	 * \brief Porovnani s malym cislem (se znamenkem).
+	 */
+	bool operator == ( int value ) const { return CompareScalar( IntMagnitude( value ), value < 0 ) == 0; };
+	bool operator == ( unsigned int value ) const { return CompareScalar( value, false ) == 0; };
+	bool operator == ( long value ) const { return CompareScalar( IntMagnitude( value ), value < 0 ) == 0; };
+	bool operator == ( unsigned long value ) const { return CompareScalar( value, false ) == 0; };
+	bool operator == ( long long value ) const { return CompareScalar( IntMagnitude( value ), value < 0 ) == 0; };
+	bool operator == ( unsigned long long value ) const { return CompareScalar( value, false ) == 0; };
+	bool operator != ( int value ) const { return CompareScalar( IntMagnitude( value ), value < 0 ) != 0; };
+	bool operator != ( unsigned int value ) const { return CompareScalar( value, false ) != 0; };
+	bool operator != ( long value ) const { return CompareScalar( IntMagnitude( value ), value < 0 ) != 0; };
+	bool operator != ( unsigned long value ) const { return CompareScalar( value, false ) != 0; };
+	bool operator != ( long long value ) const { return CompareScalar( IntMagnitude( value ), value < 0 ) != 0; };
+	bool operator != ( unsigned long long value ) const { return CompareScalar( value, false ) != 0; };
+	bool operator > ( int value ) const { return CompareScalar( IntMagnitude( value ), value < 0 ) > 0; };
+	bool operator > ( unsigned int value ) const { return CompareScalar( value, false ) > 0; };
+	bool operator > ( long value ) const { return CompareScalar( IntMagnitude( value ), value < 0 ) > 0; };
+	bool operator > ( unsigned long value ) const { return CompareScalar( value, false ) > 0; };
+	bool operator > ( long long value ) const { return CompareScalar( IntMagnitude( value ), value < 0 ) > 0; };
+	bool operator > ( unsigned long long value ) const { return CompareScalar( value, false ) > 0; };
+	bool operator >= ( int value ) const { return CompareScalar( IntMagnitude( value ), value < 0 ) >= 0; };
+	bool operator >= ( unsigned int value ) const { return CompareScalar( value, false ) >= 0; };
+	bool operator >= ( long value ) const { return CompareScalar( IntMagnitude( value ), value < 0 ) >= 0; };
+	bool operator >= ( unsigned long value ) const { return CompareScalar( value, false ) >= 0; };
+	bool operator >= ( long long value ) const { return CompareScalar( IntMagnitude( value ), value < 0 ) >= 0; };
+	bool operator >= ( unsigned long long value ) const { return CompareScalar( value, false ) >= 0; };
+	bool operator < ( int value ) const { return CompareScalar( IntMagnitude( value ), value < 0 ) < 0; };
+	bool operator < ( unsigned int value ) const { return CompareScalar( value, false ) < 0; };
+	bool operator < ( long value ) const { return CompareScalar( IntMagnitude( value ), value < 0 ) < 0; };
+	bool operator < ( unsigned long value ) const { return CompareScalar( value, false ) < 0; };
+	bool operator < ( long long value ) const { return CompareScalar( IntMagnitude( value ), value < 0 ) < 0; };
+	bool operator < ( unsigned long long value ) const { return CompareScalar( value, false ) < 0; };
+	bool operator <= ( int value ) const { return CompareScalar( IntMagnitude( value ), value < 0 ) <= 0; };
+	bool operator <= ( unsigned int value ) const { return CompareScalar( value, false ) <= 0; };
+	bool operator <= ( long value ) const { return CompareScalar( IntMagnitude( value ), value < 0 ) <= 0; };
+	bool operator <= ( unsigned long value ) const { return CompareScalar( value, false ) <= 0; };
+	bool operator <= ( long long value ) const { return CompareScalar( IntMagnitude( value ), value < 0 ) <= 0; };
+	bool operator <= ( unsigned long long value ) const { return CompareScalar( value, false ) <= 0; };
+
+
 	/**
 	 * \brief Nastavi hodnotu cisla z stringu.
 	 *
@@ -310,6 +469,52 @@ public:
 	bool SetValue( uint intValue );
 
 
+	/**
+	 * \brief Nastavi hodnotu cisla z pole 32bitovych cislic.
+	 *
+	 * Cislice jsou ulozeny ve stylu little-endian (nejnizsi cislice
+	 * na indexu 0), stejne jako v NumberBuffer. Hodnota se pouze
+	 * zkopiruje, neprobiha zadny prevod.
+	 *
+	 * \param pLimbs Ukazatel na pole cislic.
+	 * \param count  Pocet cislic.
+	 *
+	 * \return True pokud nastaveni hodnoty probehlo uspesne, jinak false.
+	 */
+	bool SetValue( const uint32_t* pLimbs, size_t count );
+
+
+	/**
+	 * \brief Nastavi hodnotu cisla z pole bytu.
+	 *
+	 * Cele cislice se kopiruji najednou (memcpy, pripadne s prohozenim
+	 * bytu), ne po jednotlivych bytech jako pri SetByte().
+	 *
+	 * \param pBytes Ukazatel na byty cisla.
+	 * \param count  Pocet bytu.
+	 * \param order  Poradi bytu (LittleEndian = nejnizsi byte prvni).
+	 *
+	 * \return True pokud nastaveni hodnoty probehlo uspesne, jinak false.
+	 */
+	bool FromBytes( const char* pBytes, size_t count, ByteOrder order = LittleEndian );
+
+
+	/**
+	 * \brief Zapise absolutni hodnotu cisla do pole bytu.
+	 *
+	 * Pri width = 0 se zapise GetActiveBytes() bytu (bez nulovych bytu
+	 * na konci). Jinak se zapise presne width bytu doplnenych nulami;
+	 * pokud se cislo do width bytu nevejde, nezapise se nic.
+	 *
+	 * \param pBytes Vystupni buffer.
+	 * \param width  Pevna delka vystupu v bytech, nebo 0.
+	 * \param order  Poradi bytu (LittleEndian = nejnizsi byte prvni).
+	 *
+	 * \return Pocet zapsanych bytu, 0 pokud se cislo nevejde.
+	 */
+	size_t ToBytes( char* pBytes, size_t width = 0, ByteOrder order = LittleEndian ) const;
+
+
 	/**
 	 * \brief Vraci hodnotu cisla v 32bitovem integeru.
 	 *
@@ -427,6 +632,13 @@ public:
 	size_t GetActiveBytes( void ) const;
 
 
+	/**
+	 * \brief Testuje, zda-li udrzovany pocet aktivnich cislic odpovida
+	 *  obsahu cisla (pro kontroly v BIGNUM_DEBUG).
+	 */
+	bool IsNormalized( void ) const { return mNb.IsNormalized(); };
+
+
 	/**
 	 * \brief Vraci velikost cisla v bytech.
 	 */
@@ -527,6 +739,34 @@ public:
 	static bool Divide( const BigNum& u, const BigNum& v, BigNum& q, BigNum& r );
 
 
+	/**
+	 * \brief Vypocita soucin a * b.
+	 *
+	 * Pokud jde o tentyz objekt (a * a), pouzije se umocneni na druhou,
+	 * ktere potrebuje asi polovinu nasobeni cislic.
+	 */
+	static BigNum Multiply( const BigNum& a, const BigNum& b );
+
+
+	/**
+	 * \brief Vypocita ( a * b ) mod m.
+	 *
+	 * Soucin se pocita do docasneho bufferu v arene a rovnou se redukuje,
+	 * podil se nepocita. Zaporne operandy se pocitaji obecne pres
+	 * Divide(), aby znamenko vysledku bylo stejne jako u operatoru %.
+	 */
+	static BigNum MultiplyModulo( const BigNum& a, const BigNum& b, const BigNum& m );
+
+
+	/**
+	 * \brief Vypocita c + a * b.
+	 *
+	 * Radky soucinu se pricitaji primo do kopie c, nad prahem Karatsuby
+	 * se soucin spocita v arene a pricte najednou.
+	 */
+	static BigNum MultiplyAdd( const BigNum& c, const BigNum& a, const BigNum& b );
+
+
 	/**
 	 * \brief Nejvetsi spolecny delitel dvou cisel.
 	 *
@@ -572,6 +812,46 @@ public:
 	static BigNum ModularInverse( const BigNum& u, const BigNum& v );
 
 
+	/**
+	 * \brief Vypocita konstantu -m^(-1) mod 2^32 pro Montgomeryho nasobeni.
+	 *
+	 * \param m Modulo. Musi byt liche.
+	 *
+	 * \return Konstanta pro Montgomeryho redukci.
+	 */
+	static uint32_t MontgomeryInverse( const BigNum& m );
+
+
+	/**
+	 * \brief Vypocita hodnotu R^2 mod m, kde R = 2^(32 * n) a n je pocet
+	 *  cislic modula m.
+	 *
+	 * \param m Modulo. Musi byt liche.
+	 *
+	 * \return R^2 mod m.
+	 */
+	static BigNum MontgomeryRR( const BigNum& m );
+
+
+	/**
+	 * \brief Vypocita hodnotu vztahu ( b ^ e ) mod m pomoci Montgomeryho
+	 *  nasobeni.
+	 *
+	 * Konstanty mInv a rr lze spocitat pomoci MontgomeryInverse()
+	 * a MontgomeryRR() jednou pro dane modulo (napr. pri nacteni klice)
+	 * a pak je opakovane pouzivat.
+	 *
+	 * \param b    Zaklad.
+	 * \param e    Exponent.
+	 * \param m    Modulo. Musi byt liche.
+	 * \param mInv Konstanta -m^(-1) mod 2^32.
+	 * \param rr   Konstanta R^2 mod m.
+	 */
+	static BigNum MontgomeryExponentiation( const BigNum& b, const BigNum& e,
+	                                        const BigNum& m, uint32_t mInv,
+	                                        const BigNum& rr );
+
+
 	/**
 	 * \brief Nastavi seed pro generator pseudo-nahodnych cisel.
 	 */
@@ -628,6 +908,63 @@ public:
 	static BigNum GeneratePrime( uint bits, uint topBits = 0 );
 
 
+private:
+	/**
+	 * \brief Absolutni hodnota celeho cisla (i pro INT64_MIN).
+	 */
+	static uint64_t IntMagnitude( int64_t value )
+	{
+		return value < 0 ? 0 - static_cast< uint64_t >( value ) : value;
+	};
+
+	/**
+	 * \brief Vraci this + (-1)^negative * magnitude.
+	 */
+	BigNum AddScalar( uint64_t magnitude, bool negative ) const;
+
+	/**
+	 * \brief Pricte (-1)^negative * magnitude na miste.
+	 */
+	BigNum& AddScalarInPlace( uint64_t magnitude, bool negative );
+
+	/**
+	 * \brief Vraci this * (-1)^negative * magnitude.
+	 */
+	BigNum MultiplyScalar( uint64_t magnitude, bool negative ) const;
+
+	/**
+	 * \brief Vynasobi cislo (-1)^negative * magnitude na miste.
+	 */
+	BigNum& MultiplyScalarInPlace( uint64_t magnitude, bool negative );
+
+	/**
+	 * \brief Vraci this / ( (-1)^negative * magnitude ).
+	 */
+	BigNum DivideScalar( uint64_t magnitude, bool negative ) const;
+
+	/**
+	 * \brief Vydeli cislo (-1)^negative * magnitude na miste.
+	 */
+	BigNum& DivideScalarInPlace( uint64_t magnitude, bool negative );
+
+	/**
+	 * \brief Vraci zbytek absolutni hodnoty cisla po deleni magnitude.
+	 */
+	uint64_t ModuloScalar( uint64_t magnitude ) const;
+
+	/**
+	 * \brief Nahradi cislo zbytkem po deleni (-1)^negative * magnitude.
+	 */
+	BigNum& ModuloScalarInPlace( uint64_t magnitude, bool negative );
+
+	/**
+	 * \brief Porovna cislo s (-1)^negative * magnitude.
+	 *
+	 * \return 1 pokud je cislo vetsi, -1 pokud je mensi, jinak 0.
+	 */
+	int CompareScalar( uint64_t magnitude, bool negative ) const;
+
+
 // :TODO:
 // Privatni promenne:
 public:
@@ -0,0 +1,693 @@
+/*
+ * BigNum/Kernels.cc - Varianty jader pro konkretni procesor a jejich vyber.
+ *
+ * Copyright (c) 2006 Jiri Zajpt, <jzajpt@blueberry.cz>
+ */
+
+#include <iostream>
+#include <algorithm>
+#include <cstring>
+#include "Kernels.h"
+
+#if defined( __GNUC__ ) && defined( __x86_64__ )
+#define KERNELS_ADX
+#include <cpuid.h>
+#endif // __GNUC__
+
+
+//
+// Prenositelne varianty jsou inline funkce z Kernels.h, do tabulky
+// se berou jejich adresy.
+//
+
+const LimbKernels cLimbKernelsPortable =
+{
+	"portable",
+	LimbsMul1,
+	LimbsAddMul1,
+	LimbsSubMul1,
+	LimbsMul,
+	LimbsSqr,
+	LimbsMontMul
+};
+
+
+// Do vyberu podle CPUID (viz konec souboru) plati prenositelna jadra,
+// i pro pripadne vypocty pri inicializaci jinych modulu.
+LimbKernels gLimbKernels = cLimbKernelsPortable;
+
+
+#ifdef KERNELS_ADX
+
+//
+// Jadra pro x86-64 s BMI2 a ADX.
+//
+// Pracuji se 64bitovymi slovy, tj. dvojicemi 32bitovych cislic (cislice
+// jsou little-endian, takze cislice 2i a 2i + 1 tvori slovo i). MULX
+// nemeni priznaky, ADCX pouziva jen CF a ADOX jen OF, takze prenosy
+// z nasobeni a z pricitani bezi ve dvou nezavislych retezcich. Smycky
+// proto nesmi menit priznaky: ukazatele se posouvaji pres LEA a konec
+// se testuje pomoci JRCXZ.
+//
+// Slova se ctou a zapisuji jen v asembleru nebo pres memcpy, pole jsou
+// v C++ typu uint32_t.
+//
+
+
+/**
+ * \brief r = a * b (n slov), vraci nejvyssi slovo soucinu.
+ */
+static uint64_t
+AdxMul1( uint32_t* pR, const uint32_t* pA, size_t n, uint64_t b )
+{
+	uint64_t carry;
+	uint64_t lo;
+	uint64_t hi;
+
+	__asm__ __volatile__ (
+		"xor    %k[carry], %k[carry]\n\t"     // carry = 0, CF = OF = 0
+		"1:\n\t"
+		"jrcxz  2f\n\t"
+		"mulx   (%[a]), %[lo], %[hi]\n\t"
+		"adcx   %[carry], %[lo]\n\t"
+		"mov    %[lo], (%[r])\n\t"
+		"mov    %[hi], %[carry]\n\t"
+		"lea    8(%[a]), %[a]\n\t"
+		"lea    8(%[r]), %[r]\n\t"
+		"lea    -1(%%rcx), %%rcx\n\t"
+		"jmp    1b\n\t"
+		"2:\n\t"
+		"mov    $0, %k[lo]\n\t"
+		"adcx   %[lo], %[carry]\n\t"
+		: [carry] "=&r" ( carry ), [lo] "=&r" ( lo ), [hi] "=&r" ( hi ),
+		  [r] "+r" ( pR ), [a] "+r" ( pA ), "+c" ( n )
+		: "d" ( b )
+		: "cc", "memory" );
+
+	return carry;
+}
+
+
+/**
+ * \brief r += a * b (n slov), vraci prenos do slova r[ n ].
+ */
+static uint64_t
+AdxAddMul1( uint32_t* pR, const uint32_t* pA, size_t n, uint64_t b )
+{
+	uint64_t carry;
+	uint64_t lo;
+	uint64_t hi;
+	uint64_t tmp;
+
+	// lo + carry jde pres OF (ADOX), pricteni r[ i ] pres CF (ADCX)
+	__asm__ __volatile__ (
+		"xor    %k[carry], %k[carry]\n\t"
+		"1:\n\t"
+		"jrcxz  2f\n\t"
+		"mulx   (%[a]), %[lo], %[hi]\n\t"
+		"adox   %[carry], %[lo]\n\t"
+		"mov    (%[r]), %[tmp]\n\t"
+		"adcx   %[tmp], %[lo]\n\t"
+		"mov    %[lo], (%[r])\n\t"
+		"mov    %[hi], %[carry]\n\t"
+		"lea    8(%[a]), %[a]\n\t"
+		"lea    8(%[r]), %[r]\n\t"
+		"lea    -1(%%rcx), %%rcx\n\t"
+		"jmp    1b\n\t"
+		"2:\n\t"
+		"mov    $0, %k[tmp]\n\t"
+		"adox   %[tmp], %[carry]\n\t"
+		"adcx   %[tmp], %[carry]\n\t"
+		: [carry] "=&r" ( carry ), [lo] "=&r" ( lo ), [hi] "=&r" ( hi ), [tmp] "=&r" ( tmp ),
+		  [r] "+r" ( pR ), [a] "+r" ( pA ), "+c" ( n )
+		: "d" ( b )
+		: "cc", "memory" );
+
+	return carry;
+}
+
+
+/**
+ * \brief r -= a * b (n slov), vraci slovo, ktere se ma odecist od r[ n ].
+ *
+ * Odcitani by menilo OF, pocita se proto ~r + a * b: nizsich n slov
+ * souctu je ~( r - a * b ) a prenos je presne vypujcka. NOT priznaky
+ * nemeni.
+ */
+static uint64_t
+AdxSubMul1( uint32_t* pR, const uint32_t* pA, size_t n, uint64_t b )
+{
+	uint64_t carry;
+	uint64_t lo;
+	uint64_t hi;
+	uint64_t tmp;
+
+	__asm__ __volatile__ (
+		"xor    %k[carry], %k[carry]\n\t"
+		"1:\n\t"
+		"jrcxz  2f\n\t"
+		"mulx   (%[a]), %[lo], %[hi]\n\t"
+		"adox   %[carry], %[lo]\n\t"
+		"mov    (%[r]), %[tmp]\n\t"
+		"not    %[tmp]\n\t"
+		"adcx   %[tmp], %[lo]\n\t"
+		"not    %[lo]\n\t"
+		"mov    %[lo], (%[r])\n\t"
+		"mov    %[hi], %[carry]\n\t"
+		"lea    8(%[a]), %[a]\n\t"
+		"lea    8(%[r]), %[r]\n\t"
+		"lea    -1(%%rcx), %%rcx\n\t"
+		"jmp    1b\n\t"
+		"2:\n\t"
+		"mov    $0, %k[tmp]\n\t"
+		"adox   %[tmp], %[carry]\n\t"
+		"adcx   %[tmp], %[carry]\n\t"
+		: [carry] "=&r" ( carry ), [lo] "=&r" ( lo ), [hi] "=&r" ( hi ), [tmp] "=&r" ( tmp ),
+		  [r] "+r" ( pR ), [a] "+r" ( pA ), "+c" ( n )
+		: "d" ( b )
+		: "cc", "memory" );
+
+	return carry;
+}
+
+
+/**
+ * \brief Precte slovo (dvojici cislic od pA).
+ */
+static inline uint64_t
+LoadWord( const uint32_t* pA )
+{
+	uint64_t word;
+
+	memcpy( &word, pA, sizeof( word ) );
+	return word;
+}
+
+
+/**
+ * \brief Zapise slovo na misto dvojice cislic od pR.
+ */
+static inline void
+StoreWord( uint32_t* pR, uint64_t word )
+{
+	memcpy( pR, &word, sizeof( word ) );
+}
+
+
+//
+// Varianty s rozhranim prenositelnych jader (32bitovy cinitel b).
+// Sude cislice zpracuje asembler po slovech, pripadnou posledni licha
+// cislice se dopocita zde. Prenos z b < 2^32 se vejde do 32 bitu.
+//
+
+static uint32_t
+AdxLimbsMul1( uint32_t* pR, const uint32_t* pA, size_t n, uint32_t b )
+{
+	uint64_t carry = AdxMul1( pR, pA, n / 2, b );
+
+	if ( n & 1 )
+	{
+		carry += static_cast< uint64_t >( pA[ n - 1 ] ) * b;
+		pR[ n - 1 ] = static_cast< uint32_t >( carry );
+		carry >>= 32;
+	}
+
+	return static_cast< uint32_t >( carry );
+}
+
+
+static uint32_t
+AdxLimbsAddMul1( uint32_t* pR, const uint32_t* pA, size_t n, uint32_t b )
+{
+	uint64_t carry = AdxAddMul1( pR, pA, n / 2, b );
+
+	if ( n & 1 )
+	{
+		carry += static_cast< uint64_t >( pA[ n - 1 ] ) * b + pR[ n - 1 ];
+		pR[ n - 1 ] = static_cast< uint32_t >( carry );
+		carry >>= 32;
+	}
+
+	return static_cast< uint32_t >( carry );
+}
+
+
+static uint32_t
+AdxLimbsSubMul1( uint32_t* pR, const uint32_t* pA, size_t n, uint32_t b )
+{
+	uint64_t borrow = AdxSubMul1( pR, pA, n / 2, b );
+
+	if ( n & 1 )
+	{
+		uint64_t product = static_cast< uint64_t >( pA[ n - 1 ] ) * b + borrow;
+		uint32_t low     = static_cast< uint32_t >( product );
+
+		borrow = ( product >> 32 ) + ( pR[ n - 1 ] < low );
+		pR[ n - 1 ] -= low;
+	}
+
+	return static_cast< uint32_t >( borrow );
+}
+
+
+/**
+ * \brief Skolni nasobeni po slovech, pro lichy pocet cislic po radcich
+ *  s 32bitovym cinitelem.
+ */
+static void
+AdxLimbsMul( uint32_t* pR, const uint32_t* pA, size_t na, const uint32_t* pB, size_t nb )
+{
+	size_t i;
+
+	if ( ( na | nb ) & 1 )
+	{
+		pR[ na ] = AdxLimbsMul1( pR, pA, na, pB[ 0 ] );
+		for ( i = 1 ; i < nb ; i++ )
+			pR[ na + i ] = AdxLimbsAddMul1( pR + i, pA, na, pB[ i ] );
+		return;
+	}
+
+	size_t wa = na / 2;
+	size_t wb = nb / 2;
+
+	StoreWord( pR + na, AdxMul1( pR, pA, wa, LoadWord( pB ) ) );
+	for ( i = 1 ; i < wb ; i++ )
+		StoreWord( pR + na + 2 * i, AdxAddMul1( pR + 2 * i, pA, wa, LoadWord( pB + 2 * i ) ) );
+}
+
+
+/**
+ * \brief Druha mocnina po slovech (stejny postup jako LimbsSqr).
+ */
+static void
+AdxLimbsSqr( uint32_t* pR, const uint32_t* pA, size_t n )
+{
+	if ( n & 1 )
+	{
+		LimbsSqr( pR, pA, n );
+		return;
+	}
+
+	size_t   w = n / 2;
+	size_t   i;
+	uint64_t carry = 0;
+
+	// Soucty a[ i ] * a[ j ] pro i < j (ve slovech), radek i od slova 2i + 1
+	StoreWord( pR, 0 );
+	StoreWord( pR + 2 * n - 2, 0 );
+	if ( w > 1 )
+	{
+		StoreWord( pR + n, AdxMul1( pR + 2, pA + 2, w - 1, LoadWord( pA ) ) );
+		for ( i = 1 ; i + 1 < w ; i++ )
+			StoreWord( pR + n + 2 * i,
+			           AdxAddMul1( pR + 4 * i + 2, pA + 2 * i + 2, w - i - 1, LoadWord( pA + 2 * i ) ) );
+
+		pR[ 2 * n - 1 ] = LimbsShiftLeft( pR, pR, 2 * n - 1, 1 );
+	}
+
+	// Pricteme druhe mocniny slov
+	for ( i = 0 ; i < w ; i++ )
+	{
+		uint64_t          word   = LoadWord( pA + 2 * i );
+		unsigned __int128 square = static_cast< unsigned __int128 >( word ) * word;
+		unsigned __int128 tmp;
+
+		tmp = static_cast< unsigned __int128 >( LoadWord( pR + 4 * i ) )
+		    + static_cast< uint64_t >( square ) + carry;
+		StoreWord( pR + 4 * i, static_cast< uint64_t >( tmp ) );
+		tmp = static_cast< unsigned __int128 >( LoadWord( pR + 4 * i + 2 ) )
+		    + static_cast< uint64_t >( square >> 64 ) + static_cast< uint64_t >( tmp >> 64 );
+		StoreWord( pR + 4 * i + 2, static_cast< uint64_t >( tmp ) );
+		carry = static_cast< uint64_t >( tmp >> 64 );
+	}
+}
+
+
+/**
+ * \brief Montgomeryho nasobeni po slovech (R = 2^(32 * n) = 2^(64 * n / 2)).
+ *
+ * Redukuje se po slovech, potrebujeme tedy -m^(-1) mod 2^64. Spocita se
+ * z 32bitove konstanty jednim krokem Newtonovy iterace.
+ */
+static void
+AdxLimbsMontMul( uint32_t* pR, const uint32_t* pA, const uint32_t* pB,
+                 const uint32_t* pM, size_t n, uint32_t mInv, uint32_t* pT )
+{
+	if ( n & 1 )
+	{
+		LimbsMontMul( pR, pA, pB, pM, n, mInv, pT );
+		return;
+	}
+
+	size_t   w  = n / 2;
+	uint64_t m0 = LoadWord( pM );
+	uint64_t x  = static_cast< uint64_t >( 0 ) - mInv;    // m^(-1) mod 2^32
+	uint64_t carry;
+	size_t   i;
+
+	x *= 2 - m0 * x;
+	uint64_t mInv64 = 0 - x;
+
+	memset( pT, 0, ( 2 * n + 2 ) * sizeof( uint32_t ) );
+
+	// t = a * b
+	for ( i = 0 ; i < w ; i++ )
+		StoreWord( pT + n + 2 * i, AdxAddMul1( pT + 2 * i, pA, w, LoadWord( pB + 2 * i ) ) );
+
+	// Redukce po slovech, prenos radku pricteme k t od slova i + w
+	for ( i = 0 ; i < w ; i++ )
+	{
+		uint64_t u = LoadWord( pT + 2 * i ) * mInv64;
+
+		carry = AdxAddMul1( pT + 2 * i, pM, w, u );
+		LimbsAdd1( pT + n + 2 * i, pT + n + 2 * i, n + 2 - 2 * i,
+		           static_cast< uint32_t >( carry ) );
+		LimbsAdd1( pT + n + 2 * i + 1, pT + n + 2 * i + 1, n + 1 - 2 * i,
+		           static_cast< uint32_t >( carry >> 32 ) );
+	}
+
+	uint32_t* pHigh = pT + n;
+
+	if ( pHigh[ n ] != 0 || LimbsCompare( pHigh, pM, n ) >= 0 )
+		LimbsSub( pR, pHigh, pM, n );
+	else
+		memcpy( pR, pHigh, n * sizeof( uint32_t ) );
+}
+
+
+static const LimbKernels cLimbKernelsAdx =
+{
+	"bmi2-adx",
+	AdxLimbsMul1,
+	AdxLimbsAddMul1,
+	AdxLimbsSubMul1,
+	AdxLimbsMul,
+	AdxLimbsSqr,
+	AdxLimbsMontMul
+};
+
+
+/**
+ * \brief Testuje podporu MULX (BMI2) a ADCX/ADOX (ADX) pomoci CPUID.
+ */
+static bool
+HasBmi2Adx( void )
+{
+	unsigned int eax, ebx, ecx, edx;
+
+	if ( __get_cpuid_max( 0, NULL ) < 7 )
+		return false;
+
+	__cpuid_count( 7, 0, eax, ebx, ecx, edx );
+
+	// CPUID.(EAX=7,ECX=0):EBX bit 8 = BMI2, bit 19 = ADX
+	return ( ebx & ( 1 << 8 ) ) && ( ebx & ( 1 << 19 ) );
+}
+
+#endif // KERNELS_ADX
+
+
+const LimbKernels*
+LimbKernelsNative( void )
+{
+#ifdef KERNELS_ADX
+	static const bool supported = HasBmi2Adx();
+
+	if ( supported )
+		return &cLimbKernelsAdx;
+#endif // KERNELS_ADX
+
+	return NULL;
+}
+
+
+/**
+ * \brief Nastavi gLimbKernels podle procesoru.
+ */
+static bool
+SelectLimbKernels( void )
+{
+	const LimbKernels* pNative = LimbKernelsNative();
+
+	if ( pNative )
+		gLimbKernels = *pNative;
+
+	return pNative != NULL;
+}
+
+
+static const bool gLimbKernelsNative = SelectLimbKernels();
+
+
+//
+// Karatsubovo nasobeni. Cisla se rozdeli na polovinu a = a1 B^h + a0,
+// b = b1 B^h + b0 a soucin se slozi ze tri nasobeni polovicnich cisel:
+//
+//   a b = a1 b1 B^2h + ( a0 b0 + a1 b1 - ( a1 - a0 )( b1 - b0 ) ) B^h + a0 b0
+//
+// Rozdily se pocitaji v absolutni hodnote se znamenkem bokem, aby
+// se prostredni clen vesel do stejne delky. Pod prahem se nasobi
+// jadry z gLimbKernels.
+//
+
+size_t gKaratsubaThreshold = 64;
+
+size_t gKaratsubaSqrThreshold = 96;
+
+size_t gDivideThreshold = 32;
+
+
+/**
+ * \brief Vraci prah, rekurze potrebuje aspon 4 cislice.
+ */
+static inline size_t
+KaratsubaThreshold( size_t threshold )
+{
+	return threshold < 4 ? 4 : threshold;
+}
+
+
+/**
+ * \brief Vraci delku horni poloviny cisla o n cislicich.
+ *
+ * Horni polovina ma sudy pocet cislic, aby ji jadra z gLimbKernels
+ * mohla nasobit po 64bitovych slovech. Neni kratsi nez dolni polovina
+ * a je nejvyse o tri delsi (napr. n = 9 da 6 a 3, n = 10 da 6 a 4).
+ * Pro n >= 4 je dolni polovina neprazdna a horni kratsi nez n.
+ */
+static inline size_t
+KaratsubaHigh( size_t n )
+{
+	return ( ( n + 1 ) / 2 + 1 ) & ~static_cast< size_t >( 1 );
+}
+
+
+/**
+ * \brief d = | x - y |, x ma nx cislic, y ny cislic (ny <= nx),
+ *  d ma nx cislic.
+ *
+ * \return true, pokud x < y.
+ */
+static bool
+LimbsAbsDiff( uint32_t* pD, const uint32_t* pX, size_t nx, const uint32_t* pY, size_t ny )
+{
+	size_t i = nx;
+
+	while ( i > ny && pX[ i - 1 ] == 0 )
+		pD[ --i ] = 0;
+
+	if ( i > ny )
+	{
+		// x ma navic nenulovou cislici, je tedy vetsi
+		LimbsSub1( pD + ny, pX + ny, i - ny, LimbsSub( pD, pX, pY, ny ) );
+		return false;
+	}
+
+	if ( LimbsCompare( pX, pY, ny ) >= 0 )
+	{
+		LimbsSub( pD, pX, pY, ny );
+		return false;
+	}
+
+	LimbsSub( pD, pY, pX, ny );
+	return true;
+}
+
+
+/**
+ * \brief Pricte k r = a0 b0 + a1 b1 B^2lo (n = lo + hi cislic kazde cislo)
+ *  prostredni clen ( a0 b0 + a1 b1 -+ m ) B^lo, m ma 2hi cislic.
+ *
+ * pW je pracovni pole o 2hi + 1 cislicich.
+ */
+static void
+KaratsubaMiddle( uint32_t* pR, const uint32_t* pM, bool subtract, size_t lo, size_t hi, uint32_t* pW )
+{
+	size_t   n = lo + hi;
+	uint32_t carry;
+
+	// w = a0 b0 + a1 b1
+	carry           = LimbsAdd( pW, pR, pR + 2 * lo, 2 * lo );
+	carry           = LimbsAdd1( pW + 2 * lo, pR + 4 * lo, 2 * ( hi - lo ), carry );
+	pW[ 2 * hi ]    = carry;
+
+	if ( subtract )
+		pW[ 2 * hi ] -= LimbsSub( pW, pW, pM, 2 * hi );
+	else
+		pW[ 2 * hi ] += LimbsAdd( pW, pW, pM, 2 * hi );
+
+	carry = LimbsAdd( pR + lo, pR + lo, pW, 2 * hi + 1 );
+	LimbsAdd1( pR + lo + 2 * hi + 1, pR + lo + 2 * hi + 1, 2 * n - lo - 2 * hi - 1, carry );
+}
+
+
+/**
+ * \brief r = a * b, obe n cislic, r 2n cislic.
+ */
+static void
+KaratsubaMul( uint32_t* pR, const uint32_t* pA, const uint32_t* pB, size_t n, uint32_t* pT )
+{
+	if ( n < KaratsubaThreshold( gKaratsubaThreshold ) )
+	{
+		gLimbKernels.mpMul( pR, pA, n, pB, n );
+		return;
+	}
+
+	size_t    hi  = KaratsubaHigh( n );
+	size_t    lo  = n - hi;
+	uint32_t* pM  = pT;
+	uint32_t* pDa = pT + 2 * hi;
+	uint32_t* pDb = pT + 3 * hi;
+	bool      negative;
+
+	// m = | a1 - a0 | | b1 - b0 |, rozdily pak prepise w
+	negative  = LimbsAbsDiff( pDa, pA + lo, hi, pA, lo );
+	negative ^= LimbsAbsDiff( pDb, pB + lo, hi, pB, lo );
+	KaratsubaMul( pM, pDa, pDb, hi, pT + 4 * hi + 1 );
+
+	KaratsubaMul( pR, pA, pB, lo, pT + 4 * hi + 1 );
+	KaratsubaMul( pR + 2 * lo, pA + lo, pB + lo, hi, pT + 4 * hi + 1 );
+
+	KaratsubaMiddle( pR, pM, !negative, lo, hi, pT + 2 * hi );
+}
+
+
+/**
+ * \brief r = a * a, a ma n cislic, r 2n cislic.
+ */
+static void
+KaratsubaSqr( uint32_t* pR, const uint32_t* pA, size_t n, uint32_t* pT )
+{
+	if ( n < KaratsubaThreshold( gKaratsubaSqrThreshold ) )
+	{
+		gLimbKernels.mpSqr( pR, pA, n );
+		return;
+	}
+
+	size_t    hi  = KaratsubaHigh( n );
+	size_t    lo  = n - hi;
+	uint32_t* pM  = pT;
+	uint32_t* pDa = pT + 2 * hi;
+
+	LimbsAbsDiff( pDa, pA + lo, hi, pA, lo );
+	KaratsubaSqr( pM, pDa, hi, pT + 4 * hi + 1 );
+
+	KaratsubaSqr( pR, pA, lo, pT + 4 * hi + 1 );
+	KaratsubaSqr( pR + 2 * lo, pA + lo, hi, pT + 4 * hi + 1 );
+
+	KaratsubaMiddle( pR, pM, true, lo, hi, pT + 2 * hi );
+}
+
+
+/**
+ * \brief Vraci velikost pracovniho pole pro KaratsubaMul() a KaratsubaSqr().
+ */
+static size_t
+KaratsubaScratch( size_t n, size_t threshold )
+{
+	size_t size = 0;
+
+	while ( n >= KaratsubaThreshold( threshold ) )
+	{
+		n     = KaratsubaHigh( n );
+		size += 4 * n + 1;
+	}
+
+	return size;
+}
+
+
+size_t
+LimbsSqrKaratsubaScratch( size_t n )
+{
+	return KaratsubaScratch( n, gKaratsubaSqrThreshold );
+}
+
+
+size_t
+LimbsMulKaratsubaScratch( size_t na, size_t nb )
+{
+	if ( na < nb )
+		std::swap( na, nb );
+
+	if ( nb < KaratsubaThreshold( gKaratsubaThreshold ) )
+		return 0;
+	if ( na == nb || na % nb == 0 )
+		return 2 * nb + KaratsubaScratch( nb, gKaratsubaThreshold );
+
+	return 2 * nb + std::max( KaratsubaScratch( nb, gKaratsubaThreshold ),
+	                          LimbsMulKaratsubaScratch( nb, na % nb ) );
+}
+
+
+void
+LimbsMulKaratsuba( uint32_t* pR, const uint32_t* pA, size_t na, const uint32_t* pB, size_t nb,
+                   uint32_t* pT )
+{
+	if ( na < nb )
+	{
+		std::swap( pA, pB );
+		std::swap( na, nb );
+	}
+
+	if ( nb < KaratsubaThreshold( gKaratsubaThreshold ) )
+	{
+		gLimbKernels.mpMul( pR, pA, na, pB, nb );
+		return;
+	}
+
+	if ( na == nb )
+	{
+		KaratsubaMul( pR, pA, pB, nb, pT );
+		return;
+	}
+
+	// Delsi cislo nasobime po blocich nb cislic
+	uint32_t* pP = pT;
+	size_t    i  = nb;
+	uint32_t  carry;
+
+	KaratsubaMul( pR, pA, pB, nb, pT + 2 * nb );
+
+	while ( na - i >= nb )
+	{
+		KaratsubaMul( pP, pA + i, pB, nb, pT + 2 * nb );
+		carry = LimbsAdd( pR + i, pR + i, pP, nb );
+		LimbsAdd1( pR + i + nb, pP + nb, nb, carry );
+		i += nb;
+	}
+
+	if ( i < na )
+	{
+		LimbsMulKaratsuba( pP, pB, nb, pA + i, na - i, pT + 2 * nb );
+		carry = LimbsAdd( pR + i, pR + i, pP, nb );
+		LimbsAdd1( pR + i + nb, pP + nb, na - i, carry );
+	}
+}
+
+
+void
+LimbsSqrKaratsuba( uint32_t* pR, const uint32_t* pA, size_t n, uint32_t* pT )
+{
+	KaratsubaSqr( pR, pA, n, pT );
+}
@@ -0,0 +1,678 @@
+/*
+ * BigNum/Kernels.h - Zakladni operace nad poli 32bitovych cislic.
+ *
+ * Copyright (c) 2006 Jiri Zajpt, <jzajpt@blueberry.cz>
+ */
+
+#ifndef _BIGNUM_KERNELS__H
+#define _BIGNUM_KERNELS__H
+
+
+#include <cstring>
+#include "../Common/Types.h"
+#include "NumberBuffer.h"
+
+
+//
+// Funkce pracuji primo s ukazateli na cislice (little-endian, viz
+// NumberBuffer) a delkou, bez kontroly mezi. Meze kontroluje volajici
+// (operatory BigNum), v ladicim prekladu (make DEBUG=1) je hlida
+// BIGNUM_ASSERT. Vsechny jsou inline, aby prekladac mohl cislice
+// drzet v registrech.
+//
+// Vystupni pole se smi prekryvat se vstupem, pokud zacina na stejne
+// adrese (pR == pA), u posuvu viz popis jednotlivych funkci.
+//
+// Nasobeni, na kterych zavisi rychlost RSA, maji navic varianty pro
+// konkretni procesor (viz LimbKernels na konci souboru a Kernels.cc).
+// Aritmetika BigNum je vola pres gLimbKernels, funkce v tomto souboru
+// jsou prenositelne varianty, se kterymi se ostatni porovnavaji.
+//
+
+
+/**
+ * \brief r = a + b (n cislic), vraci prenos (0 nebo 1).
+ */
+inline uint32_t
+LimbsAdd( uint32_t* pR, const uint32_t* pA, const uint32_t* pB, size_t n )
+{
+	uint64_t tmp;
+	uint32_t carry = 0;
+	size_t   i;
+
+	for ( i = 0 ; i < n ; i++ )
+	{
+		tmp = static_cast< uint64_t >( pA[ i ] ) + pB[ i ] + carry;
+		pR[ i ] = static_cast< uint32_t >( tmp );
+		carry = static_cast< uint32_t >( tmp >> 32 );
+	}
+
+	return carry;
+}
+
+
+/**
+ * \brief r = a + b (a ma n cislic, b jednu), vraci prenos.
+ */
+inline uint32_t
+LimbsAdd1( uint32_t* pR, const uint32_t* pA, size_t n, uint32_t b )
+{
+	uint64_t tmp;
+	size_t   i;
+
+	for ( i = 0 ; i < n && b != 0 ; i++ )
+	{
+		tmp = static_cast< uint64_t >( pA[ i ] ) + b;
+		pR[ i ] = static_cast< uint32_t >( tmp );
+		b = static_cast< uint32_t >( tmp >> 32 );
+	}
+
+	if ( pR != pA )
+		for ( ; i < n ; i++ )
+			pR[ i ] = pA[ i ];
+
+	return b;
+}
+
+
+/**
+ * \brief r = a - b (n cislic), vraci vypujcku (0 nebo 1).
+ */
+inline uint32_t
+LimbsSub( uint32_t* pR, const uint32_t* pA, const uint32_t* pB, size_t n )
+{
+	uint64_t tmp;
+	uint32_t borrow = 0;
+	size_t   i;
+
+	for ( i = 0 ; i < n ; i++ )
+	{
+		tmp = static_cast< uint64_t >( pA[ i ] ) - pB[ i ] - borrow;
+		pR[ i ] = static_cast< uint32_t >( tmp );
+		borrow = static_cast< uint32_t >( tmp >> 32 ) & 1;
+	}
+
+	return borrow;
+}
+
+
+/**
+ * \brief r = a - b (a ma n cislic, b jednu), vraci vypujcku.
+ */
+inline uint32_t
+LimbsSub1( uint32_t* pR, const uint32_t* pA, size_t n, uint32_t b )
+{
+	uint64_t tmp;
+	size_t   i;
+
+	for ( i = 0 ; i < n && b != 0 ; i++ )
+	{
+		tmp = static_cast< uint64_t >( pA[ i ] ) - b;
+		pR[ i ] = static_cast< uint32_t >( tmp );
+		b = static_cast< uint32_t >( tmp >> 32 ) & 1;
+	}
+
+	if ( pR != pA )
+		for ( ; i < n ; i++ )
+			pR[ i ] = pA[ i ];
+
+	return b;
+}
+
+
+/**
+ * \brief r = a * b (a ma n cislic), vraci nejvyssi cislici soucinu.
+ */
+inline uint32_t
+LimbsMul1( uint32_t* pR, const uint32_t* pA, size_t n, uint32_t b )
+{
+	uint64_t tmp;
+	uint32_t carry = 0;
+	size_t   i;
+
+	for ( i = 0 ; i < n ; i++ )
+	{
+		tmp = static_cast< uint64_t >( pA[ i ] ) * b + carry;
+		pR[ i ] = static_cast< uint32_t >( tmp );
+		carry = static_cast< uint32_t >( tmp >> 32 );
+	}
+
+	return carry;
+}
+
+
+/**
+ * \brief r += a * b (n cislic), vraci prenos do cislice r[n].
+ */
+inline uint32_t
+LimbsAddMul1( uint32_t* pR, const uint32_t* pA, size_t n, uint32_t b )
+{
+	uint64_t tmp;
+	uint32_t carry = 0;
+	size_t   i;
+
+	// a * b + r + carry < 2^64, mezivysledek se tedy vejde
+	for ( i = 0 ; i < n ; i++ )
+	{
+		tmp = static_cast< uint64_t >( pA[ i ] ) * b + pR[ i ] + carry;
+		pR[ i ] = static_cast< uint32_t >( tmp );
+		carry = static_cast< uint32_t >( tmp >> 32 );
+	}
+
+	return carry;
+}
+
+
+/**
+ * \brief r -= a * b (n cislic), vraci cislici, ktera se ma odecist od r[n].
+ */
+inline uint32_t
+LimbsSubMul1( uint32_t* pR, const uint32_t* pA, size_t n, uint32_t b )
+{
+	uint64_t product;
+	uint32_t low;
+	uint32_t borrow = 0;
+	size_t   i;
+
+	for ( i = 0 ; i < n ; i++ )
+	{
+		product = static_cast< uint64_t >( pA[ i ] ) * b + borrow;
+		low     = static_cast< uint32_t >( product );
+		borrow  = static_cast< uint32_t >( product >> 32 ) + ( pR[ i ] < low );
+		pR[ i ] -= low;
+	}
+
+	return borrow;
+}
+
+
+//
+// Deleni invariantem podle Mollera a Granlunda (Improved division by
+// invariant integers, 2011). Misto hardwaroveho deleni kazde cislice
+// se jednou spocita prevracena hodnota normalizovaneho delitele
+// (nejvyssi bit je jednicka) a podil se pak odhaduje nasobenim.
+// B = 2^32.
+//
+
+
+/**
+ * \brief Vraci prevracenou hodnotu v = floor( ( B^2 - 1 ) / d ) - B
+ *  normalizovane cislice d.
+ */
+inline uint32_t
+LimbsInvert( uint32_t d )
+{
+	BIGNUM_ASSERT( d & 0x80000000 );
+
+	// ( B^2 - 1 - B * d ) / d, jedine hardwarove deleni
+	return static_cast< uint32_t >(
+		( ( static_cast< uint64_t >( ~d ) << 32 ) | 0xFFFFFFFF ) / d );
+}
+
+
+/**
+ * \brief Vraci prevracenou hodnotu v = floor( ( B^3 - 1 ) / ( d1 B + d0 ) ) - B
+ *  normalizovaneho dvouciferneho delitele (d1 ma nejvyssi bit jednicku).
+ */
+inline uint32_t
+LimbsInvert3by2( uint32_t d1, uint32_t d0 )
+{
+	uint32_t v = LimbsInvert( d1 );
+	uint32_t p = d1 * v;
+	uint64_t t;
+	uint32_t t1;
+	uint32_t t0;
+
+	// Oprava v podle d0
+	p += d0;
+	if ( p < d0 )
+	{
+		v--;
+		if ( p >= d1 )
+		{
+			v--;
+			p -= d1;
+		}
+		p -= d1;
+	}
+
+	t  = static_cast< uint64_t >( v ) * d0;
+	t1 = static_cast< uint32_t >( t >> 32 );
+	t0 = static_cast< uint32_t >( t );
+
+	p += t1;
+	if ( p < t1 )
+	{
+		v--;
+		if ( p > d1 || ( p == d1 && t0 >= d0 ) )
+			v--;
+	}
+
+	return v;
+}
+
+
+/**
+ * \brief Vydeli dvouciferne cislo ( u1 B + u0 ) normalizovanou cislici d
+ *  (u1 < d), v je LimbsInvert( d ). Vraci podil, zbytek zapise do rR.
+ */
+inline uint32_t
+LimbsDivRem2by1( uint32_t u1, uint32_t u0, uint32_t d, uint32_t v, uint32_t& rR )
+{
+	uint64_t q  = static_cast< uint64_t >( v ) * u1
+	            + ( ( static_cast< uint64_t >( u1 ) << 32 ) | u0 );
+	uint32_t q1 = static_cast< uint32_t >( q >> 32 ) + 1;
+	uint32_t q0 = static_cast< uint32_t >( q );
+	uint32_t r  = u0 - q1 * d;
+
+	// Odhad q1 je nejvyse o jednu vetsi nebo mensi
+	if ( r > q0 )
+	{
+		q1--;
+		r += d;
+	}
+	if ( r >= d )
+	{
+		q1++;
+		r -= d;
+	}
+
+	rR = r;
+	return q1;
+}
+
+
+/**
+ * \brief Vydeli trojciferne cislo ( u2 B^2 + u1 B + u0 ) normalizovanym
+ *  dvoucifernym delitelem ( d1 B + d0 ), kde ( u2, u1 ) < ( d1, d0 ) a v je
+ *  LimbsInvert3by2( d1, d0 ). Vraci podil, zbytek zapise do rR1 a rR0.
+ */
+inline uint32_t
+LimbsDivRem3by2( uint32_t u2, uint32_t u1, uint32_t u0, uint32_t d1, uint32_t d0,
+                 uint32_t v, uint32_t& rR1, uint32_t& rR0 )
+{
+	uint64_t q  = static_cast< uint64_t >( v ) * u2
+	            + ( ( static_cast< uint64_t >( u2 ) << 32 ) | u1 );
+	uint32_t q1 = static_cast< uint32_t >( q >> 32 );
+	uint32_t q0 = static_cast< uint32_t >( q );
+	uint64_t d  = ( static_cast< uint64_t >( d1 ) << 32 ) | d0;
+	uint64_t r;
+
+	// r = ( ( u1 - q1 d1 ) B + u0 ) - q1 d0 - d  (mod B^2)
+	r  = ( static_cast< uint64_t >( static_cast< uint32_t >( u1 - q1 * d1 ) ) << 32 ) | u0;
+	r -= static_cast< uint64_t >( q1 ) * d0;
+	r -= d;
+	q1++;
+
+	if ( static_cast< uint32_t >( r >> 32 ) >= q0 )
+	{
+		q1--;
+		r += d;
+	}
+	if ( r >= d )
+	{
+		q1++;
+		r -= d;
+	}
+
+	rR1 = static_cast< uint32_t >( r >> 32 );
+	rR0 = static_cast< uint32_t >( r );
+	return q1;
+}
+
+
+/**
+ * \brief q = a / d (n cislic, d > 0), vraci zbytek.
+ *
+ * Delitel se normalizuje posuvem a delenec se posouva prubezne, kazda
+ * cislice podilu je pak jedno deleni 2/1 prevracenou hodnotou.
+ * Postupuje od nejvyssi cislice, pQ tedy muze lezet na pA.
+ */
+inline uint32_t
+LimbsDivRem1( uint32_t* pQ, const uint32_t* pA, size_t n, uint32_t d )
+{
+	BIGNUM_ASSERT( d != 0 );
+
+	if ( n == 0 )
+		return 0;
+
+	unsigned int s = 0;
+
+	while ( ( d << s & 0x80000000 ) == 0 )
+		s++;
+
+	uint32_t dn = d << s;
+	uint32_t v  = LimbsInvert( dn );
+	uint32_t r  = 0;
+	uint32_t u0;
+
+	if ( s == 0 )
+	{
+		while ( n-- )
+			pQ[ n ] = LimbsDivRem2by1( r, pA[ n ], dn, v, r );
+		return r;
+	}
+
+	// Horni bity nejvyssi cislice jsou mensi nez dn
+	r = pA[ n - 1 ] >> ( 32 - s );
+	while ( --n )
+	{
+		u0 = ( pA[ n ] << s ) | ( pA[ n - 1 ] >> ( 32 - s ) );
+		pQ[ n ] = LimbsDivRem2by1( r, u0, dn, v, r );
+	}
+	pQ[ 0 ] = LimbsDivRem2by1( r, pA[ 0 ] << s, dn, v, r );
+
+	return r >> s;
+}
+
+
+/**
+ * \brief Vraci a mod d (n cislic, d > 0), stejne jako LimbsDivRem1().
+ */
+inline uint32_t
+LimbsMod1( const uint32_t* pA, size_t n, uint32_t d )
+{
+	BIGNUM_ASSERT( d != 0 );
+
+	if ( n == 0 )
+		return 0;
+
+	unsigned int s = 0;
+
+	while ( ( d << s & 0x80000000 ) == 0 )
+		s++;
+
+	uint32_t dn = d << s;
+	uint32_t v  = LimbsInvert( dn );
+	uint32_t r  = 0;
+
+	if ( s == 0 )
+	{
+		while ( n-- )
+			LimbsDivRem2by1( r, pA[ n ], dn, v, r );
+		return r;
+	}
+
+	r = pA[ n - 1 ] >> ( 32 - s );
+	while ( --n )
+		LimbsDivRem2by1( r, ( pA[ n ] << s ) | ( pA[ n - 1 ] >> ( 32 - s ) ), dn, v, r );
+	LimbsDivRem2by1( r, pA[ 0 ] << s, dn, v, r );
+
+	return r >> s;
+}
+
+
+/**
+ * \brief r = a << bits (n cislic, 0 < bits < 32), vraci vysunute bity.
+ *
+ * Postupuje od nejvyssi cislice, pR tedy muze lezet na pA nebo za nim.
+ */
+inline uint32_t
+LimbsShiftLeft( uint32_t* pR, const uint32_t* pA, size_t n, unsigned int bits )
+{
+	BIGNUM_ASSERT( bits > 0 && bits < 32 );
+
+	if ( n == 0 )
+		return 0;
+
+	unsigned int rem_bits = 32 - bits;
+	uint32_t     out      = pA[ n - 1 ] >> rem_bits;
+	size_t       i;
+
+	for ( i = n - 1 ; i > 0 ; i-- )
+		pR[ i ] = ( pA[ i ] << bits ) | ( pA[ i - 1 ] >> rem_bits );
+	pR[ 0 ] = pA[ 0 ] << bits;
+
+	return out;
+}
+
+
+/**
+ * \brief r = a >> bits (n cislic, 0 < bits < 32), vraci vysunute bity
+ *  (v hornich bitech vysledku).
+ *
+ * Postupuje od nejnizsi cislice, pR tedy muze lezet na pA nebo pred nim.
+ */
+inline uint32_t
+LimbsShiftRight( uint32_t* pR, const uint32_t* pA, size_t n, unsigned int bits )
+{
+	BIGNUM_ASSERT( bits > 0 && bits < 32 );
+
+	if ( n == 0 )
+		return 0;
+
+	unsigned int rem_bits = 32 - bits;
+	uint32_t     out      = pA[ 0 ] << rem_bits;
+	size_t       i;
+
+	for ( i = 0 ; i + 1 < n ; i++ )
+		pR[ i ] = ( pA[ i ] >> bits ) | ( pA[ i + 1 ] << rem_bits );
+	pR[ n - 1 ] = pA[ n - 1 ] >> bits;
+
+	return out;
+}
+
+
+/**
+ * \brief r = a * a (a ma n > 0 cislic, r 2 * n cislic).
+ *
+ * Soucny a[ i ] * a[ j ] pro i < j se spocitaji jen jednou a zdvojnasobi
+ * posuvem, pak se prictou druhe mocniny cislic. Oproti obecnemu nasobeni
+ * je to zhruba polovina nasobeni cislic. pR nesmi lezet na pA.
+ */
+inline void
+LimbsSqr( uint32_t* pR, const uint32_t* pA, size_t n )
+{
+	BIGNUM_ASSERT( n > 0 && pR != pA );
+
+	uint64_t square;
+	uint64_t tmp;
+	uint32_t carry = 0;
+	size_t   i;
+
+	// Soucty a[ i ] * a[ j ] pro i < j, radek i zacina na cislici 2 * i + 1
+	pR[ 0 ] = 0;
+	pR[ 2 * n - 1 ] = 0;
+	if ( n > 1 )
+	{
+		pR[ n ] = LimbsMul1( pR + 1, pA + 1, n - 1, pA[ 0 ] );
+		for ( i = 1 ; i + 1 < n ; i++ )
+			pR[ n + i ] = LimbsAddMul1( pR + 2 * i + 1, pA + i + 1, n - i - 1, pA[ i ] );
+
+		pR[ 2 * n - 1 ] = LimbsShiftLeft( pR, pR, 2 * n - 1, 1 );
+	}
+
+	// Pricteme a[ i ]^2 na cislice 2 * i a 2 * i + 1
+	for ( i = 0 ; i < n ; i++ )
+	{
+		square = static_cast< uint64_t >( pA[ i ] ) * pA[ i ];
+
+		tmp = static_cast< uint64_t >( pR[ 2 * i ] ) + static_cast< uint32_t >( square ) + carry;
+		pR[ 2 * i ] = static_cast< uint32_t >( tmp );
+		tmp = static_cast< uint64_t >( pR[ 2 * i + 1 ] ) + ( square >> 32 ) + ( tmp >> 32 );
+		pR[ 2 * i + 1 ] = static_cast< uint32_t >( tmp );
+		carry = static_cast< uint32_t >( tmp >> 32 );
+	}
+}
+
+
+/**
+ * \brief Skolni nasobeni r = a * b (r ma na + nb cislic, na, nb > 0).
+ *
+ * K vysledku pricitame radky a * b[i] posunute o i cislic primo
+ * ve vyslednem poli, bez mezivysledku. pR nesmi lezet na pA ani pB.
+ */
+inline void
+LimbsMul( uint32_t* pR, const uint32_t* pA, size_t na, const uint32_t* pB, size_t nb )
+{
+	size_t i;
+
+	pR[ na ] = LimbsMul1( pR, pA, na, pB[ 0 ] );
+	for ( i = 1 ; i < nb ; i++ )
+		pR[ na + i ] = LimbsAddMul1( pR + i, pA, na, pB[ i ] );
+}
+
+
+/**
+ * \brief Porovna a a b (n cislic).
+ *
+ * \return 1 pokud a > b, -1 pokud a < b, jinak 0.
+ */
+inline int
+LimbsCompare( const uint32_t* pA, const uint32_t* pB, size_t n )
+{
+	while ( n-- )
+		if ( pA[ n ] != pB[ n ] )
+			return pA[ n ] > pB[ n ] ? 1 : -1;
+
+	return 0;
+}
+
+
+/**
+ * \brief Montgomeryho nasobeni r = a * b * R^(-1) mod m (R = 2^(32 * n)).
+ *
+ * Vsechna pole maji n cislic, a i b musi byt mensi nez m. Pole pT
+ * slouzi jako pracovni prostor a musi mit alespon 2n + 2 cislic.
+ * Pole pR se muze prekryvat s pA nebo pB.
+ */
+inline void
+LimbsMontMul( uint32_t* pR, const uint32_t* pA, const uint32_t* pB,
+              const uint32_t* pM, size_t n, uint32_t mInv, uint32_t* pT )
+{
+	uint32_t carry;
+	uint32_t u;
+	size_t   i;
+
+	memset( pT, 0, ( 2 * n + 2 ) * sizeof( uint32_t ) );
+
+	// t = a * b
+	for ( i = 0 ; i < n ; i++ )
+		pT[ i + n ] = LimbsAddMul1( pT + i, pA, n, pB[ i ] );
+
+	// Redukce: ke t pricitame nasobky m tak, aby nejnizsich n cislic
+	// bylo nulovych, a vysledek je pak horni polovina t.
+	for ( i = 0 ; i < n ; i++ )
+	{
+		u = pT[ i ] * mInv;
+		carry = LimbsAddMul1( pT + i, pM, n, u );
+		LimbsAdd1( pT + i + n, pT + i + n, n + 2 - i, carry );
+	}
+
+	// Vysledek je mensi nez 2m, staci tedy nejvyse jedno odecteni.
+	uint32_t* pHigh = pT + n;
+
+	if ( pHigh[ n ] != 0 || LimbsCompare( pHigh, pM, n ) >= 0 )
+		LimbsSub( pR, pHigh, pM, n );
+	else
+		memcpy( pR, pHigh, n * sizeof( uint32_t ) );
+}
+
+
+/**
+ * \brief Tabulka jader s variantou pro konkretni procesor.
+ *
+ * Parametry a vysledky maji stejny vyznam jako odpovidajici prenositelne
+ * funkce (LimbsMul1, LimbsAddMul1, LimbsSubMul1, LimbsMul, LimbsSqr,
+ * LimbsMontMul).
+ */
+struct LimbKernels
+{
+	const char* mpName;
+
+	uint32_t ( *mpMul1 )( uint32_t* pR, const uint32_t* pA, size_t n, uint32_t b );
+	uint32_t ( *mpAddMul1 )( uint32_t* pR, const uint32_t* pA, size_t n, uint32_t b );
+	uint32_t ( *mpSubMul1 )( uint32_t* pR, const uint32_t* pA, size_t n, uint32_t b );
+	void     ( *mpMul )( uint32_t* pR, const uint32_t* pA, size_t na,
+	                     const uint32_t* pB, size_t nb );
+	void     ( *mpSqr )( uint32_t* pR, const uint32_t* pA, size_t n );
+	void     ( *mpMontMul )( uint32_t* pR, const uint32_t* pA, const uint32_t* pB,
+	                         const uint32_t* pM, size_t n, uint32_t mInv, uint32_t* pT );
+};
+
+
+/**
+ * \brief Prenositelne varianty jader.
+ */
+extern const LimbKernels cLimbKernelsPortable;
+
+
+/**
+ * \brief Jadra, ktera pouziva aritmetika BigNum.
+ *
+ * Pri startu programu se podle CPUID nastavi na LimbKernelsNative(),
+ * pokud je procesor podporuje, jinak zustanou prenositelna.
+ */
+extern LimbKernels gLimbKernels;
+
+
+/**
+ * \brief Vraci varianty jader pro tento procesor (x86-64 s BMI2 a ADX),
+ *  nebo NULL, pokud je procesor nebo prekladac nema.
+ */
+const LimbKernels* LimbKernelsNative( void );
+
+
+//
+// Rychle nasobeni velkych cisel (Kernels.cc). Pracovni pole pT musi
+// mit alespon tolik cislic, kolik vrati odpovidajici funkce *Scratch.
+//
+
+
+/**
+ * \brief Pocet cislic, od ktereho se nasobi Karatsubovou metodou.
+ *
+ * Hodnota je nastavena podle mereni (Pmz_RSA_bench), meni se jen
+ * pred vypoctem (testy, mereni), nejmensi pouzity prah je 4.
+ */
+extern size_t gKaratsubaThreshold;
+
+
+/**
+ * \brief Pocet cislic, od ktereho se umocnuje na druhou Karatsubovou
+ *  metodou. Prima druha mocnina je temer dvakrat rychlejsi nez
+ *  nasobeni, prah je proto vyssi.
+ */
+extern size_t gKaratsubaSqrThreshold;
+
+
+/**
+ * \brief Pocet cislic delitele (a podilu), od ktereho BigNum::Divide()
+ *  deli rekurzivne (Burnikel, Ziegler) misto algoritmu D.
+ *
+ * Meni se jen pred vypoctem jako gKaratsubaThreshold, nejmensi
+ * pouzity prah je 4.
+ */
+extern size_t gDivideThreshold;
+
+
+/**
+ * \brief Vraci velikost pracovniho pole pro LimbsMulKaratsuba().
+ */
+size_t LimbsMulKaratsubaScratch( size_t na, size_t nb );
+
+
+/**
+ * \brief Vraci velikost pracovniho pole pro LimbsSqrKaratsuba().
+ */
+size_t LimbsSqrKaratsubaScratch( size_t n );
+
+
+/**
+ * \brief r = a * b (na a nb cislic, r na + nb cislic), pod prahem
+ *  gKaratsubaThreshold primo gLimbKernels.mpMul.
+ *
+ * Pole pR se nesmi prekryvat se vstupy.
+ */
+void LimbsMulKaratsuba( uint32_t* pR, const uint32_t* pA, size_t na, const uint32_t* pB, size_t nb,
+                        uint32_t* pT );
+
+
+/**
+ * \brief r = a * a (n cislic, r 2n cislic), pod prahem gKaratsubaSqrThreshold
+ *  primo gLimbKernels.mpSqr.
+ */
+void LimbsSqrKaratsuba( uint32_t* pR, const uint32_t* pA, size_t n, uint32_t* pT );
+
+
+#endif // _BIGNUM_KERNELS__H
@@ -0,0 +1,230 @@
+/*
+ * BigNum/NumberArena.cc - Arena pro docasna cisla uvnitr jedne operace.
+ *
+ * Copyright (c) 2006 Jiri Zajpt, <jzajpt@blueberry.cz>
+ */
+
+#include <iostream>
+#include <vector>
+#include <algorithm>
+#include <cstring>
+#include <pthread.h>
+#include "NumberBuffer.h"
+#include "NumberArena.h"
+
+
+/**
+ * \brief Velikost prvniho bloku areny (v cislicich).
+ */
+const size_t cArenaInitialSize = 16 * 1024;
+
+/**
+ * \brief Nejmensi buffer areny (v cislicich). Uvolneny buffer v sobe
+ *  nese ukazatel na dalsi volny buffer, musi se do nej vejit.
+ */
+const size_t cArenaMinClass = 2;
+
+/**
+ * \brief Pocet trid velikosti (buffery 2^cArenaMinClass az 2^47 cislic).
+ */
+const size_t cArenaClasses = 48;
+
+
+/**
+ * \brief Arena jednoho vlakna.
+ */
+struct NumberArenaState
+{
+	size_t                    mDepth;                   // Hloubka vnoreni NumberArenaScope
+	uint32_t*                 mpBlock;                  // Aktualni blok
+	size_t                    mBlockSize;               // Velikost bloku (v cislicich)
+	size_t                    mUsed;                    // Pouzita cast bloku
+	std::vector< uint32_t* >  mFullBlocks;              // Zaplnene bloky, uvolni se pri vyprazdneni
+	size_t                    mFullSize;                // Celkova velikost zaplnenych bloku
+	uint32_t*                 mpFree[ cArenaClasses ];  // Uvolnene buffery podle velikosti
+};
+
+
+static __thread NumberArenaState* tpArenaState = NULL;
+static pthread_key_t              gArenaKey;
+static pthread_once_t             gArenaOnce = PTHREAD_ONCE_INIT;
+
+
+static void
+DestroyArenaState( void* pArg )
+{
+	NumberArenaState* pState = static_cast< NumberArenaState* >( pArg );
+	size_t            i;
+
+	for ( i = 0 ; i < pState->mFullBlocks.size() ; i++ )
+		delete[] pState->mFullBlocks[ i ];
+
+	delete[] pState->mpBlock;
+	delete pState;
+}
+
+
+static void
+CreateArenaKey( void )
+{
+	pthread_key_create( &gArenaKey, DestroyArenaState );
+}
+
+
+/**
+ * \brief Vraci arenu volajiciho vlakna, pri prvnim volani ji vytvori.
+ */
+static NumberArenaState&
+GetArenaState( void )
+{
+	if ( tpArenaState )
+		return *tpArenaState;
+
+	pthread_once( &gArenaOnce, CreateArenaKey );
+
+	NumberArenaState* pState = new NumberArenaState;
+
+	pState->mDepth     = 0;
+	pState->mpBlock    = new uint32_t[ cArenaInitialSize ];
+	pState->mBlockSize = cArenaInitialSize;
+	pState->mUsed      = 0;
+	pState->mFullSize  = 0;
+	memset( pState->mpFree, 0, sizeof( pState->mpFree ) );
+
+	// Pri ukonceni vlakna se arena uvolni
+	pthread_setspecific( gArenaKey, pState );
+	tpArenaState = pState;
+
+	return *pState;
+}
+
+
+/**
+ * \brief Vraci tridu velikosti pro buffer o count cislicich.
+ */
+static size_t
+GetArenaClass( size_t count )
+{
+	size_t c = cArenaMinClass;
+
+	while ( ( static_cast< size_t >( 1 ) << c ) < count )
+		c++;
+
+	return c;
+}
+
+
+/**
+ * \brief Uvolni vsechny buffery areny. Pokud arena behem operace
+ *  nestacila, nahradi vsechny bloky jednim dostatecne velkym.
+ */
+static void
+ResetArena( NumberArenaState& rState )
+{
+	if ( !rState.mFullBlocks.empty() )
+	{
+		size_t i;
+
+		for ( i = 0 ; i < rState.mFullBlocks.size() ; i++ )
+			delete[] rState.mFullBlocks[ i ];
+
+		rState.mBlockSize += rState.mFullSize;
+		rState.mFullSize   = 0;
+		rState.mFullBlocks.clear();
+
+		delete[] rState.mpBlock;
+		rState.mpBlock = new uint32_t[ rState.mBlockSize ];
+	}
+
+	rState.mUsed = 0;
+	memset( rState.mpFree, 0, sizeof( rState.mpFree ) );
+}
+
+
+uint32_t*
+NumberArena::Allocate( size_t count )
+{
+	if ( !tpArenaState || tpArenaState->mDepth == 0 )
+		return NULL;
+
+	NumberArenaState& rState = *tpArenaState;
+	size_t            c      = GetArenaClass( count );
+	size_t            size   = static_cast< size_t >( 1 ) << c;
+	uint32_t*         pBuffer;
+
+	// Nejdrive zkusime uvolneny buffer stejne tridy
+	if ( rState.mpFree[ c ] )
+	{
+		pBuffer = rState.mpFree[ c ];
+		memcpy( &rState.mpFree[ c ], pBuffer, sizeof( uint32_t* ) );
+		return pBuffer;
+	}
+
+	if ( rState.mUsed + size > rState.mBlockSize )
+	{
+		// Zaplneny blok si nechame do vyprazdneni areny, jsou v nem
+		// buffery, ktere se jeste pouzivaji
+		rState.mFullBlocks.push_back( rState.mpBlock );
+		rState.mFullSize += rState.mBlockSize;
+
+		rState.mBlockSize = std::max( 2 * rState.mBlockSize, size );
+		rState.mpBlock    = new uint32_t[ rState.mBlockSize ];
+		rState.mUsed      = 0;
+	}
+
+	pBuffer       = rState.mpBlock + rState.mUsed;
+	rState.mUsed += size;
+
+	return pBuffer;
+}
+
+
+void
+NumberArena::Release( uint32_t* pBuffer, size_t count )
+{
+	// Po vyprazdneni areny buffer uz nikomu nepatri
+	if ( !tpArenaState || tpArenaState->mDepth == 0 )
+		return;
+
+	NumberArenaState& rState = *tpArenaState;
+	size_t            c      = GetArenaClass( count );
+
+	memcpy( pBuffer, &rState.mpFree[ c ], sizeof( uint32_t* ) );
+	rState.mpFree[ c ] = pBuffer;
+}
+
+
+bool
+NumberArena::IsActive( void )
+{
+	return tpArenaState && tpArenaState->mDepth > 0;
+}
+
+
+NumberArenaScope::NumberArenaScope( NumberBuffer* pFirst, NumberBuffer* pSecond )
+	: mpFirst( pFirst ), mpSecond( pSecond )
+{
+	GetArenaState().mDepth++;
+}
+
+
+NumberArenaScope::~NumberArenaScope()
+{
+	NumberArenaState& rState = *tpArenaState;
+
+	// Ve vnorene oblasti vysledky patri nadrazene operaci, ktera
+	// je v arene pouziva dal
+	if ( rState.mDepth > 1 )
+	{
+		rState.mDepth--;
+		return;
+	}
+
+	if ( mpFirst )
+		mpFirst->Detach();
+	if ( mpSecond )
+		mpSecond->Detach();
+
+	rState.mDepth = 0;
+	ResetArena( rState );
+}
@@ -0,0 +1,78 @@
+/*
+ * BigNum/NumberArena.h - Arena pro docasna cisla uvnitr jedne operace.
+ *
+ * Copyright (c) 2006 Jiri Zajpt, <jzajpt@blueberry.cz>
+ */
+
+#ifndef _BIGNUM_NUMBERARENA__H
+#define _BIGNUM_NUMBERARENA__H
+
+
+#include "../Common/Types.h"
+
+
+class NumberBuffer;
+
+
+/**
+ * \brief Pamet pro buffery NumberBuffer vytvorene uvnitr operace.
+ *
+ * Kazde vlakno ma vlastni arenu. Je aktivni jen uvnitr NumberArenaScope,
+ * mimo ni se buffery alokuji normalne pres new[]. Buffery se berou
+ * z jednoho bloku posunem ukazatele a uvolnene buffery se vraci do
+ * seznamu podle velikosti (mocniny dvou), takze se opakujici se
+ * vypocet (cyklus modularniho umocneni) obejde bez alokatoru.
+ * Na konci vnejsi NumberArenaScope se cela arena najednou vyprazdni.
+ *
+ * \author Jiri Zajpt
+ */
+class NumberArena
+{
+public:
+	/**
+	 * \brief Vraci buffer pro count cislic (neinicializovany).
+	 *
+	 * \return Ukazatel do areny nebo NULL, pokud arena neni aktivni.
+	 */
+	static uint32_t* Allocate( size_t count );
+
+	/**
+	 * \brief Vrati buffer ziskany pomoci Allocate() k dalsimu pouziti.
+	 */
+	static void Release( uint32_t* pBuffer, size_t count );
+
+	/**
+	 * \brief Testuje, zda-li je arena volajiciho vlakna aktivni.
+	 */
+	static bool IsActive( void );
+};
+
+
+/**
+ * \brief Oblast, ve ktere NumberBuffer alokuje z areny.
+ *
+ * Oblasti lze vnorovat, arena se vyprazdni az pri opusteni te vnejsi.
+ * Cisla, ktera maji oblast prezit (vysledky operace), se predaji
+ * konstruktoru a pri opusteni vnejsi oblasti se presunou na haldu.
+ * Vysledek vraceny hodnotou musi byt deklarovan pred oblasti a oblast
+ * musi skoncit pred prikazem return, jinak by se kopie vytvorila
+ * jeste v arene.
+ *
+ * \author Jiri Zajpt
+ */
+class NumberArenaScope
+{
+public:
+	NumberArenaScope( NumberBuffer* pFirst = NULL, NumberBuffer* pSecond = NULL );
+	~NumberArenaScope();
+
+private:
+	NumberArenaScope( const NumberArenaScope& );
+	NumberArenaScope& operator = ( const NumberArenaScope& );
+
+	NumberBuffer* mpFirst;
+	NumberBuffer* mpSecond;
+};
+
+
+#endif // _BIGNUM_NUMBERARENA__H
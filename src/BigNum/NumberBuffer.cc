@@ -9,26 +9,37 @@
 
 #include <iostream>
 #include <vector>
+#include <algorithm>
 #include <limits.h>
 #include "NumberBuffer.h"
+#include "NumberArena.h"
+#include "../Common/Stats.h"
 
 
 
 NumberBuffer::NumberBuffer()
 	: mpBuffer( 0 ),
-	mBufferSize( 0 )
+	mBufferSize( 0 ),
+	mCapacity( 0 ),
+	mActiveSize( 0 ),
+	mArena( false )
 {
 }
 
 
 NumberBuffer::NumberBuffer( const NumberBuffer& rFrom, size_t count )
 	: mpBuffer( 0 ),
-	mBufferSize( 0 )
+	mBufferSize( 0 ),
+	mCapacity( 0 ),
+	mActiveSize( 0 ),
+	mArena( false )
 {
 	if ( count == 0 )
 	{
 		Allocate( rFrom.mBufferSize );
 		memcpy( mpBuffer, rFrom.mpBuffer, mBufferSize * sizeof( uint32_t ) );
+		STATS_COPY( mBufferSize * sizeof( uint32_t ) );
+		mActiveSize = rFrom.mActiveSize;
 	}
 	else
 	{
@@ -37,22 +48,37 @@ NumberBuffer::NumberBuffer( const NumberBuffer& rFrom, size_t count )
 			memcpy( mpBuffer, rFrom.mpBuffer, rFrom.mBufferSize * sizeof( uint32_t ) );
 		else
 			memcpy( mpBuffer, rFrom.mpBuffer, count * sizeof( uint32_t ) );
+		STATS_COPY( std::min( count, rFrom.mBufferSize ) * sizeof( uint32_t ) );
+
+		// Pri zkraceni mohou horni cislice kopie vyjit nulove
+		if ( count >= rFrom.mActiveSize )
+			mActiveSize = rFrom.mActiveSize;
+		else
+			Normalize();
 	}
 }
 
 
 NumberBuffer::NumberBuffer( const NumberBuffer& rFrom )
 	: mpBuffer( 0 ),
-	mBufferSize( 0 )
+	mBufferSize( 0 ),
+	mCapacity( 0 ),
+	mActiveSize( 0 ),
+	mArena( false )
 {
 	Allocate( rFrom.mBufferSize );
 	memcpy( mpBuffer, rFrom.mpBuffer, mBufferSize * sizeof( uint32_t ) );
+	STATS_COPY( mBufferSize * sizeof( uint32_t ) );
+	mActiveSize = rFrom.mActiveSize;
 }
 
 
 NumberBuffer::NumberBuffer( size_t count )
 	: mpBuffer( 0 ),
-	mBufferSize( 0 )
+	mBufferSize( 0 ),
+	mCapacity( 0 ),
+	mActiveSize( 0 ),
+	mArena( false )
 {
 	Allocate( count );
 }
@@ -71,13 +97,11 @@ NumberBuffer::operator = ( const NumberBuffer& rFrom )
 	if ( this == &rFrom )
 		return *this;
 
-	// Pokud mame alokovany buffer musime jej nejdrive
-	// uvolnit.
-	if ( IsBufferAllocated() )
-		Free();
-
+	// Pokud se cislo vejde do naseho bufferu, Allocate() jej pouzije
 	Allocate( rFrom.mBufferSize );
 	memcpy( mpBuffer, rFrom.mpBuffer, mBufferSize * sizeof( uint32_t ) );
+	STATS_COPY( mBufferSize * sizeof( uint32_t ) );
+	mActiveSize = rFrom.mActiveSize;
 	return *this;
 }
 
@@ -85,14 +109,6 @@ NumberBuffer::operator = ( const NumberBuffer& rFrom )
 bool
 NumberBuffer::Allocate( size_t count )
 {
-	// Pokud uz je buffer alokovany, s nicim nemanipulujeme
-	// a vratime false.
-	if ( IsBufferAllocated() )
-	{
-		std::cerr << "Buffer uz je alokovany!" << std::endl;
-		return false;
-	}
-
 	// Alokovani bufferu velikosti nula = Free()
 	if ( count == 0 )
 	{
@@ -100,11 +116,20 @@ NumberBuffer::Allocate( size_t count )
 		return true;
 	}
 
-	mpBuffer = new uint32_t[ count ];
-	if ( !mpBuffer )
-		throw AllocationFailedException();
+	// Pokud se pocet prvku vejde do jiz alokovaneho bufferu, pouzijeme
+	// jej (puvodni obsah se zahodi), jinak alokujeme novy.
+	if ( count > mCapacity )
+	{
+		Free();
+
+		STATS_ALLOC( STATS_ALLOCATE, count );
+
+		mpBuffer  = NewBuffer( count, mArena );
+		mCapacity = count;
+	}
 
 	mBufferSize = count;
+	mActiveSize = 0;
 	// Nastavime nuly v celem bufferu.
 	memset( mpBuffer, 0, mBufferSize * sizeof( uint32_t ) );
 
@@ -118,81 +143,151 @@ NumberBuffer::Reallocate( size_t newCount )
 	if ( newCount == mBufferSize )
 		return true;
 
-	if ( !IsBufferAllocated() )
-	{
-		Allocate( newCount );
-		return true;
-	}
-	
 	if ( newCount == 0 )
 	{
 		Free();
 		return true;
 	}
 
-	uint32_t* copy = new uint32_t[ mBufferSize ];
-	size_t    old_count = mBufferSize;
-	if ( !copy )
-		throw AllocationFailedException();
+	// Pri zvetsovani nad kapacitu rosteme geometricky, aby opakovane
+	// zvetsovani o par cislic nestalo pokazde alokaci a kopii
+	if ( newCount > mCapacity )
+		SetCapacity( std::max( newCount, 2 * mCapacity ) );
 
-	memcpy( copy, mpBuffer, old_count * sizeof( uint32_t ) );
-
-	Free();
-	mpBuffer = new uint32_t[ newCount ];
-	if ( !mpBuffer )
-		throw AllocationFailedException();
+	if ( newCount > mBufferSize )
+		memset( mpBuffer + mBufferSize, 0, ( newCount - mBufferSize ) * sizeof( uint32_t ) );
 
 	mBufferSize = newCount;
-	if ( newCount > old_count )
-		memcpy( mpBuffer, copy, old_count * sizeof( uint32_t ) );
-	else
-		memcpy( mpBuffer, copy, newCount * sizeof( uint32_t ) );
+
+	// Pri zkraceni mohou horni cislice vyjit nulove
+	if ( mActiveSize > newCount )
+		Normalize();
+
+	return true;
+}
+
+
+bool
+NumberBuffer::Reserve( size_t count )
+{
+	if ( count > mCapacity )
+		SetCapacity( count );
 
 	return true;
 }
 
 
+void
+NumberBuffer::ShrinkToFit( void )
+{
+	if ( mCapacity == mBufferSize )
+		return;
+
+	if ( mBufferSize == 0 )
+	{
+		Free();
+		return;
+	}
+
+	SetCapacity( mBufferSize );
+}
+
+
+void
+NumberBuffer::Detach( void )
+{
+	if ( !mArena )
+		return;
+
+	// Puvodni buffer zustava v arene, uvolni se s ni
+	uint32_t* pBuffer = mBufferSize ? new uint32_t[ mBufferSize ] : 0;
+
+	if ( mBufferSize )
+	{
+		memcpy( pBuffer, mpBuffer, mBufferSize * sizeof( uint32_t ) );
+		STATS_COPY( mBufferSize * sizeof( uint32_t ) );
+	}
+
+	mpBuffer  = pBuffer;
+	mCapacity = mBufferSize;
+	mArena    = false;
+}
+
+
 void
 NumberBuffer::Free( void )
 {
-	if ( IsBufferAllocated() )
-	delete[] mpBuffer;
+	if ( mpBuffer )
+		DeleteBuffer( mpBuffer, mCapacity, mArena );
+
 	mBufferSize = 0;
+	mCapacity = 0;
+	mActiveSize = 0;
 	mpBuffer = 0;
+	mArena = false;
 }
 
 
-uint32_t
-NumberBuffer::operator [] ( size_t index ) const
+uint32_t*
+NumberBuffer::NewBuffer( size_t count, bool& rArena )
 {
-	if ( index >= mBufferSize )
-		return 0;
-	return mpBuffer[ index ];
+	// Uvnitr NumberArenaScope bereme pamet z areny
+	uint32_t* pBuffer = NumberArena::Allocate( count );
+
+	rArena = pBuffer != 0;
+
+	if ( !pBuffer )
+		pBuffer = new uint32_t[ count ];
+	if ( !pBuffer )
+		throw AllocationFailedException();
+
+	return pBuffer;
 }
 
 
-uint32_t
-NumberBuffer::Get( size_t index ) const
+void
+NumberBuffer::DeleteBuffer( uint32_t* pBuffer, size_t count, bool arena )
 {
-	if ( index >= mBufferSize )
-		return 0;
-	return mpBuffer[ index ];
+	if ( arena )
+		NumberArena::Release( pBuffer, count );
+	else
+		delete[] pBuffer;
 }
 
 
-bool
-NumberBuffer::Set( size_t index, uint32_t value )
+void
+NumberBuffer::SetCapacity( size_t capacity )
 {
-	if ( index >= mBufferSize )
-		return false;
-	mpBuffer[ index ] = value;
+	STATS_ALLOC( STATS_REALLOCATE, capacity );
 
-	return true;
+	// Novy buffer alokujeme vedle stareho a obsah rovnou prekopirujeme
+	bool      arena;
+	uint32_t* pBuffer = NewBuffer( capacity, arena );
+
+	if ( mBufferSize )
+	{
+		memcpy( pBuffer, mpBuffer, mBufferSize * sizeof( uint32_t ) );
+		STATS_COPY( mBufferSize * sizeof( uint32_t ) );
+	}
+
+	if ( mpBuffer )
+		DeleteBuffer( mpBuffer, mCapacity, mArena );
+
+	mpBuffer  = pBuffer;
+	mCapacity = capacity;
+	mArena    = arena;
+}
+
+
+void
+NumberBuffer::Normalize( void )
+{
+	mActiveSize = CountActiveSize();
 }
 
 
 size_t
-NumberBuffer::GetActiveSize( void ) const
+NumberBuffer::CountActiveSize( void ) const
 {
 	size_t i = mBufferSize;
 
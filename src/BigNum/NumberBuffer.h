@@ -15,9 +15,22 @@
 #include "../Common/Exceptions.h"
 
 
+// Kontroly invariant cisel, zapinaji se pomoci make DEBUG=1
+#ifdef BIGNUM_DEBUG
+#include <cassert>
+#define BIGNUM_ASSERT( expr ) assert( expr )
+#else
+#define BIGNUM_ASSERT( expr ) ( ( void ) 0 )
+#endif // BIGNUM_DEBUG
+
+
 /**
  * \brief Trida NumberBuffer slouzi k ulozeni nekolika 32-bitovych cisel.
  *
+ * Get() a Set() kontroluji meze a jsou urcene pro jednotlive cislice.
+ * Aritmetika pracuje primo s bufferem (GetBufferPointer()) pomoci
+ * funkci z Kernels.h a pocet aktivnich cislic pak prepocita Normalize().
+ *
  * \author Jiri Zajpt
  */
 class NumberBuffer
@@ -80,7 +93,12 @@ public:
 	 *
 	 * \return Hodnota bufferu na dane pozici.
 	 */
-	uint32_t operator [] ( size_t index ) const;
+	uint32_t operator [] ( size_t index ) const
+	{
+		if ( index >= mBufferSize )
+			return 0;
+		return mpBuffer[ index ];
+	};
 
 
 	/**
@@ -90,7 +108,12 @@ public:
 	 *
 	 * \return Hodnota na dane pozici.
 	 */
-	uint32_t Get( size_t index ) const;
+	uint32_t Get( size_t index ) const
+	{
+		if ( index >= mBufferSize )
+			return 0;
+		return mpBuffer[ index ];
+	};
 
 	
 	/**
@@ -101,14 +124,34 @@ public:
 	 *
 	 * \return True pokud se podarilo nastavit prvek, jinak false.
 	 */
-	bool Set( size_t index, uint32_t value );
+	bool Set( size_t index, uint32_t value )
+	{
+		if ( index >= mBufferSize )
+			return false;
+		mpBuffer[ index ] = value;
+
+		// Udrzujeme pocet aktivnich cislic
+		if ( value != 0 )
+		{
+			if ( index >= mActiveSize )
+				mActiveSize = index + 1;
+		}
+		else if ( index + 1 == mActiveSize )
+		{
+			while ( mActiveSize && mpBuffer[ mActiveSize - 1 ] == 0 )
+				mActiveSize--;
+		}
+
+		return true;
+	};
 
 	
 	/**
 	 * \brief Alokuje buffer pro dany pocet prvku.
 	 *
 	 * Po alokaci funkce nastavi vsechny prvky na nulu pomoci
-	 * fce memset().
+	 * fce memset(). Pokud ma jiz alokovany buffer dostatecnou
+	 * kapacitu, pouzije se znovu (puvodni obsah se zahodi).
 	 *
 	 * \param count Pocet prvku.
 	 *
@@ -120,12 +163,30 @@ public:
 	/**
 	 * \brief Realokuje buffer na novou velikost, pri zachovani obsahu.
 	 *
+	 * V ramci kapacity se jen zmeni velikost. Nad kapacitu se buffer
+	 * zvetsi alespon na dvojnasobek, takze postupne zvetsovani stoji
+	 * v prumeru konstantni pocet kopii na prvek.
+	 *
 	 * \param newCount Novy pocet prvku bufferu.
 	 *
 	 * \return True pokud re-alokace probehla uspesne, jinak false.
 	 */
 	bool Reallocate( size_t newCount );
 
+
+	/**
+	 * \brief Zajisti kapacitu alespon pro count prvku (velikost se nemeni).
+	 *
+	 * \return True pokud alokace probehla uspesne, jinak false.
+	 */
+	bool Reserve( size_t count );
+
+
+	/**
+	 * \brief Zmensi kapacitu na aktualni velikost bufferu.
+	 */
+	void ShrinkToFit( void );
+
 	
 	/**
 	 * \brief Uvolni buffer.
@@ -133,15 +194,50 @@ public:
 	void Free( void );
 
 	
+	/**
+	 * \brief Presune buffer z areny (viz NumberArena) na haldu.
+	 *
+	 * Vola se pro vysledky, ktere maji prezit vyprazdneni areny.
+	 * Pokud buffer neni v arene, funkce nic nedela.
+	 */
+	void Detach( void );
+
+	
 	/**
 	 * \brief Vraci pocet aktivnich prvku v cisle. 
 	 *
 	 * Aktivni prvek je takovy prvek ktera nese uzitecnou
 	 * hodnotu, tj. vsechny cislice krome tzv. leading zero.
+	 * Pocet se udrzuje pri kazde zmene bufferu, funkce nic nepocita.
 	 *
 	 * \return Pocet aktivnich prvku v cisle.
 	 */
-	size_t GetActiveSize( void ) const;
+	size_t GetActiveSize( void ) const
+	{
+		BIGNUM_ASSERT( mActiveSize == CountActiveSize() );
+		return mActiveSize;
+	};
+
+
+	/**
+	 * \brief Spocita aktivni prvky prochazenim bufferu od konce.
+	 */
+	size_t CountActiveSize( void ) const;
+
+
+	/**
+	 * \brief Prepocita pocet aktivnich prvku.
+	 *
+	 * Je nutne zavolat po zapisu primo do bufferu (GetBufferPointer()),
+	 * Set() a ostatni metody pocet udrzuji samy.
+	 */
+	void Normalize( void );
+
+
+	/**
+	 * \brief Testuje, zda-li udrzovany pocet aktivnich prvku odpovida obsahu.
+	 */
+	bool IsNormalized( void ) const { return mActiveSize == CountActiveSize(); };
 
 
 	/**
@@ -152,6 +248,12 @@ public:
 	size_t GetSize( void ) const { return mBufferSize; };
 
 
+	/**
+	 * \brief Vraci pocet prvku, pro ktere je alokovana pamet.
+	 */
+	size_t GetCapacity( void ) const { return mCapacity; };
+
+
 	/**
 	 * \brief Vraci ukazatel na buffer.
 	 *
@@ -169,6 +271,22 @@ public:
 
 
 private:
+	/**
+	 * \brief Alokuje pamet pro count prvku (z areny nebo z haldy).
+	 */
+	static uint32_t* NewBuffer( size_t count, bool& rArena );
+
+	/**
+	 * \brief Uvolni pamet ziskanou pomoci NewBuffer().
+	 */
+	static void DeleteBuffer( uint32_t* pBuffer, size_t count, bool arena );
+
+	/**
+	 * \brief Presune obsah do noveho bufferu o dane kapacite.
+	 */
+	void SetCapacity( size_t capacity );
+
+
 	/**
 	 * \brief Ukazatel na buffer ve kterem budou ulozeny cislice.
 	 *
@@ -180,9 +298,27 @@ private:
 
 
 	/**
-	 * \brief Pocet prvku ktere muze prave alokovany buffer uchovat.
+	 * \brief Pocet prvku bufferu (muze byt mensi nez kapacita).
 	 */
 	size_t mBufferSize;
+
+
+	/**
+	 * \brief Pocet prvku, pro ktere je alokovana pamet (>= mBufferSize).
+	 */
+	size_t mCapacity;
+
+
+	/**
+	 * \brief Pocet aktivnich prvku (bez nulovych cislic na konci).
+	 */
+	size_t mActiveSize;
+
+
+	/**
+	 * \brief Buffer je z areny vlakna, ne z haldy.
+	 */
+	bool mArena;
 };
 
 
@@ -1,117 +1,423 @@
 /*
- * BigNum/BigNum.cc - Implementace tridy pro praci s libovolne velkymi cisly.
+ * Common/Base64.cc - Funkce pro praci s Base64.
  *
  * Prakticka maturitni zkouska, 2005 - 2006
  * Implementace sifrovaci algoritmu RSA.
- * 
+ *
  * Copyright (c) 2005-2006 Jiri Zajpt, <jzajpt@blueberry.cz>
  */
 
 #include <iostream>
-#include "../Common/Types.h"
+#include <cstring>
+#include <algorithm>
+#include "Types.h"
+#include "Exceptions.h"
 #include "Base64.h"
 
+#if defined( __GNUC__ ) && ( defined( __x86_64__ ) || defined( __i386__ ) )
+#define BASE64_SIMD
+#include <immintrin.h>
+#endif // __GNUC__
 
-void
-Base64EncodeAtom( char* data, size_t dataLength, char* encoded )
+
+static const char cBase64Chars[] =
+	"ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+
+/**
+ * \brief Tabulka hodnot znaku, -1 pro znaky mimo abecedu.
+ */
+class Base64Table
 {
-	if ( data == NULL || encoded == NULL || dataLength == 0 )
-		return;
+public:
+	Base64Table()
+	{
+		memset( mValues, -1, sizeof( mValues ) );
+		for ( int i = 0 ; i < 64 ; i++ )
+			mValues[ static_cast< uint8_t >( cBase64Chars[ i ] ) ] = i;
+	};
+
+	int8_t mValues[ 256 ];
+};
 
-	uint32_t    buffer;
-	static char base64Chars[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
 
-	buffer = data[ 0 ] << 16;
-	if ( dataLength >= 2 )
-		buffer |= data[ 1 ] << 8;
-	if ( dataLength == 3 )
-		buffer |= data[ 2 ];
+static const Base64Table gTable;
 
-	encoded[ 0 ] = base64Chars[ ( buffer >> 18 ) & 0x3F ];
-	encoded[ 1 ] = base64Chars[ ( buffer >> 12 ) & 0x3F ];
 
-	if ( dataLength == 2 )
+/**
+ * \brief Zakoduje celistve trojice bytu (size je nasobek tri).
+ */
+static void
+EncodeScalar( const uint8_t* pIn, size_t size, char* pOut )
+{
+	for ( ; size >= 3 ; size -= 3, pIn += 3, pOut += 4 )
 	{
-		encoded[ 2 ] = base64Chars[ ( buffer >> 6 ) & 0x3F ];
-		encoded[ 3 ] = '=';
+		uint32_t buffer = ( pIn[ 0 ] << 16 ) | ( pIn[ 1 ] << 8 ) | pIn[ 2 ];
+
+		pOut[ 0 ] = cBase64Chars[ buffer >> 18 ];
+		pOut[ 1 ] = cBase64Chars[ ( buffer >> 12 ) & 0x3F ];
+		pOut[ 2 ] = cBase64Chars[ ( buffer >> 6 ) & 0x3F ];
+		pOut[ 3 ] = cBase64Chars[ buffer & 0x3F ];
 	}
-	else if ( dataLength == 3 )
+}
+
+
+/**
+ * \brief Dekoduje celistve ctverice znaku bez doplneni.
+ *
+ * \return false, obsahuje-li vstup znak mimo abecedu.
+ */
+static bool
+DecodeScalar( const char* pIn, size_t size, uint8_t* pOut )
+{
+	const int8_t* pValues = gTable.mValues;
+
+	for ( ; size >= 4 ; size -= 4, pIn += 4, pOut += 3 )
 	{
-		encoded[ 2 ] = base64Chars[ ( buffer >> 6 ) & 0x3F ];
-		encoded[ 3 ] = base64Chars[ buffer & 0x3F ];
+		int32_t a = pValues[ static_cast< uint8_t >( pIn[ 0 ] ) ];
+		int32_t b = pValues[ static_cast< uint8_t >( pIn[ 1 ] ) ];
+		int32_t c = pValues[ static_cast< uint8_t >( pIn[ 2 ] ) ];
+		int32_t d = pValues[ static_cast< uint8_t >( pIn[ 3 ] ) ];
+
+		// Zaporna hodnota kterehokoliv znaku nastavi znamenkovy bit
+		if ( ( a | b | c | d ) < 0 )
+			return false;
+
+		uint32_t buffer = ( a << 18 ) | ( b << 12 ) | ( c << 6 ) | d;
+
+		pOut[ 0 ] = static_cast< uint8_t >( buffer >> 16 );
+		pOut[ 1 ] = static_cast< uint8_t >( buffer >> 8 );
+		pOut[ 2 ] = static_cast< uint8_t >( buffer );
 	}
-	else
+
+	return true;
+}
+
+
+#ifdef BASE64_SIMD
+
+/*
+ * Vektorove varianty podle W. Muly a D. Lemira: 12 (24) bytu se pomoci
+ * pshufb rozlozi na 16 (32) sestibitovych indexu a ty se na znaky
+ * prevedou dalsi pshufb s tabulkou posunu. Dekodovani postupuje opacne
+ * a zaroven overuje, ze vstup obsahuje jen znaky abecedy.
+ */
+
+__attribute__(( target( "ssse3" ) ))
+static inline __m128i
+EncodeIndices128( __m128i in )
+{
+	in = _mm_shuffle_epi8( in, _mm_setr_epi8( 1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10 ) );
+
+	__m128i t0 = _mm_and_si128( in, _mm_set1_epi32( 0x0fc0fc00 ) );
+	__m128i t1 = _mm_mulhi_epu16( t0, _mm_set1_epi32( 0x04000040 ) );
+	__m128i t2 = _mm_and_si128( in, _mm_set1_epi32( 0x003f03f0 ) );
+	__m128i t3 = _mm_mullo_epi16( t2, _mm_set1_epi32( 0x01000010 ) );
+	__m128i indices = _mm_or_si128( t1, t3 );
+
+	// 0..25 -> 13, 26..51 -> 0, 52..61 -> 1..10, 62 -> 11, 63 -> 12
+	__m128i result = _mm_subs_epu8( indices, _mm_set1_epi8( 51 ) );
+	__m128i less   = _mm_cmpgt_epi8( _mm_set1_epi8( 26 ), indices );
+	result = _mm_or_si128( result, _mm_and_si128( less, _mm_set1_epi8( 13 ) ) );
+
+	const __m128i shift = _mm_setr_epi8( 'a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+	                                     '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+	                                     '0' - 52, '+' - 62, '/' - 63, 'A', 0, 0 );
+
+	return _mm_add_epi8( _mm_shuffle_epi8( shift, result ), indices );
+}
+
+
+__attribute__(( target( "ssse3" ) ))
+static size_t
+EncodeSsse3( const uint8_t* pIn, size_t size, char* pOut )
+{
+	size_t done = 0;
+
+	// Cte se 16 bytu, zpracuje 12
+	for ( ; size - done >= 16 ; done += 12, pOut += 16 )
 	{
-		encoded[ 2 ] = '=';
-		encoded[ 3 ] = '=';
+		__m128i in = _mm_loadu_si128( reinterpret_cast< const __m128i* >( pIn + done ) );
+		_mm_storeu_si128( reinterpret_cast< __m128i* >( pOut ), EncodeIndices128( in ) );
 	}
+
+	return done;
 }
 
 
-int
-Base64CharToInt( char c )
+__attribute__(( target( "avx2" ) ))
+static size_t
+EncodeAvx2( const uint8_t* pIn, size_t size, char* pOut )
 {
-	static char base64Chars[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
-	int i;
-	if ( c == '=' )
-		return 0;
-	for ( i = 0 ; i < 64 ; i++ )
+	size_t done = 0;
+
+	const __m256i shuffle = _mm256_setr_epi8( 1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10,
+	                                          1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10 );
+	const __m256i shift = _mm256_setr_epi8( 'a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+	                                        '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+	                                        '0' - 52, '+' - 62, '/' - 63, 'A', 0, 0,
+	                                        'a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+	                                        '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+	                                        '0' - 52, '+' - 62, '/' - 63, 'A', 0, 0 );
+
+	// Kazda polovina registru zpracuje 12 bytu, cte se az 28 bytu
+	for ( ; size - done >= 28 ; done += 24, pOut += 32 )
 	{
-		if ( base64Chars[ i ] == c )
-			return i;
+		__m128i lo = _mm_loadu_si128( reinterpret_cast< const __m128i* >( pIn + done ) );
+		__m128i hi = _mm_loadu_si128( reinterpret_cast< const __m128i* >( pIn + done + 12 ) );
+		__m256i in = _mm256_inserti128_si256( _mm256_castsi128_si256( lo ), hi, 1 );
+
+		in = _mm256_shuffle_epi8( in, shuffle );
+
+		__m256i t0 = _mm256_and_si256( in, _mm256_set1_epi32( 0x0fc0fc00 ) );
+		__m256i t1 = _mm256_mulhi_epu16( t0, _mm256_set1_epi32( 0x04000040 ) );
+		__m256i t2 = _mm256_and_si256( in, _mm256_set1_epi32( 0x003f03f0 ) );
+		__m256i t3 = _mm256_mullo_epi16( t2, _mm256_set1_epi32( 0x01000010 ) );
+		__m256i indices = _mm256_or_si256( t1, t3 );
+
+		__m256i result = _mm256_subs_epu8( indices, _mm256_set1_epi8( 51 ) );
+		__m256i less   = _mm256_cmpgt_epi8( _mm256_set1_epi8( 26 ), indices );
+		result = _mm256_or_si256( result, _mm256_and_si256( less, _mm256_set1_epi8( 13 ) ) );
+		result = _mm256_add_epi8( _mm256_shuffle_epi8( shift, result ), indices );
+
+		_mm256_storeu_si256( reinterpret_cast< __m256i* >( pOut ), result );
 	}
-	return -1;
-};
 
+	return done;
+}
 
-void
-Base64DecodeAtom( char* data, char* decoded )
+
+/*
+ * Tabulky pro overeni znaku podle dolniho a horniho pulbytu. Znak je
+ * platny, pokud maji obe hodnoty prazdny prunik.
+ */
+#define BASE64_LUT_LO \
+	0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, \
+	0x11, 0x11, 0x13, 0x1A, 0x1B, 0x1B, 0x1B, 0x1A
+#define BASE64_LUT_HI \
+	0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08, \
+	0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10
+#define BASE64_LUT_ROLL \
+	0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0
+
+
+__attribute__(( target( "ssse3" ) ))
+static size_t
+DecodeSsse3( const char* pIn, size_t size, uint8_t* pOut )
 {
-	if ( data == NULL || decoded == NULL )
-		return;
+	size_t done = 0;
+
+	const __m128i lutLo   = _mm_setr_epi8( BASE64_LUT_LO );
+	const __m128i lutHi   = _mm_setr_epi8( BASE64_LUT_HI );
+	const __m128i lutRoll = _mm_setr_epi8( BASE64_LUT_ROLL );
+	const __m128i mask    = _mm_set1_epi8( 0x0F );
+
+	// Zapisuje se 16 bytu, platnych je 12; zbytek prepise dalsi ctverice
+	for ( ; size - done >= 24 ; done += 16, pOut += 12 )
+	{
+		__m128i in = _mm_loadu_si128( reinterpret_cast< const __m128i* >( pIn + done ) );
+		__m128i hiNibbles = _mm_and_si128( _mm_srli_epi32( in, 4 ), mask );
+		__m128i loNibbles = _mm_and_si128( in, mask );
+		__m128i lo = _mm_shuffle_epi8( lutLo, loNibbles );
+		__m128i hi = _mm_shuffle_epi8( lutHi, hiNibbles );
 
-	uint32_t buffer;
+		// Neplatny znak, blok (a zbytek) dokonci skalarni cesta
+		if ( _mm_movemask_epi8( _mm_cmpeq_epi8( _mm_and_si128( lo, hi ), _mm_setzero_si128() ) ) != 0xFFFF )
+			break;
 
-	buffer = Base64CharToInt( data[ 3 ] );
-	buffer |= Base64CharToInt( data[ 2 ] ) << 6;
-	buffer |= Base64CharToInt( data[ 1 ] ) << 12;
-	buffer |= Base64CharToInt( data[ 0 ] ) << 18;
+		__m128i eq2F   = _mm_cmpeq_epi8( in, _mm_set1_epi8( '/' ) );
+		__m128i roll   = _mm_shuffle_epi8( lutRoll, _mm_add_epi8( eq2F, hiNibbles ) );
+		__m128i values = _mm_add_epi8( in, roll );
 
+		__m128i merged = _mm_maddubs_epi16( values, _mm_set1_epi32( 0x01400140 ) );
+		__m128i out    = _mm_madd_epi16( merged, _mm_set1_epi32( 0x00011000 ) );
 
-	decoded[ 0 ] = ( buffer >> 16 ) & 0xFF;
-	decoded[ 1 ] = ( buffer >> 8 ) & 0xFF;
-	decoded[ 2 ] = buffer & 0xFF;
+		out = _mm_shuffle_epi8( out, _mm_setr_epi8( 2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1 ) );
+		_mm_storeu_si128( reinterpret_cast< __m128i* >( pOut ), out );
+	}
 
+	return done;
 }
 
 
-char*
-Base64EncodeString( const char* originalString, size_t stringLength )
+__attribute__(( target( "avx2" ) ))
+static size_t
+DecodeAvx2( const char* pIn, size_t size, uint8_t* pOut )
 {
-	uint iterations = stringLength / 3;
+	size_t done = 0;
 
-	char* encodedString = new char[ ( iterations * 4 ) + 5 ];
-	if ( !encodedString )
-		return NULL;
+	const __m256i lutLo   = _mm256_setr_epi8( BASE64_LUT_LO, BASE64_LUT_LO );
+	const __m256i lutHi   = _mm256_setr_epi8( BASE64_LUT_HI, BASE64_LUT_HI );
+	const __m256i lutRoll = _mm256_setr_epi8( BASE64_LUT_ROLL, BASE64_LUT_ROLL );
+	const __m256i mask    = _mm256_set1_epi8( 0x0F );
+	const __m256i pack    = _mm256_setr_epi8( 2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1,
+	                                          2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1 );
 
-	memset( encodedString, 0, ( iterations * 4 ) + 5 );
-	
-	int i;
-	char* pIn = const_cast< char* >( originalString );
-	char* pOut = encodedString;
-	for ( i = 0 ; i < iterations ; i++ )
+	// Zapisuje se 32 bytu, platnych je 24
+	for ( ; size - done >= 44 ; done += 32, pOut += 24 )
 	{
-		Base64EncodeAtom( pIn, 3, pOut );
-		pIn += 3;
-		pOut += 4;
+		__m256i in = _mm256_loadu_si256( reinterpret_cast< const __m256i* >( pIn + done ) );
+		__m256i hiNibbles = _mm256_and_si256( _mm256_srli_epi32( in, 4 ), mask );
+		__m256i loNibbles = _mm256_and_si256( in, mask );
+		__m256i lo = _mm256_shuffle_epi8( lutLo, loNibbles );
+		__m256i hi = _mm256_shuffle_epi8( lutHi, hiNibbles );
+
+		if ( !_mm256_testz_si256( lo, hi ) )
+			break;
+
+		__m256i eq2F   = _mm256_cmpeq_epi8( in, _mm256_set1_epi8( '/' ) );
+		__m256i roll   = _mm256_shuffle_epi8( lutRoll, _mm256_add_epi8( eq2F, hiNibbles ) );
+		__m256i values = _mm256_add_epi8( in, roll );
+
+		__m256i merged = _mm256_maddubs_epi16( values, _mm256_set1_epi32( 0x01400140 ) );
+		__m256i out    = _mm256_madd_epi16( merged, _mm256_set1_epi32( 0x00011000 ) );
+
+		out = _mm256_shuffle_epi8( out, pack );
+		out = _mm256_permutevar8x32_epi32( out, _mm256_setr_epi32( 0, 1, 2, 4, 5, 6, 3, 7 ) );
+		_mm256_storeu_si256( reinterpret_cast< __m256i* >( pOut ), out );
 	}
 
-	uint rest = stringLength % 3;
+	return done;
+}
+
+#endif // BASE64_SIMD
+
+
+typedef size_t (*EncodeBlocksFunc)( const uint8_t* pIn, size_t size, char* pOut );
+typedef size_t (*DecodeBlocksFunc)( const char* pIn, size_t size, uint8_t* pOut );
+
+
+static size_t
+EncodeNone( const uint8_t*, size_t, char* )
+{
+	return 0;
+}
+
+
+static size_t
+DecodeNone( const char*, size_t, uint8_t* )
+{
+	return 0;
+}
+
+
+/**
+ * \brief Vybere nejrychlejsi variantu, kterou procesor podporuje.
+ */
+static EncodeBlocksFunc
+SelectEncode( void )
+{
+#ifdef BASE64_SIMD
+	__builtin_cpu_init();
+
+	if ( __builtin_cpu_supports( "avx2" ) )
+		return EncodeAvx2;
+	if ( __builtin_cpu_supports( "ssse3" ) )
+		return EncodeSsse3;
+#endif // BASE64_SIMD
+
+	return EncodeNone;
+}
+
+
+static DecodeBlocksFunc
+SelectDecode( void )
+{
+#ifdef BASE64_SIMD
+	__builtin_cpu_init();
+
+	if ( __builtin_cpu_supports( "avx2" ) )
+		return DecodeAvx2;
+	if ( __builtin_cpu_supports( "ssse3" ) )
+		return DecodeSsse3;
+#endif // BASE64_SIMD
+
+	return DecodeNone;
+}
+
+
+static const EncodeBlocksFunc gpEncodeBlocks = SelectEncode();
+static const DecodeBlocksFunc gpDecodeBlocks = SelectDecode();
+
+
+size_t
+Base64Encode( const uint8_t* pInput, size_t size, char* pOutput )
+{
+	size_t whole = size - size % 3;
+	size_t done  = gpEncodeBlocks( pInput, whole, pOutput );
+	char*  pOut  = pOutput + done / 3 * 4;
+
+	EncodeScalar( pInput + done, whole - done, pOut );
+	pOut += ( whole - done ) / 3 * 4;
+
+	size_t rest = size - whole;
 	if ( rest != 0 )
 	{
-		Base64EncodeAtom( pIn, rest, pOut );
+		uint32_t buffer = pInput[ whole ] << 16;
+		if ( rest == 2 )
+			buffer |= pInput[ whole + 1 ] << 8;
+
+		pOut[ 0 ] = cBase64Chars[ buffer >> 18 ];
+		pOut[ 1 ] = cBase64Chars[ ( buffer >> 12 ) & 0x3F ];
+		pOut[ 2 ] = rest == 2 ? cBase64Chars[ ( buffer >> 6 ) & 0x3F ] : '=';
+		pOut[ 3 ] = '=';
+		pOut += 4;
 	}
 
+	return pOut - pOutput;
+}
+
+
+size_t
+Base64Decode( const char* pInput, size_t size, uint8_t* pOutput )
+{
+	if ( size % 4 != 0 )
+		return cBase64Invalid;
+	if ( size == 0 )
+		return 0;
+
+	// Doplneni smi byt jen v posledni ctverici
+	size_t padding = 0;
+	if ( pInput[ size - 1 ] == '=' )
+		padding = pInput[ size - 2 ] == '=' ? 2 : 1;
+
+	size_t whole = padding ? size - 4 : size;
+	size_t done  = gpDecodeBlocks( pInput, whole, pOutput );
+
+	if ( !DecodeScalar( pInput + done, whole - done, pOutput + done / 4 * 3 ) )
+		return cBase64Invalid;
+
+	size_t decoded = whole / 4 * 3;
+
+	if ( padding )
+	{
+		char    last[ 4 ];
+		uint8_t tmp[ 3 ];
+
+		memcpy( last, pInput + whole, 4 );
+		last[ 2 ] = padding == 2 ? 'A' : last[ 2 ];
+		last[ 3 ] = 'A';
+
+		if ( !DecodeScalar( last, 4, tmp ) )
+			return cBase64Invalid;
+
+		memcpy( pOutput + decoded, tmp, 3 - padding );
+		decoded += 3 - padding;
+	}
+
+	return decoded;
+}
+
+
+char*
+Base64EncodeString( const char* originalString, size_t stringLength )
+{
+	char*  encodedString = new char[ Base64EncodedSize( stringLength ) + 1 ];
+	size_t length        = Base64Encode( reinterpret_cast< const uint8_t* >( originalString ),
+	                                     stringLength, encodedString );
+
+	encodedString[ length ] = 0;
+
 	return encodedString;
 }
 
@@ -119,24 +425,168 @@ Base64EncodeString( const char* originalString, size_t stringLength )
 char*
 Base64DecodeString( const char* encodedString, size_t stringLength )
 {
-	uint iterations = stringLength / 4;
+	std::string decoded;
 
-	char* decodedString = new char[ ( iterations * 3 ) + 1 ];
-	if ( !decodedString )
+	try
+	{
+		Base64Decoder decoder;
+
+		decoder.Update( encodedString, stringLength, decoded );
+		decoder.Finish();
+	}
+	catch ( Exception& )
+	{
 		return NULL;
+	}
+
+	char* decodedString = new char[ decoded.length() + 1 ];
+
+	memcpy( decodedString, decoded.data(), decoded.length() );
+	decodedString[ decoded.length() ] = 0;
+
+	return decodedString;
+}
 
-	decodedString[ ( iterations * 3 ) + 1 ] = 0;
-	
-	int i;
-	char* pIn = const_cast< char* >( encodedString );
-	char* pOut = decodedString;
 
-	for ( i = 0 ; i < iterations ; i++ )
+void
+Base64Encoder::Update( const char* pData, size_t size, std::string& rOutput )
+{
+	const uint8_t* pIn = reinterpret_cast< const uint8_t* >( pData );
+	char           encoded[ 4 ];
+
+	// Nejdrive doplnime rozpracovanou trojici
+	while ( mPendingSize != 0 && mPendingSize < 3 && size != 0 )
 	{
-		Base64DecodeAtom( pIn, pOut );
-		pIn += 4;
-		pOut += 3;
+		mPending[ mPendingSize++ ] = *pIn++;
+		size--;
 	}
 
-	return decodedString;
+	if ( mPendingSize == 3 )
+	{
+		Base64Encode( mPending, 3, encoded );
+		Append( encoded, 4, rOutput );
+		mPendingSize = 0;
+	}
+
+	size_t whole = size - size % 3;
+	if ( whole != 0 )
+	{
+		// Bez zalamovani kodujeme primo do vystupu
+		std::string& rTarget = mLineLength ? mEncoded : rOutput;
+		size_t       offset  = rTarget.length();
+
+		rTarget.resize( offset + whole / 3 * 4 );
+		Base64Encode( pIn, whole, &rTarget[ offset ] );
+
+		if ( mLineLength )
+		{
+			Append( mEncoded.data(), mEncoded.length(), rOutput );
+			mEncoded.clear();
+		}
+	}
+
+	for ( ; whole < size ; whole++ )
+		mPending[ mPendingSize++ ] = pIn[ whole ];
+}
+
+
+void
+Base64Encoder::Finish( std::string& rOutput )
+{
+	if ( mPendingSize != 0 )
+	{
+		char encoded[ 4 ];
+
+		Base64Encode( mPending, mPendingSize, encoded );
+		Append( encoded, 4, rOutput );
+		mPendingSize = 0;
+	}
+
+	if ( mColumn != 0 )
+	{
+		rOutput += '\n';
+		mColumn = 0;
+	}
+}
+
+
+void
+Base64Encoder::Append( const char* pEncoded, size_t size, std::string& rOutput )
+{
+	if ( mLineLength == 0 )
+	{
+		rOutput.append( pEncoded, size );
+		return;
+	}
+
+	while ( size != 0 )
+	{
+		size_t n = std::min( size, mLineLength - mColumn );
+
+		rOutput.append( pEncoded, n );
+		pEncoded += n;
+		size     -= n;
+		mColumn  += n;
+
+		if ( mColumn == mLineLength )
+		{
+			rOutput += '\n';
+			mColumn = 0;
+		}
+	}
+}
+
+
+void
+Base64Decoder::Update( const char* pData, size_t size, std::string& rOutput )
+{
+	size_t i;
+
+	// Vynechame bile znaky, zbytek z minula zustava na zacatku bufferu
+	for ( i = 0 ; i < size ; i++ )
+	{
+		char c = pData[ i ];
+
+		if ( c == '\n' || c == '\r' || c == ' ' || c == '\t' )
+			continue;
+
+		if ( mEnded )
+			throw Exception( "Base64Decoder::Update(): Data za koncem Base64!" );
+
+		mBuffer += c;
+	}
+
+	size_t whole = mBuffer.length() - mBuffer.length() % 4;
+	if ( whole == 0 )
+		return;
+
+	// Ctverice se znakem '=' musi byt posledni (npos je vetsi nez whole)
+	size_t pad = mBuffer.find( '=' );
+	if ( pad < whole )
+	{
+		if ( pad < whole - 4 || mBuffer.length() != whole )
+			throw Exception( "Base64Decoder::Update(): Neplatna data Base64!" );
+
+		mEnded = true;
+	}
+
+	size_t offset = rOutput.length();
+
+	rOutput.resize( offset + whole / 4 * 3 );
+
+	size_t decoded = Base64Decode( mBuffer.data(), whole,
+	                               reinterpret_cast< uint8_t* >( &rOutput[ offset ] ) );
+	if ( decoded == cBase64Invalid )
+		throw Exception( "Base64Decoder::Update(): Neplatna data Base64!" );
+
+	rOutput.resize( offset + decoded );
+	mBuffer.erase( 0, whole );
+}
+
+
+void
+Base64Decoder::Finish( void )
+{
+	if ( !mBuffer.empty() )
+		throw Exception( "Base64Decoder::Finish(): Data Base64 jsou zkracena!" );
 }
@@ -3,15 +3,140 @@
  *
  * Prakticka maturitni zkouska, 2005 - 2006
  * Implementace sifrovaci algoritmu RSA.
- * 
+ *
  * Copyright (c) 2005-2006 Jiri Zajpt, <jzajpt@blueberry.cz>
  */
 
 #ifndef _COMMON_BASE64__H
+#define _COMMON_BASE64__H
+
+
+#include <string>
+#include "Types.h"
+
+
+/**
+ * \brief Delka radku textovych vystupu (klice, textove zasifrovane soubory).
+ */
+const size_t cBase64LineLength = 48;
+
+
+/**
+ * \brief Navratova hodnota Base64Decode() pro neplatna data.
+ */
+const size_t cBase64Invalid = static_cast< size_t >( -1 );
+
 
+/**
+ * \brief Vraci delku zakodovanych dat (vcetne doplneni znaky '=').
+ */
+inline size_t
+Base64EncodedSize( size_t size )
+{
+	return ( size + 2 ) / 3 * 4;
+};
+
+
+/**
+ * \brief Zakoduje data do Base64.
+ *
+ * \param pOutput Buffer o velikosti alespon Base64EncodedSize( size ).
+ * \return Pocet zapsanych znaku (bez ukoncovaci nuly, ta se nezapisuje).
+ */
+size_t Base64Encode( const uint8_t* pInput, size_t size, char* pOutput );
 
+/**
+ * \brief Dekoduje Base64 (bez bilych znaku).
+ *
+ * Delka vstupu musi byt nasobkem ctyr, znaky '=' smi byt jen na konci.
+ *
+ * \param pOutput Buffer o velikosti alespon size / 4 * 3.
+ * \return Pocet zapsanych bytu nebo cBase64Invalid.
+ */
+size_t Base64Decode( const char* pInput, size_t size, uint8_t* pOutput );
+
+/**
+ * \brief Zakoduje retezec, vysledek je nutne uvolnit pomoci delete[].
+ */
 char* Base64EncodeString( const char* originalString, size_t stringLength );
+
+/**
+ * \brief Dekoduje retezec (bile znaky se preskakuji).
+ *
+ * \return Dekodovana data ukoncena nulou (uvolnit pomoci delete[]),
+ *  NULL pro neplatny vstup.
+ */
 char* Base64DecodeString( const char* encodedString, size_t stringLength );
 
 
+/**
+ * \brief Postupne kodovani do Base64.
+ *
+ * Data lze predavat po libovolne velkych castech, zakodovany vystup
+ * se pripojuje na konec retezce. Pri zadane delce radku se vystup
+ * zalamuje znakem '\n' a Finish() ukonci i posledni radek.
+ *
+ * \author Jiri Zajpt
+ */
+class Base64Encoder
+{
+public:
+	/**
+	 * \brief Konstruktor.
+	 *
+	 * \param lineLength Delka radku, 0 znamena bez zalamovani.
+	 */
+	Base64Encoder( size_t lineLength = 0 )
+		: mPendingSize( 0 ), mLineLength( lineLength ), mColumn( 0 ) {};
+
+	/**
+	 * \brief Zakoduje dalsi cast dat.
+	 */
+	void Update( const char* pData, size_t size, std::string& rOutput );
+
+	/**
+	 * \brief Zakoduje zbytek dat vcetne doplneni.
+	 */
+	void Finish( std::string& rOutput );
+
+private:
+	void Append( const char* pEncoded, size_t size, std::string& rOutput );
+
+	uint8_t     mPending[ 3 ];
+	size_t      mPendingSize;
+	size_t      mLineLength;
+	size_t      mColumn;
+	std::string mEncoded;
+};
+
+
+/**
+ * \brief Postupne dekodovani Base64.
+ *
+ * Bile znaky (konce radku, mezery) se preskakuji. Pri neplatnych datech
+ * vyhodi Update() nebo Finish() vyjimku Exception.
+ *
+ * \author Jiri Zajpt
+ */
+class Base64Decoder
+{
+public:
+	Base64Decoder() : mEnded( false ) {};
+
+	/**
+	 * \brief Dekoduje dalsi cast dat.
+	 */
+	void Update( const char* pData, size_t size, std::string& rOutput );
+
+	/**
+	 * \brief Overi, ze data nekonci uprostred skupiny ctyr znaku.
+	 */
+	void Finish( void );
+
+private:
+	std::string mBuffer;
+	bool        mEnded;
+};
+
+
 #endif // _COMMON_BASE64__H
@@ -0,0 +1,153 @@
+/*
+ * Common/ChaCha20.cc - Proudova sifra ChaCha20 (RFC 8439).
+ *
+ * Copyright (c) 2006 Jiri Zajpt, <jzajpt@blueberry.cz>
+ */
+
+#include <iostream>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include "ChaCha20.h"
+#include "Exceptions.h"
+
+#ifdef WIN32
+#include <windows.h>
+#include <wincrypt.h>
+#endif // WIN32
+
+
+#define ROTL32( x, n ) \
+	( ( ( x ) << ( n ) ) | ( ( x ) >> ( 32 - ( n ) ) ) )
+
+#define QUARTERROUND( a, b, c, d ) \
+	a += b; d ^= a; d = ROTL32( d, 16 ); \
+	c += d; b ^= c; b = ROTL32( b, 12 ); \
+	a += b; d ^= a; d = ROTL32( d, 8 );  \
+	c += d; b ^= c; b = ROTL32( b, 7 );
+
+
+static uint32_t
+Load32( const uint8_t* p )
+{
+	return p[ 0 ] | ( p[ 1 ] << 8 ) | ( p[ 2 ] << 16 ) |
+	       ( static_cast< uint32_t >( p[ 3 ] ) << 24 );
+}
+
+
+ChaCha20::ChaCha20( const uint8_t* pKey, const uint8_t* pNonce, uint32_t counter )
+	: mPosition( cBlockSize )
+{
+	// "expand 32-byte k"
+	mState[ 0 ] = 0x61707865;
+	mState[ 1 ] = 0x3320646e;
+	mState[ 2 ] = 0x79622d32;
+	mState[ 3 ] = 0x6b206574;
+
+	size_t i;
+	for ( i = 0 ; i < 8 ; i++ )
+		mState[ 4 + i ] = Load32( pKey + 4 * i );
+
+	mState[ 12 ] = counter;
+	for ( i = 0 ; i < 3 ; i++ )
+		mState[ 13 + i ] = Load32( pNonce + 4 * i );
+}
+
+
+ChaCha20::~ChaCha20()
+{
+	memset( mState, 0, sizeof( mState ) );
+	memset( mKeyStream, 0, sizeof( mKeyStream ) );
+}
+
+
+void
+ChaCha20::NextBlock( void )
+{
+	uint32_t x[ 16 ];
+	size_t   i;
+
+	for ( i = 0 ; i < 16 ; i++ )
+		x[ i ] = mState[ i ];
+
+	// 20 kol = 10 x (sloupce + diagonaly)
+	for ( i = 0 ; i < 10 ; i++ )
+	{
+		QUARTERROUND( x[ 0 ], x[ 4 ], x[  8 ], x[ 12 ] )
+		QUARTERROUND( x[ 1 ], x[ 5 ], x[  9 ], x[ 13 ] )
+		QUARTERROUND( x[ 2 ], x[ 6 ], x[ 10 ], x[ 14 ] )
+		QUARTERROUND( x[ 3 ], x[ 7 ], x[ 11 ], x[ 15 ] )
+		QUARTERROUND( x[ 0 ], x[ 5 ], x[ 10 ], x[ 15 ] )
+		QUARTERROUND( x[ 1 ], x[ 6 ], x[ 11 ], x[ 12 ] )
+		QUARTERROUND( x[ 2 ], x[ 7 ], x[  8 ], x[ 13 ] )
+		QUARTERROUND( x[ 3 ], x[ 4 ], x[  9 ], x[ 14 ] )
+	}
+
+	for ( i = 0 ; i < 16 ; i++ )
+	{
+		uint32_t v = x[ i ] + mState[ i ];
+
+		mKeyStream[ 4 * i + 0 ] = static_cast< uint8_t >( v );
+		mKeyStream[ 4 * i + 1 ] = static_cast< uint8_t >( v >> 8 );
+		mKeyStream[ 4 * i + 2 ] = static_cast< uint8_t >( v >> 16 );
+		mKeyStream[ 4 * i + 3 ] = static_cast< uint8_t >( v >> 24 );
+	}
+
+	mState[ 12 ]++;
+	mPosition = 0;
+}
+
+
+void
+ChaCha20::Process( const char* pInput, char* pOutput, size_t size )
+{
+	size_t i;
+
+	for ( i = 0 ; i < size ; i++ )
+	{
+		if ( mPosition == cBlockSize )
+			NextBlock();
+
+		pOutput[ i ] = pInput[ i ] ^ mKeyStream[ mPosition++ ];
+	}
+}
+
+
+void
+ChaCha20::GenerateRandom( uint8_t* pBuffer, size_t size )
+{
+#ifdef WIN32
+	HCRYPTPROV provider;
+	bool       ok = false;
+
+	if ( CryptAcquireContext( &provider, NULL, NULL, PROV_RSA_FULL,
+	                          CRYPT_VERIFYCONTEXT | CRYPT_SILENT ) )
+	{
+		ok = CryptGenRandom( provider, static_cast< DWORD >( size ), pBuffer ) != 0;
+		CryptReleaseContext( provider, 0 );
+	}
+
+	if ( !ok )
+		throw Exception( "ChaCha20::GenerateRandom(): Chyba CryptGenRandom()!" );
+#else
+	size_t n  = 0;
+	size_t r;
+	FILE*  fp = fopen( "/dev/urandom", "rb" );
+
+	if ( !fp )
+		throw Exception( "ChaCha20::GenerateRandom(): Nelze otevrit /dev/urandom!" );
+
+	// fread() muze vratit mene bytu, dokud nenastane chyba, cteme dal
+	while ( n < size )
+	{
+		r = fread( pBuffer + n, 1, size - n, fp );
+		if ( r == 0 )
+			break;
+		n += r;
+	}
+	fclose( fp );
+
+	if ( n < size )
+		throw Exception( "ChaCha20::GenerateRandom(): Chyba cteni /dev/urandom!" );
+#endif // WIN32
+}
@@ -0,0 +1,70 @@
+/*
+ * Common/ChaCha20.h - Proudova sifra ChaCha20 (RFC 8439).
+ *
+ * Copyright (c) 2006 Jiri Zajpt, <jzajpt@blueberry.cz>
+ */
+
+#ifndef _COMMON_CHACHA20__H
+#define _COMMON_CHACHA20__H
+
+
+#include "Types.h"
+
+
+/**
+ * \brief Proudova sifra ChaCha20.
+ *
+ * Sifrovani i desifrovani je stejna operace (XOR s proudem klice).
+ * Data lze zpracovavat po libovolne velkych castech, pozice v proudu
+ * klice se mezi volanimi Process() pamatuje.
+ *
+ * \author Jiri Zajpt
+ */
+class ChaCha20
+{
+public:
+	static const size_t cKeySize   = 32;
+	static const size_t cNonceSize = 12;
+	static const size_t cBlockSize = 64;
+
+	/**
+	 * \brief Konstruktor.
+	 *
+	 * \param pKey     Klic (cKeySize bytu).
+	 * \param pNonce   Nonce (cNonceSize bytu), pro jeden klic nesmi
+	 *                 byt nikdy pouzita dvakrat.
+	 * \param counter  Pocatecni hodnota citace bloku.
+	 */
+	ChaCha20( const uint8_t* pKey, const uint8_t* pNonce, uint32_t counter = 0 );
+
+	/**
+	 * \brief Destruktor. Smaze klic z pameti.
+	 */
+	~ChaCha20();
+
+	/**
+	 * \brief Zasifruje (desifruje) size bytu z pInput do pOutput.
+	 *
+	 * pInput a pOutput mohou ukazovat na stejny buffer.
+	 */
+	void Process( const char* pInput, char* pOutput, size_t size );
+
+	/**
+	 * \brief Naplni buffer nahodnymi byty vhodnymi pro klic.
+	 *
+	 * Pouziva /dev/urandom, ve Windows CryptGenRandom(). Pokud zdroj
+	 * nahody neni k dispozici, vyhodi Exception (klic z rand() by byl
+	 * predvidatelny).
+	 */
+	static void GenerateRandom( uint8_t* pBuffer, size_t size );
+
+private:
+	void NextBlock( void );
+
+	uint32_t mState[ 16 ];
+	uint8_t  mKeyStream[ cBlockSize ];
+	size_t   mPosition;
+};
+
+
+#endif // _COMMON_CHACHA20__H
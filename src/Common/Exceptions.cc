@@ -40,3 +40,10 @@ UnableToOpenFileException::UnableToOpenFileException( std::string fileName )
 	gpLastException = this;
 	mFileName = fileName;
 }
+
+
+InvalidKeyException::InvalidKeyException( std::string message )
+{
+	gpLastException = this;
+	mMessage = message;
+}
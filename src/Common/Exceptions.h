@@ -62,10 +62,10 @@ public:
 };
 
 
-class InvalidKeyException
+class InvalidKeyException : public Exception
 {
 public:
-	InvalidKeyException() {};
+	InvalidKeyException( std::string message );
 };
 
 
@@ -0,0 +1,797 @@
+/*
+ * Common/FilePipeline.cc - Prekryvani cteni, zapisu a zpracovani souboru.
+ *
+ * Copyright (c) 2006 Jiri Zajpt, <jzajpt@blueberry.cz>
+ */
+
+#include <iostream>
+#include <cstring>
+#include <vector>
+#include <algorithm>
+#include <pthread.h>
+#include "Exceptions.h"
+#include "FilePipeline.h"
+
+#ifdef __linux__
+#include <cerrno>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <sys/syscall.h>
+#include <linux/io_uring.h>
+#endif // __linux__
+
+
+/**
+ * \brief Synchronni varianta - obycejne fread/fwrite.
+ */
+class SyncFilePipeline : public FilePipeline
+{
+public:
+	SyncFilePipeline( FILE* fpInput, FILE* fpOutput, size_t bufferSize )
+		: mpInput( fpInput ), mpOutput( fpOutput ), mBuffer( bufferSize ) {};
+
+	virtual size_t Read( const char*& rpData )
+	{
+		size_t n = fread( &mBuffer[ 0 ], 1, mBuffer.size(), mpInput );
+		if ( n == 0 && ferror( mpInput ) )
+			throw Exception( "FilePipeline::Read(): Chyba pri cteni souboru!" );
+
+		rpData = &mBuffer[ 0 ];
+		return n;
+	};
+
+	virtual void Write( const char* pData, size_t size )
+	{
+		if ( fwrite( pData, 1, size, mpOutput ) != size )
+			throw Exception( "FilePipeline::Write(): Chyba pri zapisu souboru!" );
+	};
+
+	virtual void Finish( void )
+	{
+		if ( fflush( mpOutput ) != 0 )
+			throw Exception( "FilePipeline::Write(): Chyba pri zapisu souboru!" );
+	};
+
+	virtual FilePipelineMode GetMode( void ) const { return FILE_PIPELINE_SYNC; };
+
+private:
+	FILE*               mpInput;
+	FILE*               mpOutput;
+	std::vector< char > mBuffer;
+};
+
+
+/**
+ * \brief Asynchronni varianta s ctecim a zapisovacim vlaknem.
+ *
+ * Buffery pro cteni i zapis tvori kruhove fronty, poradi urcuji
+ * pocitadla (n-ty buffer ma index n % depth).
+ */
+class ThreadFilePipeline : public FilePipeline
+{
+public:
+	ThreadFilePipeline( FILE* fpInput, FILE* fpOutput, size_t bufferSize, size_t depth );
+
+	virtual ~ThreadFilePipeline();
+
+	virtual size_t Read( const char*& rpData );
+
+	virtual void Write( const char* pData, size_t size );
+
+	virtual void Finish( void );
+
+	virtual FilePipelineMode GetMode( void ) const { return FILE_PIPELINE_THREADS; };
+
+private:
+	static void* ReaderMain( void* pArg );
+	static void* WriterMain( void* pArg );
+
+	void Stop( void );
+	void CheckError( void );
+
+	FILE*                 mpInput;
+	FILE*                 mpOutput;
+	size_t                mBufferSize;
+	size_t                mDepth;
+	std::vector< char* >  mInBuffers;
+	std::vector< size_t > mInSizes;
+	std::vector< char* >  mOutBuffers;
+	std::vector< size_t > mOutSizes;
+
+	pthread_mutex_t       mMutex;
+	pthread_cond_t        mChanged;
+	pthread_t             mReader;
+	pthread_t             mWriter;
+	bool                  mStop;
+	bool                  mInputDone;
+	bool                  mOutputDone;
+	const char*           mpError;
+
+	uint64_t              mFilled;     // Pocet prectenych bufferu
+	uint64_t              mTaken;      // Pocet bufferu predanych z Read()
+	uint64_t              mQueued;     // Pocet bufferu zarazenych k zapisu
+	uint64_t              mWritten;    // Pocet zapsanych bufferu
+};
+
+
+ThreadFilePipeline::ThreadFilePipeline( FILE* fpInput, FILE* fpOutput,
+                                        size_t bufferSize, size_t depth )
+	: mpInput( fpInput ), mpOutput( fpOutput ), mBufferSize( bufferSize ),
+	  mDepth( depth ), mInBuffers( depth ), mInSizes( depth ),
+	  mOutBuffers( depth ), mOutSizes( depth, 0 ), mStop( false ),
+	  mInputDone( false ), mOutputDone( false ), mpError( NULL ),
+	  mFilled( 0 ), mTaken( 0 ), mQueued( 0 ), mWritten( 0 )
+{
+	size_t i;
+	for ( i = 0 ; i < mDepth ; i++ )
+	{
+		mInBuffers[ i ]  = new char[ mBufferSize ];
+		mOutBuffers[ i ] = new char[ mBufferSize ];
+	}
+
+	pthread_mutex_init( &mMutex, NULL );
+	pthread_cond_init( &mChanged, NULL );
+
+	if ( pthread_create( &mReader, NULL, ReaderMain, this ) != 0 )
+		throw Exception( "FilePipeline: Nepodarilo se vytvorit vlakno!" );
+	if ( pthread_create( &mWriter, NULL, WriterMain, this ) != 0 )
+	{
+		Stop();
+		pthread_join( mReader, NULL );
+		throw Exception( "FilePipeline: Nepodarilo se vytvorit vlakno!" );
+	}
+}
+
+
+ThreadFilePipeline::~ThreadFilePipeline()
+{
+	Stop();
+	pthread_join( mReader, NULL );
+	pthread_join( mWriter, NULL );
+
+	pthread_cond_destroy( &mChanged );
+	pthread_mutex_destroy( &mMutex );
+
+	size_t i;
+	for ( i = 0 ; i < mDepth ; i++ )
+	{
+		delete[] mInBuffers[ i ];
+		delete[] mOutBuffers[ i ];
+	}
+}
+
+
+void
+ThreadFilePipeline::Stop( void )
+{
+	pthread_mutex_lock( &mMutex );
+	mStop = true;
+	pthread_cond_broadcast( &mChanged );
+	pthread_mutex_unlock( &mMutex );
+}
+
+
+void
+ThreadFilePipeline::CheckError( void )
+{
+	// Volano se zamcenym mMutex
+	if ( mpError )
+	{
+		const char* pError = mpError;
+		pthread_mutex_unlock( &mMutex );
+		throw Exception( pError );
+	}
+}
+
+
+size_t
+ThreadFilePipeline::Read( const char*& rpData )
+{
+	pthread_mutex_lock( &mMutex );
+
+	while ( mTaken == mFilled && !mInputDone && !mpError )
+		pthread_cond_wait( &mChanged, &mMutex );
+	CheckError();
+
+	if ( mTaken == mFilled )
+	{
+		pthread_mutex_unlock( &mMutex );
+		return 0;
+	}
+
+	size_t index = mTaken % mDepth;
+	size_t size  = mInSizes[ index ];
+	rpData = mInBuffers[ index ];
+	mTaken++;
+
+	// Cteci vlakno muze pouzit buffer vraceny minule
+	pthread_cond_broadcast( &mChanged );
+	pthread_mutex_unlock( &mMutex );
+
+	return size;
+}
+
+
+void
+ThreadFilePipeline::Write( const char* pData, size_t size )
+{
+	while ( size != 0 )
+	{
+		size_t  index = mQueued % mDepth;
+		size_t& rUsed = mOutSizes[ index ];
+		size_t  n     = std::min( size, mBufferSize - rUsed );
+
+		// Buffer plni jen toto vlakno, zapisovaci vlakno ho dostane az
+		// po zvyseni mQueued.
+		memcpy( mOutBuffers[ index ] + rUsed, pData, n );
+		rUsed += n;
+		pData += n;
+		size  -= n;
+
+		if ( rUsed == mBufferSize )
+		{
+			pthread_mutex_lock( &mMutex );
+			mQueued++;
+			pthread_cond_broadcast( &mChanged );
+
+			// Dalsi buffer musi byt uz zapsany
+			while ( mQueued - mWritten >= mDepth && !mpError )
+				pthread_cond_wait( &mChanged, &mMutex );
+			CheckError();
+			pthread_mutex_unlock( &mMutex );
+		}
+	}
+}
+
+
+void
+ThreadFilePipeline::Finish( void )
+{
+	pthread_mutex_lock( &mMutex );
+	if ( mOutSizes[ mQueued % mDepth ] != 0 )
+		mQueued++;
+	mOutputDone = true;
+	pthread_cond_broadcast( &mChanged );
+
+	while ( mWritten != mQueued && !mpError )
+		pthread_cond_wait( &mChanged, &mMutex );
+	CheckError();
+	pthread_mutex_unlock( &mMutex );
+
+	if ( fflush( mpOutput ) != 0 )
+		throw Exception( "FilePipeline::Write(): Chyba pri zapisu souboru!" );
+}
+
+
+void*
+ThreadFilePipeline::ReaderMain( void* pArg )
+{
+	ThreadFilePipeline* p = static_cast< ThreadFilePipeline* >( pArg );
+
+	pthread_mutex_lock( &p->mMutex );
+	while ( !p->mStop )
+	{
+		// Buffer, ktery prave zpracovava Read(), je mTaken - 1
+		uint64_t busy = p->mTaken ? p->mTaken - 1 : 0;
+		if ( p->mFilled - busy >= p->mDepth )
+		{
+			pthread_cond_wait( &p->mChanged, &p->mMutex );
+			continue;
+		}
+
+		size_t index = p->mFilled % p->mDepth;
+		pthread_mutex_unlock( &p->mMutex );
+
+		size_t n     = fread( p->mInBuffers[ index ], 1, p->mBufferSize, p->mpInput );
+		bool   error = n == 0 && ferror( p->mpInput );
+
+		pthread_mutex_lock( &p->mMutex );
+		if ( error )
+			p->mpError = "FilePipeline::Read(): Chyba pri cteni souboru!";
+		if ( n == 0 )
+		{
+			p->mInputDone = true;
+			pthread_cond_broadcast( &p->mChanged );
+			break;
+		}
+
+		p->mInSizes[ index ] = n;
+		p->mFilled++;
+		pthread_cond_broadcast( &p->mChanged );
+	}
+	pthread_mutex_unlock( &p->mMutex );
+
+	return NULL;
+}
+
+
+void*
+ThreadFilePipeline::WriterMain( void* pArg )
+{
+	ThreadFilePipeline* p = static_cast< ThreadFilePipeline* >( pArg );
+
+	pthread_mutex_lock( &p->mMutex );
+	while ( true )
+	{
+		if ( p->mWritten == p->mQueued )
+		{
+			if ( p->mStop || p->mOutputDone )
+				break;
+			pthread_cond_wait( &p->mChanged, &p->mMutex );
+			continue;
+		}
+
+		size_t index = p->mWritten % p->mDepth;
+		size_t size  = p->mOutSizes[ index ];
+		pthread_mutex_unlock( &p->mMutex );
+
+		bool error = fwrite( p->mOutBuffers[ index ], 1, size, p->mpOutput ) != size;
+
+		pthread_mutex_lock( &p->mMutex );
+		if ( error )
+		{
+			p->mpError = "FilePipeline::Write(): Chyba pri zapisu souboru!";
+			pthread_cond_broadcast( &p->mChanged );
+			break;
+		}
+
+		p->mOutSizes[ index ] = 0;
+		p->mWritten++;
+		pthread_cond_broadcast( &p->mChanged );
+	}
+	pthread_mutex_unlock( &p->mMutex );
+
+	return NULL;
+}
+
+
+#ifdef __linux__
+
+/**
+ * \brief Asynchronni varianta nad io_uring.
+ *
+ * Nepouziva liburing, ale primo systemova volani a sdilene fronty.
+ * Vse bezi ve vlakne, ktere vola Read() a Write(); jadro mezitim cte
+ * dalsi buffery dopredu a zapisuje hotova data.
+ */
+class UringFilePipeline : public FilePipeline
+{
+public:
+	UringFilePipeline( int inputFd, int outputFd, size_t bufferSize, size_t depth );
+
+	virtual ~UringFilePipeline();
+
+	virtual size_t Read( const char*& rpData );
+
+	virtual void Write( const char* pData, size_t size );
+
+	virtual void Finish( void );
+
+	virtual FilePipelineMode GetMode( void ) const { return FILE_PIPELINE_URING; };
+
+private:
+	struct Buffer
+	{
+		char*        mpData;
+		size_t       mSize;     // Pozadovana velikost cteni / data k zapisu
+		size_t       mDone;     // Kolik uz bylo precteno / zapsano
+		uint64_t     mOffset;
+		bool         mBusy;     // Ceka se na jadro
+		struct iovec mIov;
+	};
+
+	enum
+	{
+		OP_READ  = 1,
+		OP_WRITE = 2
+	};
+
+	void Cleanup( void );
+	void SubmitRead( size_t index );
+	void SubmitWrite( size_t index );
+	void Submit( int opcode, int fd, Buffer& rBuffer, uint64_t userData );
+	void Reap( bool wait );
+
+	int                   mInputFd;
+	int                   mOutputFd;
+	size_t                mBufferSize;
+	size_t                mDepth;
+	uint64_t              mInputSize;
+	uint64_t              mReadOffset;
+	uint64_t              mWriteOffset;
+	std::vector< Buffer > mIn;
+	std::vector< Buffer > mOut;
+	uint64_t              mTaken;
+	uint64_t              mQueued;
+	const char*           mpError;
+
+	int                   mRingFd;
+	void*                 mpSqRing;
+	void*                 mpCqRing;
+	size_t                mSqRingSize;
+	size_t                mCqRingSize;
+	struct io_uring_sqe*  mpSqes;
+	size_t                mSqesSize;
+	unsigned*             mpSqHead;
+	unsigned*             mpSqTail;
+	unsigned*             mpSqMask;
+	unsigned*             mpSqArray;
+	unsigned*             mpCqHead;
+	unsigned*             mpCqTail;
+	unsigned*             mpCqMask;
+	struct io_uring_cqe*  mpCqes;
+	unsigned              mToSubmit;
+};
+
+
+UringFilePipeline::UringFilePipeline( int inputFd, int outputFd,
+                                      size_t bufferSize, size_t depth )
+	: mInputFd( inputFd ), mOutputFd( outputFd ), mBufferSize( bufferSize ),
+	  mDepth( depth ), mInputSize( 0 ), mReadOffset( 0 ), mWriteOffset( 0 ),
+	  mIn( depth ), mOut( depth ), mTaken( 0 ), mQueued( 0 ), mpError( NULL ),
+	  mRingFd( -1 ), mpSqRing( MAP_FAILED ), mpCqRing( MAP_FAILED ),
+	  mpSqes( static_cast< struct io_uring_sqe* >( MAP_FAILED ) ), mToSubmit( 0 )
+{
+	struct stat st;
+	if ( fstat( mInputFd, &st ) != 0 )
+		throw Exception( "FilePipeline: Nelze zjistit velikost souboru!" );
+	mInputSize = st.st_size;
+
+	off_t position = lseek( mInputFd, 0, SEEK_CUR );
+	mReadOffset    = position > 0 ? position : 0;
+	position       = lseek( mOutputFd, 0, SEEK_CUR );
+	mWriteOffset   = position > 0 ? position : 0;
+
+	struct io_uring_params params;
+	memset( &params, 0, sizeof( params ) );
+
+	mRingFd = syscall( __NR_io_uring_setup, 2 * depth, &params );
+	if ( mRingFd < 0 )
+		throw NotImplementedException();
+
+	mSqRingSize = params.sq_off.array + params.sq_entries * sizeof( unsigned );
+	mCqRingSize = params.cq_off.cqes + params.cq_entries * sizeof( struct io_uring_cqe );
+	if ( params.features & IORING_FEAT_SINGLE_MMAP )
+		mSqRingSize = mCqRingSize = std::max( mSqRingSize, mCqRingSize );
+
+	mpSqRing = mmap( NULL, mSqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+	                 mRingFd, IORING_OFF_SQ_RING );
+	if ( params.features & IORING_FEAT_SINGLE_MMAP )
+		mpCqRing = mpSqRing;
+	else
+		mpCqRing = mmap( NULL, mCqRingSize, PROT_READ | PROT_WRITE,
+		                 MAP_SHARED | MAP_POPULATE, mRingFd, IORING_OFF_CQ_RING );
+
+	mSqesSize = params.sq_entries * sizeof( struct io_uring_sqe );
+	mpSqes    = static_cast< struct io_uring_sqe* >(
+		mmap( NULL, mSqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+		      mRingFd, IORING_OFF_SQES ) );
+
+	if ( mpSqRing == MAP_FAILED || mpCqRing == MAP_FAILED || mpSqes == MAP_FAILED )
+	{
+		Cleanup();
+		throw NotImplementedException();
+	}
+
+	char* pSq = static_cast< char* >( mpSqRing );
+	char* pCq = static_cast< char* >( mpCqRing );
+	mpSqHead  = reinterpret_cast< unsigned* >( pSq + params.sq_off.head );
+	mpSqTail  = reinterpret_cast< unsigned* >( pSq + params.sq_off.tail );
+	mpSqMask  = reinterpret_cast< unsigned* >( pSq + params.sq_off.ring_mask );
+	mpSqArray = reinterpret_cast< unsigned* >( pSq + params.sq_off.array );
+	mpCqHead  = reinterpret_cast< unsigned* >( pCq + params.cq_off.head );
+	mpCqTail  = reinterpret_cast< unsigned* >( pCq + params.cq_off.tail );
+	mpCqMask  = reinterpret_cast< unsigned* >( pCq + params.cq_off.ring_mask );
+	mpCqes    = reinterpret_cast< struct io_uring_cqe* >( pCq + params.cq_off.cqes );
+
+	size_t i;
+	for ( i = 0 ; i < mDepth ; i++ )
+	{
+		mIn[ i ].mpData  = new char[ mBufferSize ];
+		mIn[ i ].mBusy   = false;
+		mOut[ i ].mpData = new char[ mBufferSize ];
+		mOut[ i ].mSize  = 0;
+		mOut[ i ].mBusy  = false;
+	}
+
+	// Hned zadame cteni do vsech bufferu
+	for ( i = 0 ; i < mDepth ; i++ )
+		SubmitRead( i );
+}
+
+
+UringFilePipeline::~UringFilePipeline()
+{
+	Cleanup();
+}
+
+
+void
+UringFilePipeline::Cleanup( void )
+{
+	// Jadro nesmi zapisovat do uz uvolnenych bufferu
+	size_t i;
+	bool   busy = true;
+	while ( busy && mRingFd >= 0 && mpCqRing != MAP_FAILED && mpSqes != MAP_FAILED )
+	{
+		busy = false;
+		for ( i = 0 ; i < mIn.size() ; i++ )
+			busy = busy || mIn[ i ].mBusy || mOut[ i ].mBusy;
+		if ( busy )
+		{
+			try
+			{
+				Reap( true );
+			}
+			catch ( Exception& )
+			{
+				break;
+			}
+		}
+	}
+
+	for ( i = 0 ; i < mIn.size() ; i++ )
+	{
+		delete[] mIn[ i ].mpData;
+		delete[] mOut[ i ].mpData;
+		mIn[ i ].mpData  = NULL;
+		mOut[ i ].mpData = NULL;
+	}
+
+	if ( mpSqes != MAP_FAILED )
+		munmap( mpSqes, mSqesSize );
+	if ( mpCqRing != MAP_FAILED && mpCqRing != mpSqRing )
+		munmap( mpCqRing, mCqRingSize );
+	if ( mpSqRing != MAP_FAILED )
+		munmap( mpSqRing, mSqRingSize );
+	if ( mRingFd >= 0 )
+		close( mRingFd );
+
+	mpSqes   = static_cast< struct io_uring_sqe* >( MAP_FAILED );
+	mpCqRing = mpSqRing = MAP_FAILED;
+	mRingFd  = -1;
+}
+
+
+void
+UringFilePipeline::SubmitRead( size_t index )
+{
+	Buffer& rBuffer = mIn[ index ];
+
+	rBuffer.mOffset = mReadOffset;
+	rBuffer.mDone   = 0;
+	rBuffer.mSize   = 0;
+	if ( mReadOffset < mInputSize )
+		rBuffer.mSize = std::min< uint64_t >( mBufferSize, mInputSize - mReadOffset );
+	mReadOffset += rBuffer.mSize;
+
+	// Za koncem souboru neni co cist, buffer zustane prazdny
+	if ( rBuffer.mSize == 0 )
+		return;
+
+	Submit( IORING_OP_READV, mInputFd, rBuffer, ( static_cast< uint64_t >( OP_READ ) << 32 ) | index );
+}
+
+
+void
+UringFilePipeline::SubmitWrite( size_t index )
+{
+	Buffer& rBuffer = mOut[ index ];
+
+	rBuffer.mOffset = mWriteOffset;
+	rBuffer.mDone   = 0;
+	mWriteOffset   += rBuffer.mSize;
+
+	Submit( IORING_OP_WRITEV, mOutputFd, rBuffer, ( static_cast< uint64_t >( OP_WRITE ) << 32 ) | index );
+}
+
+
+void
+UringFilePipeline::Submit( int opcode, int fd, Buffer& rBuffer, uint64_t userData )
+{
+	unsigned tail  = *mpSqTail;
+	unsigned index = tail & *mpSqMask;
+
+	struct io_uring_sqe* pSqe = &mpSqes[ index ];
+	memset( pSqe, 0, sizeof( *pSqe ) );
+
+	rBuffer.mIov.iov_base = rBuffer.mpData + rBuffer.mDone;
+	rBuffer.mIov.iov_len  = rBuffer.mSize - rBuffer.mDone;
+	rBuffer.mBusy         = true;
+
+	pSqe->opcode    = opcode;
+	pSqe->fd        = fd;
+	pSqe->addr      = reinterpret_cast< uint64_t >( &rBuffer.mIov );
+	pSqe->len       = 1;
+	pSqe->off       = rBuffer.mOffset + rBuffer.mDone;
+	pSqe->user_data = userData;
+
+	mpSqArray[ index ] = index;
+	__atomic_store_n( mpSqTail, tail + 1, __ATOMIC_RELEASE );
+	mToSubmit++;
+
+	// Zadame hned, at jadro zacne pracovat co nejdrive
+	while ( mToSubmit != 0 )
+	{
+		int n = syscall( __NR_io_uring_enter, mRingFd, mToSubmit, 0, 0, NULL, 0 );
+		if ( n < 0 )
+		{
+			if ( errno == EINTR || errno == EAGAIN || errno == EBUSY )
+			{
+				Reap( false );
+				continue;
+			}
+			throw Exception( "FilePipeline: Chyba io_uring_enter()!" );
+		}
+		mToSubmit -= n;
+	}
+}
+
+
+void
+UringFilePipeline::Reap( bool wait )
+{
+	unsigned head = *mpCqHead;
+
+	if ( wait && head == __atomic_load_n( mpCqTail, __ATOMIC_ACQUIRE ) )
+	{
+		int n = syscall( __NR_io_uring_enter, mRingFd, 0, 1, IORING_ENTER_GETEVENTS, NULL, 0 );
+		if ( n < 0 && errno != EINTR )
+			throw Exception( "FilePipeline: Chyba io_uring_enter()!" );
+	}
+
+	while ( head != __atomic_load_n( mpCqTail, __ATOMIC_ACQUIRE ) )
+	{
+		struct io_uring_cqe* pCqe = &mpCqes[ head & *mpCqMask ];
+		uint64_t userData = pCqe->user_data;
+		int      res      = pCqe->res;
+
+		head++;
+		__atomic_store_n( mpCqHead, head, __ATOMIC_RELEASE );
+
+		Buffer& rBuffer = ( userData >> 32 ) == OP_READ
+			? mIn[ userData & 0xFFFFFFFF ] : mOut[ userData & 0xFFFFFFFF ];
+		rBuffer.mBusy = false;
+
+		if ( res < 0 )
+		{
+			mpError = ( userData >> 32 ) == OP_READ
+				? "FilePipeline::Read(): Chyba pri cteni souboru!"
+				: "FilePipeline::Write(): Chyba pri zapisu souboru!";
+			continue;
+		}
+
+		// Soubor se mezitim zkratil
+		if ( res == 0 && ( userData >> 32 ) == OP_READ )
+		{
+			rBuffer.mSize = rBuffer.mDone;
+			continue;
+		}
+
+		if ( res == 0 )
+		{
+			mpError = "FilePipeline::Write(): Chyba pri zapisu souboru!";
+			continue;
+		}
+
+		// Neuplne cteni nebo zapis dokoncime dalsim pozadavkem
+		rBuffer.mDone += res;
+		if ( rBuffer.mDone < rBuffer.mSize )
+			Submit( ( userData >> 32 ) == OP_READ ? IORING_OP_READV : IORING_OP_WRITEV,
+			        ( userData >> 32 ) == OP_READ ? mInputFd : mOutputFd,
+			        rBuffer, userData );
+		else if ( ( userData >> 32 ) == OP_WRITE )
+			rBuffer.mSize = 0;
+	}
+
+	if ( mpError )
+		throw Exception( mpError );
+}
+
+
+size_t
+UringFilePipeline::Read( const char*& rpData )
+{
+	// Minule vraceny buffer uz neni potreba - cteme do nej dal
+	if ( mTaken != 0 )
+		SubmitRead( ( mTaken - 1 ) % mDepth );
+
+	Buffer& rBuffer = mIn[ mTaken % mDepth ];
+	while ( rBuffer.mBusy )
+		Reap( true );
+
+	if ( rBuffer.mSize == 0 )
+		return 0;
+
+	rpData = rBuffer.mpData;
+	mTaken++;
+
+	return rBuffer.mSize;
+}
+
+
+void
+UringFilePipeline::Write( const char* pData, size_t size )
+{
+	while ( size != 0 )
+	{
+		Buffer& rBuffer = mOut[ mQueued % mDepth ];
+
+		// Buffer se jeste zapisuje z minuleho kola
+		while ( rBuffer.mBusy )
+			Reap( true );
+
+		size_t n = std::min( size, mBufferSize - rBuffer.mSize );
+		memcpy( rBuffer.mpData + rBuffer.mSize, pData, n );
+		rBuffer.mSize += n;
+		pData += n;
+		size  -= n;
+
+		if ( rBuffer.mSize == mBufferSize )
+		{
+			SubmitWrite( mQueued % mDepth );
+			mQueued++;
+		}
+	}
+}
+
+
+void
+UringFilePipeline::Finish( void )
+{
+	Buffer& rLast = mOut[ mQueued % mDepth ];
+	if ( !rLast.mBusy && rLast.mSize != 0 )
+	{
+		SubmitWrite( mQueued % mDepth );
+		mQueued++;
+	}
+
+	size_t i;
+	for ( i = 0 ; i < mDepth ; i++ )
+		while ( mOut[ i ].mBusy )
+			Reap( true );
+}
+
+#endif // __linux__
+
+
+FilePipeline*
+FilePipeline::Create( FILE* fpInput, FILE* fpOutput, FilePipelineMode mode,
+                      size_t bufferSize, size_t depth )
+{
+	if ( depth < 2 )
+		depth = 2;
+
+#ifdef __linux__
+	if ( mode == FILE_PIPELINE_URING || mode == FILE_PIPELINE_AUTO )
+	{
+		// io_uring pouzijeme jen pro bezne soubory (ne roury)
+		struct stat in, out;
+		if ( fstat( fileno( fpInput ), &in ) == 0 && S_ISREG( in.st_mode ) &&
+		     fstat( fileno( fpOutput ), &out ) == 0 && S_ISREG( out.st_mode ) )
+		{
+			try
+			{
+				fflush( fpOutput );
+				return new UringFilePipeline( fileno( fpInput ), fileno( fpOutput ),
+				                              bufferSize, depth );
+			}
+			catch ( NotImplementedException& )
+			{
+				// Jadro io_uring nepodporuje nebo ho zakazuje
+			}
+		}
+		mode = FILE_PIPELINE_THREADS;
+	}
+#else
+	if ( mode != FILE_PIPELINE_SYNC )
+		mode = FILE_PIPELINE_THREADS;
+#endif // __linux__
+
+	if ( mode == FILE_PIPELINE_THREADS )
+		return new ThreadFilePipeline( fpInput, fpOutput, bufferSize, depth );
+
+	return new SyncFilePipeline( fpInput, fpOutput, bufferSize );
+}
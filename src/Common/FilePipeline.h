@@ -0,0 +1,89 @@
+/*
+ * Common/FilePipeline.h - Prekryvani cteni, zapisu a zpracovani souboru.
+ *
+ * Copyright (c) 2006 Jiri Zajpt, <jzajpt@blueberry.cz>
+ */
+
+#ifndef _COMMON_FILEPIPELINE__H
+#define _COMMON_FILEPIPELINE__H
+
+
+#include <cstdio>
+#include "Types.h"
+
+
+/**
+ * \brief Zpusob provadeni vstupu a vystupu.
+ */
+enum FilePipelineMode
+{
+	FILE_PIPELINE_SYNC,     // Synchronni fread/fwrite
+	FILE_PIPELINE_THREADS,  // Cteci a zapisovaci vlakno
+	FILE_PIPELINE_URING,    // io_uring (jen Linux, jen bezne soubory)
+	FILE_PIPELINE_AUTO      // io_uring pokud to jde, jinak vlakna
+};
+
+
+/**
+ * \brief Cteni vstupniho a zapis vystupniho souboru po velkych blocich.
+ *
+ * V asynchronnich rezimech je neustale rozpracovano nekolik cteni
+ * dopredu a zapisy probihaji na pozadi, takze disk pracuje soucasne
+ * s procesorem. Data se ctou i zapisuji v poradi.
+ *
+ * Pouziti:
+ *
+ *   while ( ( n = pPipeline->Read( pData ) ) != 0 )
+ *       ... zpracovani, vystup pres pPipeline->Write() ...
+ *   pPipeline->Finish();
+ *
+ * \author Jiri Zajpt
+ */
+class FilePipeline
+{
+public:
+	/**
+	 * \brief Vytvori pipeline pro dane soubory.
+	 *
+	 * Neni-li pozadovany rezim k dispozici (napr. jadro bez io_uring
+	 * nebo vstup je roura), pouzije se nejblizsi dostupny.
+	 *
+	 * \param fpInput    Vstupni soubor otevreny pro cteni.
+	 * \param fpOutput   Vystupni soubor otevreny pro zapis.
+	 * \param mode       Pozadovany rezim.
+	 * \param bufferSize Velikost jednoho bufferu.
+	 * \param depth      Pocet bufferu pro cteni i pro zapis.
+	 */
+	static FilePipeline* Create( FILE* fpInput, FILE* fpOutput,
+	                             FilePipelineMode mode = FILE_PIPELINE_AUTO,
+	                             size_t bufferSize = 1024 * 1024, size_t depth = 4 );
+
+	virtual ~FilePipeline() {};
+
+	/**
+	 * \brief Vrati dalsi precteny kus vstupu.
+	 *
+	 * Data jsou platna do dalsiho volani Read().
+	 *
+	 * \return Pocet bytu, 0 na konci souboru.
+	 */
+	virtual size_t Read( const char*& rpData ) = 0;
+
+	/**
+	 * \brief Zapise data na konec vystupu.
+	 */
+	virtual void Write( const char* pData, size_t size ) = 0;
+
+	/**
+	 * \brief Pocka na dokonceni vsech zapisu.
+	 */
+	virtual void Finish( void ) = 0;
+
+	/**
+	 * \brief Vraci skutecne pouzity rezim.
+	 */
+	virtual FilePipelineMode GetMode( void ) const = 0;
+};
+
+
+#endif // _COMMON_FILEPIPELINE__H
@@ -0,0 +1,155 @@
+/*
+ * Common/Stats.cc - Pocitadla volani a alokaci v aritmetice BigNum.
+ *
+ * Copyright (c) 2006 Jiri Zajpt, <jzajpt@blueberry.cz>
+ */
+
+#include <iostream>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <pthread.h>
+#include "Stats.h"
+
+
+/**
+ * \brief Nazvy operaci pro vypis (ve stejnem poradi jako StatsOperation).
+ */
+static const char* const cStatsNames[ STATS_OPERATION_COUNT ] =
+{
+	"add", "sub", "mul", "divide", "shift", "gcd", "modinv", "modexp",
+	"montgomery", "rabin-miller", "allocate", "reallocate"
+};
+
+
+// Seznam pocitadel vsech vlaken. Pocitadla ukoncenych vlaken zustavaji,
+// aby se jejich prace zapocitala do vypisu.
+static StatsCounters*  gpStatsHead = NULL;
+static pthread_mutex_t gStatsMutex = PTHREAD_MUTEX_INITIALIZER;
+
+#ifdef PMZ_STATS
+static __thread StatsCounters* tpStatsCounters = NULL;
+#endif // PMZ_STATS
+
+
+bool
+StatsEnabled( void )
+{
+#ifdef PMZ_STATS
+	return true;
+#else
+	return false;
+#endif // PMZ_STATS
+}
+
+
+#ifdef PMZ_STATS
+
+StatsCounters&
+StatsGetCounters( void )
+{
+	if ( tpStatsCounters )
+		return *tpStatsCounters;
+
+	StatsCounters* pCounters = new StatsCounters;
+	memset( pCounters, 0, sizeof( StatsCounters ) );
+
+	pthread_mutex_lock( &gStatsMutex );
+	pCounters->mpNext = gpStatsHead;
+	gpStatsHead       = pCounters;
+	pthread_mutex_unlock( &gStatsMutex );
+
+	tpStatsCounters = pCounters;
+
+	return *pCounters;
+}
+
+
+uint64_t
+StatsGetTime( void )
+{
+	struct timespec ts;
+	clock_gettime( CLOCK_MONOTONIC, &ts );
+
+	return static_cast< uint64_t >( ts.tv_sec ) * 1000000000ULL + ts.tv_nsec;
+}
+
+#endif // PMZ_STATS
+
+
+void
+StatsDump( std::ostream& rOutput )
+{
+	if ( !StatsEnabled() )
+	{
+		rOutput << "Pocitadla nejsou zakompilovana (prelozte pomoci make STATS=1)." << std::endl;
+		return;
+	}
+
+	StatsCounters  total;
+	StatsCounters* pCounters;
+	size_t         threads = 0;
+	size_t         i;
+
+	memset( &total, 0, sizeof( total ) );
+
+	pthread_mutex_lock( &gStatsMutex );
+
+	for ( pCounters = gpStatsHead ; pCounters ; pCounters = pCounters->mpNext )
+	{
+		for ( i = 0 ; i < STATS_OPERATION_COUNT ; i++ )
+		{
+			total.mCalls[ i ]       += pCounters->mCalls[ i ];
+			total.mLimbs[ i ]       += pCounters->mLimbs[ i ];
+			total.mNanoseconds[ i ] += pCounters->mNanoseconds[ i ];
+		}
+
+		total.mAllocatedBytes += pCounters->mAllocatedBytes;
+		total.mCopiedBytes    += pCounters->mCopiedBytes;
+		threads++;
+	}
+
+	pthread_mutex_unlock( &gStatsMutex );
+
+	char line[ 128 ];
+
+	snprintf( line, sizeof( line ), "%-14s %14s %16s %12s %12s",
+	          "operace", "volani", "cislice", "cas ms", "ns/volani" );
+	rOutput << line << std::endl;
+
+	for ( i = 0 ; i < STATS_OPERATION_COUNT ; i++ )
+	{
+		if ( total.mCalls[ i ] == 0 )
+			continue;
+
+		snprintf( line, sizeof( line ), "%-14s %14llu %16llu %12.3f %12.1f", cStatsNames[ i ],
+		          static_cast< unsigned long long >( total.mCalls[ i ] ),
+		          static_cast< unsigned long long >( total.mLimbs[ i ] ),
+		          total.mNanoseconds[ i ] / 1e6,
+		          static_cast< double >( total.mNanoseconds[ i ] ) / total.mCalls[ i ] );
+		rOutput << line << std::endl;
+	}
+
+	rOutput << "Alokovano bytu: " << total.mAllocatedBytes
+	        << ", zkopirovano bytu: " << total.mCopiedBytes
+	        << ", vlaken: " << threads << std::endl;
+}
+
+
+void
+StatsReset( void )
+{
+	StatsCounters* pCounters;
+
+	pthread_mutex_lock( &gStatsMutex );
+
+	for ( pCounters = gpStatsHead ; pCounters ; pCounters = pCounters->mpNext )
+	{
+		StatsCounters* pNext = pCounters->mpNext;
+
+		memset( pCounters, 0, sizeof( StatsCounters ) );
+		pCounters->mpNext = pNext;
+	}
+
+	pthread_mutex_unlock( &gStatsMutex );
+}
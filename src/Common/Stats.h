@@ -0,0 +1,139 @@
+/*
+ * Common/Stats.h - Pocitadla volani a alokaci v aritmetice BigNum.
+ *
+ * Copyright (c) 2006 Jiri Zajpt, <jzajpt@blueberry.cz>
+ */
+
+#ifndef _COMMON_STATS__H
+#define _COMMON_STATS__H
+
+
+#include <iostream>
+#include "Types.h"
+
+
+/**
+ * \brief Sledovane operace.
+ */
+enum StatsOperation
+{
+	STATS_ADD,          // operator +
+	STATS_SUB,          // operator -
+	STATS_MUL,          // operator *
+	STATS_DIVIDE,       // Divide(), ShortDivide()
+	STATS_SHIFT,        // operator << a >>
+	STATS_GCD,          // Gcd()
+	STATS_MODINV,       // ModularInverse()
+	STATS_MODEXP,       // ModularExponentiation(), MontgomeryExponentiation()
+	STATS_MONTGOMERY,   // Jedno Montgomeryho nasobeni
+	STATS_RABIN_MILLER, // Jedno kolo Rabin-Millerova testu
+	STATS_ALLOCATE,     // NumberBuffer::Allocate()
+	STATS_REALLOCATE,   // NumberBuffer::Reallocate()
+	STATS_OPERATION_COUNT
+};
+
+
+/**
+ * \brief Pocitadla jednoho vlakna.
+ *
+ * Kazde vlakno zapisuje jen do svych pocitadel, takze se nic nezamyka.
+ * Cas operace je vcetne vnorenych operaci (nasobeni obsahuje i scitani).
+ */
+struct StatsCounters
+{
+	uint64_t       mCalls[ STATS_OPERATION_COUNT ];       // Pocet volani
+	uint64_t       mLimbs[ STATS_OPERATION_COUNT ];       // Zpracovane 32bitove cislice
+	uint64_t       mNanoseconds[ STATS_OPERATION_COUNT ]; // Straveny cas
+	uint64_t       mAllocatedBytes;                       // Alokovane byty
+	uint64_t       mCopiedBytes;                          // Kopirovane byty
+	StatsCounters* mpNext;                                // Dalsi vlakno v seznamu
+};
+
+
+/**
+ * \brief Testuje, zda-li jsou pocitadla zakompilovana (make STATS=1).
+ */
+bool StatsEnabled( void );
+
+/**
+ * \brief Vypise soucet pocitadel vsech vlaken.
+ */
+void StatsDump( std::ostream& rOutput );
+
+/**
+ * \brief Vynuluje pocitadla vsech vlaken.
+ */
+void StatsReset( void );
+
+
+#ifdef PMZ_STATS
+
+/**
+ * \brief Vraci pocitadla volajiciho vlakna (pri prvnim volani je vytvori).
+ */
+StatsCounters& StatsGetCounters( void );
+
+/**
+ * \brief Vraci monotonni cas v nanosekundach.
+ */
+uint64_t StatsGetTime( void );
+
+
+/**
+ * \brief Zapocita jedno volani operace vcetne doby jeho trvani.
+ *
+ * \author Jiri Zajpt
+ */
+class StatsTimer
+{
+public:
+	StatsTimer( StatsOperation operation, size_t limbs )
+		: mrCounters( StatsGetCounters() ), mOperation( operation ), mStart( StatsGetTime() )
+	{
+		mrCounters.mCalls[ operation ]++;
+		mrCounters.mLimbs[ operation ] += limbs;
+	};
+
+	~StatsTimer()
+	{
+		mrCounters.mNanoseconds[ mOperation ] += StatsGetTime() - mStart;
+	};
+
+private:
+	StatsCounters& mrCounters;
+	StatsOperation mOperation;
+	uint64_t       mStart;
+};
+
+
+#define STATS_JOIN2( a, b ) a##b
+#define STATS_JOIN( a, b ) STATS_JOIN2( a, b )
+
+// Zapocita volani a meri cas do konce bloku
+#define STATS_CALL( operation, limbs ) \
+	StatsTimer STATS_JOIN( statsTimer, __LINE__ )( operation, limbs )
+
+// Zapocita alokaci bufferu pro limbs cislic
+#define STATS_ALLOC( operation, limbs ) \
+	do { \
+		StatsCounters& rStats = StatsGetCounters(); \
+		rStats.mCalls[ operation ]++; \
+		rStats.mLimbs[ operation ] += ( limbs ); \
+		rStats.mAllocatedBytes += ( limbs ) * sizeof( uint32_t ); \
+	} while ( 0 )
+
+// Zapocita kopirovani bytes bytu
+#define STATS_COPY( bytes ) \
+	( StatsGetCounters().mCopiedBytes += ( bytes ) )
+
+#else
+
+// Bez STATS=1 se argumenty ani nevyhodnocuji
+#define STATS_CALL( operation, limbs )  ( ( void ) 0 )
+#define STATS_ALLOC( operation, limbs ) ( ( void ) 0 )
+#define STATS_COPY( bytes )             ( ( void ) 0 )
+
+#endif // PMZ_STATS
+
+
+#endif // _COMMON_STATS__H
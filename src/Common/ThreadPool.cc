@@ -0,0 +1,118 @@
+/*
+ * Common/ThreadPool.cc - Jednoducha skupina pracovnich vlaken.
+ *
+ * Copyright (c) 2006 Jiri Zajpt, <jzajpt@blueberry.cz>
+ */
+
+#include <iostream>
+#include <unistd.h>
+#include "Exceptions.h"
+#include "ThreadPool.h"
+
+
+ThreadPool::ThreadPool( size_t threads )
+	: mActive( 0 ), mStop( false )
+{
+	pthread_mutex_init( &mMutex, NULL );
+	pthread_cond_init( &mWork, NULL );
+	pthread_cond_init( &mIdle, NULL );
+
+	if ( threads == 0 )
+		threads = GetCpuCount();
+
+	size_t i;
+	for ( i = 0 ; i < threads ; i++ )
+	{
+		pthread_t thread;
+		if ( pthread_create( &thread, NULL, ThreadMain, this ) != 0 )
+			throw Exception( "ThreadPool: Nepodarilo se vytvorit vlakno!" );
+		mThreads.push_back( thread );
+	}
+}
+
+
+ThreadPool::~ThreadPool()
+{
+	pthread_mutex_lock( &mMutex );
+	mStop = true;
+	pthread_cond_broadcast( &mWork );
+	pthread_mutex_unlock( &mMutex );
+
+	size_t i;
+	for ( i = 0 ; i < mThreads.size() ; i++ )
+		pthread_join( mThreads[ i ], NULL );
+
+	pthread_cond_destroy( &mIdle );
+	pthread_cond_destroy( &mWork );
+	pthread_mutex_destroy( &mMutex );
+}
+
+
+void
+ThreadPool::Submit( ThreadTask* pTask )
+{
+	pthread_mutex_lock( &mMutex );
+	mQueue.push_back( pTask );
+	pthread_cond_signal( &mWork );
+	pthread_mutex_unlock( &mMutex );
+}
+
+
+void
+ThreadPool::Wait( void )
+{
+	pthread_mutex_lock( &mMutex );
+	while ( !mQueue.empty() || mActive != 0 )
+		pthread_cond_wait( &mIdle, &mMutex );
+	pthread_mutex_unlock( &mMutex );
+}
+
+
+size_t
+ThreadPool::GetCpuCount( void )
+{
+	long count = sysconf( _SC_NPROCESSORS_ONLN );
+
+	return count > 0 ? count : 1;
+}
+
+
+void*
+ThreadPool::ThreadMain( void* pArg )
+{
+	ThreadPool* pPool = static_cast< ThreadPool* >( pArg );
+
+	pthread_mutex_lock( &pPool->mMutex );
+	while ( true )
+	{
+		while ( pPool->mQueue.empty() && !pPool->mStop )
+			pthread_cond_wait( &pPool->mWork, &pPool->mMutex );
+
+		// Pri ukoncovani nejdrive dokoncime vsechny zarazene ukoly.
+		if ( pPool->mQueue.empty() )
+			break;
+
+		ThreadTask* pTask = pPool->mQueue.front();
+		pPool->mQueue.pop_front();
+		pPool->mActive++;
+		pthread_mutex_unlock( &pPool->mMutex );
+
+		try
+		{
+			pTask->Run();
+		}
+		catch ( Exception& e )
+		{
+			std::cerr << "ThreadPool: Vyjimka v ukolu: " << e.mMessage << std::endl;
+		}
+		delete pTask;
+
+		pthread_mutex_lock( &pPool->mMutex );
+		pPool->mActive--;
+		if ( pPool->mQueue.empty() && pPool->mActive == 0 )
+			pthread_cond_broadcast( &pPool->mIdle );
+	}
+	pthread_mutex_unlock( &pPool->mMutex );
+
+	return NULL;
+}
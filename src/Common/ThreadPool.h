@@ -0,0 +1,90 @@
+/*
+ * Common/ThreadPool.h - Jednoducha skupina pracovnich vlaken.
+ *
+ * Copyright (c) 2006 Jiri Zajpt, <jzajpt@blueberry.cz>
+ */
+
+#ifndef _COMMON_THREADPOOL__H
+#define _COMMON_THREADPOOL__H
+
+
+#include <deque>
+#include <vector>
+#include <pthread.h>
+
+
+/**
+ * \brief Ukol pro vykonani ve skupine vlaken.
+ */
+class ThreadTask
+{
+public:
+	virtual ~ThreadTask() {};
+
+	/**
+	 * \brief Vykona ukol. Vola se z pracovniho vlakna.
+	 */
+	virtual void Run( void ) = 0;
+};
+
+
+/**
+ * \brief Skupina pracovnich vlaken se spolecnou frontou ukolu.
+ *
+ * \author Jiri Zajpt
+ */
+class ThreadPool
+{
+public:
+	/**
+	 * \brief Konstruktor. Spusti pracovni vlakna.
+	 *
+	 * \param threads Pocet vlaken. Nula znamena pocet procesoru.
+	 */
+	ThreadPool( size_t threads = 0 );
+
+	/**
+	 * \brief Destruktor. Pocka na dokonceni vsech ukolu a ukonci vlakna.
+	 */
+	~ThreadPool();
+
+	/**
+	 * \brief Zaradi ukol do fronty.
+	 *
+	 * Skupina vlaken prebira vlastnictvi ukolu a po jeho vykonani jej
+	 * uvolni pomoci delete.
+	 */
+	void Submit( ThreadTask* pTask );
+
+	/**
+	 * \brief Pocka, dokud nejsou vsechny zarazene ukoly dokonceny.
+	 */
+	void Wait( void );
+
+	/**
+	 * \brief Vraci pocet pracovnich vlaken.
+	 */
+	size_t GetThreadCount( void ) const { return mThreads.size(); };
+
+	/**
+	 * \brief Vraci pocet procesoru v systemu.
+	 */
+	static size_t GetCpuCount( void );
+
+private:
+	ThreadPool( const ThreadPool& );
+	ThreadPool& operator = ( const ThreadPool& );
+
+	static void* ThreadMain( void* pArg );
+
+	std::vector< pthread_t >  mThreads;
+	std::deque< ThreadTask* > mQueue;
+	size_t                    mActive;
+	bool                      mStop;
+	pthread_mutex_t           mMutex;
+	pthread_cond_t            mWork;
+	pthread_cond_t            mIdle;
+};
+
+
+#endif // _COMMON_THREADPOOL__H
@@ -15,6 +15,14 @@
 #include "BigNum/BigNum.h"
 #include "Rsa/RsaKey.h"
 #include "Rsa/Rsa.h"
+#include "Rsa/RsaBatch.h"
+#include "Common/Stats.h"
+#ifndef WIN32
+#include <csignal>
+#include <unistd.h>
+#include "Rsa/RsaKeyStore.h"
+#include "Server/RsaServer.h"
+#endif // WIN32
 
 
 using namespace std;
@@ -23,6 +31,134 @@ using namespace std;
 const int port = 8666;
 
 
+#ifndef WIN32
+static RsaServer* gpServer = NULL;
+
+
+static void
+StopServer( int )
+{
+	if ( gpServer )
+		gpServer->Stop();
+}
+#endif // WIN32
+
+
+/**
+ * \brief Vypise prubeh sifrovani (nejvyse nekolikrat za sekundu).
+ */
+static void
+PrintProgress( uint64_t done, uint64_t total, void* )
+{
+	if ( total == 0 )
+		cout << "Zpracovano: " << ( done / 1024 ) << " kB \r";
+	else
+		cout << "Prubeh: " << ( done * 100 / total ) << "% \r";
+
+	flush( cout );
+}
+
+
+/**
+ * \brief Zapne vypis prubehu, pokud je vystup terminal.
+ */
+static void
+EnableProgress( Rsa& rRsa )
+{
+#ifndef WIN32
+	if ( !isatty( STDOUT_FILENO ) )
+		return;
+#endif // WIN32
+
+	rRsa.SetProgressCallback( PrintProgress, NULL, 250 );
+}
+
+
+/**
+ * \brief Zpracuje volby sifrovani (obalka, bloky, text) od argumentu first.
+ *
+ * \return false pro neznamou volbu.
+ */
+static bool
+ParseEncryptOptions( int argc, char** argv, int first, RsaFileFormat& rFormat, bool& rArmor )
+{
+	rFormat = RSA_FILE_FORMAT_ENVELOPE;
+	rArmor  = false;
+
+	for ( int i = first ; i < argc ; i++ )
+	{
+		if ( strcmp( argv[ i ], "bloky" ) == 0 )
+			rFormat = RSA_FILE_FORMAT_BLOCKS;
+		else if ( strcmp( argv[ i ], "obalka" ) == 0 )
+			rFormat = RSA_FILE_FORMAT_ENVELOPE;
+		else if ( strcmp( argv[ i ], "text" ) == 0 )
+			rArmor = true;
+		else
+			return false;
+	}
+
+	return true;
+}
+
+
+/**
+ * \brief Vypise vysledek zpracovani jednoho souboru davky.
+ */
+static void
+PrintBatchItem( const RsaBatchItem& rItem, void* )
+{
+	if ( rItem.mFailed )
+		cerr << "CHYBA " << rItem.mInput << ": " << rItem.mError << endl;
+	else
+		cout << "OK    " << rItem.mInput << " -> " << rItem.mOutput << endl;
+}
+
+
+/**
+ * \brief Zpracuje davku souboru jednim klicem.
+ *
+ * \return Navratovy kod programu.
+ */
+static int
+RunBatch( const char* pKeyFile, const char* pPath, const char* pOutputDir,
+          bool encrypt, RsaFileFormat format, bool armor )
+{
+	RsaKey key;
+
+	// Klic se nacita (a predpocitava) jen jednou pro celou davku
+	if ( !key.LoadKeyFromFile( pKeyFile ) )
+	{
+		cerr << "Nepodarilo se nacist klic ze souboru: " << pKeyFile << "!" << endl;
+		return 1;
+	}
+
+	Rsa      rsa( key );
+	RsaBatch batch( rsa, pOutputDir );
+
+	try
+	{
+		batch.AddPath( pPath );
+	}
+	catch ( UnableToOpenFileException& e )
+	{
+		cerr << e.mMessage << ": " << e.mFileName << "!" << endl;
+		return 1;
+	}
+
+	cout << ( encrypt ? "Sifruji " : "Desifruji " ) << batch.GetItems().size()
+	     << " souboru klicem " << pKeyFile << endl;
+
+	batch.SetCallback( PrintBatchItem );
+
+	size_t failed = encrypt ? batch.Encrypt( format, armor ) : batch.Decrypt();
+
+	cout << "Zpracovano souboru: " << batch.GetItems().size() - failed
+	     << ", chyb: " << failed << endl;
+
+	return failed ? 1 : 0;
+}
+
+
 void
 PrintHelp( char* pProgramName )
 {
@@ -34,12 +170,21 @@ PrintHelp( char* pProgramName )
 	cout << "\t\t" << "Vygeneruje RSA klic o dane bitove delce a ulozi jej do souboru." << endl << endl;
 	cout << "\t" << pProgramName << " publickey <privatni-klic> <verejny-klic>" << endl;
 	cout << "\t\t" << "Nacte RSA klic ze souboru privatni klic a vezme z nej " << endl << "\t\tverejne parametry a ulozi je do verejneho klice." << endl << endl;
+	cout << "\t" << pProgramName << " binkey <klic> <binarni-klic>" << endl;
+	cout << "\t\t" << "Prevede klic do binarniho formatu, ktery se nacita bez parsovani" << endl << "\t\ta obsahuje predpocitane konstanty." << endl << endl;
 	cout << "\t" << pProgramName << " checkkey <soubor-s-klicem>" << endl;
 	cout << "\t\t" << "Zkontroluje platnost RSA klice." << endl << endl;
-	cout << "\t" << pProgramName << " encrypt <soubor-s-klicem> <vstup> <vystup>" << endl;
-	cout << "\t\t" << "Zasifruje soubor." << endl << endl;
+	cout << "\t" << pProgramName << " encrypt <soubor-s-klicem> <vstup> <vystup> [obalka|bloky] [text]" << endl;
+	cout << "\t\t" << "Zasifruje soubor. Implicitne se data sifruji ChaCha20 a RSA jen jeji klic" << endl << "\t\t(obalka), volba bloky sifruje RSA cely soubor po blocich. Volba text" << endl << "\t\tzapise vystup v Base64 po radcich." << endl << endl;
 	cout << "\t" << pProgramName << " decrypt <soubor-s-klicem> <vstup> <vystup>" << endl;
-	cout << "\t\t" << "Desifruje soubor." << endl;
+	cout << "\t\t" << "Desifruje soubor." << endl << endl;
+	cout << "\t" << pProgramName << " encrypt-batch <soubor-s-klicem> <seznam|adresar> <vystupni-adresar> [obalka|bloky] [text]" << endl;
+	cout << "\t\t" << "Zasifruje vsechny soubory z adresare nebo ze seznamu (radek: vstup[<TAB>vystup])." << endl << "\t\tVystupy dostanou priponu " << cRsaBatchSuffix << ", chyba u souboru davku neprerusi." << endl << endl;
+	cout << "\t" << pProgramName << " decrypt-batch <soubor-s-klicem> <seznam|adresar> <vystupni-adresar>" << endl;
+	cout << "\t\t" << "Desifruje vsechny soubory z adresare nebo ze seznamu." << endl << endl;
+	cout << "\t" << pProgramName << " serve <adresar-s-klici> [port|unix-socket]" << endl;
+	cout << "\t\t" << "Spusti sluzbu pro sifrovani a desifrovani (implicitne na portu " << port << ")." << endl << "\t\tKlice se nacitaji z adresare, id klice je nazev souboru bez pripony." << endl;
+	cout << endl << "Volba --stats (na libovolnem miste) vypise po dokonceni prikazu pocitadla" << endl << "operaci BigNum na chybovy vystup. Pocitadla je nutne zakompilovat: make STATS=1." << endl;
 }
 
 
@@ -53,8 +198,13 @@ term_func()
 }
 
 
+/**
+ * \brief Provede prikaz zadany na prikazove radce.
+ *
+ * \return Navratovy kod programu.
+ */
 int
-main( int argc, char** argv )
+RunCommand( int argc, char** argv )
 {
 	if ( argc < 2 )
 	{
@@ -134,6 +284,36 @@ main( int argc, char** argv )
 		
 		return 0;
 	}
+	else if ( strncmp( pAction, "binkey", 6 ) == 0 )
+	{
+		if ( argc != 4 )
+		{
+			PrintHelp( argv[ 0 ] );
+			return 1;
+		}
+
+		char*  pKeyFile       = argv[ 2 ];
+		char*  pBinaryKeyFile = argv[ 3 ];
+		RsaKey key;
+
+		// Pokusime se nacist klic ze souboru
+		if ( !key.LoadKeyFromFile( pKeyFile ) )
+		{
+			cerr << "Nepodarilo se nacist klic ze souboru: " << pKeyFile << "!" << endl;
+			return 1;
+		}
+
+		// Ulozime klic v binarnim formatu
+		if ( !key.SaveKeyToFile( pBinaryKeyFile, RSA_KEY_FORMAT_BINARY ) )
+		{
+			cerr << "Nepodarilo se ulozit klic do souboru: " << pBinaryKeyFile << "!" << endl;
+			return 1;
+		}
+
+		cout << "Binarni klic byl uspesne ulozen do souboru: " << pBinaryKeyFile << "." << endl;
+
+		return 0;
+	}
 	else if ( strncmp( pAction, "checkkey", 8 ) == 0 )
 	{
 		if ( argc != 3 )
@@ -163,7 +343,25 @@ main( int argc, char** argv )
 
 		return 0;
 	}
-	else if ( strncmp( pAction, "encrypt", 7 ) == 0 )
+	else if ( strncmp( pAction, "encrypt-batch", 13 ) == 0 )
+	{
+		if ( argc < 5 || argc > 7 )
+		{
+			PrintHelp( argv[ 0 ] );
+			return 1;
+		}
+
+		RsaFileFormat format;
+		bool          armor;
+		if ( !ParseEncryptOptions( argc, argv, 5, format, armor ) )
+		{
+			PrintHelp( argv[ 0 ] );
+			return 1;
+		}
+
+		return RunBatch( argv[ 2 ], argv[ 3 ], argv[ 4 ], true, format, armor );
+	}
+	else if ( strncmp( pAction, "decrypt-batch", 13 ) == 0 )
 	{
 		if ( argc != 5 )
 		{
@@ -171,6 +369,24 @@ main( int argc, char** argv )
 			return 1;
 		}
 
+		return RunBatch( argv[ 2 ], argv[ 3 ], argv[ 4 ], false, RSA_FILE_FORMAT_BLOCKS, false );
+	}
+	else if ( strncmp( pAction, "encrypt", 7 ) == 0 )
+	{
+		if ( argc < 5 || argc > 7 )
+		{
+			PrintHelp( argv[ 0 ] );
+			return 1;
+		}
+
+		RsaFileFormat format;
+		bool          armor;
+		if ( !ParseEncryptOptions( argc, argv, 5, format, armor ) )
+		{
+			PrintHelp( argv[ 0 ] );
+			return 1;
+		}
+
 		char*  pKeyFile = argv[ 2 ];
 		char*  pInputFile = argv[ 3 ];
 		char*  pOutputFile = argv[ 4 ];
@@ -187,7 +403,11 @@ main( int argc, char** argv )
 	
 		cout << "Sifruji soubor " << pInputFile << " klicem " << pKeyFile << endl;
 		
-		rsa.EncryptFileToFile( pInputFile, pOutputFile );
+		EnableProgress( rsa );
+		rsa.SetIoMode( FILE_PIPELINE_AUTO );
+		rsa.EncryptFileToFile( pInputFile, pOutputFile, format, armor );
+
+		cout << "Sifrovani souboru probehlo uspesne!" << endl;
 
 		return 0;
 	}
@@ -214,8 +434,59 @@ main( int argc, char** argv )
 
 		cout << "Desifruji soubor " << pInputFile << " klicem " << pKeyFile << endl;
 
+		EnableProgress( rsa );
+		rsa.SetIoMode( FILE_PIPELINE_AUTO );
 		rsa.DecryptFileToFile( pInputFile, pOutputFile );
 
+		cout << "Desifrovani souboru probehlo uspesne!" << endl;
+
+		return 0;
+	}
+	else if ( strncmp( pAction, "serve", 5 ) == 0 )
+	{
+		if ( argc != 3 && argc != 4 )
+		{
+			PrintHelp( argv[ 0 ] );
+			return 1;
+		}
+
+#ifndef WIN32
+		char*       pKeyDirectory = argv[ 2 ];
+		RsaKeyStore store( pKeyDirectory );
+		RsaServer   server( store );
+
+		cout << "Nalezeno klicu: " << store.Scan() << endl;
+
+		// Cislo znamena TCP port, cokoliv jineho cestu k unixovemu socketu
+		if ( argc == 4 && strspn( argv[ 3 ], "0123456789" ) != strlen( argv[ 3 ] ) )
+		{
+			server.ListenUnix( argv[ 3 ] );
+			cout << "Posloucham na socketu " << argv[ 3 ] << endl;
+		}
+		else
+		{
+			int listenPort = argc == 4 ? atoi( argv[ 3 ] ) : port;
+			server.ListenTcp( listenPort );
+			cout << "Posloucham na 127.0.0.1:" << listenPort << endl;
+		}
+
+		gpServer = &server;
+		signal( SIGINT, StopServer );
+		signal( SIGTERM, StopServer );
+		signal( SIGPIPE, SIG_IGN );
+
+		server.Run();
+
+		signal( SIGINT, SIG_DFL );
+		signal( SIGTERM, SIG_DFL );
+		gpServer = NULL;
+
+		cout << "Sluzba ukoncena." << endl;
+#else
+		cerr << "Sluzba neni na teto platforme podporovana!" << endl;
+		return 1;
+#endif // WIN32
+
 		return 0;
 	}
 	else
@@ -225,3 +496,29 @@ main( int argc, char** argv )
 
 	return 0;
 }
+
+
+int
+main( int argc, char** argv )
+{
+	bool stats = false;
+	int  count = 0;
+	int  i;
+
+	// Volbu --stats odebereme, ostatni argumenty zustanou na svych mistech
+	for ( i = 0 ; i < argc ; i++ )
+	{
+		if ( i > 0 && strcmp( argv[ i ], "--stats" ) == 0 )
+			stats = true;
+		else
+			argv[ count++ ] = argv[ i ];
+	}
+	argv[ count ] = NULL;
+
+	int result = RunCommand( count, argv );
+
+	if ( stats )
+		StatsDump( cerr );
+
+	return result;
+}
@@ -10,21 +10,25 @@
 #include <iostream>
 #include <fstream>
 #include <string>
+#include <ctime>
+#ifdef WIN32
+#include <windows.h>
+#endif // WIN32
 #include "../BigNum/BigNum.h"
+#include "../BigNum/NumberArena.h"
 #include "RsaKey.h"
 #include "Rsa.h"
+#include "RsaStream.h"
+
+
 
 
 BigNum
 StringToBigNum( const char* pInputString, size_t inputLength )
 {
-	BigNum bn( 0, inputLength + 3 / 4 );
-	size_t i = inputLength;
+	BigNum bn;
 
-	while ( i-- != 0 )
-	{
-		bn.SetByte( i, pInputString[ i ] );
-	}
+	bn.FromBytes( pInputString, inputLength );
 	
 	return bn;
 }
@@ -33,27 +37,38 @@ StringToBigNum( const char* pInputString, size_t inputLength )
 char*
 BigNumToString( const BigNum& rBn )
 {
-	size_t i = rBn.GetActiveBytes();
-	char* pOutputBuffer = new char[ i + 1 ];
+	size_t size = rBn.GetActiveBytes();
+	char* pOutputBuffer = new char[ size + 1 ];
 
 	// Zkontrolujeme zda-li alokace probehla uspesne
 	if ( pOutputBuffer == NULL )
 		throw Exception( "BigNumToString(): Nepodarilo se alokovat pamet!" );
 
-	while ( i-- != 0 )
-	{
-		pOutputBuffer[ i ] = rBn.GetByte( i );
-	}
+	rBn.ToBytes( pOutputBuffer );
 	// Ukoncime string
-	pOutputBuffer[ rBn.GetActiveBytes() ] = '\0';
+	pOutputBuffer[ size ] = '\0';
 
 	return pOutputBuffer;
 } 
 
 
+char*
+BigNumToString( const BigNum& rBn, char* pOutputBuffer, size_t outputSize )
+{
+	if ( outputSize != 0 && rBn.ToBytes( pOutputBuffer, outputSize ) == 0 )
+		throw Exception( "BigNumToString(): Cislo se nevejde do bufferu!" );
+
+	return pOutputBuffer;
+}
+
+
 Rsa::Rsa( const RsaKey& rKey )
-	: mRsaKey( rKey )
+	: mRsaKey( rKey ), mpProgress( NULL ), mpProgressContext( NULL ),
+	  mProgressInterval( 0 ), mIoMode( FILE_PIPELINE_SYNC )
 {
+	// Konstanty pro Montgomeryho nasobeni spocitame jen jednou pro
+	// vsechny bloky (pokud nebyly nacteny spolu s klicem).
+	mRsaKey.Precompute();
 }
 
 
@@ -70,7 +85,7 @@ Rsa::EncryptBlock( const char* pInputBuffer, size_t inputSize )
 	if ( m >= mRsaKey.GetN() )
 		throw Exception( "Rsa::EncryptBlock(): Vstupni data jsou prilis velka" );
 
-	BigNum c = BigNum::ModularExponentiation( m, mRsaKey.GetE(), mRsaKey.GetN() );
+	BigNum c = PublicOperation( mRsaKey, m );
 
 	return BigNumToString( c ); 
 }
@@ -81,13 +96,223 @@ Rsa::DecryptBlock( const char* pInputBuffer, size_t inputSize )
 {
 
 	BigNum c = StringToBigNum( pInputBuffer, inputSize );
-	BigNum m = BigNum::ModularExponentiation( c, mRsaKey.GetD(), mRsaKey.GetN() ); 
+	BigNum m = PrivateOperation( mRsaKey, c );
 	return BigNumToString( m );
 } 
 
 
+size_t
+Rsa::EncryptBlockInto( const char* pInputBuffer, size_t inputSize,
+                       char* pOutputBuffer, size_t outputSize )
+{
+	size_t keyByteSize = GetBlockSize();
+
+	if ( inputSize >= keyByteSize )
+		throw Exception( "Rsa::EncryptBlockInto(): Vstupni data jsou prilis velka" );
+	if ( outputSize < keyByteSize )
+		throw Exception( "Rsa::EncryptBlockInto(): Vystupni buffer je prilis maly" );
+
+	// Vsechna cisla (i kopie parametru klice) jsou jen uvnitr oblasti,
+	// vysledek se zapise do bufferu volajiciho pred jejim koncem.
+	NumberArenaScope arena;
+	BigNum           m;
+
+	m.FromBytes( pInputBuffer, inputSize );
+	if ( m >= mRsaKey.GetN() )
+		throw Exception( "Rsa::EncryptBlockInto(): Vstupni data jsou prilis velka" );
+
+	if ( PublicOperation( mRsaKey, m ).ToBytes( pOutputBuffer, keyByteSize ) == 0 )
+		throw Exception( "Rsa::EncryptBlockInto(): Vysledek je delsi nez blok" );
+
+	return keyByteSize;
+}
+
+
+size_t
+Rsa::DecryptBlockInto( const char* pInputBuffer, size_t inputSize,
+                       char* pOutputBuffer, size_t outputSize )
+{
+	size_t keyByteSize = GetBlockSize();
+
+	if ( inputSize > keyByteSize )
+		throw Exception( "Rsa::DecryptBlockInto(): Vstupni data jsou prilis velka" );
+	if ( outputSize < keyByteSize )
+		throw Exception( "Rsa::DecryptBlockInto(): Vystupni buffer je prilis maly" );
+
+	NumberArenaScope arena;
+	BigNum           c;
+
+	c.FromBytes( pInputBuffer, inputSize );
+	if ( PrivateOperation( mRsaKey, c ).ToBytes( pOutputBuffer, keyByteSize ) == 0 )
+		throw Exception( "Rsa::DecryptBlockInto(): Vysledek je delsi nez blok" );
+
+	return keyByteSize;
+}
+
+
+BigNum
+Rsa::PublicOperation( const RsaKey& rKey, const BigNum& rM )
+{
+	if ( rKey.HasMontgomery() )
+		return BigNum::MontgomeryExponentiation( rM, rKey.GetE(), rKey.GetN(),
+		                                         rKey.GetNInv(), rKey.GetRR() );
+
+	return BigNum::ModularExponentiation( rM, rKey.GetE(), rKey.GetN() );
+}
+
+
+BigNum
+Rsa::PrivateOperation( const RsaKey& rKey, const BigNum& rC )
+{
+	if ( rKey.HasMontgomery() )
+		return BigNum::MontgomeryExponentiation( rC, rKey.GetD(), rKey.GetN(),
+		                                         rKey.GetNInv(), rKey.GetRR() );
+
+	return BigNum::ModularExponentiation( rC, rKey.GetD(), rKey.GetN() );
+}
+
+
 void
-Rsa::EncryptFileToFile( const char* pInputFileName, const char* pOutputFileName )
+Rsa::PrivateOperationBatch( const RsaKey& rKey, const BigNum* pInput,
+                            BigNum* pOutput, size_t count )
+{
+	BigNum p    = rKey.GetP();
+	BigNum q    = rKey.GetQ();
+	BigNum dp   = rKey.GetDp();
+	BigNum dq   = rKey.GetDq();
+	BigNum qInv = rKey.GetQinv();
+	size_t i;
+
+	// Bez parametru pro CRT (napr. klic bez p a q) pocitame primo
+	if ( p.IsZero() || q.IsZero() || dp.IsZero() || dq.IsZero() || qInv.IsZero() ||
+	     p.IsEven() || q.IsEven() )
+	{
+		for ( i = 0 ; i < count ; i++ )
+			pOutput[ i ] = PrivateOperation( rKey, pInput[ i ] );
+		return;
+	}
+
+	uint32_t pNInv = BigNum::MontgomeryInverse( p );
+	uint32_t qNInv = BigNum::MontgomeryInverse( q );
+	BigNum   pRR   = BigNum::MontgomeryRR( p );
+	BigNum   qRR   = BigNum::MontgomeryRR( q );
+
+	for ( i = 0 ; i < count ; i++ )
+	{
+		// m1 = c ^ dp mod p, m2 = c ^ dq mod q
+		BigNum m1 = BigNum::MontgomeryExponentiation( pInput[ i ], dp, p, pNInv, pRR );
+		BigNum m2 = BigNum::MontgomeryExponentiation( pInput[ i ], dq, q, qNInv, qRR );
+
+		// h = qInv * ( m1 - m2 ) mod p, m = m2 + h * q
+		BigNum m2p = m2 % p;
+		BigNum h   = m1 >= m2p ? m1 - m2p : m1 + p - m2p;
+		h = BigNum::MultiplyModulo( h, qInv, p );
+
+		pOutput[ i ] = BigNum::MultiplyAdd( m2, h, q );
+	}
+}
+
+
+/**
+ * \brief Zapis vystupu proudu pres FilePipeline.
+ */
+class PipelineSink : public RsaStreamSink
+{
+public:
+	PipelineSink( FilePipeline& rPipeline ) : mrPipeline( rPipeline ) {};
+
+	virtual void Write( const char* pData, size_t size ) { mrPipeline.Write( pData, size ); };
+
+private:
+	FilePipeline& mrPipeline;
+};
+
+
+/**
+ * \brief Vraci velikost souboru, nebo -1 pokud ji nelze zjistit (roura).
+ */
+static long
+GetFileSize( FILE* fp )
+{
+	long position = ftell( fp );
+	if ( position < 0 || fseek( fp, 0, SEEK_END ) != 0 )
+		return -1;
+
+	long size = ftell( fp );
+	fseek( fp, position, SEEK_SET );
+
+	return size;
+}
+
+
+/**
+ * \brief Vraci monotonni cas v milisekundach.
+ */
+static uint64_t
+GetMilliseconds( void )
+{
+#ifdef WIN32
+	return GetTickCount();
+#else
+	struct timespec ts;
+	clock_gettime( CLOCK_MONOTONIC, &ts );
+
+	return static_cast< uint64_t >( ts.tv_sec ) * 1000 + ts.tv_nsec / 1000000;
+#endif // WIN32
+}
+
+
+void
+Rsa::SetProgressCallback( RsaProgressCallback pCallback, void* pContext,
+                          unsigned int intervalMs )
+{
+	mpProgress        = pCallback;
+	mpProgressContext = pContext;
+	mProgressInterval = intervalMs;
+}
+
+
+/**
+ * \brief Precte cely soubor a preda ho proudu (RsaEncryptStream nebo
+ *  RsaDecryptStream).
+ */
+template < class Stream >
+void
+Rsa::StreamFile( FILE* fpInput, FilePipeline& rPipeline, Stream& rStream )
+{
+	long        inputFileSize = GetFileSize( fpInput );
+	uint64_t    total         = inputFileSize > 0 ? inputFileSize : 0;
+	const char* pData;
+	size_t      n;
+
+	// Hlaseni prubehu je omezene casem, ne poctem bloku
+	uint64_t lastReport = mpProgress ? GetMilliseconds() : 0;
+
+	while ( ( n = rPipeline.Read( pData ) ) != 0 )
+	{
+		rStream.Update( pData, n );
+
+		if ( mpProgress )
+		{
+			uint64_t now = GetMilliseconds();
+			if ( now - lastReport >= mProgressInterval )
+			{
+				mpProgress( rStream.GetInputSize(), total, mpProgressContext );
+				lastReport = now;
+			}
+		}
+	}
+	rStream.Finish();
+	rPipeline.Finish();
+
+	if ( mpProgress )
+		mpProgress( rStream.GetInputSize(), total, mpProgressContext );
+}
+
+
+void
+Rsa::EncryptFileToFile( const char* pInputFileName, const char* pOutputFileName,
+                        RsaFileFormat format, bool armor )
 {
 
 	// Pokud mame neplatny klic nebo verejny
@@ -97,75 +322,39 @@ Rsa::EncryptFileToFile( const char* pInputFileName, const char* pOutputFileName
 	FILE* fpInput = fopen( pInputFileName, "rb" );
 	if ( !fpInput )
 		throw UnableToOpenFileException(
-			"Rsa::EncryptFileToFile(): Nepodarilo se vytvorit vystupni soubor",
+			"Rsa::EncryptFileToFile(): Nepodarilo se otevrit vstupni soubor",
 			pInputFileName
 		);
 
 	FILE* fpOutput = fopen( pOutputFileName, "wb" );
 	if ( !fpOutput )
+	{
+		fclose( fpInput );
 		throw UnableToOpenFileException(
 			"Rsa::EncryptFileToFile(): Nepodarilo se vytvorit vystupni soubor",
 			pOutputFileName
 		);
+	}
 
-	/*
-	 * Budeme sifrovat po blocich, ktere budou mit velikost jako
-	 * nas klic minus dva znaky (tj. 16 bitu). Jeden byte zustava
-	 * nevyuzity, protoze by pak nemusela platit podminka P1 (viz nize)
-	 *
-	 * Napr. je-li velikost klice 512 bitu, coz je 64 bytu, potom
-	 * bude delka vstupniho bloku 63 bytu.
-	 */
-
-	uint   keyByteSize    = mRsaKey.GetKeySize() / 8; 
-	size_t inblockSize    = keyByteSize - 2;
-	size_t outblockSize   = keyByteSize;
-	char*  inputBuffer    = new char[ inblockSize + 1 ];;
-	char*  encryptedBlock = NULL;
-	size_t n;
-	float  progress;
-	
-	if ( !inputBuffer )
-		throw Exception(
-			"Rsa::DecryptFileToFile(): Nepodarilo se alokovat pamet!"
-		);
-		
-	fseek( fpInput, 0, SEEK_END );
-	long inputFileSize = ftell( fpInput );
-	fseek( fpInput, 0, SEEK_SET);
-	
-	uint blocks = ( inputFileSize + keyByteSize - 1 ) / ( keyByteSize - 2 );
-	uint i = 0;
+	FilePipeline* pPipeline = NULL;
+	try
+	{
+		pPipeline = FilePipeline::Create( fpInput, fpOutput, mIoMode );
 
-	std::cout.precision( 4 );
-	std::cout << std::endl;
-	
-	while ( ( n = fread( inputBuffer + 1, 1, inblockSize, fpInput ) ) != 0 )
+		PipelineSink     sink( *pPipeline );
+		RsaEncryptStream stream( mRsaKey, sink, format, armor );
+
+		StreamFile( fpInput, *pPipeline, stream );
+	}
+	catch ( ... )
 	{
-		// Na zacatek bufferu vlozime jeho delku
-		inputBuffer[ 0 ] = static_cast< uint8_t >( n );
-
-		// Zasifrujeme blok
-		encryptedBlock = EncryptBlock( inputBuffer, n + 1 );
-
-		// Zapiseme zasifrovany blok
-		fwrite( encryptedBlock, 1, outblockSize, fpOutput );
-		
-		// Uvolnime alokovanou pamet
-		delete[] encryptedBlock;
-		
-		// Spocitame prubeh v procentech
-		progress = i / static_cast< float >( blocks ) * 100.0f;
-		
-		// Vypiseme prubeh
-		std::cout << "Prubeh: " << progress << "% \r";
-		
-		i++;
+		delete pPipeline;
+		fclose( fpInput );
+		fclose( fpOutput );
+		throw;
 	}
-	
-	std::cout << "Sifrovani souboru probehlo uspesne!" << std::endl;
-	delete[] inputBuffer;
-	
+	delete pPipeline;
+
 	fclose( fpInput );
 	fclose( fpOutput );
 }
@@ -182,65 +371,39 @@ Rsa::DecryptFileToFile( const char* pInputFileName, const char* pOutputFileName
 	FILE* fpInput = fopen( pInputFileName, "rb" );
 	if ( !fpInput )
 		throw UnableToOpenFileException(
-			"Rsa::EncryptFileToFile(): Nepodarilo se vytvorit vystupni soubor",
+			"Rsa::DecryptFileToFile(): Nepodarilo se otevrit vstupni soubor",
 			pInputFileName
 		);
 
 	FILE* fpOutput = fopen( pOutputFileName, "wb" );
 	if ( !fpOutput )
+	{
+		fclose( fpInput );
 		throw UnableToOpenFileException(
-			"Rsa::EncryptFileToFile(): Nepodarilo se vytvorit vystupni soubor",
+			"Rsa::DecryptFileToFile(): Nepodarilo se vytvorit vystupni soubor",
 			pOutputFileName
 		);
+	}
 
-	uint    keyByteSize    = mRsaKey.GetKeySize() / 8; 
-	size_t  inblockSize    = keyByteSize;
-	size_t  outblockSize   = keyByteSize - 2;
-	char*   inputBuffer    = new char[ inblockSize + 1 ];;
-	char*   decryptedBlock = NULL;
-	size_t  n;
-	uint8_t size;
-	float   progress;
-	
-	if ( !inputBuffer )
-		throw Exception(
-			"Rsa::DecryptFileToFile(): Nepodarilo se alokovat pamet!"
-		);
+	FilePipeline* pPipeline = NULL;
+	try
+	{
+		pPipeline = FilePipeline::Create( fpInput, fpOutput, mIoMode );
 
-	fseek( fpInput, 0, SEEK_END );
-	long inputFileSize = ftell( fpInput );
-	fseek( fpInput, 0, SEEK_SET);
-	
-	uint blocks = ( inputFileSize + keyByteSize - 1 ) / ( keyByteSize - 2 );
-	uint i = 0;
-	
-	std::cout.precision( 4 );
-	std::cout << std::endl;
+		PipelineSink     sink( *pPipeline );
+		RsaDecryptStream stream( mRsaKey, sink );
 
-	while ( ( n = fread( inputBuffer, 1, inblockSize, fpInput ) ) != 0 )
+		StreamFile( fpInput, *pPipeline, stream );
+	}
+	catch ( ... )
 	{
-		// Desifrujeme jeden blok
-		decryptedBlock = DecryptBlock( inputBuffer, n );
-		size = decryptedBlock[ 0 ];
-
-		// Zapiseme desifrovany blok do souboru
-		fwrite( decryptedBlock + 1, 1, size, fpOutput );
-		
-		// Uvolnime alokovanou pamet
-		delete[] decryptedBlock;
-		
-		// Spocitame prubeh v procentech
-		progress = i / static_cast< float >( blocks ) * 100.0f;
-		
-		// Vypiseme prubeh
-		std::cout << "Prubeh: " << progress << "% \r";
-		
-		i++;
+		delete pPipeline;
+		fclose( fpInput );
+		fclose( fpOutput );
+		throw;
 	}
+	delete pPipeline;
 
-	std::cout << "Desifrovani souboru probehlo uspesne!" << std::endl;
-	delete[] inputBuffer;
-	
 	fclose( fpInput );
 	fclose( fpOutput );
 }
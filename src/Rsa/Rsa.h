@@ -13,6 +13,7 @@
 
 #include "../Common/Types.h"
 #include "../Common/Exceptions.h"
+#include "../Common/FilePipeline.h"
 
 
 using std::string;
@@ -20,13 +21,43 @@ using std::ifstream;
 using std::ofstream;
 
 
+/**
+ * \brief Format zasifrovaneho souboru.
+ */
+enum RsaFileFormat
+{
+	RSA_FILE_FORMAT_BLOCKS,   // Kazdy blok souboru je zasifrovan RSA
+	RSA_FILE_FORMAT_ENVELOPE  // Data sifrovana ChaCha20, RSA jen jeji klic
+};
+
+
 /**
  * \brief Prevede string na BigNum
  */
 BigNum StringToBigNum( const char* pInputString, size_t inputLength );
+
+/**
+ * \brief Zapise BigNum do bufferu o pevne delce outputSize bytu.
+ *
+ * Cislo je zapsano little-endian (stejne jako ho cte StringToBigNum())
+ * a doplneno nulami na celou delku bufferu. Pokud se cislo do bufferu
+ * nevejde, vyhodi Exception.
+ *
+ * \return Ukazatel na buffer.
+ */
 char* BigNumToString( const BigNum& rBn, char* pOutputBuffer, size_t outputSize );
 
 
+/**
+ * \brief Funkce pro hlaseni prubehu sifrovani souboru.
+ *
+ * \param done     Pocet zpracovanych bytu vstupu.
+ * \param total    Velikost vstupu, nebo 0 pokud neni znama (roura).
+ * \param pContext Ukazatel predany do Rsa::SetProgressCallback().
+ */
+typedef void ( *RsaProgressCallback )( uint64_t done, uint64_t total, void* pContext );
+
+
 /**
  * Trida slouzi pro sifrovani pomoci RSA.
  *
@@ -38,7 +69,8 @@ public:
 	/**
 	 * \brief Implicitni konstruktor.
 	 */
-	Rsa() {};
+	Rsa() : mpProgress( NULL ), mpProgressContext( NULL ), mProgressInterval( 0 ),
+	        mIoMode( FILE_PIPELINE_SYNC ) {};
 
 	Rsa( const RsaKey& rKey );
 
@@ -50,25 +82,128 @@ public:
 	/**
 	 * \brief Nastavi RSA klic.
 	 */
-	void SetKey( const RsaKey& key ) { mRsaKey = key; };
+	void SetKey( const RsaKey& key ) { mRsaKey = key; mRsaKey.Precompute(); };
+
+	/**
+	 * \brief Nastavi funkci pro hlaseni prubehu EncryptFileToFile()
+	 *  a DecryptFileToFile().
+	 *
+	 * Funkce je volana nejvyse jednou za intervalMs milisekund a vzdy
+	 * jednou na konci. Implicitne se prubeh nehlasi.
+	 *
+	 * \param pCallback  Funkce, NULL hlaseni vypne.
+	 * \param pContext   Ukazatel predavany funkci.
+	 * \param intervalMs Minimalni doba mezi dvema volanimi.
+	 */
+	void SetProgressCallback( RsaProgressCallback pCallback, void* pContext = NULL,
+	                          unsigned int intervalMs = 250 );
+
+	/**
+	 * \brief Nastavi zpusob cteni a zapisu souboru.
+	 *
+	 * V asynchronnich rezimech (FILE_PIPELINE_AUTO, _URING, _THREADS)
+	 * se soubor cte dopredu a zapisuje na pozadi, takze disk pracuje
+	 * soucasne se sifrovanim. Implicitne se pouziva FILE_PIPELINE_SYNC.
+	 */
+	void SetIoMode( FilePipelineMode mode ) { mIoMode = mode; };
 	
+	/**
+	 * \brief Vraci velikost zasifrovaneho bloku v bytech.
+	 */
+	size_t GetBlockSize( void ) const { return mRsaKey.GetKeySize() / 8; };
+
+	/**
+	 * \brief Zasifruje blok, vysledek vraci v bufferu alokovanem new[].
+	 *
+	 * Buffer obsahuje jen aktivni byty vysledku a musi ho uvolnit volajici,
+	 * pro opakovane sifrovani viz EncryptBlockInto().
+	 */
 	char* EncryptBlock( const char* pInputBuffer, size_t inputSize );
 
+	/**
+	 * \brief Desifruje blok, vysledek vraci v bufferu alokovanem new[].
+	 */
 	char* DecryptBlock( const char* pInputBuffer, size_t inputSize );
 
+	/**
+	 * \brief Zasifruje blok do bufferu volajiciho.
+	 *
+	 * Vysledek ma vzdy GetBlockSize() bytu (little-endian, doplneno
+	 * nulami). Docasna cisla se berou z areny vlakna (viz NumberArena),
+	 * takze opakovane volani ve stejnem vlakne nealokuje pamet na halde.
+	 *
+	 * \param pInputBuffer  Vstupni data.
+	 * \param inputSize     Velikost vstupu, mene nez GetBlockSize().
+	 * \param pOutputBuffer Vystupni buffer.
+	 * \param outputSize    Velikost vystupniho bufferu, alespon GetBlockSize().
+	 *
+	 * \return Pocet zapsanych bytu, tj. GetBlockSize().
+	 */
+	size_t EncryptBlockInto( const char* pInputBuffer, size_t inputSize,
+	                         char* pOutputBuffer, size_t outputSize );
+
+	/**
+	 * \brief Desifruje blok do bufferu volajiciho.
+	 *
+	 * Stejne jako EncryptBlockInto(), vstup muze mit az GetBlockSize() bytu.
+	 *
+	 * \return Pocet zapsanych bytu, tj. GetBlockSize().
+	 */
+	size_t DecryptBlockInto( const char* pInputBuffer, size_t inputSize,
+	                         char* pOutputBuffer, size_t outputSize );
+
+	/**
+	 * \brief Verejna operace RSA, tj. m ^ e mod n.
+	 *
+	 * Pouzije predpocitane Montgomeryho konstanty klice, pokud je ma.
+	 */
+	static BigNum PublicOperation( const RsaKey& rKey, const BigNum& rM );
+
+	/**
+	 * \brief Soukroma operace RSA, tj. c ^ d mod n.
+	 */
+	static BigNum PrivateOperation( const RsaKey& rKey, const BigNum& rC );
+
+	/**
+	 * \brief Soukroma operace RSA nad vice bloky stejnym klicem.
+	 *
+	 * Ma-li klic parametry pro CRT (p, q, dp, dq, qInv), pocita se pres
+	 * cinsky zbytkovy teorem. Montgomeryho konstanty pro p a q se pritom
+	 * pocitaji jen jednou pro celou davku.
+	 *
+	 * \param rKey    Soukromy klic.
+	 * \param pInput  Pole vstupnich cisel.
+	 * \param pOutput Pole pro vysledky (muze byt stejne jako pInput).
+	 * \param count   Pocet cisel.
+	 */
+	static void PrivateOperationBatch( const RsaKey& rKey, const BigNum* pInput,
+	                                   BigNum* pOutput, size_t count );
+
 
 	/**
 	 * \brief Zasifruje soubor pomoci aktualniho RSA klice.
 	 *
+	 * Ve formatu RSA_FILE_FORMAT_ENVELOPE je RSA zasifrovan jen nahodny
+	 * klic pro ChaCha20, kterou se pak sifruji samotna data. Vystup je
+	 * tak jen o hlavicku vetsi nez vstup a sifrovani je mnohem rychlejsi.
+	 * Pro jine zdroje dat nez soubory viz RsaEncryptStream.
+	 *
 	 * \param pFileName Vstupni soubor pro zasifrovani.
 	 * \param pOut      Vystupni soubor.
+	 * \param format    Format vystupniho souboru.
+	 * \param armor     Zapsat vystup v textove podobe (Base64 po radcich).
 	 *
 	 */
-	void EncryptFileToFile( const char* pFileName, const char* pOut );
+	void EncryptFileToFile( const char* pFileName, const char* pOut,
+	                        RsaFileFormat format = RSA_FILE_FORMAT_BLOCKS,
+	                        bool armor = false );
 
 	/**
 	 * \brief Desifruje soubor pomoci aktualniho RSA klice.
 	 *
+	 * Format souboru (bloky nebo obalka, binarne nebo v textove podobe)
+	 * se rozpozna automaticky.
+	 *
 	 * \param pFileName Vstupni soubor pro desifrovani.
 	 * \param pOut      Vystupni soubor.
 	 *
@@ -77,7 +212,14 @@ public:
 	
 
 private:
-	RsaKey mRsaKey;
+	template < class Stream >
+	void StreamFile( FILE* fpInput, FilePipeline& rPipeline, Stream& rStream );
+
+	RsaKey              mRsaKey;
+	RsaProgressCallback mpProgress;
+	void*               mpProgressContext;
+	unsigned int        mProgressInterval;
+	FilePipelineMode    mIoMode;
 };
 
 
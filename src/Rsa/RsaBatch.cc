@@ -0,0 +1,317 @@
+/*
+ * RsaBatch.cc - Hromadne sifrovani a desifrovani souboru jednim klicem.
+ *
+ * Copyright (c) 2006 Jiri Zajpt, <jzajpt@blueberry.cz>
+ */
+
+#include <iostream>
+#include <string>
+#include <cstdio>
+#include <cstring>
+#include <algorithm>
+#include <map>
+#include <dirent.h>
+#include <sys/stat.h>
+#include "../BigNum/BigNum.h"
+#include "RsaKey.h"
+#include "Rsa.h"
+#include "RsaBatch.h"
+#include "../Common/ThreadPool.h"
+
+
+/**
+ * \brief Zpracovani jednoho souboru davky ve skupine vlaken.
+ */
+class RsaBatchFileTask : public ThreadTask
+{
+public:
+	RsaBatchFileTask( RsaBatch& rBatch, size_t index, bool encrypt, RsaFileFormat format,
+	                  bool armor )
+		: mrBatch( rBatch ), mIndex( index ), mEncrypt( encrypt ), mFormat( format ),
+		  mArmor( armor ) {};
+
+	virtual void Run( void ) { mrBatch.Process( mIndex, mEncrypt, mFormat, mArmor ); };
+
+private:
+	RsaBatch&     mrBatch;
+	size_t        mIndex;
+	bool          mEncrypt;
+	RsaFileFormat mFormat;
+	bool          mArmor;
+};
+
+
+static bool
+IsDirectory( const std::string& rPath )
+{
+	struct stat st;
+	return stat( rPath.c_str(), &st ) == 0 && S_ISDIR( st.st_mode );
+}
+
+
+static bool
+IsRegularFile( const std::string& rPath )
+{
+	struct stat st;
+	return stat( rPath.c_str(), &st ) == 0 && S_ISREG( st.st_mode );
+}
+
+
+RsaBatch::RsaBatch( Rsa& rRsa, const std::string& outputDir )
+	: mrRsa( rRsa ), mOutputDir( outputDir ), mpCallback( NULL ), mpContext( NULL ),
+	  mFailed( 0 )
+{
+	pthread_mutex_init( &mMutex, NULL );
+}
+
+
+RsaBatch::~RsaBatch()
+{
+	pthread_mutex_destroy( &mMutex );
+}
+
+
+void
+RsaBatch::AddFile( const std::string& input, const std::string& output )
+{
+	RsaBatchItem item;
+
+	item.mInput  = input;
+	item.mOutput = output;
+	item.mDone   = false;
+	item.mFailed = false;
+
+	mItems.push_back( item );
+}
+
+
+size_t
+RsaBatch::AddManifest( const std::string& manifest )
+{
+	FILE* fp = fopen( manifest.c_str(), "r" );
+	if ( !fp )
+		throw UnableToOpenFileException( "Nepodarilo se otevrit seznam souboru", manifest );
+
+	size_t count = 0;
+	char   line[ 4096 ];
+
+	while ( fgets( line, sizeof( line ), fp ) )
+	{
+		std::string entry = line;
+
+		// Odrizneme konec radku (i windowsovsky)
+		while ( !entry.empty() &&
+		        ( entry[ entry.length() - 1 ] == '\n' || entry[ entry.length() - 1 ] == '\r' ) )
+			entry.erase( entry.length() - 1 );
+
+		if ( entry.empty() || entry[ 0 ] == '#' )
+			continue;
+
+		size_t tab = entry.find( '\t' );
+		if ( tab != std::string::npos )
+			AddFile( entry.substr( 0, tab ), entry.substr( tab + 1 ) );
+		else
+			AddFile( entry );
+
+		count++;
+	}
+
+	fclose( fp );
+
+	return count;
+}
+
+
+size_t
+RsaBatch::AddDirectory( const std::string& directory )
+{
+	DIR* pDir = opendir( directory.c_str() );
+	if ( !pDir )
+		throw UnableToOpenFileException( "Nepodarilo se otevrit adresar", directory );
+
+	size_t                     count = 0;
+	struct dirent*             pEntry;
+	std::vector< std::string > names;
+
+	while ( ( pEntry = readdir( pDir ) ) != NULL )
+	{
+		if ( pEntry->d_name[ 0 ] == '.' )
+			continue;
+
+		std::string path = directory + "/" + pEntry->d_name;
+		if ( IsRegularFile( path ) )
+			names.push_back( path );
+	}
+
+	closedir( pDir );
+
+	// Poradi readdir() je nahodne, vystup ma byt opakovatelny
+	std::sort( names.begin(), names.end() );
+
+	for ( ; count < names.size() ; count++ )
+		AddFile( names[ count ] );
+
+	return count;
+}
+
+
+size_t
+RsaBatch::AddPath( const std::string& path )
+{
+	if ( IsDirectory( path ) )
+		return AddDirectory( path );
+
+	return AddManifest( path );
+}
+
+
+std::string
+RsaBatch::GetOutputName( const std::string& input, bool encrypt ) const
+{
+	std::string name   = input;
+	size_t      pos    = name.rfind( '/' );
+	size_t      suffix = strlen( cRsaBatchSuffix );
+
+	if ( pos != std::string::npos )
+		name = name.substr( pos + 1 );
+
+	if ( encrypt )
+		name += cRsaBatchSuffix;
+	else if ( name.length() > suffix &&
+	          name.compare( name.length() - suffix, suffix, cRsaBatchSuffix ) == 0 )
+		name.erase( name.length() - suffix );
+	else
+		name += ".out";
+
+	return mOutputDir.empty() ? name : mOutputDir + "/" + name;
+}
+
+
+size_t
+RsaBatch::Encrypt( RsaFileFormat format, bool armor, size_t threads )
+{
+	return Run( true, format, armor, threads );
+}
+
+
+size_t
+RsaBatch::Decrypt( size_t threads )
+{
+	return Run( false, RSA_FILE_FORMAT_BLOCKS, false, threads );
+}
+
+
+size_t
+RsaBatch::Run( bool encrypt, RsaFileFormat format, bool armor, size_t threads )
+{
+	size_t i;
+
+	mFailed = 0;
+
+	for ( i = 0 ; i < mItems.size() ; i++ )
+	{
+		mItems[ i ].mDone   = false;
+		mItems[ i ].mFailed = false;
+		mItems[ i ].mError.clear();
+
+		if ( mItems[ i ].mOutput.empty() )
+			mItems[ i ].mOutput = GetOutputName( mItems[ i ].mInput, encrypt );
+	}
+
+	// Soubory se stejnym vystupem (napr. a/x a b/x v manifestu) by vlakna
+	// zapisovala a mazala soubezne, zadny z nich proto nezpracujeme
+	std::map< std::string, size_t > outputs;
+	size_t                          count = 0;
+
+	for ( i = 0 ; i < mItems.size() ; i++ )
+		outputs[ mItems[ i ].mOutput ]++;
+
+	for ( i = 0 ; i < mItems.size() ; i++ )
+	{
+		if ( outputs[ mItems[ i ].mOutput ] == 1 )
+		{
+			count++;
+			continue;
+		}
+
+		mItems[ i ].mDone   = true;
+		mItems[ i ].mFailed = true;
+		mItems[ i ].mError  = "Vystup " + mItems[ i ].mOutput + " ma i jiny soubor davky";
+		mFailed++;
+
+		if ( mpCallback )
+			mpCallback( mItems[ i ], mpContext );
+	}
+
+	// Vice vlaken nez souboru nema smysl
+	if ( threads == 0 )
+		threads = ThreadPool::GetCpuCount();
+	if ( threads > count )
+		threads = count;
+
+	if ( threads == 0 )
+		return mFailed;
+
+	ThreadPool pool( threads );
+
+	for ( i = 0 ; i < mItems.size() ; i++ )
+		if ( !mItems[ i ].mDone )
+			pool.Submit( new RsaBatchFileTask( *this, i, encrypt, format, armor ) );
+
+	pool.Wait();
+
+	return mFailed;
+}
+
+
+void
+RsaBatch::Process( size_t index, bool encrypt, RsaFileFormat format, bool armor )
+{
+	// Polozky se behem zpracovani nepridavaji, odkaz zustava platny
+	RsaBatchItem& rItem = mItems[ index ];
+	std::string   error;
+	bool          failed  = true;
+	bool          partial = true;
+
+	try
+	{
+		if ( encrypt )
+			mrRsa.EncryptFileToFile( rItem.mInput.c_str(), rItem.mOutput.c_str(), format, armor );
+		else
+			mrRsa.DecryptFileToFile( rItem.mInput.c_str(), rItem.mOutput.c_str() );
+
+		failed = false;
+	}
+	catch ( UnableToOpenFileException& e )
+	{
+		// Vystup jeste nebyl vytvoren (nebo to nejde), nemazeme jej
+		error   = e.mMessage + ": " + e.mFileName;
+		partial = false;
+	}
+	catch ( Exception& e )
+	{
+		error = e.mMessage;
+	}
+	catch ( ... )
+	{
+		error = "Neznama chyba";
+	}
+
+	// Po chybe nenechavame na disku neuplny vystup
+	if ( failed && partial )
+		remove( rItem.mOutput.c_str() );
+
+	pthread_mutex_lock( &mMutex );
+
+	rItem.mDone   = true;
+	rItem.mFailed = failed;
+	rItem.mError  = error;
+
+	if ( failed )
+		mFailed++;
+
+	if ( mpCallback )
+		mpCallback( rItem, mpContext );
+
+	pthread_mutex_unlock( &mMutex );
+}
@@ -0,0 +1,158 @@
+/*
+ * RsaBatch.h - Hromadne sifrovani a desifrovani souboru jednim klicem.
+ *
+ * Copyright (c) 2006 Jiri Zajpt, <jzajpt@blueberry.cz>
+ */
+
+#ifndef _RSA_RSABATCH__H
+#define _RSA_RSABATCH__H
+
+
+#include <string>
+#include <vector>
+#include <pthread.h>
+
+
+/**
+ * \brief Pripona zasifrovanych souboru v davce.
+ */
+const char* const cRsaBatchSuffix = ".rsa";
+
+
+/**
+ * \brief Jeden soubor davky a vysledek jeho zpracovani.
+ */
+struct RsaBatchItem
+{
+	std::string mInput;    // Vstupni soubor
+	std::string mOutput;   // Vystupni soubor
+	bool        mDone;     // Soubor byl zpracovan
+	bool        mFailed;   // Pri zpracovani nastala chyba
+	std::string mError;    // Popis chyby
+};
+
+
+/**
+ * \brief Funkce volana po zpracovani kazdeho souboru.
+ *
+ * Vola se z pracovnich vlaken, ale nikdy soubezne (pod zamkem davky).
+ */
+typedef void (*RsaBatchCallback)( const RsaBatchItem& rItem, void* pContext );
+
+
+/**
+ * \brief Davka souboru sifrovanych nebo desifrovanych jednim klicem.
+ *
+ * Klic se nacte a predpocita jen jednou (v objektu Rsa), soubory se
+ * rozdeli mezi pracovni vlakna. Chyba u jednoho souboru se zaznamena
+ * a zpracovani ostatnich pokracuje.
+ *
+ * Seznam souboru lze zadat primo, manifestem nebo adresarem. Manifest je
+ * textovy soubor, kazdy radek obsahuje vstupni soubor a volitelne po
+ * tabulatoru vystupni soubor. Prazdne radky a radky zacinajici znakem
+ * '#' se preskakuji.
+ *
+ * \author Jiri Zajpt
+ */
+class RsaBatch
+{
+public:
+	/**
+	 * \brief Konstruktor.
+	 *
+	 * \param rRsa      Objekt s nactenym klicem. Nesmi mit nastaveno
+	 *                  hlaseni prubehu, sdili jej vsechna vlakna.
+	 * \param outputDir Adresar pro vystupni soubory bez explicitni cesty.
+	 */
+	RsaBatch( Rsa& rRsa, const std::string& outputDir );
+
+	~RsaBatch();
+
+	/**
+	 * \brief Prida soubor.
+	 *
+	 * Prazdny vystup znamena vychozi nazev, viz GetOutputName().
+	 */
+	void AddFile( const std::string& input, const std::string& output = "" );
+
+	/**
+	 * \brief Prida soubory ze seznamu (manifestu).
+	 *
+	 * \return Pocet pridanych souboru.
+	 */
+	size_t AddManifest( const std::string& manifest );
+
+	/**
+	 * \brief Prida vsechny bezne soubory z adresare (bez podadresaru).
+	 *
+	 * \return Pocet pridanych souboru.
+	 */
+	size_t AddDirectory( const std::string& directory );
+
+	/**
+	 * \brief Prida adresar nebo manifest podle toho, co cesta oznacuje.
+	 */
+	size_t AddPath( const std::string& path );
+
+	/**
+	 * \brief Nastavi funkci volanou po zpracovani kazdeho souboru.
+	 */
+	void SetCallback( RsaBatchCallback pCallback, void* pContext = NULL )
+	{
+		mpCallback = pCallback;
+		mpContext  = pContext;
+	};
+
+	/**
+	 * \brief Zasifruje vsechny soubory davky.
+	 *
+	 * \param format  Format vystupu, viz RsaFileFormat.
+	 * \param armor   Vystup v textove podobe (Base64).
+	 * \param threads Pocet vlaken, nula znamena pocet procesoru.
+	 * \return Pocet souboru, ktere se nepodarilo zpracovat.
+	 */
+	size_t Encrypt( RsaFileFormat format, bool armor = false, size_t threads = 0 );
+
+	/**
+	 * \brief Desifruje vsechny soubory davky.
+	 *
+	 * \return Pocet souboru, ktere se nepodarilo zpracovat.
+	 */
+	size_t Decrypt( size_t threads = 0 );
+
+	/**
+	 * \brief Vraci soubory davky vcetne vysledku.
+	 */
+	const std::vector< RsaBatchItem >& GetItems( void ) const { return mItems; };
+
+	/**
+	 * \brief Vraci vychozi nazev vystupu pro vstupni soubor.
+	 *
+	 * Nazev souboru (bez adresare) se umisti do vystupniho adresare.
+	 * Pri sifrovani se pripoji pripona cRsaBatchSuffix, pri desifrovani
+	 * se odebere (pokud ji soubor nema, pripoji se ".out"). Soubory davky,
+	 * jejichz vystupy splynou (stejny nazev v ruznych adresarich), se
+	 * nezpracuji a oznaci se jako chybne.
+	 */
+	std::string GetOutputName( const std::string& input, bool encrypt ) const;
+
+private:
+	friend class RsaBatchFileTask;
+
+	RsaBatch( const RsaBatch& );
+	RsaBatch& operator = ( const RsaBatch& );
+
+	size_t Run( bool encrypt, RsaFileFormat format, bool armor, size_t threads );
+	void   Process( size_t index, bool encrypt, RsaFileFormat format, bool armor );
+
+	Rsa&                        mrRsa;
+	std::string                 mOutputDir;
+	std::vector< RsaBatchItem > mItems;
+	RsaBatchCallback            mpCallback;
+	void*                       mpContext;
+	size_t                      mFailed;
+	pthread_mutex_t             mMutex;
+};
+
+
+#endif // _RSA_RSABATCH__H
@@ -8,6 +8,13 @@
 #include <fstream>
 #include <sstream>
 #include <string>
+#include <cstring>
+#ifndef WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif // WIN32
 #include "../Common/Base64.h"
 #include "../BigNum/BigNum.h"
 #include "RsaKey.h"
@@ -15,11 +22,86 @@
 
 const char cPublicKeyId[]  = "-- PMZ_RSA PUBLIC KEY --";
 const char cPrivateKeyId[] = "-- PMZ_RSA PRIVATE KEY --";
-const int  cLineLength = 48;
+
+
+/*
+ * Binarni format klice
+ * --------------------
+ *
+ * Soubor zacina hlavickou RsaKeyFileHeader, za kterou nasleduji pole
+ * 32bitovych cislic jednotlivych cisel klice. Kazde pole zacina na offsetu
+ * zarovnanem na cBinaryFieldAlign bytu a cislice jsou ulozeny little-endian,
+ * tj. ve stejnem tvaru jako v NumberBuffer. Na little-endian stroji se
+ * tak cisla pri nacitani pouze zkopiruji, bez jakehokoliv prevodu.
+ *
+ * Krome parametru klice obsahuje soubor i predpocitane konstanty pro
+ * Montgomeryho nasobeni modulo N (priznak RSA_BINKEY_MONTGOMERY).
+ */
+const char     cBinaryKeyId[ 8 ]  = { 'P', 'M', 'Z', '_', 'R', 'S', 'A', 0 };
+const uint32_t cBinaryKeyVersion  = 1;
+const size_t   cBinaryFieldAlign  = 64;
+const size_t   cBinaryKeyMinSize  = 128;   // jako nejmensi klic prikazu genkey
+
+const uint32_t RSA_BINKEY_MONTGOMERY = 0x01;
+
+
+/**
+ * \brief Poradi cisel v tabulce poli binarniho klice.
+ */
+enum RsaKeyFileFieldIndex
+{
+	RSA_FIELD_N,
+	RSA_FIELD_E,
+	RSA_FIELD_P,
+	RSA_FIELD_Q,
+	RSA_FIELD_DP,
+	RSA_FIELD_DQ,
+	RSA_FIELD_QINV,
+	RSA_FIELD_D,
+	RSA_FIELD_RR,
+	RSA_FIELD_MAX = 12
+};
+
+
+struct RsaKeyFileField
+{
+	uint32_t offset; // Offset pole od zacatku souboru (v bytech)
+	uint32_t limbs;  // Pocet 32bitovych cislic
+};
+
+
+struct RsaKeyFileHeader
+{
+	char            id[ 8 ];
+	uint32_t        version;
+	uint32_t        keyType;
+	uint32_t        keySize;
+	uint32_t        flags;
+	uint32_t        nInv;
+	uint32_t        reserved;
+	RsaKeyFileField fields[ RSA_FIELD_MAX ];
+};
+
+
+/**
+ * \brief Prevede 32bitove cislo mezi little-endian a nativnim poradim bytu.
+ */
+static uint32_t
+LittleEndian32( uint32_t value )
+{
+	const uint32_t probe = 1;
+
+	if ( *reinterpret_cast< const uint8_t* >( &probe ) == 1 )
+		return value;
+
+	return ( value >> 24 ) | ( ( value >> 8 ) & 0xFF00 )
+	     | ( ( value << 8 ) & 0xFF0000 ) | ( value << 24 );
+}
 
 
 RsaKey::RsaKey()
-	: mKeyType( RSA_KEY_INVALID ), mKeySize( 0 )
+	: mKeyType( RSA_KEY_INVALID ), mKeySize( 0 ),
+	mHasMontgomery( false ), mNInv( 0 )
 {
 }
 
@@ -31,7 +113,8 @@ RsaKey::RsaKey(
 )
 	: mKeyType( keyType ), mKeySize( keySize ),
 	mP( p ), mQ( q ), mN( n ),
-	mDp( 0 ), mDq( 0 ), mQinv( 0 ), mD( d ), mE( e )
+	mDp( 0 ), mDq( 0 ), mQinv( 0 ), mD( d ), mE( e ),
+	mHasMontgomery( false ), mNInv( 0 )
 {
 }
 
@@ -88,6 +171,9 @@ RsaKey::GenerateKey( size_t bits, BigNum e )
 
 	mKeyType = RSA_KEY_PRIVATE;
 	mKeySize = bits;
+
+	mHasMontgomery = false;
+	Precompute();
 	
 	std::cout << std::endl;
 
@@ -96,11 +182,14 @@ RsaKey::GenerateKey( size_t bits, BigNum e )
 
 
 bool
-RsaKey::SaveKeyToFile( const char* pFilename )
+RsaKey::SaveKeyToFile( const char* pFilename, RsaKeyFormat format )
 {
 	if ( mKeyType == RSA_KEY_INVALID )
 		return false;
 
+	if ( format == RSA_KEY_FORMAT_BINARY )
+		return SaveBinaryKey( pFilename );
+
 	ofstream ofs( pFilename );
 	if ( !ofs.is_open() )
 		throw UnableToOpenFileException( "Nepodarilo se vytvorit soubor", pFilename );
@@ -127,18 +216,12 @@ RsaKey::SaveKeyToFile( const char* pFilename )
 		buffer += temp;
 		buffer += "\n";
 		
-		char*  encoded = Base64EncodeString( buffer.c_str(), buffer.length() );
-		size_t encodedLen = strlen( encoded );
-		int i;
-		int times = encodedLen / cLineLength;
+		Base64Encoder encoder( cBase64LineLength );
+		std::string   encoded;
 
-		for ( i = 0 ; i < times  ; i++ )
-		{
-			ofs.write( encoded + ( i * cLineLength ), cLineLength );
-			ofs.put( '\n' );
-		}
-		ofs.write( encoded + ( i * cLineLength ), encodedLen % cLineLength );
-		delete[] encoded;
+		encoder.Update( buffer.data(), buffer.length(), encoded );
+		encoder.Finish( encoded );
+		ofs.write( encoded.data(), encoded.length() );
 	}
 	else if ( mKeyType == RSA_KEY_PRIVATE )
 	{
@@ -187,28 +270,270 @@ RsaKey::SaveKeyToFile( const char* pFilename )
 		buffer += temp;
 		buffer += "\n";
 
-		char*  encoded = Base64EncodeString( buffer.c_str(), buffer.length() );
-		size_t encodedLen = strlen( encoded );
-		int i;
-		int times = encodedLen / cLineLength;
-		char c;
+		Base64Encoder encoder( cBase64LineLength );
+		std::string   encoded;
+
+		encoder.Update( buffer.data(), buffer.length(), encoded );
+		encoder.Finish( encoded );
+		ofs.write( encoded.data(), encoded.length() );
+	}
+
+	return true;
+}
+
+
+bool
+RsaKey::SaveBinaryKey( const char* pFilename )
+{
+	Precompute();
+
+	const BigNum* fields[ RSA_FIELD_MAX ] = { NULL };
+
+	fields[ RSA_FIELD_N ] = &mN;
+	fields[ RSA_FIELD_E ] = &mE;
+	if ( mHasMontgomery )
+		fields[ RSA_FIELD_RR ] = &mRR;
+
+	if ( mKeyType == RSA_KEY_PRIVATE )
+	{
+		fields[ RSA_FIELD_P ]    = &mP;
+		fields[ RSA_FIELD_Q ]    = &mQ;
+		fields[ RSA_FIELD_DP ]   = &mDp;
+		fields[ RSA_FIELD_DQ ]   = &mDq;
+		fields[ RSA_FIELD_QINV ] = &mQinv;
+		fields[ RSA_FIELD_D ]    = &mD;
+	}
+
+	RsaKeyFileHeader header;
+	size_t           offset = sizeof( RsaKeyFileHeader );
+	size_t           limbs[ RSA_FIELD_MAX ];
+	size_t           offsets[ RSA_FIELD_MAX ];
+	int              i;
+
+	memset( &header, 0, sizeof( header ) );
+	memcpy( header.id, cBinaryKeyId, sizeof( cBinaryKeyId ) );
+	header.version = LittleEndian32( cBinaryKeyVersion );
+	header.keyType = LittleEndian32( mKeyType );
+	header.keySize = LittleEndian32( mKeySize );
+	header.flags   = LittleEndian32( mHasMontgomery ? RSA_BINKEY_MONTGOMERY : 0 );
+	header.nInv    = LittleEndian32( mNInv );
+
+	// Rozvrhneme pole cislic, kazde zarovname na cBinaryFieldAlign bytu.
+	for ( i = 0 ; i < RSA_FIELD_MAX ; i++ )
+	{
+		limbs[ i ]   = fields[ i ] ? fields[ i ]->GetActiveSize() : 0;
+		offsets[ i ] = 0;
+		if ( limbs[ i ] == 0 )
+			continue;
+
+		offset = ( offset + cBinaryFieldAlign - 1 ) & ~( cBinaryFieldAlign - 1 );
+		offsets[ i ] = offset;
+		offset += limbs[ i ] * sizeof( uint32_t );
+
+		header.fields[ i ].offset = LittleEndian32( offsets[ i ] );
+		header.fields[ i ].limbs  = LittleEndian32( limbs[ i ] );
+	}
+
+	// Cely soubor sestavime v pameti a zapiseme jednim volanim.
+	char* pData = new char[ offset ];
+	memset( pData, 0, offset );
+	memcpy( pData, &header, sizeof( header ) );
+
+	for ( i = 0 ; i < RSA_FIELD_MAX ; i++ )
+	{
+		uint32_t* pOut = reinterpret_cast< uint32_t* >( pData + offsets[ i ] );
+		size_t    j;
+
+		for ( j = 0 ; j < limbs[ i ] ; j++ )
+			pOut[ j ] = LittleEndian32( fields[ i ]->mNb.Get( j ) );
+	}
+
+	FILE* fp = fopen( pFilename, "wb" );
+	if ( !fp )
+	{
+		delete[] pData;
+		throw UnableToOpenFileException( "Nepodarilo se vytvorit soubor", pFilename );
+	}
+
+	size_t written = fwrite( pData, 1, offset, fp );
+	fclose( fp );
+	delete[] pData;
+
+	return written == offset;
+}
+
+
+bool
+RsaKey::LoadBinaryKey( const char* pData, size_t dataSize )
+{
+	if ( dataSize < sizeof( RsaKeyFileHeader ) )
+		return false;
+
+	const RsaKeyFileHeader* pHeader =
+		reinterpret_cast< const RsaKeyFileHeader* >( pData );
+
+	if ( LittleEndian32( pHeader->version ) != cBinaryKeyVersion )
+	{
+		std::cerr << "Nepodporovana verze binarniho klice!" << std::endl;
+		return false;
+	}
+
+	RsaKeyType keyType = static_cast< RsaKeyType >( LittleEndian32( pHeader->keyType ) );
+	if ( keyType != RSA_KEY_PRIVATE && keyType != RSA_KEY_PUBLIC )
+		return false;
+
+	BigNum* fields[ RSA_FIELD_MAX ] = { NULL };
 
-		for ( i = 0 ; i < times  ; i++ )
+	fields[ RSA_FIELD_N ]    = &mN;
+	fields[ RSA_FIELD_E ]    = &mE;
+	fields[ RSA_FIELD_P ]    = &mP;
+	fields[ RSA_FIELD_Q ]    = &mQ;
+	fields[ RSA_FIELD_DP ]   = &mDp;
+	fields[ RSA_FIELD_DQ ]   = &mDq;
+	fields[ RSA_FIELD_QINV ] = &mQinv;
+	fields[ RSA_FIELD_D ]    = &mD;
+	fields[ RSA_FIELD_RR ]   = &mRR;
+
+	int i;
+	for ( i = 0 ; i < RSA_FIELD_MAX ; i++ )
+	{
+		size_t offset = LittleEndian32( pHeader->fields[ i ].offset );
+		size_t limbs  = LittleEndian32( pHeader->fields[ i ].limbs );
+
+		if ( ( offset % sizeof( uint32_t ) ) != 0 || offset > dataSize
+		  || limbs > ( dataSize - offset ) / sizeof( uint32_t ) )
 		{
-			ofs.write( encoded + ( i * cLineLength ), cLineLength );
-			ofs.put( '\n' );
+			std::cerr << "Poskozeny binarni klic!" << std::endl;
+			return false;
+		}
+
+		if ( fields[ i ] == NULL )
+			continue;
+
+		const uint32_t* pLimbs = reinterpret_cast< const uint32_t* >( pData + offset );
+		fields[ i ]->SetValue( pLimbs, limbs );
+
+		// Na big-endian stroji musime prohodit poradi bytu.
+		if ( LittleEndian32( 1 ) != 1 )
+		{
+			size_t j;
+			for ( j = 0 ; j < limbs ; j++ )
+				fields[ i ]->mNb.Set( j, LittleEndian32( pLimbs[ j ] ) );
+		}
+	}
+
+	mKeyType = keyType;
+	mKeySize = LittleEndian32( pHeader->keySize );
+	mNInv    = LittleEndian32( pHeader->nInv );
+	mHasMontgomery =
+		( LittleEndian32( pHeader->flags ) & RSA_BINKEY_MONTGOMERY ) != 0
+		&& !mRR.IsZero();
+
+	//
+	// Hlavicce ani predpocitanym konstantam neverime, kontrolujeme je
+	// proti modulu. Z velikosti klice se pocita velikost bloku, nesmi
+	// tedy byt mensi nez skutecna (ani nesmyslne mala).
+	//
+	if ( mN.IsZero() || mN.IsEven() )
+		throw InvalidKeyException( "Poskozeny binarni klic: modulus neni liche cislo!" );
+
+	if ( mKeySize < cBinaryKeyMinSize || mKeySize != mN.GetBitCnt() )
+		throw InvalidKeyException( "Poskozeny binarni klic: velikost klice neodpovida modulu!" );
+
+	if ( mHasMontgomery )
+	{
+		if ( mNInv != BigNum::MontgomeryInverse( mN ) )
+			throw InvalidKeyException( "Poskozeny binarni klic: chybna konstanta nInv!" );
+
+		// Se spravnym R^2 mod N vrati Montgomeryho umocneni 2^1 dvojku,
+		// jinak konstantu spocitame znovu
+		if ( mRR >= mN || BigNum::MontgomeryExponentiation( 2, 1, mN, mNInv, mRR ) != 2 )
+		{
+			mHasMontgomery = false;
+			Precompute();
 		}
-		ofs.write( encoded + ( i * cLineLength ), encodedLen % cLineLength );
-		delete[] encoded;
 	}
 
 	return true;
 }
 
 
+void
+RsaKey::Precompute( void )
+{
+	if ( mHasMontgomery )
+		return;
+
+	// Montgomeryho nasobeni vyzaduje liche modulo.
+	if ( mN.IsZero() || mN.IsEven() )
+		return;
+
+	mNInv = BigNum::MontgomeryInverse( mN );
+	mRR   = BigNum::MontgomeryRR( mN );
+	mHasMontgomery = true;
+}
+
+
 bool
 RsaKey::LoadKeyFromFile( const char* pFilename )
 {
+	//
+	// Nejdrive zkusime binarni format. Soubor nacteme najednou (mmap,
+	// pripadne jednim volanim fread) a pokud zacina identifikatorem
+	// binarniho klice, cisla z nej pouze zkopirujeme.
+	//
+	bool isBinary = false;
+	bool loaded   = false;
+
+#ifndef WIN32
+	int fd = open( pFilename, O_RDONLY );
+	if ( fd < 0 )
+		throw UnableToOpenFileException( "Nepodarilo se otevrit soubor", pFilename );
+
+	struct stat st;
+	if ( fstat( fd, &st ) == 0 && st.st_size >= ( off_t ) sizeof( RsaKeyFileHeader ) )
+	{
+		void* pMap = mmap( NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0 );
+		if ( pMap != MAP_FAILED )
+		{
+			const char* pData = static_cast< const char* >( pMap );
+			if ( memcmp( pData, cBinaryKeyId, sizeof( cBinaryKeyId ) ) == 0 )
+			{
+				isBinary = true;
+				loaded = LoadBinaryKey( pData, st.st_size );
+			}
+			munmap( pMap, st.st_size );
+		}
+	}
+	close( fd );
+#else
+	FILE* fp = fopen( pFilename, "rb" );
+	if ( !fp )
+		throw UnableToOpenFileException( "Nepodarilo se otevrit soubor", pFilename );
+
+	fseek( fp, 0, SEEK_END );
+	long fileSize = ftell( fp );
+	fseek( fp, 0, SEEK_SET );
+
+	if ( fileSize >= ( long ) sizeof( RsaKeyFileHeader ) )
+	{
+		char* pData = new char[ fileSize ];
+		if ( fread( pData, 1, fileSize, fp ) == ( size_t ) fileSize
+		  && memcmp( pData, cBinaryKeyId, sizeof( cBinaryKeyId ) ) == 0 )
+		{
+			isBinary = true;
+			loaded = LoadBinaryKey( pData, fileSize );
+		}
+		delete[] pData;
+	}
+	fclose( fp );
+#endif // WIN32
+
+	if ( isBinary )
+		return loaded;
+
+	mHasMontgomery = false;
+
 	ifstream ifs( pFilename );
 	if ( !ifs.is_open() )
 		throw UnableToOpenFileException( "Nepodarilo se otevrit soubor", pFilename );
@@ -230,7 +555,16 @@ RsaKey::LoadKeyFromFile( const char* pFilename )
 			inbuffer += tmp;
 		}
 
-		decodedBuffer = Base64DecodeString( inbuffer.c_str(), inbuffer.length() );
+		char* pDecoded = Base64DecodeString( inbuffer.c_str(), inbuffer.length() );
+		if ( !pDecoded )
+		{
+			mKeyType = RSA_KEY_INVALID;
+			return false;
+		}
+
+		decodedBuffer = pDecoded;
+		delete[] pDecoded;
+
 		std::stringstream ss( decodedBuffer );
 		
 		// Nacteme delku klice
@@ -259,7 +593,16 @@ RsaKey::LoadKeyFromFile( const char* pFilename )
 			inbuffer += tmp;
 		}
 
-		decodedBuffer = Base64DecodeString( inbuffer.c_str(), inbuffer.length() );
+		char* pDecoded = Base64DecodeString( inbuffer.c_str(), inbuffer.length() );
+		if ( !pDecoded )
+		{
+			mKeyType = RSA_KEY_INVALID;
+			return false;
+		}
+
+		decodedBuffer = pDecoded;
+		delete[] pDecoded;
+
 		std::stringstream ss( decodedBuffer );
 		
 		// Nacteme delku klice
@@ -300,6 +643,42 @@ RsaKey::LoadKeyFromFile( const char* pFilename )
 }
 
 
+std::string
+RsaKey::GetFingerprint( void ) const
+{
+	const BigNum* fields[] = { &mN, &mE };
+	uint64_t      hash = 0xcbf29ce484222325ULL;
+	size_t        i;
+	size_t        j;
+
+	for ( i = 0 ; i < sizeof( fields ) / sizeof( fields[ 0 ] ) ; i++ )
+	{
+		size_t bytes = fields[ i ]->GetActiveSize() * 4;
+
+		for ( j = 0 ; j < bytes ; j++ )
+		{
+			hash ^= fields[ i ]->GetByte( j );
+			hash *= 0x100000001b3ULL;
+		}
+	}
+
+	char buffer[ 17 ];
+	snprintf( buffer, sizeof( buffer ), "%016llx", ( unsigned long long ) hash );
+
+	return buffer;
+}
+
+
+size_t
+RsaKey::GetMemorySize( void ) const
+{
+	return sizeof( RsaKey ) + sizeof( uint32_t ) * (
+		mP.GetSize() + mQ.GetSize() + mN.GetSize() +
+		mDp.GetSize() + mDq.GetSize() + mQinv.GetSize() +
+		mD.GetSize() + mE.GetSize() + mRR.GetSize() );
+}
+
+
 bool
 RsaKey::IsValid() const
 {
@@ -27,6 +27,16 @@ enum RsaKeyType
 };
 
 
+/**
+ * \brief Format souboru s RSA klicem.
+ */
+enum RsaKeyFormat
+{
+	RSA_KEY_FORMAT_TEXT,   // Textovy format (hex + Base64)
+	RSA_KEY_FORMAT_BINARY  // Binarni format (viz RsaKey.cc)
+};
+
+
 /**
  * \brief Trida reprezentujici Rsa klic.
  *
@@ -60,14 +70,44 @@ public:
 
 	/**
 	 * \brief Ulozi klic do souboru.
+	 *
+	 * \param filename Nazev souboru.
+	 * \param format   Format souboru. Binarni format obsahuje i predpocitane
+	 *  konstanty pro Montgomeryho nasobeni.
 	 */
-	bool SaveKeyToFile( const char* filename );
+	bool SaveKeyToFile( const char* filename,
+	                    RsaKeyFormat format = RSA_KEY_FORMAT_TEXT );
 
 	/**
 	 * \brief Nacte klic ze souboru.
+	 *
+	 * Format souboru (textovy nebo binarni) je rozpoznan automaticky.
 	 */
 	bool LoadKeyFromFile( const char* filename );
 
+	/**
+	 * \brief Predpocita konstanty pro Montgomeryho nasobeni modulo N.
+	 *
+	 * Pokud uz jsou konstanty spocitane (napr. nactene z binarniho
+	 * souboru), funkce nic nedela.
+	 */
+	void Precompute( void );
+
+	/**
+	 * \brief Testuje zda-li ma klic predpocitane Montgomeryho konstanty.
+	 */
+	bool HasMontgomery( void ) const { return mHasMontgomery; };
+
+	/**
+	 * \brief Vraci konstantu -N^(-1) mod 2^32.
+	 */
+	uint32_t GetNInv( void ) const { return mNInv; };
+
+	/**
+	 * \brief Vraci konstantu R^2 mod N.
+	 */
+	const BigNum& GetRR( void ) const { return mRR; };
+
 	/**
 	 * \brief Zkontroluje zda-li je klic platny.
 	 *
@@ -118,6 +158,22 @@ public:
 	 */
 	void SetKeyType( RsaKeyType keyType ) { mKeyType = keyType; };
 
+	/**
+	 * \brief Vraci otisk klice.
+	 *
+	 * Otisk je 64bitovy FNV-1a hash modulu a verejneho exponentu
+	 * v hexadecimalnim tvaru. Slouzi k identifikaci klice, nikoliv
+	 * jako kryptograficky hash.
+	 *
+	 * \return Otisk klice (16 hexadecimalnich znaku).
+	 */
+	std::string GetFingerprint( void ) const;
+
+	/**
+	 * \brief Vraci priblizne mnozstvi pameti, kterou klic zabira (v bytech).
+	 */
+	size_t GetMemorySize( void ) const;
+
 	/**
 	 * \brief Vraci velikost modulusu klice v bitech.
 	 * 
@@ -177,6 +233,24 @@ private:
 	 * Vetsinou ma hodnotu 3 nebo 65537.
 	 */
 	BigNum     mE;
+
+	/**
+	 * \brief Montgomery - priznak platnosti konstant mNInv a mRR.
+	 */
+	bool       mHasMontgomery;
+
+	/**
+	 * \brief Montgomery - konstanta -N^(-1) mod 2^32.
+	 */
+	uint32_t   mNInv;
+
+	/**
+	 * \brief Montgomery - konstanta R^2 mod N.
+	 */
+	BigNum     mRR;
+
+	bool LoadBinaryKey( const char* pData, size_t dataSize );
+	bool SaveBinaryKey( const char* pFilename );
 };
 
 
@@ -0,0 +1,542 @@
+/*
+ * RsaKeyStore.cc - Uloziste (keyring) RSA klicu s pametovou cache.
+ *
+ * Copyright (c) 2006 Jiri Zajpt, <jzajpt@blueberry.cz>
+ */
+
+#include <iostream>
+#include <string>
+#include <cstring>
+#include <vector>
+#include <dirent.h>
+#include <sys/stat.h>
+#include "../BigNum/BigNum.h"
+#include "RsaKey.h"
+#include "RsaKeyStore.h"
+
+
+/**
+ * \brief Hash nazvu klice (FNV-1a).
+ */
+static size_t
+HashName( const std::string& rName )
+{
+	uint64_t hash = 0xcbf29ce484222325ULL;
+	size_t   i;
+
+	for ( i = 0 ; i < rName.length() ; i++ )
+	{
+		hash ^= static_cast< uint8_t >( rName[ i ] );
+		hash *= 0x100000001b3ULL;
+	}
+
+	return static_cast< size_t >( hash ^ ( hash >> 32 ) );
+}
+
+
+/**
+ * \brief Vraci nazev souboru bez adresare a pripony.
+ */
+static std::string
+FileNameToId( const std::string& rFileName )
+{
+	std::string name = rFileName;
+	size_t      pos  = name.rfind( '/' );
+
+	if ( pos != std::string::npos )
+		name = name.substr( pos + 1 );
+
+	pos = name.rfind( '.' );
+	if ( pos != std::string::npos && pos != 0 )
+		name = name.substr( 0, pos );
+
+	return name;
+}
+
+
+static bool
+IsRegularFile( const std::string& rPath )
+{
+	struct stat st;
+	return stat( rPath.c_str(), &st ) == 0 && S_ISREG( st.st_mode );
+}
+
+
+/**
+ * \brief Zamek uloziste drzeny po dobu platnosti objektu.
+ *
+ * Mutex se uvolni i pri vyjimce. Unlock() a Lock() dovoli cast prace
+ * (nacitani klice z disku) udelat mimo zamek.
+ */
+class RsaKeyStoreLock
+{
+public:
+	explicit RsaKeyStoreLock( pthread_mutex_t* pMutex ) : mpMutex( pMutex ), mLocked( false ) { Lock(); };
+	~RsaKeyStoreLock() { if ( mLocked ) Unlock(); };
+
+	void Lock( void ) { pthread_mutex_lock( mpMutex ); mLocked = true; };
+	void Unlock( void ) { pthread_mutex_unlock( mpMutex ); mLocked = false; };
+
+private:
+	RsaKeyStoreLock( const RsaKeyStoreLock& );
+	RsaKeyStoreLock& operator = ( const RsaKeyStoreLock& );
+
+	pthread_mutex_t* mpMutex;
+	bool             mLocked;
+};
+
+
+RsaKeyHandle::RsaKeyHandle( const RsaKeyHandle& rFrom )
+	: mpBlock( rFrom.mpBlock )
+{
+	if ( mpBlock )
+		__sync_fetch_and_add( &mpBlock->mRefs, 1 );
+}
+
+
+RsaKeyHandle::~RsaKeyHandle()
+{
+	Release();
+}
+
+
+RsaKeyHandle&
+RsaKeyHandle::operator = ( const RsaKeyHandle& rFrom )
+{
+	if ( this == &rFrom )
+		return *this;
+
+	if ( rFrom.mpBlock )
+		__sync_fetch_and_add( &rFrom.mpBlock->mRefs, 1 );
+
+	Release();
+	mpBlock = rFrom.mpBlock;
+
+	return *this;
+}
+
+
+void
+RsaKeyHandle::Release( void )
+{
+	// Blok uvolni az uloziste (Collect), tady jen snizime pocitadlo.
+	if ( mpBlock )
+		__sync_fetch_and_sub( &mpBlock->mRefs, 1 );
+	mpBlock = NULL;
+}
+
+
+RsaKeyStore::RsaKeyStore( const char* pDirectory, size_t memoryBudget,
+                          size_t maxKeys )
+	: mDirectory( pDirectory ? pDirectory : "." ),
+	mMemoryBudget( memoryBudget ), mMaxKeys( maxKeys ), mResidentUsage( 0 ), mMemoryUsage( 0 ),
+	mpSlots( NULL ), mSlotMask( 0 ), mClock( 0 ), mEpoch( 0 )
+{
+	// Kazdy klic ma v tabulce dva zaznamy (id a otisk), tabulku
+	// drzime nejvyse z poloviny plnou (pocet klicu hlida AddEntry).
+	size_t slots = 16;
+	while ( slots < maxKeys * 4 )
+		slots <<= 1;
+
+	mpSlots = new Alias*[ slots ];
+	memset( ( void* ) mpSlots, 0, slots * sizeof( Alias* ) );
+	mSlotMask = slots - 1;
+
+	mReaders[ 0 ] = 0;
+	mReaders[ 1 ] = 0;
+
+	pthread_mutex_init( &mMutex, NULL );
+}
+
+
+RsaKeyStore::~RsaKeyStore()
+{
+	size_t i;
+
+	for ( i = 0 ; i <= mSlotMask ; i++ )
+		delete mpSlots[ i ];
+	delete[] mpSlots;
+
+	for ( i = 0 ; i < mEntries.size() ; i++ )
+	{
+		delete mEntries[ i ]->mpBlock;
+		delete mEntries[ i ];
+	}
+
+	for ( i = 0 ; i < mRetired.size() ; i++ )
+		delete mRetired[ i ];
+
+	pthread_mutex_destroy( &mMutex );
+}
+
+
+size_t
+RsaKeyStore::Scan( void )
+{
+	DIR* pDir = opendir( mDirectory.c_str() );
+	if ( !pDir )
+		throw UnableToOpenFileException( "Nepodarilo se otevrit adresar", mDirectory );
+
+	// Adresar projdeme mimo zamek a zavreme ho i pri vyjimce
+	std::vector< std::string > names;
+	struct dirent*             pEntry;
+
+	try
+	{
+		while ( ( pEntry = readdir( pDir ) ) != NULL )
+		{
+			if ( pEntry->d_name[ 0 ] != '.' )
+				names.push_back( pEntry->d_name );
+		}
+	}
+	catch ( ... )
+	{
+		closedir( pDir );
+		throw;
+	}
+
+	closedir( pDir );
+
+	RsaKeyStoreLock lock( &mMutex );
+	size_t          i;
+
+	for ( i = 0 ; i < names.size() ; i++ )
+	{
+		std::string path = mDirectory + "/" + names[ i ];
+		if ( !IsRegularFile( path ) )
+			continue;
+
+		std::string id = FileNameToId( names[ i ] );
+		if ( FindAlias( id ) == NULL && AddEntry( id, path ) == NULL )
+			break;
+	}
+
+	return mEntries.size();
+}
+
+
+size_t
+RsaKeyStore::GetKeyCount( void ) const
+{
+	RsaKeyStoreLock lock( &mMutex );
+
+	return mEntries.size();
+}
+
+
+RsaKeyHandle
+RsaKeyStore::Acquire( const std::string& rId )
+{
+	// Rychla cesta - klic uz je nacteny.
+	RsaKeyBlock* pBlock = Lookup( rId );
+	if ( pBlock )
+		return RsaKeyHandle( pBlock );
+
+	// Pomala cesta - klic musime najit a nacist z disku.
+	RsaKeyStoreLock lock( &mMutex );
+
+	Alias* pAlias = FindAlias( rId );
+	Entry* pEntry = pAlias ? pAlias->mpEntry : NULL;
+
+	if ( pEntry == NULL && rId.find( '/' ) == std::string::npos )
+	{
+		const char* extensions[] = { "", ".key", ".bin" };
+		size_t      i;
+
+		for ( i = 0 ; i < sizeof( extensions ) / sizeof( extensions[ 0 ] ) ; i++ )
+		{
+			std::string path = mDirectory + "/" + rId + extensions[ i ];
+			if ( IsRegularFile( path ) )
+			{
+				pEntry = AddEntry( rId, path );
+				break;
+			}
+		}
+	}
+
+	// Klic neexistuje nebo je uloziste plne
+	if ( pEntry == NULL )
+		return RsaKeyHandle();
+
+	if ( pEntry->mpBlock == NULL )
+	{
+		// Klic nacteme mimo zamek, aby nacitani neblokovalo ostatni.
+		std::string path = pEntry->mPath;
+		lock.Unlock();
+
+		pBlock = new RsaKeyBlock;
+		pBlock->mRefs = 0;
+		pBlock->mRetireEpoch = 0;
+
+		bool loaded = false;
+		try
+		{
+			loaded = pBlock->mKey.LoadKeyFromFile( path.c_str() );
+		}
+		catch ( Exception& e )
+		{
+			loaded = false;
+		}
+
+		if ( !loaded )
+		{
+			delete pBlock;
+			return RsaKeyHandle();
+		}
+
+		pBlock->mKey.Precompute();
+		pBlock->mMemSize = pBlock->mKey.GetMemorySize();
+
+		lock.Lock();
+		if ( pEntry->mpBlock == NULL )
+		{
+			Publish( pEntry, pBlock );
+			Evict( pEntry );
+		}
+		else
+			delete pBlock;
+	}
+
+	// Pod zamkem nemuze byt blok vyrazen, referenci tedy ziskame primo.
+	pBlock = pEntry->mpBlock;
+	__sync_fetch_and_add( &pBlock->mRefs, 1 );
+	pEntry->mLastUse = __sync_add_and_fetch( &mClock, 1 );
+
+	CollectLocked();
+
+	return RsaKeyHandle( pBlock );
+}
+
+
+bool
+RsaKeyStore::AddKey( const std::string& rId, const RsaKey& rKey )
+{
+	RsaKeyStoreLock lock( &mMutex );
+
+	if ( FindAlias( rId ) != NULL )
+		return false;
+
+	Entry* pEntry = AddEntry( rId, "" );
+	if ( pEntry == NULL )
+		return false;
+
+	RsaKeyBlock* pBlock = new RsaKeyBlock;
+	pBlock->mKey = rKey;
+	pBlock->mKey.Precompute();
+	pBlock->mRefs = 0;
+	pBlock->mRetireEpoch = 0;
+	pBlock->mMemSize = pBlock->mKey.GetMemorySize();
+
+	pEntry->mPinned = true;
+	Publish( pEntry, pBlock );
+
+	return true;
+}
+
+
+void
+RsaKeyStore::Collect( void )
+{
+	RsaKeyStoreLock lock( &mMutex );
+	CollectLocked();
+}
+
+
+RsaKeyBlock*
+RsaKeyStore::Lookup( const std::string& rId )
+{
+	//
+	// Ctenar se nejdrive zapise do pocitadla aktualni epochy. Dokud je
+	// v nem zapsany, nemuze byt uvolnen zadny blok, ktery mohl videt.
+	//
+	unsigned int idx = mEpoch & 1;
+	__sync_fetch_and_add( &mReaders[ idx ], 1 );
+
+	RsaKeyBlock* pBlock = NULL;
+	Alias*       pAlias = FindAlias( rId );
+
+	if ( pAlias )
+	{
+		Entry* pEntry = pAlias->mpEntry;
+
+		pBlock = pEntry->mpBlock;
+		if ( pBlock )
+		{
+			__sync_fetch_and_add( &pBlock->mRefs, 1 );
+			pEntry->mLastUse = __sync_add_and_fetch( &mClock, 1 );
+		}
+	}
+
+	__sync_fetch_and_sub( &mReaders[ idx ], 1 );
+
+	return pBlock;
+}
+
+
+RsaKeyStore::Alias*
+RsaKeyStore::FindAlias( const std::string& rName ) const
+{
+	size_t i = HashName( rName ) & mSlotMask;
+	Alias* pAlias;
+
+	while ( ( pAlias = mpSlots[ i ] ) != NULL )
+	{
+		if ( pAlias->mName == rName )
+			return pAlias;
+		i = ( i + 1 ) & mSlotMask;
+	}
+
+	return NULL;
+}
+
+
+bool
+RsaKeyStore::InsertAlias( const std::string& rName, Entry* pEntry )
+{
+	size_t i     = HashName( rName ) & mSlotMask;
+	size_t count = 0;
+
+	while ( mpSlots[ i ] != NULL )
+	{
+		if ( mpSlots[ i ]->mName == rName )
+			return false;
+		i = ( i + 1 ) & mSlotMask;
+
+		// Pri dodrzenem mMaxKeys nenastane, tabulka je nejvyse z poloviny plna
+		if ( ++count > mSlotMask )
+			return false;
+	}
+
+	Alias* pAlias = new Alias;
+	pAlias->mName = rName;
+	pAlias->mpEntry = pEntry;
+
+	// Zaznam musi byt cely zapsany drive nez jej zverejnime.
+	__sync_synchronize();
+	mpSlots[ i ] = pAlias;
+
+	return true;
+}
+
+
+RsaKeyStore::Entry*
+RsaKeyStore::AddEntry( const std::string& rId, const std::string& rPath )
+{
+	if ( mEntries.size() >= mMaxKeys )
+		return NULL;
+
+	Entry* pEntry = new Entry;
+
+	pEntry->mId = rId;
+	pEntry->mPath = rPath;
+	pEntry->mpBlock = NULL;
+	pEntry->mLastUse = 0;
+	pEntry->mPinned = false;
+
+	if ( !InsertAlias( rId, pEntry ) )
+	{
+		delete pEntry;
+
+		Alias* pAlias = FindAlias( rId );
+		return pAlias ? pAlias->mpEntry : NULL;
+	}
+
+	mEntries.push_back( pEntry );
+
+	return pEntry;
+}
+
+
+void
+RsaKeyStore::Publish( Entry* pEntry, RsaKeyBlock* pBlock )
+{
+	mResidentUsage += pBlock->mMemSize;
+	mMemoryUsage += pBlock->mMemSize;
+
+	__sync_synchronize();
+	pEntry->mpBlock = pBlock;
+	pEntry->mLastUse = __sync_add_and_fetch( &mClock, 1 );
+
+	// Klic bude dohledatelny i podle otisku.
+	InsertAlias( pBlock->mKey.GetFingerprint(), pEntry );
+}
+
+
+void
+RsaKeyStore::Evict( Entry* pKeep )
+{
+	while ( mResidentUsage > mMemoryBudget )
+	{
+		Entry* pVictim = NULL;
+		size_t i;
+
+		// Najdeme nejdele nepouzity nacteny klic.
+		for ( i = 0 ; i < mEntries.size() ; i++ )
+		{
+			Entry* pEntry = mEntries[ i ];
+
+			if ( pEntry == pKeep || pEntry->mPinned || pEntry->mpBlock == NULL )
+				continue;
+			if ( pVictim == NULL || pEntry->mLastUse < pVictim->mLastUse )
+				pVictim = pEntry;
+		}
+
+		if ( pVictim == NULL )
+			break;
+
+		RsaKeyBlock* pBlock = pVictim->mpBlock;
+
+		pVictim->mpBlock = NULL;
+		__sync_synchronize();
+
+		pBlock->mRetireEpoch = mEpoch;
+		mResidentUsage -= pBlock->mMemSize;
+		mRetired.push_back( pBlock );
+	}
+}
+
+
+void
+RsaKeyStore::CollectLocked( void )
+{
+	if ( mRetired.empty() )
+		return;
+
+	//
+	// Ctenari predchozi epochy jsou v pocitadle opacne parity. Pokud je
+	// nulove, zadny ctenar uz nemuze drzet ukazatel na blok vyrazeny
+	// pred zacatkem aktualni epochy (krome tech, kteri si drzi referenci).
+	//
+	unsigned int epoch = mEpoch;
+	if ( mReaders[ ( epoch + 1 ) & 1 ] != 0 )
+		return;
+
+	bool   pending = false;
+	size_t i = 0;
+
+	while ( i < mRetired.size() )
+	{
+		RsaKeyBlock* pBlock = mRetired[ i ];
+
+		if ( pBlock->mRetireEpoch != epoch && pBlock->mRefs == 0 )
+		{
+			mMemoryUsage -= pBlock->mMemSize;
+			delete pBlock;
+			mRetired[ i ] = mRetired.back();
+			mRetired.pop_back();
+			continue;
+		}
+
+		if ( pBlock->mRetireEpoch == epoch )
+			pending = true;
+		i++;
+	}
+
+	// Bloky vyrazene v teto epose uvolnime az po jejim skonceni.
+	if ( pending )
+	{
+		__sync_synchronize();
+		mEpoch = epoch + 1;
+		__sync_synchronize();
+	}
+}
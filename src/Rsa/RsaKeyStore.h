@@ -0,0 +1,206 @@
+/*
+ * RsaKeyStore.h - Uloziste (keyring) RSA klicu s pametovou cache.
+ *
+ * Copyright (c) 2006 Jiri Zajpt, <jzajpt@blueberry.cz>
+ */
+
+#ifndef _RSA_RSAKEYSTORE__H
+#define _RSA_RSAKEYSTORE__H
+
+
+#include <string>
+#include <vector>
+#include <pthread.h>
+#include "../Common/Types.h"
+#include "../Common/Exceptions.h"
+
+
+/**
+ * \brief Nacteny klic v ulozisti spolu s pocitadlem referenci.
+ */
+struct RsaKeyBlock
+{
+	RsaKey        mKey;
+	volatile long mRefs;
+	size_t        mMemSize;
+	unsigned int  mRetireEpoch;
+};
+
+
+/**
+ * \brief Reference na klic v ulozisti RsaKeyStore.
+ *
+ * Dokud existuje alespon jedna reference, klic nebude uvolnen, a to
+ * ani v pripade, ze jej uloziste mezitim vyradi z cache.
+ *
+ * \author Jiri Zajpt
+ */
+class RsaKeyHandle
+{
+public:
+	/**
+	 * \brief Implicitni konstruktor. Vytvori neplatnou referenci.
+	 */
+	RsaKeyHandle() : mpBlock( NULL ) {};
+
+	RsaKeyHandle( const RsaKeyHandle& rFrom );
+
+	~RsaKeyHandle();
+
+	RsaKeyHandle& operator = ( const RsaKeyHandle& rFrom );
+
+	const RsaKey* operator -> () const { return &mpBlock->mKey; };
+
+	const RsaKey& operator * () const { return mpBlock->mKey; };
+
+	/**
+	 * \brief Testuje zda-li reference ukazuje na klic.
+	 */
+	bool IsValid( void ) const { return mpBlock != NULL; };
+
+private:
+	friend class RsaKeyStore;
+
+	/**
+	 * \brief Prevezme jiz zapocitanou referenci na blok.
+	 */
+	explicit RsaKeyHandle( RsaKeyBlock* pBlock ) : mpBlock( pBlock ) {};
+
+	void Release( void );
+
+	RsaKeyBlock* mpBlock;
+};
+
+
+/**
+ * \brief Uloziste RSA klicu indexovane podle id nebo otisku.
+ *
+ * Klice se nacitaji az pri prvnim pouziti ze souboru v danem adresari
+ * (id je nazev souboru bez pripony) a drzi se v pameti uz rozparsovane
+ * a s predpocitanymi konstantami. Pokud celkova velikost nactenych klicu
+ * prekroci pametovy limit, jsou z pameti vyrazeny nejdele nepouzite klice.
+ *
+ * Vyhledani jiz nacteneho klice (Acquire) je bez zamku: tabulka id ma
+ * pevnou velikost a zaznamy se do ni pouze pridavaji, vyrazene klice se
+ * uvolnuji az ve chvili, kdy je zadny ctenar nemuze drzet (dve epochy
+ * s pocitadly aktivnich ctenaru). Zamek se pouziva jen pri nacitani
+ * klice z disku a pri vyrazovani.
+ *
+ * Vsechny reference (RsaKeyHandle) musi byt uvolneny pred zrusenim
+ * uloziste.
+ *
+ * \author Jiri Zajpt
+ */
+class RsaKeyStore
+{
+public:
+	/**
+	 * \brief Konstruktor.
+	 *
+	 * \param pDirectory   Adresar s klici.
+	 * \param memoryBudget Maximalni velikost nactenych klicu v bytech.
+	 * \param maxKeys      Maximalni pocet klicu v ulozisti.
+	 */
+	RsaKeyStore( const char* pDirectory, size_t memoryBudget = 64 * 1024 * 1024,
+	             size_t maxKeys = 16384 );
+
+	/**
+	 * \brief Destruktor.
+	 */
+	~RsaKeyStore();
+
+	/**
+	 * \brief Zaindexuje vsechny soubory v adresari.
+	 *
+	 * Klice se pri tom nenacitaji. Volani neni nutne, klic, ktery
+	 * jeste neni v indexu, se pri Acquire() hleda primo na disku.
+	 * Zaindexuje se nejvyse maxKeys klicu, dalsi soubory se preskoci.
+	 *
+	 * \return Pocet klicu v indexu.
+	 */
+	size_t Scan( void );
+
+	/**
+	 * \brief Vrati referenci na klic podle id nebo otisku.
+	 *
+	 * Podle otisku lze hledat klic, ktery uz byl alespon jednou nacten.
+	 *
+	 * \param rId Id klice (nazev souboru bez pripony) nebo jeho otisk.
+	 *
+	 * \return Reference na klic, pripadne neplatna reference pokud klic
+	 *  neexistuje, nelze jej nacist nebo uz je v ulozisti maxKeys klicu.
+	 */
+	RsaKeyHandle Acquire( const std::string& rId );
+
+	/**
+	 * \brief Vlozi do uloziste klic, ktery neni ulozen na disku.
+	 *
+	 * Takovy klic neni nikdy vyrazen z pameti.
+	 *
+	 * \return True pokud se klic podarilo vlozit, false pokud uz klic
+	 *  s danym id existuje nebo je uloziste plne.
+	 */
+	bool AddKey( const std::string& rId, const RsaKey& rKey );
+
+	/**
+	 * \brief Uvolni vyrazene klice, na ktere jiz neexistuje reference.
+	 */
+	void Collect( void );
+
+	/**
+	 * \brief Vraci velikost pameti zabrane klici (v bytech).
+	 */
+	size_t GetMemoryUsage( void ) const { return mMemoryUsage; };
+
+	/**
+	 * \brief Vraci pocet klicu v indexu.
+	 */
+	size_t GetKeyCount( void ) const;
+
+private:
+	struct Entry
+	{
+		std::string           mId;
+		std::string           mPath;
+		RsaKeyBlock* volatile mpBlock;
+		volatile uint64_t     mLastUse;
+		bool                  mPinned;
+	};
+
+	struct Alias
+	{
+		std::string mName;
+		Entry*      mpEntry;
+	};
+
+	RsaKeyStore( const RsaKeyStore& );
+	RsaKeyStore& operator = ( const RsaKeyStore& );
+
+	RsaKeyBlock* Lookup( const std::string& rId );
+	Alias*       FindAlias( const std::string& rName ) const;
+	bool         InsertAlias( const std::string& rName, Entry* pEntry );
+	Entry*       AddEntry( const std::string& rId, const std::string& rPath );
+	void         Publish( Entry* pEntry, RsaKeyBlock* pBlock );
+	void         Evict( Entry* pKeep );
+	void         CollectLocked( void );
+
+	std::string                 mDirectory;
+	size_t                      mMemoryBudget;
+	size_t                      mMaxKeys;
+	size_t                      mResidentUsage;
+	volatile size_t             mMemoryUsage;
+
+	Alias* volatile*            mpSlots;
+	size_t                      mSlotMask;
+	std::vector< Entry* >       mEntries;
+	std::vector< RsaKeyBlock* > mRetired;
+
+	volatile uint64_t           mClock;
+	volatile unsigned int       mEpoch;
+	volatile long               mReaders[ 2 ];
+
+	mutable pthread_mutex_t     mMutex;
+};
+
+
+#endif // _RSA_RSAKEYSTORE__H
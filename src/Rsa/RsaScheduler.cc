@@ -0,0 +1,391 @@
+/*
+ * RsaScheduler.cc - Slucovani soukromych RSA operaci z vice vlaken.
+ *
+ * Copyright (c) 2006 Jiri Zajpt, <jzajpt@blueberry.cz>
+ */
+
+#include <iostream>
+#include <string>
+#include <ctime>
+#include "../BigNum/BigNum.h"
+#include "RsaKey.h"
+#include "Rsa.h"
+#include "RsaKeyStore.h"
+#include "RsaScheduler.h"
+
+
+/**
+ * \brief Sdileny stav jednoho pozadavku.
+ */
+struct RsaRequestState
+{
+	volatile long   mRefs;
+	pthread_mutex_t mMutex;
+	pthread_cond_t  mDone;
+	volatile bool   mReady;
+	bool            mFailed;
+	uint64_t        mSubmitTime;
+	BigNum          mInput;
+	std::string     mResult; // Vysledek, pri chybe popis chyby
+};
+
+
+static void
+ReleaseState( RsaRequestState* pState )
+{
+	if ( pState && __sync_sub_and_fetch( &pState->mRefs, 1 ) == 0 )
+	{
+		pthread_cond_destroy( &pState->mDone );
+		pthread_mutex_destroy( &pState->mMutex );
+		delete pState;
+	}
+}
+
+
+/**
+ * \brief Vraci monotonni cas v mikrosekundach.
+ */
+static uint64_t
+NowMicroseconds( void )
+{
+	struct timespec ts;
+	clock_gettime( CLOCK_MONOTONIC, &ts );
+
+	return static_cast< uint64_t >( ts.tv_sec ) * 1000000 + ts.tv_nsec / 1000;
+}
+
+
+RsaFuture::RsaFuture( const RsaFuture& rFrom )
+	: mpState( rFrom.mpState )
+{
+	if ( mpState )
+		__sync_add_and_fetch( &mpState->mRefs, 1 );
+}
+
+
+RsaFuture::~RsaFuture()
+{
+	ReleaseState( mpState );
+}
+
+
+RsaFuture&
+RsaFuture::operator = ( const RsaFuture& rFrom )
+{
+	if ( rFrom.mpState )
+		__sync_add_and_fetch( &rFrom.mpState->mRefs, 1 );
+	ReleaseState( mpState );
+	mpState = rFrom.mpState;
+
+	return *this;
+}
+
+
+bool
+RsaFuture::IsReady( void ) const
+{
+	if ( !mpState )
+		return false;
+
+	__sync_synchronize();
+	return mpState->mReady;
+}
+
+
+void
+RsaFuture::Wait( void ) const
+{
+	if ( !mpState )
+		throw Exception( "RsaFuture::Wait(): Neplatny pozadavek!" );
+
+	pthread_mutex_lock( &mpState->mMutex );
+	while ( !mpState->mReady )
+		pthread_cond_wait( &mpState->mDone, &mpState->mMutex );
+	pthread_mutex_unlock( &mpState->mMutex );
+}
+
+
+const std::string&
+RsaFuture::Get( void ) const
+{
+	Wait();
+
+	if ( mpState->mFailed )
+		throw Exception( mpState->mResult );
+
+	return mpState->mResult;
+}
+
+
+/**
+ * \brief Ukol pro pracovni vlakno: zpracuje jednu davku.
+ */
+class RsaBatchTask : public ThreadTask
+{
+public:
+	RsaBatchTask( RsaScheduler* pScheduler, RsaScheduler::Batch* pBatch )
+		: mpScheduler( pScheduler ), mpBatch( pBatch ) {};
+
+	virtual void Run( void )
+	{
+		std::vector< RsaRequestState* >& rRequests = mpBatch->mRequests;
+		size_t count = rRequests.size();
+		size_t i;
+
+		std::vector< BigNum > values( count );
+		for ( i = 0 ; i < count ; i++ )
+			values[ i ] = rRequests[ i ]->mInput;
+
+		bool        failed = false;
+		std::string error;
+		try
+		{
+			Rsa::PrivateOperationBatch( *mpBatch->mpKey, &values[ 0 ], &values[ 0 ], count );
+		}
+		catch ( Exception& e )
+		{
+			failed = true;
+			error  = e.mMessage;
+		}
+
+		for ( i = 0 ; i < count ; i++ )
+		{
+			RsaRequestState* pState = rRequests[ i ];
+
+			if ( failed )
+				pState->mResult = error;
+			else
+			{
+				// Stejne jako BigNumToString() - jen aktivni byty
+				size_t size = values[ i ].GetActiveBytes();
+
+				pState->mResult.resize( size );
+				if ( size != 0 )
+					values[ i ].ToBytes( &pState->mResult[ 0 ] );
+			}
+
+			pthread_mutex_lock( &pState->mMutex );
+			pState->mFailed = failed;
+			pState->mReady  = true;
+			pthread_cond_broadcast( &pState->mDone );
+			pthread_mutex_unlock( &pState->mMutex );
+
+			ReleaseState( pState );
+		}
+
+		delete mpBatch;
+		mpScheduler->BatchDone( count );
+	};
+
+private:
+	RsaScheduler*        mpScheduler;
+	RsaScheduler::Batch* mpBatch;
+};
+
+
+RsaScheduler::RsaScheduler( size_t maxBatch, unsigned int windowUs,
+                            unsigned int maxLatencyUs, size_t threads )
+	: mMaxBatch( maxBatch ? maxBatch : 1 ), mWindow( windowUs ),
+	  mMaxLatency( maxLatencyUs ), mPool( threads ), mStop( false ),
+	  mInFlight( 0 ), mRequestCount( 0 ), mBatchCount( 0 )
+{
+	if ( mWindow > mMaxLatency )
+		mWindow = mMaxLatency;
+
+	pthread_mutex_init( &mMutex, NULL );
+
+	// Casy jsou monotonni, stejne musi byt hodiny podminky
+	pthread_condattr_t attr;
+	pthread_condattr_init( &attr );
+	pthread_condattr_setclock( &attr, CLOCK_MONOTONIC );
+	pthread_cond_init( &mWakeup, &attr );
+	pthread_condattr_destroy( &attr );
+
+	if ( pthread_create( &mDispatcher, NULL, DispatcherMain, this ) != 0 )
+		throw Exception( "RsaScheduler: Nepodarilo se vytvorit vlakno!" );
+}
+
+
+RsaScheduler::~RsaScheduler()
+{
+	pthread_mutex_lock( &mMutex );
+	mStop = true;
+	pthread_cond_signal( &mWakeup );
+	pthread_mutex_unlock( &mMutex );
+
+	// Planovac pri ukonceni odesle vsechny cekajici davky
+	pthread_join( mDispatcher, NULL );
+	mPool.Wait();
+
+	pthread_cond_destroy( &mWakeup );
+	pthread_mutex_destroy( &mMutex );
+}
+
+
+RsaFuture
+RsaScheduler::SubmitDecrypt( const RsaKey& rKey, const char* pBlock, size_t blockSize )
+{
+	return Submit( &rKey, RsaKeyHandle(), pBlock, blockSize );
+}
+
+
+RsaFuture
+RsaScheduler::SubmitDecrypt( const RsaKeyHandle& rKey, const char* pBlock, size_t blockSize )
+{
+	if ( !rKey.IsValid() )
+		throw Exception( "RsaScheduler::SubmitDecrypt(): Neplatny klic!" );
+
+	return Submit( &*rKey, rKey, pBlock, blockSize );
+}
+
+
+RsaFuture
+RsaScheduler::Submit( const RsaKey* pKey, const RsaKeyHandle& rHandle,
+                      const char* pBlock, size_t blockSize )
+{
+	if ( pKey->GetKeyType() != RSA_KEY_PRIVATE )
+		throw Exception( "Neplatny klic pro desifrovani!" );
+
+	RsaRequestState* pState = new RsaRequestState;
+	pState->mRefs   = 2; // RsaFuture + davka
+	pState->mReady  = false;
+	pState->mFailed = false;
+	pState->mInput  = StringToBigNum( pBlock, blockSize );
+	pthread_mutex_init( &pState->mMutex, NULL );
+	pthread_cond_init( &pState->mDone, NULL );
+
+	pthread_mutex_lock( &mMutex );
+
+	// Cas bereme pod zamkem, aby byly pozadavky v davce serazene
+	uint64_t now = NowMicroseconds();
+	pState->mSubmitTime = now;
+
+	Batch*& rpBatch = mPending[ pKey ];
+	if ( !rpBatch )
+	{
+		rpBatch          = new Batch;
+		rpBatch->mpKey   = pKey;
+		rpBatch->mHandle = rHandle;
+
+		// Novy nejstarsi pozadavek - planovac musi prepocitat termin
+		pthread_cond_signal( &mWakeup );
+	}
+	rpBatch->mRequests.push_back( pState );
+
+	// Plnou davku nebo davku, na kterou ceka volne vlakno, odesleme hned
+	if ( rpBatch->mRequests.size() >= mMaxBatch ||
+	     ( mWindow == 0 && mInFlight < mPool.GetThreadCount() ) )
+		DispatchLocked( now, false );
+
+	pthread_mutex_unlock( &mMutex );
+
+	return RsaFuture( pState );
+}
+
+
+uint64_t
+RsaScheduler::DispatchLocked( uint64_t now, bool all )
+{
+	std::map< const RsaKey*, Batch* >::iterator it;
+	size_t threads = mPool.GetThreadCount();
+
+	// Nejdrive davky, ktere se nesmi zdrzet (plne, po limitu zpozdeni).
+	// Ty jdou do fronty vlaken i bez volneho vlakna - dalsi pozadavky
+	// by je uz jen zvetsovaly, rychleji zpracovane by nebyly.
+	for ( it = mPending.begin() ; it != mPending.end() ; )
+	{
+		Batch*   pBatch = it->second;
+		uint64_t age    = now - pBatch->mRequests.front()->mSubmitTime;
+
+		if ( all || pBatch->mRequests.size() >= mMaxBatch || age >= mMaxLatency )
+		{
+			mPending.erase( it++ );
+			StartBatch( pBatch );
+		}
+		else
+			++it;
+	}
+
+	// Volna vlakna dostanou davky s nejstarsimi pozadavky.
+	while ( mInFlight < threads && !mPending.empty() )
+	{
+		std::map< const RsaKey*, Batch* >::iterator oldest = mPending.end();
+		for ( it = mPending.begin() ; it != mPending.end() ; ++it )
+			if ( oldest == mPending.end() ||
+			     it->second->mRequests.front()->mSubmitTime <
+			     oldest->second->mRequests.front()->mSubmitTime )
+				oldest = it;
+
+		if ( now - oldest->second->mRequests.front()->mSubmitTime < mWindow )
+			break;
+
+		Batch* pBatch = oldest->second;
+		mPending.erase( oldest );
+		StartBatch( pBatch );
+	}
+
+	// Termin, kdy bude nutne planovat znovu (0 = az s dalsim pozadavkem).
+	uint64_t deadline = 0;
+	uint64_t delay    = mInFlight < threads ? mWindow : mMaxLatency;
+	for ( it = mPending.begin() ; it != mPending.end() ; ++it )
+	{
+		uint64_t t = it->second->mRequests.front()->mSubmitTime + delay;
+		if ( deadline == 0 || t < deadline )
+			deadline = t;
+	}
+
+	return deadline;
+}
+
+
+void
+RsaScheduler::StartBatch( Batch* pBatch )
+{
+	mInFlight++;
+	mPool.Submit( new RsaBatchTask( this, pBatch ) );
+}
+
+
+void
+RsaScheduler::BatchDone( size_t requests )
+{
+	pthread_mutex_lock( &mMutex );
+	mInFlight--;
+	mRequestCount += requests;
+	mBatchCount++;
+
+	// Uvolnilo se vlakno, cekajici pozadavky mu muzeme dat hned
+	if ( !mPending.empty() )
+	{
+		DispatchLocked( NowMicroseconds(), false );
+		pthread_cond_signal( &mWakeup );
+	}
+	pthread_mutex_unlock( &mMutex );
+}
+
+
+void*
+RsaScheduler::DispatcherMain( void* pArg )
+{
+	RsaScheduler* pScheduler = static_cast< RsaScheduler* >( pArg );
+
+	pthread_mutex_lock( &pScheduler->mMutex );
+	while ( !pScheduler->mStop )
+	{
+		uint64_t deadline = pScheduler->DispatchLocked( NowMicroseconds(), false );
+
+		if ( deadline == 0 )
+			pthread_cond_wait( &pScheduler->mWakeup, &pScheduler->mMutex );
+		else
+		{
+			struct timespec ts;
+			ts.tv_sec  = deadline / 1000000;
+			ts.tv_nsec = ( deadline % 1000000 ) * 1000;
+			pthread_cond_timedwait( &pScheduler->mWakeup, &pScheduler->mMutex, &ts );
+		}
+	}
+	pScheduler->DispatchLocked( NowMicroseconds(), true );
+	pthread_mutex_unlock( &pScheduler->mMutex );
+
+	return NULL;
+}
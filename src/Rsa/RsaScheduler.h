@@ -0,0 +1,187 @@
+/*
+ * RsaScheduler.h - Slucovani soukromych RSA operaci z vice vlaken.
+ *
+ * Copyright (c) 2006 Jiri Zajpt, <jzajpt@blueberry.cz>
+ */
+
+#ifndef _RSA_RSASCHEDULER__H
+#define _RSA_RSASCHEDULER__H
+
+
+#include <map>
+#include <string>
+#include <vector>
+#include <pthread.h>
+#include "../Common/Types.h"
+#include "../Common/ThreadPool.h"
+
+
+struct RsaRequestState;
+
+
+/**
+ * \brief Vysledek pozadavku zadaneho do RsaScheduler.
+ *
+ * Budouci hodnota - vlakno, ktere pozadavek zadalo, si na vysledek
+ * pocka metodou Get(). Kopie odkazuji na stejny pozadavek.
+ *
+ * \author Jiri Zajpt
+ */
+class RsaFuture
+{
+public:
+	/**
+	 * \brief Implicitni konstruktor. Vytvori neplatny vysledek.
+	 */
+	RsaFuture() : mpState( NULL ) {};
+
+	RsaFuture( const RsaFuture& rFrom );
+
+	~RsaFuture();
+
+	RsaFuture& operator = ( const RsaFuture& rFrom );
+
+	/**
+	 * \brief Testuje zda-li je pozadavek jiz zpracovany.
+	 */
+	bool IsReady( void ) const;
+
+	/**
+	 * \brief Pocka na zpracovani pozadavku.
+	 */
+	void Wait( void ) const;
+
+	/**
+	 * \brief Pocka na zpracovani pozadavku a vrati vysledek.
+	 *
+	 * Vysledek ma stejny obsah jako buffer vraceny Rsa::DecryptBlock(),
+	 * tj. byty desifrovaneho bloku bez nulovych bytu na konci.
+	 *
+	 * Pokud zpracovani selhalo, je vyhozena vyjimka Exception.
+	 */
+	const std::string& Get( void ) const;
+
+	/**
+	 * \brief Testuje zda-li vysledek odkazuje na pozadavek.
+	 */
+	bool IsValid( void ) const { return mpState != NULL; };
+
+private:
+	friend class RsaScheduler;
+
+	explicit RsaFuture( RsaRequestState* pState ) : mpState( pState ) {};
+
+	RsaRequestState* mpState;
+};
+
+
+/**
+ * \brief Planovac, ktery slucuje desifrovani bloku stejnym klicem.
+ *
+ * Vlakna aplikace zadavaji jednotlive bloky a dostanou RsaFuture.
+ * Pozadavky na stejny klic se sbiraji do davky, dokud neni davka plna,
+ * nejstarsi pozadavek v ni neceka dele nez je casove okno, nebo dokud
+ * nema davku kdo zpracovat (vsechna vlakna jsou obsazena). Davka se pak
+ * zpracuje najednou funkci Rsa::PrivateOperationBatch(), ktera priprava
+ * klice (konstanty pro CRT) provede jen jednou pro celou davku.
+ *
+ * Zadny pozadavek neceka ve fronte planovace dele nez maxLatency
+ * mikrosekund - pote je jeho davka odeslana do fronty ThreadPool i kdyz
+ * jsou vsechna vlakna obsazena. Limit tedy omezuje jen dobu sberu davky;
+ * ve fronte vlaken pak davka ceka, nez se uvolni vlakno, takze celkove
+ * zpozdeni pri pretizeni zavisi i na delce zpracovani davek pred ni.
+ * Okno sberu je vzdy nejvyse maxLatency.
+ *
+ * Pri nizke zatezi (volne vlakno) se s nulovym oknem pozadavky zpracuji
+ * hned, pri vysoke se samy skladaji do vetsich davek.
+ *
+ * \author Jiri Zajpt
+ */
+class RsaScheduler
+{
+public:
+	/**
+	 * \brief Konstruktor.
+	 *
+	 * \param maxBatch     Maximalni pocet pozadavku v davce.
+	 * \param windowUs     Jak dlouho se ceka na dalsi pozadavky do davky
+	 *                     (v mikrosekundach), i kdyz je volne vlakno.
+	 * \param maxLatencyUs Nejdelsi doba cekani pozadavku ve fronte planovace.
+	 * \param threads      Pocet pracovnich vlaken (0 = pocet procesoru).
+	 */
+	RsaScheduler( size_t maxBatch = 32, unsigned int windowUs = 0,
+	              unsigned int maxLatencyUs = 2000, size_t threads = 0 );
+
+	/**
+	 * \brief Destruktor. Zpracuje vsechny zadane pozadavky.
+	 */
+	~RsaScheduler();
+
+	/**
+	 * \brief Zada desifrovani jednoho bloku.
+	 *
+	 * Klic musi existovat, dokud neni pozadavek zpracovan. Pozadavky
+	 * se slucuji podle adresy klice.
+	 *
+	 * \param rKey       Soukromy klic.
+	 * \param pBlock     Zasifrovany blok.
+	 * \param blockSize  Velikost bloku v bytech.
+	 */
+	RsaFuture SubmitDecrypt( const RsaKey& rKey, const char* pBlock, size_t blockSize );
+
+	/**
+	 * \brief Zada desifrovani jednoho bloku klicem z uloziste.
+	 *
+	 * Reference na klic je drzena, dokud neni pozadavek zpracovan.
+	 */
+	RsaFuture SubmitDecrypt( const RsaKeyHandle& rKey, const char* pBlock, size_t blockSize );
+
+	/**
+	 * \brief Vraci pocet zpracovanych pozadavku.
+	 */
+	uint64_t GetRequestCount( void ) const { return mRequestCount; };
+
+	/**
+	 * \brief Vraci pocet zpracovanych davek.
+	 */
+	uint64_t GetBatchCount( void ) const { return mBatchCount; };
+
+private:
+	struct Batch
+	{
+		const RsaKey*                    mpKey;
+		RsaKeyHandle                     mHandle;
+		std::vector< RsaRequestState* >  mRequests;
+	};
+
+	friend class RsaBatchTask;
+
+	RsaScheduler( const RsaScheduler& );
+	RsaScheduler& operator = ( const RsaScheduler& );
+
+	RsaFuture Submit( const RsaKey* pKey, const RsaKeyHandle& rHandle,
+	                  const char* pBlock, size_t blockSize );
+	uint64_t  DispatchLocked( uint64_t now, bool all );
+	void      StartBatch( Batch* pBatch );
+	void      BatchDone( size_t requests );
+
+	static void* DispatcherMain( void* pArg );
+
+	size_t                              mMaxBatch;
+	uint64_t                            mWindow;
+	uint64_t                            mMaxLatency;
+
+	ThreadPool                          mPool;
+	pthread_t                           mDispatcher;
+	pthread_mutex_t                     mMutex;
+	pthread_cond_t                      mWakeup;
+	bool                                mStop;
+
+	std::map< const RsaKey*, Batch* >   mPending;
+	size_t                              mInFlight;
+	uint64_t                            mRequestCount;
+	uint64_t                            mBatchCount;
+};
+
+
+#endif // _RSA_RSASCHEDULER__H
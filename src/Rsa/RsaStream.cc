@@ -0,0 +1,497 @@
+/*
+ * RsaStream.cc - Postupne (proudove) sifrovani a desifrovani dat.
+ *
+ * Copyright (c) 2006 Jiri Zajpt, <jzajpt@blueberry.cz>
+ */
+
+#include <iostream>
+#include <string>
+#include <cstring>
+#include <algorithm>
+#include "../BigNum/BigNum.h"
+#include "../BigNum/NumberArena.h"
+#include "../Common/ChaCha20.h"
+#include "../Common/Base64.h"
+#include "RsaKey.h"
+#include "Rsa.h"
+#include "RsaStream.h"
+
+
+/*
+ * Format obalky (RSA_FILE_FORMAT_ENVELOPE), cisla jsou little-endian:
+ *
+ *   char     id[ 8 ]     "PMZ_ENV\0"
+ *   uint8_t  version     1
+ *   uint8_t  cipher      1 = ChaCha20
+ *   uint16_t keyBlocks   pocet RSA bloku s klicem pro ChaCha20
+ *   uint8_t  nonce[ 12 ]
+ *
+ * Za hlavickou nasleduje keyBlocks bloku o velikosti RSA klice, ktere
+ * obsahuji klic pro ChaCha20 ve stejnem formatu jako bloky souboru
+ * ([delka][data]). Zbytek souboru jsou data zasifrovana ChaCha20.
+ */
+static const char    cEnvelopeId[ 8 ]       = { 'P', 'M', 'Z', '_', 'E', 'N', 'V', 0 };
+static const uint8_t cEnvelopeVersion       = 1;
+static const uint8_t cEnvelopeCipherChaCha  = 1;
+static const size_t  cEnvelopeHeaderSize    = 24;
+static const size_t  cEnvelopeChunkSize     = 64 * 1024;
+
+
+/*
+ * Textova podoba (armor): radek s hlavickou a za nim zasifrovana data
+ * (v kteremkoliv formatu) v Base64 zalamovane po cBase64LineLength
+ * znacich. Hlavicka se rozpoznava podle prvnich sizeof( cEnvelopeId )
+ * znaku, zbytek radku se preskakuje.
+ */
+static const char    cArmorHeader[]         = "-- PMZ_RSA MESSAGE --\n";
+
+
+/**
+ * \brief Vraci pocet RSA bloku potrebnych pro klic ChaCha20.
+ */
+static size_t
+EnvelopeKeyBlocks( size_t keyByteSize )
+{
+	size_t inblockSize = keyByteSize - 2;
+
+	return ( ChaCha20::cKeySize + inblockSize - 1 ) / inblockSize;
+}
+
+
+void
+RsaFileSink::Write( const char* pData, size_t size )
+{
+	if ( fwrite( pData, 1, size, mpFile ) != size )
+		throw Exception( "RsaFileSink::Write(): Nepodarilo se zapsat data!" );
+}
+
+
+RsaEncryptStream::RsaEncryptStream( const RsaKey& rKey, RsaStreamSink& rSink,
+                                    RsaFileFormat format, bool armor )
+	: mrKey( rKey ), mrSink( rSink ), mFormat( format ),
+	  mKeyByteSize( rKey.GetKeySize() / 8 ), mpCipher( NULL ), mpArmor( NULL ),
+	  mStarted( false ), mFinished( false ), mInputSize( 0 )
+{
+	if ( mrKey.GetKeyType() == RSA_KEY_INVALID )
+		throw Exception( "Pro sifrovani je nutny platny klic!" );
+
+	/*
+	 * Budeme sifrovat po blocich, ktere budou mit velikost jako
+	 * nas klic minus dva znaky (tj. 16 bitu). Jeden byte zustava
+	 * nevyuzity, protoze by pak nemusela platit podminka P1 a prvni
+	 * byte bloku obsahuje delku dat v bloku.
+	 */
+	mBlock.reserve( mKeyByteSize );
+
+	if ( armor )
+		mpArmor = new Base64Encoder( cBase64LineLength );
+}
+
+
+RsaEncryptStream::~RsaEncryptStream()
+{
+	delete mpCipher;
+	delete mpArmor;
+}
+
+
+void
+RsaEncryptStream::Update( const char* pData, size_t size )
+{
+	if ( mFinished )
+		throw Exception( "RsaEncryptStream::Update(): Sifrovani jiz bylo dokonceno!" );
+
+	if ( !mStarted )
+		Start();
+
+	mInputSize += size;
+
+	if ( mFormat == RSA_FILE_FORMAT_ENVELOPE )
+	{
+		while ( size != 0 )
+		{
+			size_t n = std::min( size, cEnvelopeChunkSize );
+
+			mBuffer.resize( n );
+			mpCipher->Process( pData, &mBuffer[ 0 ], n );
+			Output( mBuffer.data(), n );
+
+			pData += n;
+			size  -= n;
+		}
+		return;
+	}
+
+	size_t inblockSize = mKeyByteSize - 2;
+	while ( size != 0 )
+	{
+		// Prvni byte bloku je delka dat, doplnime ho az pri sifrovani
+		if ( mBlock.empty() )
+			mBlock.push_back( '\0' );
+
+		size_t n = std::min( size, inblockSize - ( mBlock.size() - 1 ) );
+		mBlock.append( pData, n );
+		pData += n;
+		size  -= n;
+
+		if ( mBlock.size() - 1 == inblockSize )
+			EncryptBlock();
+	}
+}
+
+
+void
+RsaEncryptStream::Finish( void )
+{
+	if ( mFinished )
+		return;
+
+	if ( !mStarted )
+		Start();
+
+	if ( !mBlock.empty() )
+		EncryptBlock();
+
+	if ( mpArmor )
+	{
+		mpArmor->Finish( mArmorBuffer );
+		mrSink.Write( mArmorBuffer.data(), mArmorBuffer.length() );
+		mArmorBuffer.clear();
+	}
+
+	mFinished = true;
+}
+
+
+void
+RsaEncryptStream::Start( void )
+{
+	mStarted = true;
+
+	if ( mpArmor )
+		mrSink.Write( cArmorHeader, strlen( cArmorHeader ) );
+
+	if ( mFormat != RSA_FILE_FORMAT_ENVELOPE )
+		return;
+
+	size_t  inblockSize = mKeyByteSize - 2;
+	size_t  keyBlocks   = EnvelopeKeyBlocks( mKeyByteSize );
+	uint8_t key[ ChaCha20::cKeySize ];
+	uint8_t header[ cEnvelopeHeaderSize ];
+	size_t  i;
+
+	ChaCha20::GenerateRandom( key, sizeof( key ) );
+
+	memcpy( header, cEnvelopeId, sizeof( cEnvelopeId ) );
+	header[ 8 ]  = cEnvelopeVersion;
+	header[ 9 ]  = cEnvelopeCipherChaCha;
+	header[ 10 ] = static_cast< uint8_t >( keyBlocks );
+	header[ 11 ] = static_cast< uint8_t >( keyBlocks >> 8 );
+	ChaCha20::GenerateRandom( header + 12, ChaCha20::cNonceSize );
+
+	Output( reinterpret_cast< const char* >( header ), sizeof( header ) );
+
+	// Klic pro ChaCha20 zasifrujeme RSA po blocich jako bezna data
+	for ( i = 0 ; i < keyBlocks ; i++ )
+	{
+		size_t offset = i * inblockSize;
+		size_t n      = std::min( inblockSize, sizeof( key ) - offset );
+
+		mBlock.assign( 1, '\0' );
+		mBlock.append( reinterpret_cast< const char* >( key + offset ), n );
+		EncryptBlock();
+	}
+
+	mpCipher = new ChaCha20( key, header + 12 );
+	memset( key, 0, sizeof( key ) );
+}
+
+
+void
+RsaEncryptStream::EncryptBlock( void )
+{
+	// Na zacatek bloku vlozime jeho delku
+	mBlock[ 0 ] = static_cast< char >( mBlock.size() - 1 );
+
+	mBuffer.resize( mKeyByteSize );
+
+	// Docasna cisla bloku jsou v arene vlakna, v ustalenem stavu se
+	// tak pro blok nealokuje zadna pamet
+	{
+		NumberArenaScope arena;
+
+		BigNum m = StringToBigNum( mBlock.data(), mBlock.size() );
+		if ( m >= mrKey.GetN() )
+			throw Exception( "RsaEncryptStream: Vstupni data jsou prilis velka" );
+
+		BigNumToString( Rsa::PublicOperation( mrKey, m ), &mBuffer[ 0 ], mKeyByteSize );
+	}
+
+	Output( mBuffer.data(), mKeyByteSize );
+
+	mBlock.clear();
+}
+
+
+/**
+ * \brief Zapise zasifrovana data do cile (v textovem rezimu zakodovana).
+ */
+void
+RsaEncryptStream::Output( const char* pData, size_t size )
+{
+	if ( !mpArmor )
+	{
+		mrSink.Write( pData, size );
+		return;
+	}
+
+	mpArmor->Update( pData, size, mArmorBuffer );
+	mrSink.Write( mArmorBuffer.data(), mArmorBuffer.length() );
+	mArmorBuffer.clear();
+}
+
+
+RsaDecryptStream::RsaDecryptStream( const RsaKey& rKey, RsaStreamSink& rSink )
+	: mrKey( rKey ), mrSink( rSink ), mState( STATE_DETECT ),
+	  mKeyByteSize( rKey.GetKeySize() / 8 ), mNeeded( sizeof( cEnvelopeId ) ),
+	  mpCipher( NULL ), mpArmor( NULL ), mArmorHeader( false ),
+	  mFinished( false ), mInputSize( 0 )
+{
+	// Pokud mame neplatny nebo verejny klic => nemuzeme desifrovat
+	if ( ( mrKey.GetKeyType() == RSA_KEY_INVALID ) ||
+	     ( mrKey.GetKeyType() == RSA_KEY_PUBLIC ) )
+		throw Exception( "Neplatny klic pro desifrovani!" );
+}
+
+
+RsaDecryptStream::~RsaDecryptStream()
+{
+	delete mpCipher;
+	delete mpArmor;
+}
+
+
+void
+RsaDecryptStream::Update( const char* pData, size_t size )
+{
+	if ( mFinished )
+		throw Exception( "RsaDecryptStream::Update(): Desifrovani jiz bylo dokonceno!" );
+
+	mInputSize += size;
+
+	if ( mpArmor )
+		Dearmor( pData, size );
+	else
+		Process( pData, size );
+}
+
+
+/**
+ * \brief Dekoduje textovou podobu a preda data dal.
+ */
+void
+RsaDecryptStream::Dearmor( const char* pData, size_t size )
+{
+	// Zbytek radku s hlavickou preskocime
+	if ( mArmorHeader )
+	{
+		const char* pEnd = static_cast< const char* >( memchr( pData, '\n', size ) );
+		if ( !pEnd )
+			return;
+
+		size -= pEnd + 1 - pData;
+		pData = pEnd + 1;
+		mArmorHeader = false;
+	}
+
+	mpArmor->Update( pData, size, mArmorBuffer );
+	Process( mArmorBuffer.data(), mArmorBuffer.length() );
+	mArmorBuffer.clear();
+}
+
+
+/**
+ * \brief Zpracuje (binarni) zasifrovana data.
+ */
+void
+RsaDecryptStream::Process( const char* pData, size_t size )
+{
+	while ( size != 0 )
+	{
+		if ( mState == STATE_ENVELOPE_DATA )
+		{
+			size_t n = std::min( size, cEnvelopeChunkSize );
+
+			mBuffer.resize( n );
+			mpCipher->Process( pData, &mBuffer[ 0 ], n );
+			mrSink.Write( mBuffer.data(), n );
+
+			pData += n;
+			size  -= n;
+			continue;
+		}
+
+		// Ostatni stavy potrebuji mit pohromade mNeeded bytu
+		size_t n = std::min( size, mNeeded - mPending.size() );
+		mPending.append( pData, n );
+		pData += n;
+		size  -= n;
+
+		if ( mPending.size() < mNeeded )
+			break;
+
+		switch ( mState )
+		{
+		case STATE_DETECT:
+			if ( !mpArmor && memcmp( mPending.data(), cArmorHeader, sizeof( cEnvelopeId ) ) == 0 )
+			{
+				// Textova podoba, vlastni format se rozpozna az po dekodovani
+				mpArmor      = new Base64Decoder;
+				mArmorHeader = true;
+				mPending.clear();
+
+				Dearmor( pData, size );
+				return;
+			}
+			else if ( memcmp( mPending.data(), cEnvelopeId, sizeof( cEnvelopeId ) ) == 0 )
+			{
+				mState  = STATE_ENVELOPE_HEADER;
+				mNeeded = cEnvelopeHeaderSize;
+			}
+			else
+			{
+				// Precteny zacatek patri k prvnimu bloku
+				mState  = STATE_BLOCKS;
+				mNeeded = mKeyByteSize;
+			}
+			break;
+
+		case STATE_BLOCKS:
+			DecryptBlock();
+			break;
+
+		case STATE_ENVELOPE_HEADER:
+			ParseHeader();
+			break;
+
+		default:
+			break;
+		}
+	}
+}
+
+
+void
+RsaDecryptStream::Finish( void )
+{
+	if ( mFinished )
+		return;
+
+	mFinished = true;
+
+	if ( mpArmor )
+	{
+		if ( mArmorHeader )
+			throw Exception( "RsaDecryptStream::Finish(): Zasifrovana data jsou zkracena!" );
+
+		mpArmor->Finish();
+	}
+
+	// Prazdny vstup je v poradku, cokoliv rozdelaneho znamena zkracena data
+	if ( ( mState == STATE_DETECT && !mPending.empty() ) ||
+	     ( mState == STATE_BLOCKS && !mPending.empty() ) ||
+	     mState == STATE_ENVELOPE_HEADER )
+		throw Exception( "RsaDecryptStream::Finish(): Zasifrovana data jsou zkracena!" );
+}
+
+
+void
+RsaDecryptStream::DecryptBlock( void )
+{
+	// Blok zapiseme cely, prvni byte je delka dat
+	mBuffer.resize( mKeyByteSize );
+
+	{
+		NumberArenaScope arena;
+
+		// Platny zasifrovany blok je vzdy mensi nez modul
+		BigNum c = StringToBigNum( mPending.data(), mPending.size() );
+		if ( c >= mrKey.GetN() )
+			throw Exception( "RsaDecryptStream: Data byla zasifrovana jinym klicem!" );
+
+		BigNum m = Rsa::PrivateOperation( mrKey, c );
+
+		if ( m.ToBytes( &mBuffer[ 0 ], mKeyByteSize ) == 0 )
+			throw Exception( "RsaDecryptStream: Data byla zasifrovana jinym klicem!" );
+	}
+
+	size_t size = static_cast< uint8_t >( mBuffer[ 0 ] );
+
+	if ( size > mKeyByteSize - 2 )
+		throw Exception( "RsaDecryptStream: Data byla zasifrovana jinym klicem!" );
+
+	if ( size != 0 )
+		mrSink.Write( mBuffer.data() + 1, size );
+
+	mPending.clear();
+}
+
+
+void
+RsaDecryptStream::ParseHeader( void )
+{
+	const uint8_t* pHeader   = reinterpret_cast< const uint8_t* >( mPending.data() );
+	size_t         keyBlocks = EnvelopeKeyBlocks( mKeyByteSize );
+
+	if ( mNeeded == cEnvelopeHeaderSize )
+	{
+		if ( pHeader[ 8 ] != cEnvelopeVersion || pHeader[ 9 ] != cEnvelopeCipherChaCha )
+			throw Exception( "RsaDecryptStream: Nepodporovana verze obalky!" );
+
+		if ( static_cast< size_t >( pHeader[ 10 ] | ( pHeader[ 11 ] << 8 ) ) != keyBlocks )
+			throw Exception( "RsaDecryptStream: Data byla zasifrovana jinym klicem!" );
+
+		// Pockame jeste na bloky s klicem
+		mNeeded = cEnvelopeHeaderSize + keyBlocks * mKeyByteSize;
+		return;
+	}
+
+	uint8_t key[ ChaCha20::cKeySize ];
+	size_t  keySize = 0;
+	size_t  i;
+
+	for ( i = 0 ; i < keyBlocks ; i++ )
+	{
+		const char* pBlock = mPending.data() + cEnvelopeHeaderSize + i * mKeyByteSize;
+
+		BigNum c = StringToBigNum( pBlock, mKeyByteSize );
+		if ( c >= mrKey.GetN() )
+			throw Exception( "RsaDecryptStream: Data byla zasifrovana jinym klicem!" );
+
+		BigNum m = Rsa::PrivateOperation( mrKey, c );
+
+		mBuffer.resize( mKeyByteSize );
+		if ( m.ToBytes( &mBuffer[ 0 ], mKeyByteSize ) == 0 )
+			throw Exception( "RsaDecryptStream: Data byla zasifrovana jinym klicem!" );
+
+		size_t n = static_cast< uint8_t >( mBuffer[ 0 ] );
+
+		if ( n > mKeyByteSize - 2 || keySize + n > sizeof( key ) )
+			throw Exception( "RsaDecryptStream: Data byla zasifrovana jinym klicem!" );
+
+		memcpy( key + keySize, mBuffer.data() + 1, n );
+		keySize += n;
+	}
+
+	// Klic nenechavame v pracovnim bufferu
+	memset( &mBuffer[ 0 ], 0, mBuffer.size() );
+
+	if ( keySize != sizeof( key ) )
+		throw Exception( "RsaDecryptStream: Data byla zasifrovana jinym klicem!" );
+
+	mpCipher = new ChaCha20( key, pHeader + 12 );
+	memset( key, 0, sizeof( key ) );
+
+	mState = STATE_ENVELOPE_DATA;
+	mPending.clear();
+}
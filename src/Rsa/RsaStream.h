@@ -0,0 +1,206 @@
+/*
+ * RsaStream.h - Postupne (proudove) sifrovani a desifrovani dat.
+ *
+ * Copyright (c) 2006 Jiri Zajpt, <jzajpt@blueberry.cz>
+ */
+
+#ifndef _RSA_RSASTREAM__H
+#define _RSA_RSASTREAM__H
+
+
+#include <string>
+#include <cstdio>
+#include "../Common/Types.h"
+#include "../Common/Exceptions.h"
+
+
+class ChaCha20;
+class Base64Encoder;
+class Base64Decoder;
+
+
+/**
+ * \brief Cil, do ktereho proud zapisuje vystupni data.
+ */
+class RsaStreamSink
+{
+public:
+	virtual ~RsaStreamSink() {};
+
+	/**
+	 * \brief Zapise data. Pri chybe vyhodi vyjimku.
+	 */
+	virtual void Write( const char* pData, size_t size ) = 0;
+};
+
+
+/**
+ * \brief Zapis do otevreneho souboru (i roury nebo socketu).
+ */
+class RsaFileSink : public RsaStreamSink
+{
+public:
+	RsaFileSink( FILE* fpOutput ) : mpFile( fpOutput ) {};
+
+	virtual void Write( const char* pData, size_t size );
+
+private:
+	FILE* mpFile;
+};
+
+
+/**
+ * \brief Zapis do retezce v pameti.
+ */
+class RsaStringSink : public RsaStreamSink
+{
+public:
+	RsaStringSink( std::string& rOutput ) : mrOutput( rOutput ) {};
+
+	virtual void Write( const char* pData, size_t size ) { mrOutput.append( pData, size ); };
+
+private:
+	std::string& mrOutput;
+};
+
+
+/**
+ * \brief Postupne sifrovani dat libovolne delky.
+ *
+ * Data se predavaji po libovolne velkych castech metodou Update(),
+ * zasifrovana data se prubezne zapisuji do cile. Po predani vsech dat
+ * je nutne zavolat Finish(), ktera zapise posledni neuplny blok.
+ *
+ * Proud si drzi nejvyse jeden RSA blok, resp. jeden kus dat pro ChaCha20,
+ * takze pamet nezavisi na velikosti dat. Klic i cil musi existovat po
+ * celou dobu zivota proudu.
+ *
+ * V textovem rezimu (armor) se vystup rovnou koduje do Base64 a zalamuje
+ * na radky o delce cBase64LineLength, na zacatku je radek s hlavickou.
+ *
+ * \author Jiri Zajpt
+ */
+class RsaEncryptStream
+{
+public:
+	/**
+	 * \brief Konstruktor.
+	 *
+	 * \param rKey   Klic pro sifrovani (staci verejny).
+	 * \param rSink  Cil pro zasifrovana data.
+	 * \param format Format vystupu, viz RsaFileFormat.
+	 * \param armor  Vystup v textove podobe (Base64).
+	 */
+	RsaEncryptStream( const RsaKey& rKey, RsaStreamSink& rSink,
+	                  RsaFileFormat format = RSA_FILE_FORMAT_BLOCKS, bool armor = false );
+
+	~RsaEncryptStream();
+
+	/**
+	 * \brief Zasifruje dalsi cast dat.
+	 */
+	void Update( const char* pData, size_t size );
+
+	/**
+	 * \brief Dokonci sifrovani.
+	 */
+	void Finish( void );
+
+	/**
+	 * \brief Vraci pocet zpracovanych vstupnich bytu.
+	 */
+	uint64_t GetInputSize( void ) const { return mInputSize; };
+
+private:
+	RsaEncryptStream( const RsaEncryptStream& );
+	RsaEncryptStream& operator = ( const RsaEncryptStream& );
+
+	void Start( void );
+	void EncryptBlock( void );
+	void Output( const char* pData, size_t size );
+
+	const RsaKey&  mrKey;
+	RsaStreamSink& mrSink;
+	RsaFileFormat  mFormat;
+	size_t         mKeyByteSize;
+	std::string    mBlock;
+	std::string    mBuffer;
+	ChaCha20*      mpCipher;
+	Base64Encoder* mpArmor;
+	std::string    mArmorBuffer;
+	bool           mStarted;
+	bool           mFinished;
+	uint64_t       mInputSize;
+};
+
+
+/**
+ * \brief Postupne desifrovani dat.
+ *
+ * Format dat (bloky nebo obalka, pripadne v textove podobe) se rozpozna
+ * podle zacatku dat. Finish() overi, ze data nebyla zkracena.
+ *
+ * \author Jiri Zajpt
+ */
+class RsaDecryptStream
+{
+public:
+	/**
+	 * \brief Konstruktor.
+	 *
+	 * \param rKey   Soukromy klic.
+	 * \param rSink  Cil pro desifrovana data.
+	 */
+	RsaDecryptStream( const RsaKey& rKey, RsaStreamSink& rSink );
+
+	~RsaDecryptStream();
+
+	/**
+	 * \brief Desifruje dalsi cast dat.
+	 */
+	void Update( const char* pData, size_t size );
+
+	/**
+	 * \brief Dokonci desifrovani.
+	 */
+	void Finish( void );
+
+	/**
+	 * \brief Vraci pocet zpracovanych vstupnich bytu.
+	 */
+	uint64_t GetInputSize( void ) const { return mInputSize; };
+
+private:
+	enum State
+	{
+		STATE_DETECT,           // Zatim nevime, v jakem formatu data jsou
+		STATE_BLOCKS,           // Bloky RSA
+		STATE_ENVELOPE_HEADER,  // Hlavicka obalky
+		STATE_ENVELOPE_DATA     // Data obalky
+	};
+
+	RsaDecryptStream( const RsaDecryptStream& );
+	RsaDecryptStream& operator = ( const RsaDecryptStream& );
+
+	void Process( const char* pData, size_t size );
+	void Dearmor( const char* pData, size_t size );
+	void DecryptBlock( void );
+	void ParseHeader( void );
+
+	const RsaKey&  mrKey;
+	RsaStreamSink& mrSink;
+	State          mState;
+	size_t         mKeyByteSize;
+	size_t         mNeeded;
+	std::string    mPending;
+	std::string    mBuffer;
+	ChaCha20*      mpCipher;
+	Base64Decoder* mpArmor;
+	std::string    mArmorBuffer;
+	bool           mArmorHeader;
+	bool           mFinished;
+	uint64_t       mInputSize;
+};
+
+
+#endif // _RSA_RSASTREAM__H
@@ -0,0 +1,644 @@
+/*
+ * Server/RsaServer.cc - Sluzba pro sifrovani a desifrovani pres socket.
+ *
+ * Copyright (c) 2006 Jiri Zajpt, <jzajpt@blueberry.cz>
+ */
+
+#ifndef WIN32
+
+#include <iostream>
+#include <cstring>
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include "../BigNum/BigNum.h"
+#include "../BigNum/NumberArena.h"
+#include "../Rsa/RsaKey.h"
+#include "../Rsa/Rsa.h"
+#include "../Rsa/RsaKeyStore.h"
+#include "RsaServer.h"
+
+
+// Vyhrazena id v epoll pro naslouchajici socket a probouzeci eventfd,
+// spojeni maji id od cFirstConnectionId vys.
+static const uint64_t cListenId          = 0;
+static const uint64_t cWakeId            = 1;
+static const uint64_t cFirstConnectionId = 2;
+
+
+static uint32_t
+ReadLittleEndian32( const char* p )
+{
+	const uint8_t* pb = reinterpret_cast< const uint8_t* >( p );
+
+	return pb[ 0 ] | ( pb[ 1 ] << 8 ) | ( pb[ 2 ] << 16 ) |
+	       ( static_cast< uint32_t >( pb[ 3 ] ) << 24 );
+}
+
+
+static void
+AppendLittleEndian32( std::string& rOut, uint32_t value )
+{
+	rOut += static_cast< char >( value & 0xFF );
+	rOut += static_cast< char >( ( value >> 8 ) & 0xFF );
+	rOut += static_cast< char >( ( value >> 16 ) & 0xFF );
+	rOut += static_cast< char >( ( value >> 24 ) & 0xFF );
+}
+
+
+/*
+ * Sestavi ramec odpovedi.
+ */
+static void
+BuildResponse( std::string& rResponse, uint8_t status, uint32_t requestId,
+               const char* pData, size_t dataSize )
+{
+	rResponse.clear();
+	rResponse.reserve( cRsaFrameHeaderSize + dataSize );
+	AppendLittleEndian32( rResponse, cRsaFrameHeaderSize - 4 + dataSize );
+	rResponse += static_cast< char >( status );
+	rResponse.append( 3, '\0' );
+	AppendLittleEndian32( rResponse, requestId );
+	if ( dataSize != 0 )
+		rResponse.append( pData, dataSize );
+}
+
+
+static void
+SetNonBlocking( int fd )
+{
+	int flags = fcntl( fd, F_GETFL, 0 );
+	fcntl( fd, F_SETFL, flags | O_NONBLOCK );
+	fcntl( fd, F_SETFD, FD_CLOEXEC );
+}
+
+
+/**
+ * \brief Ukol pro pracovni vlakno: zpracuje jeden pozadavek.
+ */
+class RsaServerTask : public ThreadTask
+{
+public:
+	RsaServerTask( RsaServer* pServer, uint64_t connId, const std::string& rFrame )
+		: mpServer( pServer ), mConnId( connId ), mFrame( rFrame ) {};
+
+	virtual void Run( void )
+	{
+		std::string response;
+
+		RsaServer::ProcessRequest( mpServer->mStore, mFrame.data(),
+		                           mFrame.size(), response );
+		mpServer->Complete( mConnId, response );
+	};
+
+private:
+	RsaServer*  mpServer;
+	uint64_t    mConnId;
+	std::string mFrame;
+};
+
+
+RsaServer::RsaServer( RsaKeyStore& rStore, size_t threads )
+	: mStore( rStore ), mPool( threads ), mEpollFd( -1 ), mListenFd( -1 ),
+	  mWakeFd( -1 ), mStop( false ), mNextId( cFirstConnectionId )
+{
+	pthread_mutex_init( &mMutex, NULL );
+
+	mEpollFd = epoll_create( 64 );
+	if ( mEpollFd < 0 )
+		throw Exception( "RsaServer: Nepodarilo se vytvorit epoll!" );
+	fcntl( mEpollFd, F_SETFD, FD_CLOEXEC );
+
+	mWakeFd = eventfd( 0, 0 );
+	if ( mWakeFd < 0 )
+		throw Exception( "RsaServer: Nepodarilo se vytvorit eventfd!" );
+	SetNonBlocking( mWakeFd );
+
+	struct epoll_event ev;
+	memset( &ev, 0, sizeof( ev ) );
+	ev.events   = EPOLLIN;
+	ev.data.u64 = cWakeId;
+	epoll_ctl( mEpollFd, EPOLL_CTL_ADD, mWakeFd, &ev );
+}
+
+
+RsaServer::~RsaServer()
+{
+	// Nejdrive dokoncime rozpracovane ukoly, pak teprve zavreme spojeni.
+	mPool.Wait();
+
+	std::map< uint64_t, Connection* >::iterator it;
+	for ( it = mConnections.begin() ; it != mConnections.end() ; ++it )
+	{
+		close( it->second->mFd );
+		delete it->second;
+	}
+
+	if ( mListenFd >= 0 )
+		close( mListenFd );
+	if ( !mUnixPath.empty() )
+		unlink( mUnixPath.c_str() );
+
+	close( mWakeFd );
+	close( mEpollFd );
+	pthread_mutex_destroy( &mMutex );
+}
+
+
+void
+RsaServer::ListenTcp( int port )
+{
+	int fd = socket( AF_INET, SOCK_STREAM, 0 );
+	if ( fd < 0 )
+		throw Exception( "RsaServer::ListenTcp(): Nepodarilo se vytvorit socket!" );
+
+	int one = 1;
+	setsockopt( fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof( one ) );
+
+	struct sockaddr_in addr;
+	memset( &addr, 0, sizeof( addr ) );
+	addr.sin_family      = AF_INET;
+	addr.sin_port        = htons( port );
+	addr.sin_addr.s_addr = htonl( INADDR_LOOPBACK );
+
+	if ( bind( fd, reinterpret_cast< struct sockaddr* >( &addr ), sizeof( addr ) ) != 0 )
+	{
+		close( fd );
+		throw Exception( "RsaServer::ListenTcp(): Port je obsazen!" );
+	}
+
+	Listen( fd );
+}
+
+
+void
+RsaServer::ListenUnix( const char* pPath )
+{
+	struct sockaddr_un addr;
+	memset( &addr, 0, sizeof( addr ) );
+	addr.sun_family = AF_UNIX;
+
+	if ( strlen( pPath ) >= sizeof( addr.sun_path ) )
+		throw Exception( "RsaServer::ListenUnix(): Prilis dlouha cesta k socketu!" );
+	strcpy( addr.sun_path, pPath );
+
+	int fd = socket( AF_UNIX, SOCK_STREAM, 0 );
+	if ( fd < 0 )
+		throw Exception( "RsaServer::ListenUnix(): Nepodarilo se vytvorit socket!" );
+
+	unlink( pPath );
+	if ( bind( fd, reinterpret_cast< struct sockaddr* >( &addr ), sizeof( addr ) ) != 0 )
+	{
+		close( fd );
+		throw UnableToOpenFileException(
+			"RsaServer::ListenUnix(): Nepodarilo se vytvorit socket", pPath );
+	}
+	mUnixPath = pPath;
+
+	Listen( fd );
+}
+
+
+void
+RsaServer::Listen( int fd )
+{
+	if ( listen( fd, 128 ) != 0 )
+	{
+		close( fd );
+		throw Exception( "RsaServer: Nepodarilo se naslouchat na socketu!" );
+	}
+	SetNonBlocking( fd );
+
+	if ( mListenFd >= 0 )
+		close( mListenFd );
+	mListenFd = fd;
+
+	struct epoll_event ev;
+	memset( &ev, 0, sizeof( ev ) );
+	ev.events   = EPOLLIN;
+	ev.data.u64 = cListenId;
+	epoll_ctl( mEpollFd, EPOLL_CTL_ADD, mListenFd, &ev );
+}
+
+
+void
+RsaServer::Run( void )
+{
+	const int maxEvents = 64;
+	struct epoll_event events[ maxEvents ];
+
+	while ( !mStop )
+	{
+		int n = epoll_wait( mEpollFd, events, maxEvents, 500 );
+		if ( n < 0 )
+		{
+			if ( errno == EINTR )
+				continue;
+			throw Exception( "RsaServer::Run(): Chyba epoll_wait()!" );
+		}
+
+		int i;
+		for ( i = 0 ; i < n ; i++ )
+		{
+			uint64_t id = events[ i ].data.u64;
+
+			if ( id == cListenId )
+			{
+				Accept();
+				continue;
+			}
+
+			if ( id == cWakeId )
+			{
+				uint64_t value;
+				while ( read( mWakeFd, &value, sizeof( value ) ) > 0 )
+					;
+				HandleCompletions();
+				continue;
+			}
+
+			// Spojeni mohlo byt zavreno pri zpracovani predchozi udalosti
+			std::map< uint64_t, Connection* >::iterator it = mConnections.find( id );
+			if ( it == mConnections.end() )
+				continue;
+
+			if ( events[ i ].events & EPOLLOUT )
+			{
+				HandleWrite( it->second );
+
+				// HandleWrite() mohlo spojeni zavrit
+				it = mConnections.find( id );
+				if ( it == mConnections.end() )
+					continue;
+			}
+
+			// Pri EPOLLHUP/EPOLLERR jeste docteme pozadavky, ktere zustaly
+			// v soketu, konec spojeni nastavi az read()
+			if ( events[ i ].events & ( EPOLLIN | EPOLLHUP | EPOLLERR ) )
+				HandleRead( it->second );
+		}
+	}
+}
+
+
+void
+RsaServer::Stop( void )
+{
+	mStop = true;
+
+	// write() je bezpecne volat i z obsluhy signalu
+	uint64_t one = 1;
+	ssize_t  n   = write( mWakeFd, &one, sizeof( one ) );
+	( void ) n;
+}
+
+
+void
+RsaServer::Accept( void )
+{
+	while ( true )
+	{
+		int fd = accept( mListenFd, NULL, NULL );
+		if ( fd < 0 )
+		{
+			if ( errno == EINTR )
+				continue;
+			return;
+		}
+
+		int one = 1;
+		setsockopt( fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof( one ) );
+
+		Attach( fd );
+	}
+}
+
+
+void
+RsaServer::Attach( int fd )
+{
+	SetNonBlocking( fd );
+
+	Connection* pConn = new Connection;
+	pConn->mFd      = fd;
+	pConn->mId      = mNextId++;
+	pConn->mPending = 0;
+	pConn->mEof     = false;
+	pConn->mPaused  = false;
+	pConn->mEvents  = EPOLLIN;
+
+	struct epoll_event ev;
+	memset( &ev, 0, sizeof( ev ) );
+	ev.events   = pConn->mEvents;
+	ev.data.u64 = pConn->mId;
+	if ( epoll_ctl( mEpollFd, EPOLL_CTL_ADD, fd, &ev ) != 0 )
+	{
+		close( fd );
+		delete pConn;
+		return;
+	}
+
+	mConnections[ pConn->mId ] = pConn;
+}
+
+
+void
+RsaServer::HandleRead( Connection* pConn )
+{
+	char buffer[ 16384 ];
+
+	//
+	// Ramce predavame pracovnim vlaknum prubezne po kazdem cteni. Pri
+	// dosazeni limitu spojeni (cRsaMaxPending, cRsaMaxOutput) se cteni
+	// pozastavi, v mIn tak zustane nejvyse jeden neuplny ramec a posledni
+	// prectena data.
+	//
+	while ( true )
+	{
+		size_t pos = 0;
+		while ( pConn->mIn.size() - pos >= 4 )
+		{
+			if ( pConn->mPending >= cRsaMaxPending || pConn->mOut.size() >= cRsaMaxOutput )
+			{
+				pConn->mPaused = true;
+				break;
+			}
+
+			uint32_t length = ReadLittleEndian32( pConn->mIn.data() + pos );
+			if ( length < cRsaFrameHeaderSize - 4 || length > cRsaMaxFrameSize )
+			{
+				// Poruseny protokol, dalsi data uz nelze spravne rozdelit
+				Close( pConn );
+				return;
+			}
+			if ( pConn->mIn.size() - pos < 4 + length )
+				break;
+
+			pConn->mPending++;
+			mPool.Submit( new RsaServerTask( this, pConn->mId,
+			                                 pConn->mIn.substr( pos, 4 + length ) ) );
+			pos += 4 + length;
+		}
+		pConn->mIn.erase( 0, pos );
+
+		if ( pConn->mEof || pConn->mPaused )
+			break;
+
+		ssize_t n = read( pConn->mFd, buffer, sizeof( buffer ) );
+		if ( n > 0 )
+		{
+			pConn->mIn.append( buffer, n );
+			continue;
+		}
+		if ( n < 0 && errno == EINTR )
+			continue;
+		if ( n < 0 && ( errno == EAGAIN || errno == EWOULDBLOCK ) )
+			break;
+
+		// Klient ukoncil odesilani (nebo chyba), odpovedi ale jeste dorucime
+		pConn->mEof = true;
+	}
+
+	if ( pConn->mEof && pConn->mPending == 0 && pConn->mOut.empty() )
+	{
+		Close( pConn );
+		return;
+	}
+
+	UpdateEvents( pConn );
+}
+
+
+void
+RsaServer::HandleWrite( Connection* pConn )
+{
+	while ( !pConn->mOut.empty() )
+	{
+		ssize_t n = send( pConn->mFd, pConn->mOut.data(), pConn->mOut.size(),
+		                  MSG_NOSIGNAL );
+		if ( n > 0 )
+		{
+			pConn->mOut.erase( 0, n );
+			continue;
+		}
+		if ( n < 0 && errno == EINTR )
+			continue;
+		if ( n < 0 && ( errno == EAGAIN || errno == EWOULDBLOCK ) )
+			break;
+
+		Close( pConn );
+		return;
+	}
+
+	// Fronta spojeni klesla pod polovinu limitu, pokracujeme ve cteni
+	// (nejdrive ramci, ktere uz cekaji v mIn)
+	if ( pConn->mPaused && pConn->mPending <= cRsaMaxPending / 2
+	  && pConn->mOut.size() <= cRsaMaxOutput / 2 )
+	{
+		pConn->mPaused = false;
+		HandleRead( pConn );
+		return;
+	}
+
+	if ( pConn->mEof && pConn->mPending == 0 && pConn->mOut.empty() )
+	{
+		Close( pConn );
+		return;
+	}
+
+	UpdateEvents( pConn );
+}
+
+
+void
+RsaServer::HandleCompletions( void )
+{
+	std::deque< std::pair< uint64_t, std::string > > completed;
+
+	pthread_mutex_lock( &mMutex );
+	completed.swap( mCompleted );
+	pthread_mutex_unlock( &mMutex );
+
+	while ( !completed.empty() )
+	{
+		std::map< uint64_t, Connection* >::iterator it =
+			mConnections.find( completed.front().first );
+
+		// Odpovedi pro jiz zavrena spojeni zahodime
+		if ( it != mConnections.end() )
+		{
+			Connection* pConn = it->second;
+			pConn->mPending--;
+			pConn->mOut += completed.front().second;
+			HandleWrite( pConn );
+		}
+		completed.pop_front();
+	}
+}
+
+
+void
+RsaServer::Complete( uint64_t connId, const std::string& rResponse )
+{
+	pthread_mutex_lock( &mMutex );
+	mCompleted.push_back( std::make_pair( connId, rResponse ) );
+	pthread_mutex_unlock( &mMutex );
+
+	uint64_t one = 1;
+	ssize_t  n   = write( mWakeFd, &one, sizeof( one ) );
+	( void ) n;
+}
+
+
+void
+RsaServer::Close( Connection* pConn )
+{
+	epoll_ctl( mEpollFd, EPOLL_CTL_DEL, pConn->mFd, NULL );
+	close( pConn->mFd );
+	mConnections.erase( pConn->mId );
+	delete pConn;
+}
+
+
+void
+RsaServer::UpdateEvents( Connection* pConn )
+{
+	// Po konci vstupu nebo pri pozastaveni cteni EPOLLIN nechceme, jinak
+	// by epoll hlasil pripravena data porad dokola
+	uint32_t events = 0;
+	if ( !pConn->mEof && !pConn->mPaused )
+		events |= EPOLLIN;
+	if ( !pConn->mOut.empty() )
+		events |= EPOLLOUT;
+
+	if ( events == pConn->mEvents )
+		return;
+
+	struct epoll_event ev;
+	memset( &ev, 0, sizeof( ev ) );
+	ev.events   = events;
+	ev.data.u64 = pConn->mId;
+	epoll_ctl( mEpollFd, EPOLL_CTL_MOD, pConn->mFd, &ev );
+	pConn->mEvents = events;
+}
+
+
+void
+RsaServer::ProcessRequest( RsaKeyStore& rStore, const char* pFrame,
+                           size_t frameSize, std::string& rResponse )
+{
+	uint32_t requestId = 0;
+
+	if ( frameSize < cRsaFrameHeaderSize )
+	{
+		BuildResponse( rResponse, RSA_STATUS_BAD_REQUEST, requestId, NULL, 0 );
+		return;
+	}
+
+	uint8_t operation = static_cast< uint8_t >( pFrame[ 4 ] );
+	size_t  keyIdSize = static_cast< uint8_t >( pFrame[ 5 ] );
+	requestId = ReadLittleEndian32( pFrame + 8 );
+
+	if ( cRsaFrameHeaderSize + keyIdSize > frameSize )
+	{
+		BuildResponse( rResponse, RSA_STATUS_BAD_REQUEST, requestId, NULL, 0 );
+		return;
+	}
+
+	std::string keyId( pFrame + cRsaFrameHeaderSize, keyIdSize );
+	const char* pData    = pFrame + cRsaFrameHeaderSize + keyIdSize;
+	size_t      dataSize = frameSize - cRsaFrameHeaderSize - keyIdSize;
+
+	RsaKeyHandle key = rStore.Acquire( keyId );
+	if ( !key.IsValid() )
+	{
+		BuildResponse( rResponse, RSA_STATUS_UNKNOWN_KEY, requestId, NULL, 0 );
+		return;
+	}
+
+	size_t keyByteSize = key->GetKeySize() / 8;
+	bool   isPrivate   = key->GetKeyType() == RSA_KEY_PRIVATE;
+
+	try
+	{
+		// Docasna cisla pozadavku bereme z areny vlakna
+		NumberArenaScope arena;
+
+		switch ( operation )
+		{
+		case RSA_OP_ENCRYPT:
+		case RSA_OP_SIGN:
+		{
+			if ( dataSize > keyByteSize - 2 || ( operation == RSA_OP_SIGN && !isPrivate ) )
+				break;
+
+			// Stejny format bloku jako v Rsa::EncryptFileToFile()
+			char block[ 256 ];
+			std::string blockBuffer;
+			char* pBlock = block;
+			if ( dataSize + 1 > sizeof( block ) )
+			{
+				blockBuffer.resize( dataSize + 1 );
+				pBlock = &blockBuffer[ 0 ];
+			}
+			pBlock[ 0 ] = static_cast< uint8_t >( dataSize );
+			memcpy( pBlock + 1, pData, dataSize );
+
+			BigNum m = StringToBigNum( pBlock, dataSize + 1 );
+			if ( m >= key->GetN() )
+				break;
+
+			BigNum c = operation == RSA_OP_ENCRYPT
+				? Rsa::PublicOperation( *key, m )
+				: Rsa::PrivateOperation( *key, m );
+
+			std::string output( keyByteSize, '\0' );
+			BigNumToString( c, &output[ 0 ], keyByteSize );
+			BuildResponse( rResponse, RSA_STATUS_OK, requestId,
+			               output.data(), output.size() );
+			return;
+		}
+
+		case RSA_OP_DECRYPT:
+		{
+			if ( dataSize != keyByteSize || !isPrivate )
+				break;
+
+			BigNum c = StringToBigNum( pData, dataSize );
+			if ( c >= key->GetN() )
+				break;
+
+			BigNum m = Rsa::PrivateOperation( *key, c );
+
+			// Prvni byte bloku je delka dat
+			std::string output( keyByteSize, '\0' );
+			if ( m.ToBytes( &output[ 0 ], keyByteSize ) == 0 )
+				break;
+
+			size_t size = static_cast< uint8_t >( output[ 0 ] );
+			if ( size > keyByteSize - 2 )
+				break;
+
+			BuildResponse( rResponse, RSA_STATUS_OK, requestId,
+			               output.data() + 1, size );
+			return;
+		}
+		}
+	}
+	catch ( Exception& e )
+	{
+		BuildResponse( rResponse, RSA_STATUS_ERROR, requestId, NULL, 0 );
+		return;
+	}
+
+	BuildResponse( rResponse, RSA_STATUS_BAD_REQUEST, requestId, NULL, 0 );
+}
+
+#endif // WIN32
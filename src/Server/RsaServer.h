@@ -0,0 +1,179 @@
+/*
+ * Server/RsaServer.h - Sluzba pro sifrovani a desifrovani pres socket.
+ *
+ * Copyright (c) 2006 Jiri Zajpt, <jzajpt@blueberry.cz>
+ */
+
+#ifndef _SERVER_RSASERVER__H
+#define _SERVER_RSASERVER__H
+
+
+#include <map>
+#include <deque>
+#include <string>
+#include <pthread.h>
+#include "../Common/Types.h"
+#include "../Common/ThreadPool.h"
+
+
+/*
+ * Protokol
+ * --------
+ *
+ * Pozadavky i odpovedi jsou ramce s hlavickou o velikosti 12 bytu,
+ * vsechna cisla jsou little-endian:
+ *
+ *   Pozadavek: uint32 delka | uint8 operace | uint8 delka id klice |
+ *              uint16 0     | uint32 id pozadavku | id klice | data
+ *
+ *   Odpoved:   uint32 delka | uint8 stav | uint8 0 | uint16 0 |
+ *              uint32 id pozadavku | data
+ *
+ * Pole "delka" udava pocet bytu ramce, ktere za nim nasleduji. Id pozadavku
+ * server jen vraci v odpovedi, klient tak muze posilat vice pozadavku
+ * najednou a odpovedi (ktere mohou prijit v jinem poradi) si sparovat.
+ *
+ * Operace pracuji s jednim blokem stejne jako Rsa::EncryptFileToFile():
+ *
+ *   RSA_OP_ENCRYPT - data (nejvyse velikost klice - 2 byty) jsou zasifrovana
+ *                    verejnym klicem, odpoved ma velikost klice.
+ *   RSA_OP_DECRYPT - data (blok o velikosti klice) jsou desifrovana
+ *                    soukromym klicem, odpoved obsahuje puvodni data.
+ *   RSA_OP_SIGN    - data jsou "zasifrovana" soukromym klicem, odpoved
+ *                    ma velikost klice a overi se verejnou operaci.
+ */
+enum RsaServerOperation
+{
+	RSA_OP_ENCRYPT = 1,
+	RSA_OP_DECRYPT = 2,
+	RSA_OP_SIGN    = 3
+};
+
+
+enum RsaServerStatus
+{
+	RSA_STATUS_OK          = 0,
+	RSA_STATUS_UNKNOWN_KEY = 1,
+	RSA_STATUS_BAD_REQUEST = 2,
+	RSA_STATUS_ERROR       = 3
+};
+
+
+const size_t cRsaFrameHeaderSize = 12;
+const size_t cRsaMaxFrameSize    = 64 * 1024;
+
+// Limity jednoho spojeni. Po dosazeni poctu rozpracovanych pozadavku nebo
+// velikosti neodeslanych odpovedi server prestane od klienta cist a znovu
+// zacne, az obe hodnoty klesnou na polovinu.
+const size_t cRsaMaxPending      = 256;
+const size_t cRsaMaxOutput       = 1024 * 1024;
+
+
+/**
+ * \brief Dlouho bezici sluzba, ktera drzi klice v pameti.
+ *
+ * Server posloucha na lokalnim TCP portu nebo unixovem socketu.
+ * Sitova komunikace bezi v jedinem vlakne nad epoll, samotne RSA
+ * operace se vykonavaji ve skupine pracovnich vlaken. Klice se berou
+ * z uloziste RsaKeyStore, takze se nacitaji a predpocitavaji jen jednou.
+ *
+ * \author Jiri Zajpt
+ */
+class RsaServer
+{
+public:
+	/**
+	 * \brief Konstruktor.
+	 *
+	 * \param rStore  Uloziste klicu.
+	 * \param threads Pocet pracovnich vlaken (0 = pocet procesoru).
+	 */
+	RsaServer( RsaKeyStore& rStore, size_t threads = 0 );
+
+	/**
+	 * \brief Destruktor. Uzavre vsechna spojeni.
+	 */
+	~RsaServer();
+
+	/**
+	 * \brief Zacne poslouchat na TCP portu na adrese 127.0.0.1.
+	 */
+	void ListenTcp( int port );
+
+	/**
+	 * \brief Zacne poslouchat na unixovem socketu.
+	 */
+	void ListenUnix( const char* pPath );
+
+	/**
+	 * \brief Prevezme jiz otevrene spojeni (napr. jeden konec socketpair()).
+	 *
+	 * Spojeni se obsluhuje v Run() stejne jako prijata spojeni, server
+	 * ho pri ukonceni zavre.
+	 */
+	void Attach( int fd );
+
+	/**
+	 * \brief Obsluhuje spojeni, dokud neni zavolano Stop().
+	 */
+	void Run( void );
+
+	/**
+	 * \brief Ukonci Run(). Lze volat i z obsluhy signalu.
+	 */
+	void Stop( void );
+
+	/**
+	 * \brief Zpracuje jeden ramec pozadavku a sestavi odpoved.
+	 *
+	 * \param rStore    Uloziste klicu.
+	 * \param pFrame    Ramec pozadavku vcetne hlavicky.
+	 * \param frameSize Velikost ramce.
+	 * \param rResponse Ramec odpovedi.
+	 */
+	static void ProcessRequest( RsaKeyStore& rStore, const char* pFrame,
+	                            size_t frameSize, std::string& rResponse );
+
+private:
+	struct Connection
+	{
+		int         mFd;
+		uint64_t    mId;
+		std::string mIn;
+		std::string mOut;
+		size_t      mPending;
+		bool        mEof;
+		bool        mPaused;
+		uint32_t    mEvents;
+	};
+
+	friend class RsaServerTask;
+
+	RsaServer( const RsaServer& );
+	RsaServer& operator = ( const RsaServer& );
+
+	void Listen( int fd );
+	void Accept( void );
+	void HandleRead( Connection* pConn );
+	void HandleWrite( Connection* pConn );
+	void HandleCompletions( void );
+	void Complete( uint64_t connId, const std::string& rResponse );
+	void Close( Connection* pConn );
+	void UpdateEvents( Connection* pConn );
+
+	RsaKeyStore&                       mStore;
+	ThreadPool                         mPool;
+	int                                mEpollFd;
+	int                                mListenFd;
+	int                                mWakeFd;
+	std::string                        mUnixPath;
+	volatile bool                      mStop;
+	uint64_t                           mNextId;
+	std::map< uint64_t, Connection* >  mConnections;
+
+	pthread_mutex_t                                      mMutex;
+	std::deque< std::pair< uint64_t, std::string > >     mCompleted;
+};
+
+
+#endif // _SERVER_RSASERVER__H
@@ -1,7 +1,23 @@
 #include <iostream>
 #include <fstream>
 #include <cstdlib>
+#include <cstring>
+#include <algorithm>
+#include <iterator>
+#include <map>
 #include <BigNum.h>
+#include <NumberBuffer.h>
+#include <Kernels.h>
+#include <Base64.h>
+#include <RsaKey.h>
+#include <RsaKeyStore.h>
+#include <Rsa.h>
+#include <RsaStream.h>
+#include <RsaScheduler.h>
+#include <RsaServer.h>
+#include <unistd.h>
+#include <poll.h>
+#include <sys/socket.h>
 
 
 using namespace std;
@@ -229,6 +245,436 @@ test_get_size()
 }
 
 
+bool
+test_number_buffer()
+{
+	size_t       error_cnt = 0;
+	NumberBuffer nb( 4 );
+	size_t       i;
+
+	for ( i = 0 ; i < 4 ; i++ )
+		nb.Set( i, i + 1 );
+
+	// Zvetseni nad kapacitu zachova obsah a doplni nuly
+	nb.Reallocate( 5 );
+	if ( nb.GetSize() != 5 || nb.GetCapacity() < 8 || nb.Get( 3 ) != 4 || nb.Get( 4 ) != 0 )
+		error_cnt++;
+
+	// Zvetseni v ramci kapacity buffer nepresouva
+	uint32_t* pBuffer = nb.GetBufferPointer();
+	nb.Reallocate( 8 );
+	if ( nb.GetBufferPointer() != pBuffer || nb.GetActiveSize() != 4 )
+		error_cnt++;
+
+	nb.Reallocate( 2 );
+	if ( nb.GetSize() != 2 || nb.GetActiveSize() != 2 || nb.Get( 1 ) != 2 )
+		error_cnt++;
+
+	nb.Reserve( 100 );
+	if ( nb.GetSize() != 2 || nb.GetCapacity() < 100 || nb.Get( 0 ) != 1 )
+		error_cnt++;
+
+	// Allocate() pouzije stavajici kapacitu a buffer vynuluje
+	pBuffer = nb.GetBufferPointer();
+	nb.Allocate( 50 );
+	if ( nb.GetBufferPointer() != pBuffer || nb.GetSize() != 50 || nb.GetActiveSize() != 0 )
+		error_cnt++;
+
+	nb.Set( 10, 7 );
+	nb.Reallocate( 11 );
+	nb.ShrinkToFit();
+	if ( nb.GetCapacity() != 11 || nb.Get( 10 ) != 7 || nb.GetActiveSize() != 11 )
+		error_cnt++;
+
+	cout << "Test NumberBuffer dokoncen, pocet chyb: " << error_cnt << endl;
+
+	return error_cnt == 0;
+}
+
+
+/**
+ * \brief Operace s malym cislem typu T musi dat stejny vysledek jako s int.
+ *
+ * Zaroven overi, ze se pro typ T vybere jednoznacne pretizeni.
+ */
+template < class T >
+static size_t
+check_scalar_type( int value )
+{
+	size_t error_cnt = 0;
+	BigNum x( "1234567890ABCDEF0123456789ABCDEF" );
+	BigNum y = x;
+	T      v = static_cast< T >( value );
+
+	if ( x + v != x + value || x - v != x - value || x * v != x * value || x / v != x / value )
+		error_cnt++;
+	if ( x % v != static_cast< T >( x % value ) || x == v || !( x != v ) )
+		error_cnt++;
+	if ( x < v || x <= v || !( x > v ) || !( x >= v ) )
+		error_cnt++;
+
+	y += v;
+	y -= v;
+	y *= v;
+	y /= v;
+	if ( y != x )
+		error_cnt++;
+
+	y %= v;
+	if ( y != x % value )
+		error_cnt++;
+
+	return error_cnt;
+}
+
+
+bool
+test_scalar()
+{
+	size_t error_cnt = 0;
+	BigNum bn( "1234567890ABCDEF0123456789ABCDEF" );
+	BigNum big_5( 5 );
+	BigNum big_7( 7 );
+	int    i;
+
+	// Operace s malym cislem musi dat stejny vysledek jako s BigNum
+	if ( bn + 5 != bn + big_5 || bn - 5 != bn - big_5 || bn * 5 != bn * big_5 )
+		error_cnt++;
+	if ( bn / 7u != bn / big_7 || BigNum( bn % 7u ) != bn % big_7 )
+		error_cnt++;
+
+	BigNum x = bn;
+	for ( i = 0 ; i < 1000 ; i++ )
+		x += 2;
+	if ( x != bn + 2000 )
+		error_cnt++;
+	for ( i = 0 ; i < 1000 ; i++ )
+		x -= 2;
+	if ( x != bn )
+		error_cnt++;
+
+	// Zaporna cisla
+	BigNum three( 3 );
+	if ( three - 5 != -BigNum( 2 ) || !( three - 5 < 0 ) || ( three - 5 ) + 2 != 0 )
+		error_cnt++;
+	if ( BigNum( 0 ) != 0 || BigNum( 1 ) != 1u || BigNum( 1 ) > 1 )
+		error_cnt++;
+
+	// Vsechny celociselne typy (kratsi se povysi na int)
+	error_cnt += check_scalar_type< short >( -7 );
+	error_cnt += check_scalar_type< unsigned short >( 7 );
+	error_cnt += check_scalar_type< int >( -7 );
+	error_cnt += check_scalar_type< unsigned int >( 7 );
+	error_cnt += check_scalar_type< long >( -7 );
+	error_cnt += check_scalar_type< unsigned long >( 7 );
+	error_cnt += check_scalar_type< long long >( -7 );
+	error_cnt += check_scalar_type< unsigned long long >( 7 );
+	error_cnt += check_scalar_type< int64_t >( -7 );
+	error_cnt += check_scalar_type< uint64_t >( 7 );
+	error_cnt += check_scalar_type< size_t >( 7 );
+
+	cout << "Test operaci s malymi cisly dokoncen, pocet chyb: " << error_cnt << endl;
+
+	return error_cnt == 0;
+}
+
+
+bool
+test_bytes()
+{
+	size_t error_cnt = 0;
+	BigNum bn( "1234567890ABCDEF0123456789" );
+	char   le[ 16 ];
+	char   be[ 16 ];
+	size_t size = bn.GetActiveBytes();
+	size_t i;
+
+	// ToBytes() musi dat stejne byty jako GetByte()
+	if ( bn.ToBytes( le ) != size )
+		error_cnt++;
+	for ( i = 0 ; i < size ; i++ )
+		if ( static_cast< uint8_t >( le[ i ] ) != bn.GetByte( i ) )
+			error_cnt++;
+
+	// Pevna delka, obe poradi bytu
+	if ( bn.ToBytes( le, sizeof( le ) ) != sizeof( le ) ||
+	     bn.ToBytes( be, sizeof( be ), BigNum::BigEndian ) != sizeof( be ) )
+		error_cnt++;
+	for ( i = 0 ; i < sizeof( le ) ; i++ )
+		if ( le[ i ] != be[ sizeof( be ) - 1 - i ] )
+			error_cnt++;
+	if ( bn.ToBytes( le, size - 1 ) != 0 )
+		error_cnt++;
+
+	BigNum x;
+	BigNum y;
+	x.FromBytes( le, sizeof( le ) );
+	y.FromBytes( be, sizeof( be ), BigNum::BigEndian );
+	if ( x != bn || y != bn || x.GetActiveBytes() != size )
+		error_cnt++;
+
+	// Liche delky (cast nejvyssi cislice)
+	y.FromBytes( be + 3, sizeof( be ) - 3, BigNum::BigEndian );
+	x.FromBytes( le, sizeof( le ) - 3 );
+	if ( x != bn || y != bn )
+		error_cnt++;
+
+	cout << "Test FromBytes/ToBytes dokoncen, pocet chyb: " << error_cnt << endl;
+
+	return error_cnt == 0;
+}
+
+
+bool
+test_product()
+{
+	size_t error_cnt = 0;
+	BigNum a( "1234567890ABCDEF0123456789ABCDEF0123456789" );
+	BigNum b( "FEDCBA9876543210FEDCBA98765432" );
+	BigNum m( "10000000000000000000000000000000000001" );
+	BigNum ab = a * b;
+	BigNum copy_a = a;
+
+	// Spojene operace musi dat stejny vysledek jako postupny vypocet
+	if ( BigNum::MultiplyModulo( a, b, m ) != ab % m )
+		error_cnt++;
+	if ( BigNum::MultiplyModulo( a, a, m ) != ( a * copy_a ) % m || a * a != a * copy_a )
+		error_cnt++;
+	if ( BigNum::MultiplyAdd( m, a, b ) != m + ab || BigNum::MultiplyModulo( a, 0, m ) != 0 )
+		error_cnt++;
+
+	// Soucin je obycejne cislo, lze na nem volat metody
+	if ( ( a * b ).IsZero() || std::max( a * b, a ) != ab || ( a * b ) % 1000u != ab % 1000u )
+		error_cnt++;
+
+	// Zaporne operandy jdou pres Divide()
+	BigNum neg = -a;
+	if ( BigNum::MultiplyModulo( neg, b, m ) != ( neg * b ) % m ||
+	     BigNum::MultiplyAdd( m, neg, b ) != m + neg * b )
+		error_cnt++;
+
+	// Cinitele nad prahem Karatsuby (pres 64 cislic)
+	BigNum big_a = a;
+	BigNum big_b = b;
+	size_t i;
+
+	for ( i = 0 ; i < 5 ; i++ )
+	{
+		big_a = big_a * big_a + b;
+		big_b = big_b * big_b + a;
+	}
+
+	if ( BigNum::MultiplyAdd( m, big_a, big_b ) != m + big_a * big_b ||
+	     BigNum::MultiplyAdd( big_a, big_b, big_b ) != big_a + big_b * big_b )
+		error_cnt++;
+
+	cout << "Test spojenych operaci dokoncen, pocet chyb: " << error_cnt << endl;
+
+	return error_cnt == 0;
+}
+
+
+/**
+ * \brief Vyplni pole nahodnymi cislicemi (i krajnimi hodnotami).
+ */
+static void
+fill_random_limbs( uint32_t* p, size_t n )
+{
+	size_t i;
+
+	for ( i = 0 ; i < n ; i++ )
+	{
+		switch ( rand() % 4 )
+		{
+		case 0:  p[ i ] = 0xFFFFFFFF; break;
+		case 1:  p[ i ] = 0; break;
+		default: p[ i ] = ( static_cast< uint32_t >( rand() ) << 16 ) ^ rand(); break;
+		}
+	}
+}
+
+
+bool
+test_kernels()
+{
+	const LimbKernels* pNative = LimbKernelsNative();
+	size_t             error_cnt = 0;
+
+	if ( !pNative )
+	{
+		cout << "Test jader: procesor nema optimalizovana jadra, preskoceno" << endl;
+		return true;
+	}
+
+	const LimbKernels& rPort = cLimbKernelsPortable;
+	const LimbKernels& rNat  = *pNative;
+	uint32_t a[ 70 ], b[ 70 ], m[ 70 ];
+	uint32_t r1[ 142 ], r2[ 142 ], t[ 142 ];
+	uint32_t x;
+	size_t   n, nb, round;
+
+	srand( 2006 );
+
+	for ( round = 0 ; round < 20 ; round++ )
+	{
+		for ( n = 1 ; n <= 65 ; n++ )
+		{
+			fill_random_limbs( a, n );
+			fill_random_limbs( b, n );
+			fill_random_limbs( r1, n );
+			memcpy( r2, r1, n * sizeof( uint32_t ) );
+			x = rand() % 3 ? ( static_cast< uint32_t >( rand() ) << 16 ) ^ rand() : 0xFFFFFFFF;
+
+			// Radkova jadra
+			if ( rPort.mpAddMul1( r1, a, n, x ) != rNat.mpAddMul1( r2, a, n, x ) ||
+			     memcmp( r1, r2, n * sizeof( uint32_t ) ) != 0 )
+				error_cnt++;
+			if ( rPort.mpSubMul1( r1, a, n, x ) != rNat.mpSubMul1( r2, a, n, x ) ||
+			     memcmp( r1, r2, n * sizeof( uint32_t ) ) != 0 )
+				error_cnt++;
+			if ( rPort.mpMul1( r1, a, n, x ) != rNat.mpMul1( r2, a, n, x ) ||
+			     memcmp( r1, r2, n * sizeof( uint32_t ) ) != 0 )
+				error_cnt++;
+
+			// Nasobeni a druha mocnina
+			nb = 1 + rand() % n;
+			rPort.mpMul( r1, a, n, b, nb );
+			rNat.mpMul( r2, a, n, b, nb );
+			if ( memcmp( r1, r2, ( n + nb ) * sizeof( uint32_t ) ) != 0 )
+				error_cnt++;
+
+			rPort.mpSqr( r1, a, n );
+			rNat.mpSqr( r2, a, n );
+			if ( memcmp( r1, r2, 2 * n * sizeof( uint32_t ) ) != 0 )
+				error_cnt++;
+
+			// Montgomeryho nasobeni, a, b < m a m liche
+			fill_random_limbs( m, n );
+			m[ 0 ] |= 1;
+			m[ n - 1 ] |= 0x80000000;
+			a[ n - 1 ] &= 0x7FFFFFFF;
+			b[ n - 1 ] &= 0x7FFFFFFF;
+
+			uint32_t mInv = 1;
+			size_t   k;
+			for ( k = 0 ; k < 5 ; k++ )
+				mInv *= 2 - m[ 0 ] * mInv;
+			mInv = 0 - mInv;
+
+			rPort.mpMontMul( r1, a, b, m, n, mInv, t );
+			rNat.mpMontMul( r2, a, b, m, n, mInv, t );
+			if ( memcmp( r1, r2, n * sizeof( uint32_t ) ) != 0 )
+				error_cnt++;
+		}
+	}
+
+	cout << "Test jader " << rNat.mpName << " proti prenositelnym dokoncen, pocet chyb: "
+	     << error_cnt << endl;
+
+	return error_cnt == 0;
+}
+
+
+/**
+ * \brief Deleni vicecifernych cisel s krajnimi cislicemi, overuje
+ *  u = q * v + r a 0 <= r < v (vcetne odhadu podilu B - 1 a korekci).
+ */
+bool
+test_division_limbs()
+{
+	size_t   error_cnt = 0;
+	uint32_t w[ 40 ];
+	size_t   nu, nv, round;
+	BigNum   u, v, q, r;
+
+	srand( 1979 );
+
+	for ( round = 0 ; round < 5000 ; round++ )
+	{
+		nv = 1 + rand() % 12;
+		nu = nv + rand() % 16;
+
+		fill_random_limbs( w, nv );
+		v.FromBytes( reinterpret_cast< const char* >( w ), nv * sizeof( uint32_t ) );
+		fill_random_limbs( w, nu );
+		u.FromBytes( reinterpret_cast< const char* >( w ), nu * sizeof( uint32_t ) );
+
+		if ( v.IsZero() )
+			continue;
+
+		BigNum::Divide( u, v, q, r );
+		if ( BigNum( q * v ) + r != u || r >= v || r.IsNegative() )
+			error_cnt++;
+		if ( u % v != r )
+			error_cnt++;
+	}
+
+	cout << "Test deleni vicecifernych cisel dokoncen, pocet chyb: " << error_cnt << endl;
+
+	return error_cnt == 0;
+}
+
+
+/**
+ * \brief Porovna rekurzivni deleni a Karatsubovo nasobeni (s nahodne
+ *  nizkymi prahy) s algoritmem D a primym nasobenim.
+ */
+bool
+test_division_recursive()
+{
+	size_t   error_cnt  = 0;
+	size_t   karatsuba  = gKaratsubaThreshold;
+	size_t   karatsuba2 = gKaratsubaSqrThreshold;
+	size_t   divide     = gDivideThreshold;
+	size_t   nu, nv, round;
+	uint32_t w[ 1200 ];
+	BigNum   u, v, q1, r1, q2, r2, p1, p2, s1, s2;
+
+	srand( 1984 );
+
+	for ( round = 0 ; round < 300 ; round++ )
+	{
+		nv = 1 + rand() % 300;
+		nu = nv + rand() % 600;
+
+		fill_random_limbs( w, nv );
+		v.FromBytes( reinterpret_cast< const char* >( w ), nv * sizeof( uint32_t ) );
+		fill_random_limbs( w, nu );
+		u.FromBytes( reinterpret_cast< const char* >( w ), nu * sizeof( uint32_t ) );
+
+		if ( v.IsZero() )
+			continue;
+
+		// Algoritmus D a prime nasobeni
+		gKaratsubaThreshold    = ~static_cast< size_t >( 0 );
+		gKaratsubaSqrThreshold = ~static_cast< size_t >( 0 );
+		gDivideThreshold       = ~static_cast< size_t >( 0 );
+		BigNum::Divide( u, v, q1, r1 );
+		p1 = u * v;
+		s1 = v * v;
+
+		gKaratsubaThreshold    = 4 + rand() % 40;
+		gKaratsubaSqrThreshold = 4 + rand() % 40;
+		gDivideThreshold       = 4 + rand() % 40;
+		BigNum::Divide( u, v, q2, r2 );
+		p2 = u * v;
+		s2 = v * v;
+
+		if ( q1 != q2 || r1 != r2 || p1 != p2 || s1 != s2 )
+			error_cnt++;
+	}
+
+	gKaratsubaThreshold    = karatsuba;
+	gKaratsubaSqrThreshold = karatsuba2;
+	gDivideThreshold       = divide;
+
+	cout << "Test rekurzivniho deleni a Karatsubova nasobeni dokoncen, pocet chyb: "
+	     << error_cnt << endl;
+
+	return error_cnt == 0;
+}
+
+
 bool
 test_division(
 	uint32_t u_from, uint32_t u_to, uint32_t u_step,
@@ -471,12 +917,794 @@ test_modular_exponentiation_from_file( const string& filename, bool break_on_err
 }
 
 
+bool
+test_base64( bool break_on_error )
+{
+	const char* pChars = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+	size_t      error_cnt = 0;
+	size_t      size;
+
+	// Delky pokryvaji vektorove smycky i vsechny zbytky
+	for ( size = 0 ; size < 300 ; size++ )
+	{
+		string data, expected, encoded, decoded;
+		size_t i;
+
+		for ( i = 0 ; i < size ; i++ )
+			data += static_cast< char >( rand() );
+
+		// Referencni kodovani po jednotlivych bitech
+		uint32_t bits = 0;
+		size_t   count = 0;
+		for ( i = 0 ; i < size ; i++ )
+		{
+			bits = ( bits << 8 ) | static_cast< uint8_t >( data[ i ] );
+			count += 8;
+			while ( count >= 6 )
+			{
+				count -= 6;
+				expected += pChars[ ( bits >> count ) & 0x3F ];
+			}
+		}
+		if ( count )
+			expected += pChars[ ( bits << ( 6 - count ) ) & 0x3F ];
+		while ( expected.length() % 4 )
+			expected += '=';
+
+		char* pEncoded = Base64EncodeString( data.c_str(), size );
+		encoded = pEncoded;
+		delete[] pEncoded;
+
+		// Dekodovani po castech s konci radku
+		Base64Decoder decoder;
+		for ( i = 0 ; i < encoded.length() ; i += 7 )
+		{
+			decoder.Update( encoded.c_str() + i, min< size_t >( 7, encoded.length() - i ), decoded );
+			decoder.Update( "\n", 1, decoded );
+		}
+		decoder.Finish();
+
+		if ( encoded != expected || decoded != data )
+		{
+			cout << "Chyba pri delce " << size << endl;
+			error_cnt++;
+			if ( break_on_error )
+				break;
+		}
+	}
+
+	// Neplatne znaky se musi rozpoznat
+	uint8_t buffer[ 64 ];
+	if ( Base64Decode( "QUJDQUJDQUJDQUJDQUJDQUJDQUJD*UJDQUJDQUJDQUJDQUJD", 48, buffer ) != cBase64Invalid )
+		error_cnt++;
+
+	cout << "Test Base64 dokoncen, pocet chyb: " << error_cnt << endl;
+
+	if ( error_cnt )
+		return false;
+	return true;
+}
+
+
+bool
+test_key_store()
+{
+	size_t      error_cnt = 0;
+	char        dir[] = "/tmp/basictest_XXXXXX";
+	RsaKey      keys[ 3 ];
+	std::string paths[ 3 ];
+	size_t      i;
+
+	if ( mkdtemp( dir ) == NULL )
+	{
+		cout << "Nepodarilo se vytvorit docasny adresar" << endl;
+		return false;
+	}
+
+	for ( i = 0 ; i < 3 ; i++ )
+	{
+		paths[ i ] = std::string( dir ) + "/k" + char( '0' + i ) + ".key";
+		keys[ i ].GenerateKey( 512, BigNum( 65537 ) );
+		keys[ i ].SaveKeyToFile( paths[ i ].c_str() );
+	}
+
+	// Limit pameti staci na dva nactene klice
+	RsaKey loaded = keys[ 0 ];
+	loaded.Precompute();
+	size_t budget = loaded.GetMemorySize() * 5 / 2;
+
+	{
+		RsaKeyStore store( dir, budget, 16 );
+
+		if ( store.Scan() != 3 )
+			error_cnt++;
+
+		RsaKeyHandle h0 = store.Acquire( "k0" );
+		RsaKeyHandle h1 = store.Acquire( keys[ 0 ].GetFingerprint() );
+		if ( !h0.IsValid() || !h1.IsValid() || h0->GetN() != keys[ 0 ].GetN() || h1->GetN() != keys[ 0 ].GetN() )
+			error_cnt++;
+		if ( store.Acquire( "neni" ).IsValid() )
+			error_cnt++;
+
+		h0 = RsaKeyHandle();
+		h1 = RsaKeyHandle();
+
+		// Treti klic vyradi nejdele nepouzity k0
+		if ( !store.Acquire( "k1" ).IsValid() || !store.Acquire( "k2" ).IsValid() )
+			error_cnt++;
+		store.Collect();
+		store.Collect();
+		if ( store.GetMemoryUsage() > budget )
+			error_cnt++;
+
+		h0 = store.Acquire( "k0" );
+		if ( !h0.IsValid() || h0->GetN() != keys[ 0 ].GetN() )
+			error_cnt++;
+	}
+
+	{
+		// Pri plnem ulozisti se dalsi klic odmitne a uloziste funguje dal
+		RsaKeyStore store( dir, budget, 2 );
+		size_t      valid = 0;
+
+		if ( store.Scan() != 2 )
+			error_cnt++;
+		for ( i = 0 ; i < 3 ; i++ )
+			valid += store.Acquire( "k" + std::string( 1, char( '0' + i ) ) ).IsValid();
+		if ( valid != 2 || store.AddKey( "navic", keys[ 0 ] ) || store.GetKeyCount() != 2 )
+			error_cnt++;
+	}
+
+	for ( i = 0 ; i < 3 ; i++ )
+		unlink( paths[ i ].c_str() );
+	rmdir( dir );
+
+	cout << "Test uloziste klicu dokoncen, pocet chyb: " << error_cnt << endl;
+
+	return error_cnt == 0;
+}
+
+
+/**
+ * \brief Ulozi klic se zmenenym 32bitovym slovem na pozici pos a nacte ho.
+ *
+ * \return True pokud nacteni vyhodilo InvalidKeyException.
+ */
+static bool
+load_tampered_key( const string& rPath, string data, size_t pos, uint32_t value, RsaKey& rKey )
+{
+	memcpy( &data[ pos ], &value, sizeof( value ) );
+
+	ofstream ofs( rPath.c_str(), ios::binary | ios::trunc );
+	ofs.write( data.data(), data.length() );
+	ofs.close();
+
+	try
+	{
+		rKey.LoadKeyFromFile( rPath.c_str() );
+	}
+	catch ( InvalidKeyException& e )
+	{
+		return true;
+	}
+
+	return false;
+}
+
+
+bool
+test_binary_key()
+{
+	size_t error_cnt = 0;
+	string path = "/tmp/basictest_key.bin";
+	RsaKey key;
+	RsaKey loaded;
+
+	key.GenerateKey( 512, BigNum( 65537 ) );
+	key.SaveKeyToFile( path.c_str(), RSA_KEY_FORMAT_BINARY );
+
+	ifstream ifs( path.c_str(), ios::binary );
+	string   data( ( istreambuf_iterator< char >( ifs ) ), istreambuf_iterator< char >() );
+	uint32_t word;
+
+	if ( !loaded.LoadKeyFromFile( path.c_str() ) || loaded.GetN() != key.GetN() || !loaded.HasMontgomery() )
+		error_cnt++;
+
+	// Hlavicka: keySize na 16, nInv na 24, pole (offset, pocet cislic)
+	// od 32, N je prvni a R^2 mod N devate pole
+	memcpy( &word, &data[ 16 ], sizeof( word ) );
+	if ( !load_tampered_key( path, data, 16, word + 8, loaded ) )
+		error_cnt++;
+	if ( !load_tampered_key( path, data, 16, 16, loaded ) )
+		error_cnt++;
+
+	memcpy( &word, &data[ 24 ], sizeof( word ) );
+	if ( !load_tampered_key( path, data, 24, word ^ 2, loaded ) )
+		error_cnt++;
+
+	size_t offset;
+	memcpy( &word, &data[ 32 ], sizeof( word ) );
+	offset = word;
+	memcpy( &word, &data[ offset ], sizeof( word ) );
+	if ( !load_tampered_key( path, data, offset, word ^ 1, loaded ) )
+		error_cnt++;
+
+	// Chybnou konstantu R^2 mod N staci spocitat znovu
+	memcpy( &word, &data[ 32 + 8 * 8 ], sizeof( word ) );
+	offset = word;
+	memcpy( &word, &data[ offset ], sizeof( word ) );
+	if ( load_tampered_key( path, data, offset, word ^ 1, loaded ) || loaded.GetRR() != BigNum::MontgomeryRR( key.GetN() ) )
+		error_cnt++;
+
+	unlink( path.c_str() );
+
+	cout << "Test binarniho klice dokoncen, pocet chyb: " << error_cnt << endl;
+
+	return error_cnt == 0;
+}
+
+
+/**
+ * \brief Vraci size nahodnych bytu.
+ */
+static string
+random_data( size_t size )
+{
+	string data( size, '\0' );
+
+	for ( size_t i = 0 ; i < size ; i++ )
+		data[ i ] = static_cast< char >( rand() );
+
+	return data;
+}
+
+
+/**
+ * \brief Zasifruje data proudem, vstup predava po castech o velikosti step.
+ */
+static string
+encrypt_data( const RsaKey& rKey, const string& rData, RsaFileFormat format,
+              bool armor, size_t step )
+{
+	string           output;
+	RsaStringSink    sink( output );
+	RsaEncryptStream stream( rKey, sink, format, armor );
+
+	for ( size_t i = 0 ; i < rData.size() ; i += step )
+		stream.Update( rData.data() + i, min( step, rData.size() - i ) );
+	stream.Finish();
+
+	return output;
+}
+
+
+/**
+ * \brief Desifruje data proudem, vstup predava po castech o velikosti step.
+ *
+ * \return false, pokud desifrovani vyhodilo vyjimku.
+ */
+static bool
+decrypt_data( const RsaKey& rKey, const string& rData, size_t step, string& rOutput )
+{
+	rOutput.clear();
+
+	try
+	{
+		RsaStringSink    sink( rOutput );
+		RsaDecryptStream stream( rKey, sink );
+
+		for ( size_t i = 0 ; i < rData.size() ; i += step )
+			stream.Update( rData.data() + i, min( step, rData.size() - i ) );
+		stream.Finish();
+	}
+	catch ( Exception& )
+	{
+		return false;
+	}
+
+	return true;
+}
+
+
+/**
+ * \brief Zasifruje a desifruje data vsech zadanych velikosti.
+ *
+ * \return Pocet chyb.
+ */
+static size_t
+round_trip( const RsaKey& rKey, RsaFileFormat format, bool armor,
+            const size_t* pSizes, size_t count )
+{
+	static const size_t steps[] = { 1, 7, 4096, 1 << 30 };
+	size_t error_cnt = 0;
+	string output;
+
+	for ( size_t i = 0 ; i < count ; i++ )
+	{
+		string data = random_data( pSizes[ i ] );
+
+		for ( size_t j = 0 ; j < sizeof( steps ) / sizeof( steps[ 0 ] ) ; j++ )
+		{
+			// Po bytu jen male vstupy, jinak by test trval zbytecne dlouho
+			if ( steps[ j ] == 1 && data.size() > 4096 )
+				continue;
+
+			string encrypted = encrypt_data( rKey, data, format, armor, steps[ j ] );
+
+			if ( !decrypt_data( rKey, encrypted, steps[ j ], output ) || output != data )
+			{
+				cout << "Chyba: velikost " << data.size() << ", po " << steps[ j ] << " bytech" << endl;
+				error_cnt++;
+			}
+		}
+	}
+
+	return error_cnt;
+}
+
+
+/**
+ * \brief Pri desifrovani poskozenych dat musi byt vyhozena vyjimka.
+ *
+ * \return Pocet chyb (0 nebo 1).
+ */
+static size_t
+expect_decrypt_error( const RsaKey& rKey, const string& rData )
+{
+	string output;
+
+	return decrypt_data( rKey, rData, 1 << 30, output ) ? 1 : 0;
+}
+
+
+bool
+test_stream()
+{
+	size_t error_cnt = 0;
+	RsaKey key;
+
+	srand( 2006 );
+	key.GenerateKey( 512, BigNum( 65537 ) );
+
+	// Do bloku se vejde keyByteSize - 2 bytu dat
+	const size_t keyByteSize = key.GetKeySize() / 8;
+	const size_t ib          = keyByteSize - 2;
+	const size_t sizes[]     = { 0, 1, ib - 1, ib, ib + 1, 2 * ib, 10 * ib + 3, 100000 };
+
+	error_cnt += round_trip( key, RSA_FILE_FORMAT_BLOCKS, false, sizes, sizeof( sizes ) / sizeof( sizes[ 0 ] ) );
+
+	string data      = random_data( 3 * ib );
+	string encrypted = encrypt_data( key, data, RSA_FILE_FORMAT_BLOCKS, false, 1 << 30 );
+	string output;
+
+	if ( encrypted.size() != 3 * keyByteSize )
+		error_cnt++;
+
+	// Zkraceni uprostred bloku se pozna (zkraceni o cele bloky format
+	// poznat neumi, delka dat neni nikde ulozena)
+	error_cnt += expect_decrypt_error( key, encrypted.substr( 0, encrypted.size() - 1 ) );
+	error_cnt += expect_decrypt_error( key, encrypted.substr( 0, keyByteSize / 2 ) );
+
+	// Blok, ktery neni mensi nez modul, nemohl vzniknout sifrovanim
+	// (N + 1 by se jinak desifroval na m = 1, tj. jeden nulovy byte)
+	string corrupted = encrypted;
+	BigNumToString( key.GetN() + BigNum( 1 ), &corrupted[ keyByteSize ], keyByteSize );
+	error_cnt += expect_decrypt_error( key, corrupted );
+
+	// Soubor ve formatu puvodni verze programu: bloky m ^ e mod n, kde
+	// m = [delka][data], little-endian doplnene nulami na keyByteSize
+	string baseline;
+	size_t i;
+	for ( i = 0 ; i < data.size() ; i += ib )
+	{
+		string block( 1, static_cast< char >( min( ib, data.size() - i ) ) );
+		block += data.substr( i, ib );
+
+		BigNum c = BigNum::ModularExponentiation( StringToBigNum( block.data(), block.size() ),
+		                                          key.GetE(), key.GetN() );
+
+		block.assign( keyByteSize, '\0' );
+		BigNumToString( c, &block[ 0 ], keyByteSize );
+		baseline += block;
+	}
+
+	if ( !decrypt_data( key, baseline, 1 << 30, output ) || output != data )
+		error_cnt++;
+
+	// A stejne tak pres soubory
+	string baselineFile = "/tmp/basictest_baseline.enc";
+	string outputFile   = "/tmp/basictest_baseline.dec";
+	{
+		ofstream ofs( baselineFile.c_str(), ios::binary );
+		ofs.write( baseline.data(), baseline.size() );
+	}
+
+	Rsa rsa( key );
+	rsa.DecryptFileToFile( baselineFile.c_str(), outputFile.c_str() );
+
+	ifstream ifs( outputFile.c_str(), ios::binary );
+	if ( string( ( istreambuf_iterator< char >( ifs ) ), istreambuf_iterator< char >() ) != data )
+		error_cnt++;
+
+	unlink( baselineFile.c_str() );
+	unlink( outputFile.c_str() );
+
+	cout << "Test proudoveho sifrovani dokoncen, pocet chyb: " << error_cnt << endl;
+
+	return error_cnt == 0;
+}
+
+
+bool
+test_envelope()
+{
+	size_t error_cnt = 0;
+	RsaKey key;
+
+	srand( 2006 );
+	key.GenerateKey( 512, BigNum( 65537 ) );
+
+	// Data obalky se sifruji po kusech o 64 KiB
+	const size_t keyByteSize = key.GetKeySize() / 8;
+	const size_t chunk       = 64 * 1024;
+	const size_t sizes[]     = { 0, 1, 63, chunk - 1, chunk, chunk + 1, 3 * chunk + 5 };
+
+	error_cnt += round_trip( key, RSA_FILE_FORMAT_ENVELOPE, false, sizes, sizeof( sizes ) / sizeof( sizes[ 0 ] ) );
+
+	// Hlavicka (24 bytu), jeden RSA blok s klicem ChaCha20 a data
+	const size_t headerSize = 24 + keyByteSize;
+	string       data       = random_data( 1000 );
+	string       encrypted  = encrypt_data( key, data, RSA_FILE_FORMAT_ENVELOPE, false, 1 << 30 );
+
+	if ( encrypted.size() != headerSize + data.size() )
+		error_cnt++;
+
+	// Zkraceni v hlavicce nebo v bloku s klicem se pozna (zkraceni dat
+	// ne, obalka nema MAC ani ulozenou delku dat)
+	error_cnt += expect_decrypt_error( key, encrypted.substr( 0, 10 ) );
+	error_cnt += expect_decrypt_error( key, encrypted.substr( 0, 24 ) );
+	error_cnt += expect_decrypt_error( key, encrypted.substr( 0, headerSize - 1 ) );
+
+	// Poskozena verze, sifra, pocet bloku s klicem a blok s klicem
+	const size_t offsets[] = { 8, 9, 10 };
+	for ( size_t i = 0 ; i < sizeof( offsets ) / sizeof( offsets[ 0 ] ) ; i++ )
+	{
+		string corrupted = encrypted;
+		corrupted[ offsets[ i ] ] ^= 0x40;
+		error_cnt += expect_decrypt_error( key, corrupted );
+	}
+
+	string corrupted = encrypted;
+	BigNumToString( key.GetN() + BigNum( 1 ), &corrupted[ 24 ], keyByteSize );
+	error_cnt += expect_decrypt_error( key, corrupted );
+
+	cout << "Test obalky dokoncen, pocet chyb: " << error_cnt << endl;
+
+	return error_cnt == 0;
+}
+
+
+bool
+test_armor()
+{
+	size_t error_cnt = 0;
+	RsaKey key;
+	size_t i;
+
+	srand( 2006 );
+	key.GenerateKey( 512, BigNum( 65537 ) );
+
+	// Radek Base64 nese 36 bytu: bloky (64 bytu) koncici na konci radku
+	// a obalky (88 bytu + data) se vsemi zbytky po deleni 36
+	const size_t keyByteSize = key.GetKeySize() / 8;
+	const size_t ib          = keyByteSize - 2;
+	const size_t blockSizes[] = { 0, 1, ib, 9 * ib, 9 * ib + 1 };
+	size_t       envelopeSizes[ 40 ];
+
+	for ( i = 0 ; i < 40 ; i++ )
+		envelopeSizes[ i ] = i;
+
+	error_cnt += round_trip( key, RSA_FILE_FORMAT_BLOCKS, true, blockSizes, sizeof( blockSizes ) / sizeof( blockSizes[ 0 ] ) );
+	error_cnt += round_trip( key, RSA_FILE_FORMAT_ENVELOPE, true, envelopeSizes, 40 );
+
+	// Hlavicka a radky nejvyse cBase64LineLength znaku
+	string data      = random_data( 1000 );
+	string encrypted = encrypt_data( key, data, RSA_FILE_FORMAT_ENVELOPE, true, 1 << 30 );
+	string header    = "-- PMZ_RSA MESSAGE --\n";
+
+	if ( encrypted.compare( 0, header.size(), header ) != 0 )
+		error_cnt++;
+
+	size_t start = header.size();
+	while ( start < encrypted.size() )
+	{
+		size_t end = encrypted.find( '\n', start );
+		if ( end == string::npos || end - start > cBase64LineLength )
+		{
+			error_cnt++;
+			break;
+		}
+		start = end + 1;
+	}
+
+	// Zkracena hlavicka, zkracena data v Base64 a neplatny znak
+	size_t last = encrypted.find_last_not_of( "\n=" );
+
+	error_cnt += expect_decrypt_error( key, encrypted.substr( 0, 12 ) );
+	error_cnt += expect_decrypt_error( key, encrypted.substr( 0, header.size() + 5 ) );
+	error_cnt += expect_decrypt_error( key, encrypted.substr( 0, last ) );
+
+	string corrupted = encrypted;
+	corrupted[ header.size() + 100 ] = '*';
+	error_cnt += expect_decrypt_error( key, corrupted );
+
+	cout << "Test textove podoby dokoncen, pocet chyb: " << error_cnt << endl;
+
+	return error_cnt == 0;
+}
+
+
+bool
+test_scheduler()
+{
+	size_t error_cnt = 0;
+	RsaKey keys[ 2 ];
+
+	keys[ 0 ].GenerateKey( 512, BigNum( 65537 ) );
+	keys[ 1 ].GenerateKey( 768, BigNum( 65537 ) );
+
+	// Bloky na stridacku dvema klici, vysledky z davek musi odpovidat
+	// primemu desifrovani
+	const size_t        count = 100;
+	vector< string >    blocks( count );
+	vector< string >    expected( count );
+	vector< RsaFuture > futures( count );
+	size_t              i;
+
+	for ( i = 0 ; i < count ; i++ )
+	{
+		Rsa    rsa( keys[ i % 2 ] );
+		string message = "blok " + BigNum( i ).ToHexString();
+
+		blocks[ i ].resize( rsa.GetBlockSize() );
+		rsa.EncryptBlockInto( message.data(), message.size(), &blocks[ i ][ 0 ], blocks[ i ].size() );
+
+		expected[ i ].resize( rsa.GetBlockSize() );
+		rsa.DecryptBlockInto( blocks[ i ].data(), blocks[ i ].size(), &expected[ i ][ 0 ], expected[ i ].size() );
+		expected[ i ].erase( expected[ i ].find_last_not_of( '\0' ) + 1 );
+	}
+
+	{
+		RsaScheduler scheduler( 8, 1000, 5000, 2 );
+
+		for ( i = 0 ; i < count ; i++ )
+			futures[ i ] = scheduler.SubmitDecrypt( keys[ i % 2 ], blocks[ i ].data(), blocks[ i ].size() );
+
+		for ( i = 0 ; i < count ; i++ )
+		{
+			if ( futures[ i ].Get() != expected[ i ] )
+				error_cnt++;
+		}
+
+		// Verejnym klicem desifrovat nelze
+		RsaKey publicKey( keys[ 0 ] );
+		publicKey.SetKeyType( RSA_KEY_PUBLIC );
+		try
+		{
+			scheduler.SubmitDecrypt( publicKey, blocks[ 0 ].data(), blocks[ 0 ].size() );
+			error_cnt++;
+		}
+		catch ( Exception& )
+		{
+		}
+	}
+
+	// Pozadavky zadane tesne pred zrusenim planovace se jeste zpracuji
+	{
+		RsaScheduler scheduler( 32, 5000, 5000, 1 );
+
+		for ( i = 0 ; i < 10 ; i++ )
+			futures[ i ] = scheduler.SubmitDecrypt( keys[ i % 2 ], blocks[ i ].data(), blocks[ i ].size() );
+	}
+	for ( i = 0 ; i < 10 ; i++ )
+	{
+		if ( !futures[ i ].IsReady() || futures[ i ].Get() != expected[ i ] )
+			error_cnt++;
+	}
+
+	cout << "Test planovace dokoncen, pocet chyb: " << error_cnt << endl;
+
+	return error_cnt == 0;
+}
+
+
+static void*
+run_server( void* pServer )
+{
+	static_cast< RsaServer* >( pServer )->Run();
+	return NULL;
+}
+
+
+/**
+ * \brief Posle ramec pozadavku serveru.
+ */
+static void
+send_request( int fd, uint8_t operation, uint32_t requestId, const string& rData )
+{
+	string   frame;
+	uint32_t length = cRsaFrameHeaderSize - 4 + 1 + rData.size();
+
+	frame.append( reinterpret_cast< const char* >( &length ), 4 );
+	frame += static_cast< char >( operation );
+	frame += static_cast< char >( 1 );
+	frame.append( 2, '\0' );
+	frame.append( reinterpret_cast< const char* >( &requestId ), 4 );
+	frame += 'k';
+	frame += rData;
+
+	size_t pos = 0;
+	while ( pos < frame.size() )
+	{
+		ssize_t n = write( fd, frame.data() + pos, frame.size() - pos );
+		if ( n <= 0 )
+			return;
+		pos += n;
+	}
+}
+
+
+/**
+ * \brief Precte count odpovedi (data podle id pozadavku).
+ *
+ * \return Pocet odpovedi se stavem RSA_STATUS_OK.
+ */
+static size_t
+read_responses( int fd, size_t count, map< uint32_t, string >& rResponses )
+{
+	string input;
+	size_t ok = 0;
+	char   buffer[ 4096 ];
+
+	while ( count > 0 )
+	{
+		struct pollfd pfd = { fd, POLLIN, 0 };
+		if ( poll( &pfd, 1, 10000 ) <= 0 )
+			break;
+
+		ssize_t n = read( fd, buffer, sizeof( buffer ) );
+		if ( n <= 0 )
+			break;
+		input.append( buffer, n );
+
+		uint32_t length;
+		while ( count > 0 && input.size() >= 4 )
+		{
+			memcpy( &length, input.data(), 4 );
+			if ( input.size() < 4 + length )
+				break;
+
+			uint32_t requestId;
+			memcpy( &requestId, input.data() + 8, 4 );
+			if ( input[ 4 ] == RSA_STATUS_OK )
+				ok++;
+			rResponses[ requestId ] = input.substr( cRsaFrameHeaderSize, 4 + length - cRsaFrameHeaderSize );
+			input.erase( 0, 4 + length );
+			count--;
+		}
+	}
+
+	return ok;
+}
+
+
+bool
+test_server()
+{
+	size_t      error_cnt = 0;
+	RsaKey      key;
+	RsaKeyStore store( "/nonexistent" );
+
+	key.GenerateKey( 512, BigNum( 65537 ) );
+	store.AddKey( "k", key );
+
+	RsaServer server( store, 2 );
+	int       fds[ 2 ];
+	pthread_t thread;
+
+	if ( socketpair( AF_UNIX, SOCK_STREAM, 0, fds ) != 0 )
+		return false;
+	server.Attach( fds[ 1 ] );
+	pthread_create( &thread, NULL, run_server, &server );
+
+	// Vice pozadavku nez cRsaMaxPending, server musi cteni pozastavit
+	// a po vyrizeni casti fronty zase obnovit
+	const size_t               count = cRsaMaxPending * 3;
+	map< uint32_t, string >    encrypted;
+	map< uint32_t, string >    decrypted;
+	uint32_t                   i;
+
+	for ( i = 0 ; i < count ; i++ )
+		send_request( fds[ 0 ], RSA_OP_ENCRYPT, i, "blok " + BigNum( i ).ToHexString() );
+	if ( read_responses( fds[ 0 ], count, encrypted ) != count )
+		error_cnt++;
+
+	for ( i = 0 ; i < count ; i++ )
+		send_request( fds[ 0 ], RSA_OP_DECRYPT, i, encrypted[ i ] );
+	if ( read_responses( fds[ 0 ], count, decrypted ) != count )
+		error_cnt++;
+
+	for ( i = 0 ; i < count ; i++ )
+	{
+		if ( decrypted[ i ] != "blok " + BigNum( i ).ToHexString() )
+		{
+			error_cnt++;
+			break;
+		}
+	}
+
+	// Neznamy klic
+	map< uint32_t, string > unknown;
+	send_request( fds[ 0 ], 7, 1, "x" );
+	if ( read_responses( fds[ 0 ], 1, unknown ) != 0 || unknown.size() != 1 )
+		error_cnt++;
+
+	// Po ukonceni odesilani server spojeni zavre
+	char c;
+	shutdown( fds[ 0 ], SHUT_WR );
+	struct pollfd pfd = { fds[ 0 ], POLLIN, 0 };
+	if ( poll( &pfd, 1, 10000 ) <= 0 || read( fds[ 0 ], &c, 1 ) != 0 )
+		error_cnt++;
+
+	server.Stop();
+	pthread_join( thread, NULL );
+	close( fds[ 0 ] );
+
+	cout << "Test serveru dokoncen, pocet chyb: " << error_cnt << endl;
+
+	return error_cnt == 0;
+}
+
+
 int
 main( int argc, char** argv )
 {
 	bool failed;
 	int  ret = 0;
 	test_get_size();
+	if ( !test_number_buffer() )
+		ret = 1;
+	if ( !test_scalar() )
+		ret = 1;
+	if ( !test_bytes() )
+		ret = 1;
+	if ( !test_product() )
+		ret = 1;
+	if ( !test_kernels() )
+		ret = 1;
+	if ( !test_division_limbs() )
+		ret = 1;
+	if ( !test_division_recursive() )
+		ret = 1;
+	if ( !test_key_store() )
+		ret = 1;
+	if ( !test_binary_key() )
+		ret = 1;
+	if ( !test_stream() )
+		ret = 1;
+	if ( !test_envelope() )
+		ret = 1;
+	if ( !test_armor() )
+		ret = 1;
+	if ( !test_scheduler() )
+		ret = 1;
+	if ( !test_server() )
+		ret = 1;
+
+	cout << endl << "- test_base64() -------------------------------------" << endl;
+	if ( !test_base64( false ) )
+		ret = 1;
+	cout << "=====================================================" << endl << endl;
 
 	//test_modular_exponentiation_from_file( "ModularExponentiationTest_512bits", false );
 	test_multiplication_from_file( "MultiplyTest_2048bits", false );